@@ -62,7 +62,8 @@ AABB AABB::Encapsulate(const AABB& a, const AABB& b) {
 
 bool AABB::Raycast(const Ray& ray, RaycastHit* const hitInfo,
                    float maxDistance) {
-  float tmin = -INFINITY, tmax = maxDistance > 0 ? maxDistance : INFINITY;
+  float tmin = -INFINITY, tmax = INFINITY;
+  if (maxDistance <= 0) maxDistance = INFINITY;
   Math::Vector3 e = extents;
   Math::Vector3 o = ray.GetOrigin() - center;
   Math::Vector3 d = ray.GetDirection();
@@ -79,7 +80,7 @@ bool AABB::Raycast(const Ray& ray, RaycastHit* const hitInfo,
   tmax =
       Math::Util::Min({Math::Util::Max(t[0], t[1]), Math::Util::Max(t[2], t[3]),
                        Math::Util::Max(t[4], t[5])});
-  if (tmax < 0 || tmin > tmax) return false;
+  if (tmax < 0 || tmin > tmax || tmin > maxDistance) return false;
   if (tmin < 0) tmin = tmax;
 
   // TODO(Jacob) normal
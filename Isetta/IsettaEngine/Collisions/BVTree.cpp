@@ -3,20 +3,130 @@
  */
 #include "BVTree.h"
 
+#include <algorithm>
 #include <queue>
+#include <vector>
 #include "Collisions/RaycastHit.h"
 #include "Core/Config/Config.h"
 #include "Core/DataStructures/Array.h"
 #include "Core/Debug/Assert.h"
 #include "Core/Debug/DebugDraw.h"
 #include "Core/Geometry/Ray.h"
+#include "Core/Memory/MemoryManager.h"
 #include "Scene/Entity.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 namespace Isetta {
+namespace {
+/// Surface area of the box around a and b, without building that box
+float UnionSurfaceArea(const AABB &a, const AABB &b) {
+  const Math::Vector3 aMin = a.GetMin(), aMax = a.GetMax();
+  const Math::Vector3 bMin = b.GetMin(), bMax = b.GetMax();
+  Math::Vector3 size;
+  for (int i = 0; i < 3; ++i) {
+    size[i] = Math::Util::Max(aMax[i], bMax[i]) -
+              Math::Util::Min(aMin[i], bMin[i]);
+  }
+  return 2 * (size.x * size.y + size.y * size.z + size.x * size.z);
+}
+
+/// Lightweight min/max box used while building, starts out empty
+struct Bounds {
+  Math::Vector3 min{INFINITY, INFINITY, INFINITY};
+  Math::Vector3 max{-INFINITY, -INFINITY, -INFINITY};
+
+  void Grow(const Math::Vector3 &point) {
+    for (int i = 0; i < 3; ++i) {
+      min[i] = Math::Util::Min(min[i], point[i]);
+      max[i] = Math::Util::Max(max[i], point[i]);
+    }
+  }
+  void Grow(const Bounds &other) {
+    Grow(other.min);
+    Grow(other.max);
+  }
+  float SurfaceArea() const {
+    if (min.x > max.x) return 0;
+    const Math::Vector3 size = max - min;
+    return 2 * (size.x * size.y + size.y * size.z + size.x * size.z);
+  }
+};
+
+/// Distance the ray enters the box at, 0 if it starts inside and INFINITY if
+/// it misses or only reaches the box past maxDistance
+float RayEnterDistance(const AABB &aabb, const Math::Vector3 &origin,
+                       const Math::Vector3 &invDir, const float maxDistance) {
+  const Math::Vector3 min = aabb.GetMin(), max = aabb.GetMax();
+  float tmin = 0, tmax = maxDistance;
+  for (int i = 0; i < 3; ++i) {
+    const float t1 = (min[i] - origin[i]) * invDir[i];
+    const float t2 = (max[i] - origin[i]) * invDir[i];
+    tmin = Math::Util::Max(tmin, Math::Util::Min(t1, t2));
+    tmax = Math::Util::Min(tmax, Math::Util::Max(t1, t2));
+  }
+  return tmin <= tmax ? tmin : INFINITY;
+}
+
+Math::Vector3 InverseDirection(const Ray &ray) {
+  const Math::Vector3 direction = ray.GetDirection();
+  return Math::Vector3{1 / direction.x, 1 / direction.y, 1 / direction.z};
+}
+
+/**
+ * Write the lanes set in mask to order, nearest entry distance first
+ * \return Number of lanes written
+ */
+int SortLanes(const float tEnter[4], const int mask, int order[4]) {
+  int count = 0;
+  for (int i = 0; i < 4; ++i) {
+    if ((mask & (1 << i)) == 0) continue;
+    int j = count++;
+    for (; j > 0 && tEnter[order[j - 1]] > tEnter[i]; --j) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+  }
+  return count;
+}
+
+CollisionUtil::CollisionPair *AllocPairsOnSingleFrame(const Size count) {
+  return static_cast<CollisionUtil::CollisionPair *>(
+      MemoryManager::AllocOnSingleFrame(
+          count * sizeof(CollisionUtil::CollisionPair)));
+}
+
+/// Traversal stack of a flat query. Kept on the call stack unless the tree is
+/// too deep for inlineSize entries, then it falls back to the heap
+template <typename T, int inlineSize>
+class FlatStack {
+ public:
+  explicit FlatStack(const int capacity) : capacity{capacity} {
+    if (capacity > inlineSize) {
+      heapItems.resize(capacity);
+      items = heapItems.data();
+    }
+  }
+
+  void Push(const T& item) {
+    ASSERT(size < capacity);
+    items[size++] = item;
+  }
+  T Pop() { return items[--size]; }
+  bool IsEmpty() const { return size == 0; }
+
+ private:
+  T inlineItems[inlineSize];
+  std::vector<T> heapItems;
+  T* items{inlineItems};
+  int capacity;
+  int size{0};
+};
+}  // namespace
+
 void BVTree::Node::UpdateBranchAABB() {
   ASSERT(collider == nullptr && !IsLeaf());
   aabb = AABB::Encapsulate(left->aabb, right->aabb);
+  isStatic = left->isStatic && right->isStatic;
 }
 
 void BVTree::Node::UpdateLeafAABB() {
@@ -41,8 +151,10 @@ BVTree::BVTree()
 
 void BVTree::AddCollider(Collider *const collider) {
   Node *newNode = nodePool.Get(collider);
+  newNode->isStatic = collider->entity->isStatic;
   colNodeMap.insert({collider, newNode});
   AddNode(newNode);
+  ++reinsertCount;
 }
 
 void BVTree::RemoveCollider(Collider *const collider) {
@@ -50,28 +162,36 @@ void BVTree::RemoveCollider(Collider *const collider) {
   ASSERT(it != colNodeMap.end());
   RemoveNode(it->second, true);
   colNodeMap.erase(it);
+
+  if (collider->isMoved) {
+    auto moved =
+        std::find(movedColliders.begin(), movedColliders.end(), collider);
+    *moved = movedColliders.back();
+    movedColliders.pop_back();
+    collider->isMoved = false;
+  }
+}
+
+void BVTree::MarkMoved(Collider *const collider) {
+  // a disabled collider is refit when it's added again
+  if (collider->isMoved || colNodeMap.count(collider) == 0) return;
+  collider->isMoved = true;
+  movedColliders.push_back(collider);
 }
 
 void BVTree::Update() {
   BROFILER_CATEGORY("BVTree Update", Profiler::Color::Coral);
   Array<Node *> toReInsert;
 
-  std::queue<Node *> q;
-  if (root != nullptr) {
-    q.push(root);
-  }
-
-  while (!q.empty()) {
-    Node *cur = q.front();
-    q.pop();
-
-    if (cur->left != nullptr) q.push(cur->left);
-    if (cur->right != nullptr) q.push(cur->right);
-
-    if (cur->IsLeaf() && !cur->IsInFatAABB()) {
-      toReInsert.PushBack(cur);
+  // Only colliders whose transform changed can have left their fat AABB
+  for (Collider *collider : movedColliders) {
+    collider->isMoved = false;
+    Node *node = colNodeMap.at(collider);
+    if (!node->IsInFatAABB()) {
+      toReInsert.PushBack(node);
     }
   }
+  movedColliders.clear();
 
   for (auto node : toReInsert) {
     RemoveNode(node, false);
@@ -82,6 +202,14 @@ void BVTree::Update() {
     AddNode(node);
   }
 
+  reinsertCount += toReInsert.Size();
+  CheckQuality();
+  // Flattened here rather than by the first query, so concurrent queries
+  // only ever read it
+  if (CONFIG_VAL(collisionConfig.bvTreeFlatQueries)) {
+    UpdateFlatTree();
+  }
+
 #if _EDITOR
   DebugDraw();
 #endif
@@ -89,16 +217,22 @@ void BVTree::Update() {
 
 bool BVTree::Raycast(const Ray &ray, RaycastHit *const hitInfo,
                      const float maxDistance) const {
+  if (UseFlatTree()) {
+    return FlatRaycast(ray, hitInfo, maxDistance);
+  }
   return Raycast(root, ray, hitInfo, maxDistance);
 }
 bool BVTree::Raycast(Node *const node, const Ray &ray,
                      RaycastHit *const hitInfo, const float maxDistance) const {
-  if (node == nullptr || !node->aabb.Raycast(ray, nullptr, maxDistance)) {
+  if (node == nullptr) {
     return false;
   }
+  // Nothing past the closest hit so far can be the nearest one
+  const float rayLength = Math::Util::Min(
+      maxDistance > 0 ? maxDistance : INFINITY, hitInfo->GetDistance());
   if (node->IsLeaf()) {
     RaycastHit hitTmp{};
-    if (node->collider->Raycast(ray, &hitTmp, maxDistance) &&
+    if (node->collider->Raycast(ray, &hitTmp, rayLength) &&
         hitTmp.GetDistance() < hitInfo->GetDistance()) {
       *hitInfo = std::move(hitTmp);
       return true;
@@ -107,15 +241,62 @@ bool BVTree::Raycast(Node *const node, const Ray &ray,
     return false;
   }
 
-  return Raycast(node->left, ray, hitInfo, maxDistance) ||
-         Raycast(node->right, ray, hitInfo, maxDistance);
+  // Visit the child the ray enters first, its hits cull the other one
+  const Math::Vector3 origin = ray.GetOrigin();
+  const Math::Vector3 invDir = InverseDirection(ray);
+  Node *nearChild = node->left, *farChild = node->right;
+  float nearEnter =
+      RayEnterDistance(nearChild->aabb, origin, invDir, rayLength);
+  float farEnter = RayEnterDistance(farChild->aabb, origin, invDir, rayLength);
+  if (farEnter < nearEnter) {
+    std::swap(nearChild, farChild);
+    std::swap(nearEnter, farEnter);
+  }
+
+  bool hit = false;
+  if (nearEnter < INFINITY) {
+    hit = Raycast(nearChild, ray, hitInfo, maxDistance);
+  }
+  if (farEnter < INFINITY && farEnter <= hitInfo->GetDistance()) {
+    hit = Raycast(farChild, ray, hitInfo, maxDistance) || hit;
+  }
+  return hit;
 }
 
 Array<RaycastHit> BVTree::RaycastAll(const Ray &ray, float maxDistance) const {
   Array<RaycastHit> hits;
-  RaycastAll(root, &hits, ray, maxDistance);
+  if (UseFlatTree()) {
+    FlatRaycastAll(&hits, ray, maxDistance);
+  } else {
+    RaycastAll(root, &hits, ray, maxDistance);
+  }
   return hits;
 }
+Size BVTree::RaycastBatch(const Ray *const rays, const Size count,
+                          RaycastHit *const hitInfos,
+                          const float maxDistance) const {
+  for (Size i = 0; i < count; ++i) {
+    hitInfos[i] = RaycastHit{};
+  }
+
+  Size hitCount = 0;
+  if (!UseFlatTree()) {
+    for (Size i = 0; i < count; ++i) {
+      hitCount += Raycast(root, rays[i], &hitInfos[i], maxDistance);
+    }
+    return hitCount;
+  }
+
+  if (flatNodes.empty()) {
+    return 0;
+  }
+  for (Size i = 0; i < count; i += packetSize) {
+    const int packet = static_cast<int>(
+        std::min<Size>(packetSize, count - i));
+    hitCount += RaycastPacket(rays + i, packet, hitInfos + i, maxDistance);
+  }
+  return hitCount;
+}
 void BVTree::RaycastAll(Node *const node, Array<RaycastHit> *hits, const Ray &ray,
                                      float maxDistance) const {
   if (node == nullptr || !node->aabb.Raycast(ray, nullptr, maxDistance)) {
@@ -134,41 +315,330 @@ void BVTree::RaycastAll(Node *const node, Array<RaycastHit> *hits, const Ray &ra
   RaycastAll(node->right, hits, ray, maxDistance);
 }
 
-const CollisionUtil::ColliderPairSet &BVTree::GetCollisionPairs() {
+bool BVTree::UseFlatTree() const {
+  return CONFIG_VAL(collisionConfig.bvTreeFlatQueries) && !flatTreeDirty;
+}
+
+void BVTree::UpdateFlatTree() {
+  if (!flatTreeDirty) {
+    return;
+  }
   PROFILE
-  colliderPairSet.clear();
+  flatTreeDirty = false;
+  flatNodes.clear();
+  flatColliders.clear();
+  flatStackCapacity = 0;
+  if (root == nullptr) {
+    return;
+  }
 
-  for (const auto &pair : colNodeMap) {
-    if (pair.first->entity->isStatic) continue;
+  flatNodes.reserve(colNodeMap.size() / 2 + 1);
+  flatColliders.reserve(colNodeMap.size());
+  BuildFlatNode(root, 1);
+}
 
-    Collider *collider = pair.first;
-    AABB aabb = collider->GetFatAABB();
-    std::queue<Node *> q;
+int BVTree::BuildFlatNode(const Node *const node, const int depth) {
+  // Collapse the binary tree by splitting the largest branch among the
+  // children until there are four of them or only leaves are left
+  const Node *children[4];
+  int count = 0;
+  if (node->IsLeaf()) {
+    children[count++] = node;
+  } else {
+    children[count++] = node->left;
+    children[count++] = node->right;
+    while (count < 4) {
+      int largest = -1;
+      float largestArea = -1;
+      for (int i = 0; i < count; ++i) {
+        if (children[i]->IsLeaf()) continue;
+        const float area = children[i]->aabb.SurfaceArea();
+        if (area > largestArea) {
+          largest = i;
+          largestArea = area;
+        }
+      }
+      if (largest < 0) break;
 
-    if (root != nullptr) {
-      q.push(root);
+      const Node *split = children[largest];
+      children[largest] = split->left;
+      children[count++] = split->right;
     }
+  }
 
-    while (!q.empty()) {
-      Node *curNode = q.front();
-      q.pop();
+  // Each node popped pushes at most 4 children, so a query never holds more
+  // than 3 entries per level plus the one being expanded
+  flatStackCapacity = std::max(flatStackCapacity, 3 * depth + 1);
 
-      if (curNode->IsLeaf()) {
-        if (collider != curNode->collider) {
-          colliderPairSet.insert({collider, curNode->collider});
-        }
-      } else {
-        if (curNode->left->aabb.Intersect(aabb)) {
-          q.push(curNode->left);
-        }
-        if (curNode->right->aabb.Intersect(aabb)) {
-          q.push(curNode->right);
+  const int index = static_cast<int>(flatNodes.size());
+  flatNodes.emplace_back();
+  // flatNodes can reallocate while children are built, so index every time
+  flatNodes[index].childCount = count;
+  for (int i = 0; i < 4; ++i) {
+    FlatNode &flatNode = flatNodes[index];
+    if (i >= count) {
+      flatNode.minX[i] = flatNode.minY[i] = flatNode.minZ[i] = 0;
+      flatNode.maxX[i] = flatNode.maxY[i] = flatNode.maxZ[i] = 0;
+      flatNode.child[i] = 0;
+      continue;
+    }
+
+    const Math::Vector3 min = children[i]->aabb.GetMin();
+    const Math::Vector3 max = children[i]->aabb.GetMax();
+    flatNode.minX[i] = min.x;
+    flatNode.minY[i] = min.y;
+    flatNode.minZ[i] = min.z;
+    flatNode.maxX[i] = max.x;
+    flatNode.maxY[i] = max.y;
+    flatNode.maxZ[i] = max.z;
+    if (children[i]->IsLeaf()) {
+      flatNode.child[i] = ~static_cast<int>(flatColliders.size());
+      flatColliders.push_back(children[i]->collider);
+    } else {
+      const int child = BuildFlatNode(children[i], depth + 1);
+      flatNodes[index].child[i] = child;
+    }
+  }
+  return index;
+}
+
+int BVTree::RaycastLanes(const FlatNode &node, const Math::Vector3 &origin,
+                         const Math::Vector3 &invDir, const float maxDistance,
+                         float tEnter[4]) {
+  // Slab test written lane by lane over the per axis arrays, no branches
+  // until the mask is built
+  int mask = 0;
+  for (int i = 0; i < node.childCount; ++i) {
+    const float tx1 = (node.minX[i] - origin.x) * invDir.x;
+    const float tx2 = (node.maxX[i] - origin.x) * invDir.x;
+    const float ty1 = (node.minY[i] - origin.y) * invDir.y;
+    const float ty2 = (node.maxY[i] - origin.y) * invDir.y;
+    const float tz1 = (node.minZ[i] - origin.z) * invDir.z;
+    const float tz2 = (node.maxZ[i] - origin.z) * invDir.z;
+    const float tmin = std::max({std::min(tx1, tx2), std::min(ty1, ty2),
+                                 std::min(tz1, tz2), 0.f});
+    const float tmax = std::min({std::max(tx1, tx2), std::max(ty1, ty2),
+                                 std::max(tz1, tz2), maxDistance});
+    tEnter[i] = tmin;
+    mask |= static_cast<int>(tmin <= tmax) << i;
+  }
+  return mask;
+}
+
+int BVTree::IntersectLanes(const FlatNode &node, const Math::Vector3 &min,
+                           const Math::Vector3 &max) {
+  int mask = 0;
+  for (int i = 0; i < node.childCount; ++i) {
+    const bool overlap = node.minX[i] <= max.x && node.maxX[i] >= min.x &&
+                         node.minY[i] <= max.y && node.maxY[i] >= min.y &&
+                         node.minZ[i] <= max.z && node.maxZ[i] >= min.z;
+    mask |= static_cast<int>(overlap) << i;
+  }
+  return mask;
+}
+
+bool BVTree::FlatRaycast(const Ray &ray, RaycastHit *const hitInfo,
+                         const float maxDistance) const {
+  if (flatNodes.empty()) {
+    return false;
+  }
+
+  const Math::Vector3 origin = ray.GetOrigin();
+  const Math::Vector3 invDir = InverseDirection(ray);
+  float closest = maxDistance > 0 ? maxDistance : INFINITY;
+
+  // Nodes are pushed far to near with the distance the ray enters them at, so
+  // the nearest is visited first and anything behind the closest hit is
+  // skipped once it's popped
+  bool hit = false;
+  FlatStack<std::pair<int, float>, flatStackSize> stack{flatStackCapacity};
+  stack.Push({0, 0.f});
+  while (!stack.IsEmpty()) {
+    const auto [index, enter] = stack.Pop();
+    if (enter > closest) continue;
+
+    const FlatNode &node = flatNodes[index];
+    float tEnter[4];
+    const int mask = RaycastLanes(node, origin, invDir, closest, tEnter);
+    int order[4];
+    const int count = SortLanes(tEnter, mask, order);
+    for (int i = count - 1; i >= 0; --i) {
+      const int child = node.child[order[i]];
+      if (child >= 0) {
+        stack.Push({child, tEnter[order[i]]});
+      }
+    }
+    for (int i = 0; i < count; ++i) {
+      const int child = node.child[order[i]];
+      if (child >= 0 || tEnter[order[i]] > closest) continue;
+
+      RaycastHit hitTmp{};
+      if (flatColliders[~child]->Raycast(ray, &hitTmp, closest) &&
+          hitTmp.GetDistance() < hitInfo->GetDistance()) {
+        *hitInfo = std::move(hitTmp);
+        closest = Math::Util::Min(closest, hitInfo->GetDistance());
+        hit = true;
+      }
+    }
+  }
+  return hit;
+}
+
+int BVTree::RaycastPacket(const Ray *const rays, const int count,
+                          RaycastHit *const hitInfos,
+                          const float maxDistance) const {
+  ASSERT(count > 0 && count <= packetSize);
+  Math::Vector3 origins[packetSize], invDirs[packetSize];
+  float closest[packetSize];
+  for (int r = 0; r < count; ++r) {
+    origins[r] = rays[r].GetOrigin();
+    invDirs[r] = InverseDirection(rays[r]);
+    closest[r] = maxDistance > 0 ? maxDistance : INFINITY;
+  }
+
+  // Each entry carries the rays still inside the node, a node is visited once
+  // for the whole packet and only the rays that reached it are tested
+  int hitMask = 0;
+  FlatStack<std::pair<int, int>, flatStackSize> stack{flatStackCapacity};
+  stack.Push({0, (1 << count) - 1});
+  while (!stack.IsEmpty()) {
+    const auto [index, rayMask] = stack.Pop();
+    const FlatNode &node = flatNodes[index];
+
+    int laneRays[4]{};
+    float laneEnter[4]{INFINITY, INFINITY, INFINITY, INFINITY};
+    for (int r = 0; r < count; ++r) {
+      if ((rayMask & (1 << r)) == 0) continue;
+      float tEnter[4];
+      const int mask =
+          RaycastLanes(node, origins[r], invDirs[r], closest[r], tEnter);
+      for (int i = 0; i < node.childCount; ++i) {
+        if ((mask & (1 << i)) == 0) continue;
+        laneRays[i] |= 1 << r;
+        laneEnter[i] = Math::Util::Min(laneEnter[i], tEnter[i]);
+      }
+    }
+
+    int lanes = 0;
+    for (int i = 0; i < node.childCount; ++i) {
+      lanes |= static_cast<int>(laneRays[i] != 0) << i;
+    }
+    int order[4];
+    const int laneCount = SortLanes(laneEnter, lanes, order);
+    for (int i = laneCount - 1; i >= 0; --i) {
+      const int child = node.child[order[i]];
+      if (child >= 0) {
+        stack.Push({child, laneRays[order[i]]});
+      }
+    }
+    for (int i = 0; i < laneCount; ++i) {
+      const int child = node.child[order[i]];
+      if (child >= 0) continue;
+      for (int r = 0; r < count; ++r) {
+        if ((laneRays[order[i]] & (1 << r)) == 0) continue;
+        RaycastHit hitTmp{};
+        if (flatColliders[~child]->Raycast(rays[r], &hitTmp, closest[r]) &&
+            hitTmp.GetDistance() < hitInfos[r].GetDistance()) {
+          hitInfos[r] = std::move(hitTmp);
+          closest[r] = Math::Util::Min(closest[r], hitInfos[r].GetDistance());
+          hitMask |= 1 << r;
         }
       }
     }
   }
 
-  return colliderPairSet;
+  int hitCount = 0;
+  for (int r = 0; r < count; ++r) hitCount += (hitMask >> r) & 1;
+  return hitCount;
+}
+
+void BVTree::FlatRaycastAll(Array<RaycastHit> *const hits, const Ray &ray,
+                            const float maxDistance) const {
+  if (flatNodes.empty()) {
+    return;
+  }
+
+  const Math::Vector3 origin = ray.GetOrigin();
+  const Math::Vector3 invDir = InverseDirection(ray);
+  const float rayLength = maxDistance > 0 ? maxDistance : INFINITY;
+
+  FlatStack<int, flatStackSize> stack{flatStackCapacity};
+  stack.Push(0);
+  while (!stack.IsEmpty()) {
+    const FlatNode &node = flatNodes[stack.Pop()];
+    float tEnter[4];
+    const int mask = RaycastLanes(node, origin, invDir, rayLength, tEnter);
+    for (int i = 0; i < node.childCount; ++i) {
+      if ((mask & (1 << i)) == 0) continue;
+      const int child = node.child[i];
+      if (child >= 0) {
+        stack.Push(child);
+        continue;
+      }
+
+      RaycastHit hitTmp{};
+      if (flatColliders[~child]->Raycast(ray, &hitTmp, maxDistance)) {
+        hits->PushBack(std::move(hitTmp));
+      }
+    }
+  }
+}
+
+CollisionUtil::ColliderPairBuffer BVTree::GetCollisionPairs() {
+  PROFILE
+  CollisionUtil::ColliderPairBuffer buffer;
+  if (root == nullptr) {
+    lastPairCount = 0;
+    return buffer;
+  }
+
+  // sized from last frame so it rarely has to grow
+  Size capacity = std::max<Size>(2 * lastPairCount, 64);
+  buffer.pairs = AllocPairsOnSingleFrame(capacity);
+
+  pairStack.clear();
+  pairStack.emplace_back(root, root);
+  while (!pairStack.empty()) {
+    const auto [a, b] = pairStack.back();
+    pairStack.pop_back();
+
+    if (a == b) {
+      if (!a->IsLeaf() && !a->isStatic) {
+        pairStack.emplace_back(a->left, a->left);
+        pairStack.emplace_back(a->right, a->right);
+        pairStack.emplace_back(a->left, a->right);
+      }
+      continue;
+    }
+
+    if ((a->isStatic && b->isStatic) || !a->aabb.Intersect(b->aabb)) {
+      continue;
+    }
+
+    if (a->IsLeaf() && b->IsLeaf()) {
+      if (buffer.count == capacity) {
+        // the old block stays on the single frame allocator until frame end
+        CollisionUtil::CollisionPair *pairs =
+            AllocPairsOnSingleFrame(2 * capacity);
+        std::copy(buffer.begin(), buffer.end(), pairs);
+        buffer.pairs = pairs;
+        capacity *= 2;
+      }
+      buffer.pairs[buffer.count++] = {a->collider, b->collider};
+    } else if (b->IsLeaf() ||
+               (!a->IsLeaf() &&
+                a->aabb.SurfaceArea() >= b->aabb.SurfaceArea())) {
+      // descend into the bigger box to keep the pairs tight
+      pairStack.emplace_back(a->left, b);
+      pairStack.emplace_back(a->right, b);
+    } else {
+      pairStack.emplace_back(a, b->left);
+      pairStack.emplace_back(a, b->right);
+    }
+  }
+
+  lastPairCount = buffer.count;
+  return buffer;
 }
 
 Array<Collider *> BVTree::GetPossibleColliders(Collider *collider) const {
@@ -176,6 +646,30 @@ Array<Collider *> BVTree::GetPossibleColliders(Collider *collider) const {
   Array<Collider *> ret;
 
   AABB aabb = collider->GetFatAABB();
+  if (UseFlatTree()) {
+    if (flatNodes.empty()) {
+      return ret;
+    }
+
+    const Math::Vector3 min = aabb.GetMin(), max = aabb.GetMax();
+    FlatStack<int, flatStackSize> stack{flatStackCapacity};
+    stack.Push(0);
+    while (!stack.IsEmpty()) {
+      const FlatNode &node = flatNodes[stack.Pop()];
+      const int mask = IntersectLanes(node, min, max);
+      for (int i = 0; i < node.childCount; ++i) {
+        if ((mask & (1 << i)) == 0) continue;
+        const int child = node.child[i];
+        if (child >= 0) {
+          stack.Push(child);
+        } else if (flatColliders[~child] != collider) {
+          ret.PushBack(flatColliders[~child]);
+        }
+      }
+    }
+    return ret;
+  }
+
   std::queue<Node *> q;
 
   if (root != nullptr) {
@@ -204,61 +698,37 @@ Array<Collider *> BVTree::GetPossibleColliders(Collider *collider) const {
 
 void BVTree::AddNode(Node *const newNode) {
   PROFILE
-  AABB newAABB = newNode->aabb;
-
+  flatTreeDirty = true;
   if (root == nullptr) {
     root = newNode;
     root->parent = nullptr;
-  } else {
-    Node *cur = root;
-
-    while (!cur->IsLeaf()) {
-      float leftIncrease =
-          AABB::Encapsulate(cur->left->aabb, newAABB).SurfaceArea() -
-          cur->left->aabb.SurfaceArea();
-
-      float rightIncrease =
-          AABB::Encapsulate(cur->right->aabb, newAABB).SurfaceArea() -
-          cur->right->aabb.SurfaceArea();
-
-      if (leftIncrease > rightIncrease) {
-        cur = cur->right;
-      } else {
-        cur = cur->left;
-      }
-    }
+    return;
+  }
 
-    if (cur == root) {
-      // cur is root
-      root = nodePool.Get(AABB::Encapsulate(cur->aabb, newAABB));
-      cur->parent = root;
-      newNode->parent = root;
-      root->left = cur;
-      root->right = newNode;
-    } else {
-      // cur is actual leaf, convert cur to branch
-      Node *newBranch =
-          nodePool.Get(AABB::Encapsulate(cur->aabb, newNode->aabb));
-      newBranch->parent = cur->parent;
-      cur->parent->SwapOutChild(cur, newBranch);
-      cur->parent = newBranch;
-      newNode->parent = newBranch;
-      newBranch->left = cur;
-      newBranch->right = newNode;
-
-      Node *parent = newBranch->parent;
+  Node *sibling = FindBestSibling(newNode->aabb);
+  Node *oldParent = sibling->parent;
+  Node *newBranch =
+      nodePool.Get(AABB::Encapsulate(sibling->aabb, newNode->aabb));
+  newBranch->isStatic = sibling->isStatic && newNode->isStatic;
 
-      while (parent != nullptr) {
-        parent->UpdateBranchAABB();
-        parent = parent->parent;
-      }
-    }
+  if (oldParent == nullptr) {
+    root = newBranch;
+  } else {
+    oldParent->SwapOutChild(sibling, newBranch);
   }
+  newBranch->parent = oldParent;
+  sibling->parent = newBranch;
+  newNode->parent = newBranch;
+  newBranch->left = sibling;
+  newBranch->right = newNode;
+
+  RefitAncestors(oldParent);
 }
 
 void BVTree::RemoveNode(Node *const node, const bool deleteNode) {
   PROFILE
   ASSERT(node->IsLeaf());
+  flatTreeDirty = true;
 
   if (node == root) {
     root = nullptr;
@@ -288,12 +758,7 @@ void BVTree::RemoveNode(Node *const node, const bool deleteNode) {
     }
 
     nodePool.Free(parent);
-
-    Node *cur = grandParent;
-    while (cur != nullptr) {
-      cur->UpdateBranchAABB();
-      cur = cur->parent;
-    }
+    RefitAncestors(grandParent);
   }
 
   if (deleteNode) {
@@ -301,6 +766,272 @@ void BVTree::RemoveNode(Node *const node, const bool deleteNode) {
   }
 }
 
+BVTree::Node *BVTree::FindBestSibling(const AABB &aabb) {
+  // Branch and bound over the cost of pairing aabb with a node: the surface
+  // area of the new branch plus how much every ancestor grows (inherited).
+  // Nothing below a node can cost less than inherited + area of aabb, so the
+  // heap is ordered by inherited cost and the search stops once that bound
+  // can't beat the best found so far
+  const float area = aabb.SurfaceArea();
+  auto greater = [](const std::pair<float, Node *> &a,
+                    const std::pair<float, Node *> &b) {
+    return a.first > b.first;
+  };
+
+  Node *best = root;
+  float bestCost = UnionSurfaceArea(root->aabb, aabb);
+  siblingCandidates.clear();
+  siblingCandidates.emplace_back(0.f, root);
+
+  while (!siblingCandidates.empty()) {
+    std::pop_heap(siblingCandidates.begin(), siblingCandidates.end(), greater);
+    const auto [inheritedCost, node] = siblingCandidates.back();
+    siblingCandidates.pop_back();
+
+    if (inheritedCost + area >= bestCost) {
+      break;
+    }
+
+    const float directCost = UnionSurfaceArea(node->aabb, aabb);
+    const float cost = directCost + inheritedCost;
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = node;
+    }
+
+    if (node->IsLeaf()) {
+      continue;
+    }
+
+    const float childInheritedCost =
+        inheritedCost + directCost - node->aabb.SurfaceArea();
+    if (childInheritedCost + area < bestCost) {
+      siblingCandidates.emplace_back(childInheritedCost, node->left);
+      std::push_heap(siblingCandidates.begin(), siblingCandidates.end(),
+                     greater);
+      siblingCandidates.emplace_back(childInheritedCost, node->right);
+      std::push_heap(siblingCandidates.begin(), siblingCandidates.end(),
+                     greater);
+    }
+  }
+
+  return best;
+}
+
+void BVTree::RefitAncestors(Node *node) {
+  const bool rotate = CONFIG_VAL(collisionConfig.bvTreeRotations);
+  while (node != nullptr) {
+    node->UpdateBranchAABB();
+    if (rotate) {
+      Rotate(node);
+    }
+    node = node->parent;
+  }
+}
+
+void BVTree::Rotate(Node *const node) {
+  Node *const left = node->left;
+  Node *const right = node->right;
+  if (left->IsLeaf() && right->IsLeaf()) {
+    return;
+  }
+
+  // Moving child down into other in place of grandChild leaves other around
+  // child and keep. node's own box doesn't change, only other's does
+  Node *bestChild = nullptr;
+  Node *bestGrandChild = nullptr;
+  float bestDiff = 0;
+  auto consider = [&](Node *child, Node *other, Node *grandChild, Node *keep) {
+    const float diff =
+        UnionSurfaceArea(child->aabb, keep->aabb) - other->aabb.SurfaceArea();
+    if (diff < bestDiff) {
+      bestDiff = diff;
+      bestChild = child;
+      bestGrandChild = grandChild;
+    }
+  };
+
+  if (!right->IsLeaf()) {
+    consider(left, right, right->left, right->right);
+    consider(left, right, right->right, right->left);
+  }
+  if (!left->IsLeaf()) {
+    consider(right, left, left->left, left->right);
+    consider(right, left, left->right, left->left);
+  }
+
+  if (bestChild == nullptr) {
+    return;
+  }
+
+  Node *other = bestGrandChild->parent;
+  other->SwapOutChild(bestGrandChild, bestChild);
+  node->SwapOutChild(bestChild, bestGrandChild);
+  other->UpdateBranchAABB();
+}
+
+void BVTree::Rebuild() {
+  PROFILE
+  if (root == nullptr) {
+    return;
+  }
+
+  std::vector<Node *> leaves;
+  leaves.reserve(colNodeMap.size());
+  std::vector<Node *> stack{root};
+  while (!stack.empty()) {
+    Node *cur = stack.back();
+    stack.pop_back();
+    if (cur->IsLeaf()) {
+      leaves.push_back(cur);
+    } else {
+      stack.push_back(cur->left);
+      stack.push_back(cur->right);
+      nodePool.Free(cur);
+    }
+  }
+
+  root = BuildTopDown(leaves.data(), leaves.size());
+  root->parent = nullptr;
+  flatTreeDirty = true;
+  rebuildCost = GetStats().sahCost;
+  reinsertCount = 0;
+}
+
+BVTree::Node *BVTree::BuildTopDown(Node **const leaves, const Size count) {
+  if (count == 1) {
+    return leaves[0];
+  }
+
+  Bounds centroidBounds;
+  for (Size i = 0; i < count; ++i) {
+    centroidBounds.Grow(leaves[i]->aabb.GetCenter());
+  }
+  const Math::Vector3 extent = centroidBounds.max - centroidBounds.min;
+  int axis = 0;
+  if (extent.y > extent[axis]) axis = 1;
+  if (extent.z > extent[axis]) axis = 2;
+
+  // bin leaves by centroid along the widest axis and split where
+  // area * count summed over both sides is lowest
+  Size splitCount = 0;
+  if (extent[axis] > 0) {
+    const int binCount = 16;
+    const float binScale = binCount / extent[axis];
+    auto getBin = [&](const Node *leaf) {
+      const int bin = static_cast<int>(
+          (leaf->aabb.GetCenter()[axis] - centroidBounds.min[axis]) *
+          binScale);
+      return std::min(bin, binCount - 1);
+    };
+
+    Bounds binBounds[binCount];
+    Size binCounts[binCount]{};
+    for (Size i = 0; i < count; ++i) {
+      const int bin = getBin(leaves[i]);
+      ++binCounts[bin];
+      binBounds[bin].Grow(leaves[i]->aabb.GetMin());
+      binBounds[bin].Grow(leaves[i]->aabb.GetMax());
+    }
+
+    float rightCosts[binCount]{};
+    Bounds sideBounds;
+    Size sideCount = 0;
+    for (int i = binCount - 1; i > 0; --i) {
+      sideBounds.Grow(binBounds[i]);
+      sideCount += binCounts[i];
+      rightCosts[i] = sideBounds.SurfaceArea() * sideCount;
+    }
+
+    sideBounds = Bounds{};
+    sideCount = 0;
+    float bestCost = INFINITY;
+    int bestSplit = -1;
+    for (int i = 0; i < binCount - 1; ++i) {
+      sideBounds.Grow(binBounds[i]);
+      sideCount += binCounts[i];
+      if (sideCount == 0 || sideCount == count) continue;
+      const float cost =
+          sideBounds.SurfaceArea() * sideCount + rightCosts[i + 1];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestSplit = i;
+      }
+    }
+
+    if (bestSplit >= 0) {
+      Node **mid = std::partition(
+          leaves, leaves + count,
+          [&](const Node *leaf) { return getBin(leaf) <= bestSplit; });
+      splitCount = mid - leaves;
+    }
+  }
+
+  if (splitCount == 0) {
+    // all centroids in one bin, fall back to a median split
+    splitCount = count / 2;
+    std::nth_element(leaves, leaves + splitCount, leaves + count,
+                     [axis](const Node *a, const Node *b) {
+                       return a->aabb.GetCenter()[axis] <
+                              b->aabb.GetCenter()[axis];
+                     });
+  }
+
+  Node *left = BuildTopDown(leaves, splitCount);
+  Node *right = BuildTopDown(leaves + splitCount, count - splitCount);
+  Node *branch = nodePool.Get(AABB::Encapsulate(left->aabb, right->aabb));
+  branch->isStatic = left->isStatic && right->isStatic;
+  branch->left = left;
+  branch->right = right;
+  left->parent = branch;
+  right->parent = branch;
+  return branch;
+}
+
+void BVTree::CheckQuality() {
+  // only measure once a good share of the leaves moved since the last check,
+  // so the O(n) walk is amortized over the reinserts
+  const float ratio = CONFIG_VAL(collisionConfig.bvTreeRebuildRatio);
+  if (ratio <= 0 || reinsertCount == 0 ||
+      reinsertCount < colNodeMap.size() / 2) {
+    return;
+  }
+
+  reinsertCount = 0;
+  if (rebuildCost == 0 || GetStats().sahCost > ratio * rebuildCost) {
+    Rebuild();
+  }
+}
+
+BVTreeStats BVTree::GetStats() const {
+  BVTreeStats stats;
+  if (root == nullptr) {
+    return stats;
+  }
+
+  float branchArea = 0;
+  Size depthSum = 0;
+  std::vector<std::pair<Node *, int>> stack{{root, 0}};
+  while (!stack.empty()) {
+    const auto [cur, depth] = stack.back();
+    stack.pop_back();
+    if (cur->IsLeaf()) {
+      ++stats.leafCount;
+      depthSum += depth;
+      stats.maxDepth = std::max(stats.maxDepth, depth);
+    } else {
+      branchArea += cur->aabb.SurfaceArea();
+      stack.emplace_back(cur->left, depth + 1);
+      stack.emplace_back(cur->right, depth + 1);
+    }
+  }
+
+  stats.averageDepth = static_cast<float>(depthSum) / stats.leafCount;
+  const float rootArea = root->aabb.SurfaceArea();
+  stats.sahCost = rootArea > 0 ? branchArea / rootArea : 0;
+  return stats;
+}
+
 void BVTree::DebugDraw() const {
   if (!Config::Instance().drawConfig.bvtDrawAABBs.GetVal()) {
     return;
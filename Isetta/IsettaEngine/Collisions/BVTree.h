@@ -4,6 +4,8 @@
 #pragma once
 #include <set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "AABB.h"
 #include "Collider.h"
 #include "CollisionUtil.h"
@@ -14,6 +16,18 @@ class Ray;
 }
 
 namespace Isetta {
+/**
+ * \brief Shape of a BVTree, used to judge how well balanced it is
+ */
+struct BVTreeStats {
+  int leafCount{};
+  int maxDepth{};
+  float averageDepth{};
+  /// Sum of the surface areas of all branches over the root's. Proportional
+  /// to the expected cost of a query, lower is better
+  float sahCost{};
+};
+
 class BVTree {
  private:
   // BVNode serves two purposes: leaf and branch
@@ -22,6 +36,7 @@ class BVTree {
     explicit Node(class Collider* const collider)
         : collider(collider), aabb(collider->GetFatAABB()) {}
 
+    /// Also refreshes isStatic from the children
     void UpdateBranchAABB();
     void UpdateLeafAABB();
     void SwapOutChild(Node* oldChild, Node* newChild);
@@ -31,24 +46,55 @@ class BVTree {
 
     class Collider* collider{nullptr};
     AABB aabb;
+    /// Leaf: the collider's entity is static. Branch: every leaf below is
+    bool isStatic{false};
 
     Node* parent{nullptr};
     Node* left{nullptr};
     Node* right{nullptr};
   };
 
+  /**
+   * \brief Node of the flattened tree that queries run on. Up to four
+   * children are stored per node with their boxes split per axis, so one loop
+   * tests a ray or box against all of them. A child >= 0 is the index of
+   * another flat node, otherwise ~child indexes flatColliders
+   */
+  struct FlatNode {
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    int child[4];
+    int childCount;
+  };
+  /// Entries a flat query keeps on the call stack, deeper trees fall back to
+  /// the heap
+  static const int flatStackSize = 256;
+  /// Rays traced together by RaycastBatch
+  static const int packetSize = 4;
+
   BVTree();
   friend class CollisionsModule;
   friend class CollisionSolverModule;
   friend class FreeListAllocator;
+  friend class BVTreeTest;
 
  public:
   ~BVTree() = default;
 
   void AddCollider(class Collider* collider);
   void RemoveCollider(class Collider* collider);
+  /**
+   * \brief Queue a collider whose transform changed, the next Update refits
+   * it. Colliders that were not queued are not looked at by Update
+   */
+  void MarkMoved(class Collider* collider);
   void Update();
 
+  /**
+   * \brief Find the closest hit along the ray. Children are visited in the
+   * order the ray enters them and the ray is shortened to every hit found, so
+   * boxes behind the closest hit are never opened
+   */
   bool Raycast(const Ray& ray, class RaycastHit* hitInfo,
                float maxDistance) const;
   bool Raycast(Node* node, const Ray& ray, class RaycastHit* hitInfo,
@@ -56,19 +102,103 @@ class BVTree {
   Array<RaycastHit> RaycastAll(const Ray& ray, float maxDistance) const;
   void RaycastAll(Node* node, Array<RaycastHit>* hits, const Ray& ray,
                                float maxDistance) const;
+  /**
+   * \brief Find the closest hit of many rays, tracing them through the tree
+   * in packets of packetSize so each node is fetched once per packet
+   * \param hitInfos One per ray, misses are left without a collider
+   * \return Number of rays that hit something
+   */
+  Size RaycastBatch(const Ray* rays, Size count, class RaycastHit* hitInfos,
+                    float maxDistance) const;
 
-  const CollisionUtil::ColliderPairSet& GetCollisionPairs();
+  /**
+   * \brief Find every pair of leaves whose fat AABBs overlap, each pair once,
+   * in a single descent of the tree against itself. Subtrees that only hold
+   * static colliders are never tested against each other
+   */
+  CollisionUtil::ColliderPairBuffer GetCollisionPairs();
   Array<Collider*> GetPossibleColliders(class Collider* collider) const;
 
+  /**
+   * \brief Throw away all branches and build the tree again top down with a
+   * binned surface area heuristic. Done automatically when the tree's SAH cost
+   * grows past bv_tree_rebuild_ratio times the cost of the last rebuild
+   */
+  void Rebuild();
+  BVTreeStats GetStats() const;
+
  private:
   void AddNode(Node* newNode);
   void RemoveNode(Node* node, bool deleteNode);
+  /**
+   * \brief Branch and bound search for the node whose pairing with aabb adds
+   * the least surface area to the tree, counting the growth of its ancestors
+   */
+  Node* FindBestSibling(const AABB& aabb);
+  /// Refit branches from node up to the root, rotating each if it helps
+  void RefitAncestors(Node* node);
+  /**
+   * \brief Swap a child of node with one of its grandchildren on the other
+   * side if that shrinks the surface area of the other child
+   */
+  void Rotate(Node* node);
+  /// Build a subtree out of leaves, reordering them along the way
+  Node* BuildTopDown(Node** leaves, Size count);
+  /// Rebuild if the tree got too much worse than the last rebuild
+  void CheckQuality();
+  /// Whether queries can run on the flat tree. Until the next Update flattens
+  /// the tree again, changes to it are only seen by the linked traversal
+  bool UseFlatTree() const;
+  /// Flatten the tree again if it changed since the last Update
+  void UpdateFlatTree();
+  /// Append the flat node for node, pulling up grandchildren to fill it
+  int BuildFlatNode(const Node* node, int depth);
+  /**
+   * \brief Test a ray against the children of a flat node
+   * \param invDir 1 / ray direction, per axis
+   * \param tEnter Receives the distance the ray enters each child at
+   * \return Bit mask of the children hit closer than maxDistance
+   */
+  static int RaycastLanes(const FlatNode& node, const Math::Vector3& origin,
+                          const Math::Vector3& invDir, float maxDistance,
+                          float tEnter[4]);
+  /// Bit mask of the children of a flat node that overlap the box
+  static int IntersectLanes(const FlatNode& node, const Math::Vector3& min,
+                            const Math::Vector3& max);
+  bool FlatRaycast(const Ray& ray, class RaycastHit* hitInfo,
+                   float maxDistance) const;
+  void FlatRaycastAll(Array<RaycastHit>* hits, const Ray& ray,
+                      float maxDistance) const;
+  /// Trace up to packetSize rays together, returns how many hit
+  int RaycastPacket(const Ray* rays, int count, class RaycastHit* hitInfos,
+                    float maxDistance) const;
   void DebugDraw() const;
 
-  CollisionUtil::ColliderPairSet colliderPairSet;
   std::unordered_map<class Collider*, Node*> colNodeMap;
   Node* root = nullptr;
   TemplatePoolAllocator<Node> nodePool;
+  /// Colliders queued by MarkMoved since the last Update
+  std::vector<class Collider*> movedColliders;
+
+  /// Node pairs left to test, reused by GetCollisionPairs. A node paired with
+  /// itself means its subtree still has to be tested against itself
+  std::vector<std::pair<Node*, Node*>> pairStack;
+  /// Pairs found last frame, used to size this frame's buffer
+  Size lastPairCount{0};
+  /// Min heap of (lower bound cost, node) reused by FindBestSibling
+  std::vector<std::pair<float, Node*>> siblingCandidates;
+  /// SAH cost right after the last rebuild, 0 if it was never rebuilt
+  float rebuildCost{0};
+  /// Leaves reinserted since the quality was last checked
+  Size reinsertCount{0};
+
+  /// Flattened copy of the tree, flatNodes[0] is the root. Rebuilt by Update
+  /// after the tree changed, queries never write it
+  std::vector<FlatNode> flatNodes;
+  std::vector<class Collider*> flatColliders;
+  bool flatTreeDirty{true};
+  /// Most entries a traversal of the flat tree can hold at once
+  int flatStackCapacity{0};
 #if _EDITOR
   // std::set<class Collider*> collisionSet;
 #endif
@@ -14,13 +14,14 @@ void Update() override;
 protected:
 ColliderType GetType() const final { return ColliderType::BOX; }
 
-public:
 /**
  * @brief size of box before transform scale
  *
  */
 Math::Vector3 size;
 
+public:
+
 /**
  * @brief Construct a new Box Collider object
  *
@@ -53,6 +54,16 @@ BoxCollider(bool trigger, const Math::Vector3& center,
 bool Raycast(const class Ray& ray, RaycastHit* const hitInfo,
              float maxDistance = 0) final;
 
+const Math::Vector3& GetSize() const { return size; }
+/**
+ * @brief Set the size, the collision tree refits the collider on its next
+ * update
+ */
+void SetSize(const Math::Vector3& newSize) {
+  size = newSize;
+  OnShapeChanged();
+}
+
 /**
  * @brief Get the World Size
  *
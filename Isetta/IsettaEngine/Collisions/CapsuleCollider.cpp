@@ -61,28 +61,23 @@ float CapsuleCollider::GetWorldCapsule(Math::Matrix4* rotation,
                                        Math::Matrix4* scale) const {
   Math::Matrix4& rot = *rotation;
   rot = (Math::Matrix4)transform->GetWorldRot();
+  const Math::Vector3 worldScale = transform->GetWorldScale();
   float max;
   switch (direction) {
     case Direction::X_AXIS:
       rot *= Math::Matrix4::zRot90;
       // rot = rot * Math::Matrix4::zRot90;
-      max = Math::Util::Max(transform->GetWorldScale().y,
-                            transform->GetWorldScale().z);
-      *scale = Math::Matrix4::Scale(
-          Math::Vector3{transform->GetWorldScale().x, max, max});
+      max = Math::Util::Max(worldScale.y, worldScale.z);
+      *scale = Math::Matrix4::Scale(Math::Vector3{worldScale.x, max, max});
       break;
     case Direction::Y_AXIS:
-      max = Math::Util::Max(transform->GetWorldScale().x,
-                            transform->GetWorldScale().z);
-      *scale = Math::Matrix4::Scale(
-          Math::Vector3{max, transform->GetWorldScale().y, max});
+      max = Math::Util::Max(worldScale.x, worldScale.z);
+      *scale = Math::Matrix4::Scale(Math::Vector3{max, worldScale.y, max});
       break;
     case Direction::Z_AXIS:
       *rotation *= Math::Matrix4::xRot90;
-      max = Math::Util::Max(transform->GetWorldScale().x,
-                            transform->GetWorldScale().y);
-      *scale = Math::Matrix4::Scale(
-          Math::Vector3{max, max, transform->GetWorldScale().z});
+      max = Math::Util::Max(worldScale.x, worldScale.y);
+      *scale = Math::Matrix4::Scale(Math::Vector3{max, max, worldScale.z});
       break;
   }
   return max;
@@ -24,6 +24,7 @@ ColliderType GetType() const final { return Collider::ColliderType::CAPSULE; }
 public:
 enum class Direction { X_AXIS, Y_AXIS, Z_AXIS };
 
+protected:
 /**
  * @brief radius before scaled by transform
  * @brief height before scaled by transform
@@ -37,6 +38,8 @@ float radius, height;
  */
 Direction direction;
 
+public:
+
 /**
  * @brief Construct a new Capsule Collider object
  *
@@ -98,6 +101,26 @@ float GetWorldCapsule(Math::Matrix4* rotation, Math::Matrix4* scale) const;
 bool Raycast(const Ray& ray, RaycastHit* const hitInfo,
              float maxDistance = 0) final;
 
+float GetRadius() const { return radius; }
+float GetHeight() const { return height; }
+Direction GetDirection() const { return direction; }
+/**
+ * @brief Setters of the capsule's shape, the collision tree refits the
+ * collider on its next update
+ */
+void SetRadius(const float newRadius) {
+  radius = newRadius;
+  OnShapeChanged();
+}
+void SetHeight(const float newHeight) {
+  height = newHeight;
+  OnShapeChanged();
+}
+void SetDirection(const Direction newDirection) {
+  direction = newDirection;
+  OnShapeChanged();
+}
+
 /**
  * @brief Get the World Radius
  *
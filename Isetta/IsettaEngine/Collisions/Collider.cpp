@@ -18,6 +18,7 @@ void Collider::Start() {
 
 void Collider::OnEnable() {
   collisionsModule->bvTree.AddCollider(this);
+  transform->colliders.PushBack(this);
   // TODO(Yidi) + TODO(Jacob)
   // hierarchyHandle =
   // entity->OnHierarchyChange.Register(std::bind(&Collider::FindHandler,this));
@@ -25,6 +26,13 @@ void Collider::OnEnable() {
 
 void Collider::OnDisable() {
   collisionsModule->bvTree.RemoveCollider(this);
+  for (auto it = transform->colliders.begin(); it != transform->colliders.end();
+       ++it) {
+    if (*it == this) {
+      transform->colliders.Erase(it);
+      break;
+    }
+  }
   // TODO(Yidi) + TODO(Jacob)
   // entity->OnHierarchyChange.Unregister(hierarchyHandle);
 }
@@ -36,6 +44,14 @@ void Collider::FindHandler() {
     parent = parent->GetParent();
   }
 }
+void Collider::OnTransformDirty() {
+  if (isMoved || !entity->IsMoveable()) return;
+  collisionsModule->bvTree.MarkMoved(this);
+}
+void Collider::OnShapeChanged() {
+  if (isMoved) return;
+  collisionsModule->bvTree.MarkMoved(this);
+}
 void Collider::RaycastHitCtor(RaycastHit* const hitInfo, const float distance,
                               const Math::Vector3& point,
                               const Math::Vector3& normal) {
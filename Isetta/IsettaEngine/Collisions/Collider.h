@@ -38,11 +38,6 @@ public:
  *
  */
 bool isTrigger = false;
-/**
- * @brief center offset from transform position
- *
- */
-Math::Vector3 center;
 /**
  * @brief color of the DebugDraw collider
  *
@@ -77,6 +72,16 @@ Math::Vector3 GetWorldCenter() const {
   return transform->WorldPosFromLocalPos(center);
 }
 
+const Math::Vector3& GetCenter() const { return center; }
+/**
+ * @brief Set the center offset, the collision tree refits the collider on its
+ * next update
+ */
+void SetCenter(const Math::Vector3& newCenter) {
+  center = newCenter;
+  OnShapeChanged();
+}
+
 void Start() override;
 void OnEnable() override;
 void OnDisable() override;
@@ -93,15 +98,33 @@ class CollisionHandler* GetHandler() const {
 }
 void SetHandler(class CollisionHandler* const h) { handler = h; }
 void FindHandler();
+/// Queue the collider to be refit by the collision tree, static entities are
+/// never queued once their level has loaded
+void OnTransformDirty();
+/// Already waiting in the collision tree's moved list
+bool isMoved{false};
 
 static class CollisionsModule* collisionsModule;
+friend class BVTree;
 friend class CollisionsModule;
 friend class CollisionHandler;
 friend class CollisionSolverModule;
+friend class Transform;
+friend class BVTreeTest;
 
 protected:
 inline static float fatFactor = 0.2f;
 
+/**
+ * @brief center offset from transform position
+ *
+ */
+Math::Vector3 center;
+
+/// Queue the collider to be refit by the collision tree after its shape
+/// changed, static or not
+void OnShapeChanged();
+
 Collider(const Math::Vector3& center) : center{center} {}
 Collider(const bool trigger = false,
          const Math::Vector3& center = Math::Vector3::zero)
@@ -42,10 +42,10 @@ Collision CollisionSolverModule::Solve(Collider* collider, Collider* other) {
 
       Math::Vector3 p =
           box->transform->LocalPosFromWorldPos(collider->GetWorldCenter()) -
-          box->center;  // TODO(Caleb): Check if this is supposed
-                        // to be converted from world space
+          box->GetCenter();  // TODO(Caleb): Check if this is supposed
+                             // to be converted from world space
 
-      Math::Vector3 extents = box->size * .5;
+      Math::Vector3 extents = box->GetSize() * .5;
       Math::Vector3 scale = box->transform->GetWorldScale();
 
       int numEdges = 0;
@@ -101,11 +101,12 @@ Collision CollisionSolverModule::Solve(Collider* collider, Collider* other) {
     case Collider::ColliderType::BOX: {
       BoxCollider* box = static_cast<BoxCollider*>(collider);
 
-      Math::Vector3 p = box->transform->LocalPosFromWorldPos(point) -
-                        box->center;  // TODO(Caleb): Check if this is supposed
-                                      // to be converted from world space
+      // TODO(Caleb): Check if center is supposed to be converted from world
+      // space
+      Math::Vector3 p =
+          box->transform->LocalPosFromWorldPos(point) - box->GetCenter();
 
-      Math::Vector3 extents = box->size * .5;
+      Math::Vector3 extents = box->GetSize() * .5;
       Math::Vector3 hitPoint = Math::Vector3::zero;
       Math::Vector3 scale = box->transform->GetWorldScale();
 
@@ -129,7 +130,7 @@ Collision CollisionSolverModule::Solve(Collider* collider, Collider* other) {
           Math::Util::Sign(hitPoint[minAxis]) * extents[minAxis];
 
       collision.hitPoint =
-          box->transform->WorldPosFromLocalPos(hitPoint + box->center);
+          box->transform->WorldPosFromLocalPos(hitPoint + box->GetCenter());
       collision.pushDir = Math::Vector3::zero;
       collision.pushDir[minAxis] = 1;
       collision.pushDir =
@@ -144,9 +145,9 @@ Collision CollisionSolverModule::Solve(Collider* collider, Collider* other) {
       Math::Matrix4 rot, scale;
       Math::Vector3 cp0, cp1, cdir;
       float radiusScale = capsule->GetWorldCapsule(&rot, &scale);
+      const float segment = capsule->GetHeight() - 2 * capsule->GetRadius();
       cdir = (Math::Vector3)(rot * scale *
-                             Math::Matrix4::Scale(Math::Vector3{
-                                 capsule->height - 2 * capsule->radius}) *
+                             Math::Matrix4::Scale(Math::Vector3{segment}) *
                              Math::Vector4{0, 1, 0, 0}) *
              .5;
       cp0 = capsule->GetWorldCenter() - cdir;
@@ -161,7 +162,7 @@ Collision CollisionSolverModule::Solve(Collider* collider, Collider* other) {
       Math::Vector3 radialPoint = (point - collision.hitPoint).Normalized();
 
       collision.hitPoint =
-          collision.hitPoint + radialPoint * capsule->radius * radiusScale;
+          collision.hitPoint + radialPoint * capsule->GetRadius() * radiusScale;
       collision.pushDir = radialPoint;
 
       break;
@@ -209,8 +210,8 @@ Math::Vector3 CollisionSolverModule::Resolve(Collider* collider1,
 void CollisionSolverModule::Update() {
   BROFILER_CATEGORY("Collision Solver Update", Profiler::Color::Aqua);
 
-  CollisionUtil::ColliderPairSet collidingPairs =
-      collisionsModule->collidingPairs;
+  const std::vector<CollisionUtil::CollisionPair>& collidingPairs =
+      collisionsModule->collidingOrder;
 
   for (int i = 0; i < 3;
        ++i) {  // TODO(Caleb): Don't hardcode number of iterations
@@ -8,4 +8,30 @@ using CollisionPair = std::pair<Collider*, Collider*>;
 using ColliderPairSet =
     std::unordered_set<CollisionPair, Util::UnorderedPairHash,
                        Util::UnorderedPairHash>;
+
+/**
+ * \brief Flat list of pairs on the single frame allocator, so it's only valid
+ * until the end of the frame it was made in
+ */
+struct ColliderPairBuffer {
+  CollisionPair* pairs = nullptr;
+  Size count = 0;
+
+  CollisionPair* begin() const { return pairs; }
+  CollisionPair* end() const { return pairs + count; }
+};
+
+/**
+ * \brief What the last narrowphase did, include "Collisions/CollisionUtil.h"
+ * to use the result of Collisions::GetNarrowphaseStats
+ */
+struct NarrowphaseStats {
+  /// Pairs handed over by the broadphase
+  Size pairCount{};
+  /// Pairs that actually intersect
+  Size collidingCount{};
+  /// Ranges the pairs were split into, each tested as one job
+  int threadCount{};
+  float seconds{};
+};
 }  // namespace Isetta::CollisionUtil
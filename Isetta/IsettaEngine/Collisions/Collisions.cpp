@@ -16,6 +16,10 @@ bool Collisions::Raycast(const Ray &ray, RaycastHit *const hitInfo,
 Array<RaycastHit> Collisions::RaycastAll(const Ray &ray, float maxDistance) {
   return collisionsModule->RaycastAll(ray, maxDistance);
 }
+Size Collisions::RaycastBatch(const Ray *const rays, const Size count,
+                              RaycastHit *const hitInfos, float maxDistance) {
+  return collisionsModule->RaycastBatch(rays, count, hitInfos, maxDistance);
+}
 
 bool Collisions::GetIgnoreLayerCollision(int layer1, int layer2) {
   return collisionsModule->GetIgnoreLayerCollision(layer1, layer2);
@@ -37,4 +41,10 @@ bool Collisions::GetIgnoreCollisions(Collider *const a, Collider *const b) {
   return collisionsModule->ignoreColliderPairs.find({a, b}) !=
          collisionsModule->ignoreColliderPairs.end();
 }
+BVTreeStats Collisions::GetTreeStats() {
+  return collisionsModule->bvTree.GetStats();
+}
+CollisionUtil::NarrowphaseStats Collisions::GetNarrowphaseStats() {
+  return collisionsModule->narrowphaseStats;
+}
 }  // namespace Isetta
@@ -6,6 +6,10 @@
 #include "Core/DataStructures/Array.h"
 #include "ISETTA_API.h"
 
+namespace Isetta::CollisionUtil {
+struct NarrowphaseStats;
+}
+
 namespace Isetta {
 class ISETTA_API_DECLARE Collisions {
  public:
@@ -30,6 +34,19 @@ class ISETTA_API_DECLARE Collisions {
    */
   static Array<RaycastHit> RaycastAll(const class Ray &ray,
                                       float maxDistance = 0);
+  /**
+   * @brief Raycast many rays at once, return the closest hit of each. Cheaper
+   * than calling Raycast in a loop for line of sight checks or bullet sweeps,
+   * since nearby rays share the walk through the collision tree
+   *
+   * @param rays to cast
+   * @param count of rays
+   * @param hitInfos one per ray, the hit of a ray that missed has no collider
+   * @param maxDistance the rays can travel
+   * @return Size number of rays that hit
+   */
+  static Size RaycastBatch(const class Ray *rays, Size count,
+                           class RaycastHit *hitInfos, float maxDistance = 0);
   // TODO(Jacob) ColliderCasts? LineCast
   // TODO(Jacob) CheckCollider - check for overlap
   // TODO(Jacob) OverlapCollider - touching or inside
@@ -61,6 +78,21 @@ class ISETTA_API_DECLARE Collisions {
    */
   static bool GetIgnoreCollisions(class Collider *const, class Collider *const);
 
+  /**
+   * @brief Get the shape of the broadphase tree, include "Collisions/BVTree.h"
+   * to use the result
+   *
+   * @return BVTreeStats depth and SAH cost of the tree
+   */
+  static struct BVTreeStats GetTreeStats();
+  /**
+   * @brief Get how long the last narrowphase took and how many pairs it
+   * tested, include "Collisions/CollisionUtil.h" to use the result
+   *
+   * @return NarrowphaseStats pair counts and time of the last fixed step
+   */
+  static CollisionUtil::NarrowphaseStats GetNarrowphaseStats();
+
  private:
   static class CollisionsModule *collisionsModule;
   friend class CollisionsModule;
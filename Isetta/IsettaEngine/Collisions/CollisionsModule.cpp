@@ -22,6 +22,8 @@
 
 #include "Collisions/CollisionSolverModule.h"
 #include "Core/Config/Config.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Time/StopWatch.h"
 
 namespace Isetta {
 void CollisionsModule::StartUp() {
@@ -39,11 +41,75 @@ void CollisionsModule::Update(float deltaTime) {
   // By the end of the checking loop, pairs left in the lastFramePairs
   // are those who are no longer colliding
   lastFramePairs = collidingPairs;
+  lastFrameOrder.swap(collidingOrder);
 
   collidingPairs.clear();
+  collidingOrder.clear();
 
-  auto pairs = bvTree.GetCollisionPairs();
-  for (const auto &pair : pairs) {
+  const CollisionUtil::ColliderPairBuffer pairs = bvTree.GetCollisionPairs();
+  Narrowphase(pairs);
+}
+
+void CollisionsModule::Narrowphase(
+    const CollisionUtil::ColliderPairBuffer &pairs) {
+  PROFILE
+  StopWatch stopWatch;
+  stopWatch.Start();
+
+  int rangeCount = CONFIG_VAL(collisionConfig.narrowphaseThreads);
+  if (rangeCount <= 0) {
+    rangeCount = JobSystem::GetThreadCount();
+  }
+  if (pairs.count < CONFIG_VAL(collisionConfig.narrowphaseMinPairs)) {
+    rangeCount = 1;
+  }
+
+  if (narrowphaseResults.size() < static_cast<Size>(rangeCount)) {
+    narrowphaseResults.resize(rangeCount);
+  }
+  if (rangeCount == 1) {
+    narrowphaseResults[0].clear();
+    TestPairs(pairs.begin(), pairs.end(), &narrowphaseResults[0]);
+  } else {
+    // Transforms fill their matrix caches on first read, do that here so the
+    // threads only ever read them
+    for (const auto &pair : pairs) {
+      pair.first->transform->GetWorldToLocalMatrix();
+      pair.second->transform->GetWorldToLocalMatrix();
+    }
+
+    JobSystem::ParallelFor(rangeCount, [&](const int begin, const int end) {
+      BROFILER_CATEGORY("Narrowphase Job", Profiler::Color::Orchid);
+      for (int range = begin; range < end; ++range) {
+        std::vector<CollisionUtil::CollisionPair> &results =
+            narrowphaseResults[range];
+        results.clear();
+        TestPairs(pairs.begin() + pairs.count * range / rangeCount,
+                  pairs.begin() + pairs.count * (range + 1) / rangeCount,
+                  &results);
+      }
+    });
+  }
+
+  for (int i = 0; i < rangeCount; ++i) {
+    for (const auto &pair : narrowphaseResults[i]) {
+      collidingPairs.insert(pair);
+      collidingOrder.push_back(pair);
+    }
+  }
+
+  narrowphaseStats.pairCount = pairs.count;
+  narrowphaseStats.collidingCount = collidingOrder.size();
+  narrowphaseStats.threadCount = rangeCount;
+  narrowphaseStats.seconds = stopWatch.EvaluateInSecond();
+}
+
+void CollisionsModule::TestPairs(
+    const CollisionUtil::CollisionPair *const begin,
+    const CollisionUtil::CollisionPair *const end,
+    std::vector<CollisionUtil::CollisionPair> *const out) const {
+  for (const CollisionUtil::CollisionPair *it = begin; it != end; ++it) {
+    const auto &pair = *it;
     Collider *collider1 = pair.first;
     Collider *collider2 = pair.second;
     // Ignore Single/Layer Collisions continue
@@ -61,12 +127,12 @@ void CollisionsModule::Update(float deltaTime) {
         handler2 && handler1 == handler2)
       continue;
 
-    if (collider1->Intersection(collider2)) collidingPairs.insert(pair);
+    if (collider1->Intersection(collider2)) out->push_back(pair);
   }
 }
 
 void CollisionsModule::LateUpdate(float deltaTime) {
-  for (const auto &pair : collidingPairs) {
+  for (const auto &pair : collidingOrder) {
     Collider *collider1 = pair.first;
     Collider *collider2 = pair.second;
 
@@ -88,7 +154,9 @@ void CollisionsModule::LateUpdate(float deltaTime) {
     }
   }
 
-  for (const auto &pair : lastFramePairs) {
+  for (const auto &pair : lastFrameOrder) {
+    // pairs still colliding were taken out of lastFramePairs above
+    if (lastFramePairs.find(pair) == lastFramePairs.end()) continue;
     Collider *collider1 = pair.first;
     Collider *collider2 = pair.second;
     if (!collider1->entity || !collider2->entity) continue;
@@ -221,10 +289,10 @@ bool CollisionsModule::Intersection(const BoxCollider &box,
   PROFILE
   Math::Matrix4 rot, scale;
   float radiusScale = capsule.GetWorldCapsule(&rot, &scale);
+  const float segment = capsule.GetHeight() - 2 * capsule.GetRadius();
   Math::Vector3 dir =
       (Math::Vector3)(rot * scale *
-                      Math::Matrix4::Scale(
-                          Math::Vector3{capsule.height - 2 * capsule.radius}) *
+                      Math::Matrix4::Scale(Math::Vector3{segment}) *
                       Math::Vector4{0, 1, 0, 0}) *
       .5;
   Math::Vector3 p0 = capsule.GetWorldCenter() - dir;
@@ -232,7 +300,7 @@ bool CollisionsModule::Intersection(const BoxCollider &box,
   // DebugDraw::Point(p0, Color::magenta, 10, 0.1f);
   // DebugDraw::Point(p1, Color::magenta, 10, 0.1f);
   return SqDistSegmentOBB(p0, p1, box) <=
-         Math::Util::Square(capsule.radius * radiusScale);
+         Math::Util::Square(capsule.GetRadius() * radiusScale);
 
   // https://github.com/vancegroup-mirrors/open-dynamics-engine-svnmirror/blob/master/ode/src/capsule.cpp
 
@@ -264,17 +332,17 @@ bool CollisionsModule::Intersection(const SphereCollider &sphere,
   PROFILE
   Math::Matrix4 rot, scale;
   float radiusScale = capsule.GetWorldCapsule(&rot, &scale);
+  const float segment = capsule.GetHeight() - 2 * capsule.GetRadius();
   Math::Vector3 dir =
       (Math::Vector3)(rot * scale *
-                      Math::Matrix4::Scale(
-                          Math::Vector3{capsule.height - 2 * capsule.radius}) *
+                      Math::Matrix4::Scale(Math::Vector3{segment}) *
                       Math::Vector4{0, 1, 0, 0}) *
       .5;
   Math::Vector3 p0 = capsule.GetWorldCenter() - dir;
   Math::Vector3 p1 = capsule.GetWorldCenter() + dir;
   float distSq = SqDistPointSegment(p0, p1, sphere.GetWorldCenter());
   return distSq <= Math::Util::Square(sphere.GetWorldRadius() +
-                                      capsule.radius * radiusScale);
+                                      capsule.GetRadius() * radiusScale);
 }
 bool CollisionsModule::Intersection(const CapsuleCollider &a,
                                     const CapsuleCollider &b) {
@@ -285,13 +353,15 @@ bool CollisionsModule::Intersection(const CapsuleCollider &a,
   Math::Vector3 aDir =
       (Math::Vector3)(
           aRot * aScale *
-          Math::Matrix4::Scale(Math::Vector3{a.height - 2 * a.radius}) *
+          Math::Matrix4::Scale(
+              Math::Vector3{a.GetHeight() - 2 * a.GetRadius()}) *
           Math::Vector4{0, 1, 0, 0}) *
       .5;
   Math::Vector3 bDir =
       (Math::Vector3)(
           bRot * bScale *
-          Math::Matrix4::Scale(Math::Vector3{b.height - 2 * b.radius}) *
+          Math::Matrix4::Scale(
+              Math::Vector3{b.GetHeight() - 2 * b.GetRadius()}) *
           Math::Vector4{0, 1, 0, 0}) *
       .5;
   Math::Vector3 aP0 = a.GetWorldCenter() - aDir;
@@ -303,7 +373,8 @@ bool CollisionsModule::Intersection(const CapsuleCollider &a,
   Math::Vector3 ac, bc;
   float distSq = ClosestPtSegmentSegment(aP0, aP1, bP0, bP1, &s, &t, &ac, &bc);
 
-  return distSq <= Math::Util::Square(a.radius * arScale + b.radius * brScale);
+  return distSq <= Math::Util::Square(a.GetRadius() * arScale +
+                                      b.GetRadius() * brScale);
 }
 bool CollisionsModule::Intersection(const CapsuleCollider &capsule,
                                     const BoxCollider &box) {
@@ -325,6 +396,12 @@ Array<RaycastHit> CollisionsModule::RaycastAll(const Ray &ray,
   PROFILE
   return bvTree.RaycastAll(ray, maxDistance);
 }
+Size CollisionsModule::RaycastBatch(const Ray *const rays, const Size count,
+                                    RaycastHit *const hitInfos,
+                                    float maxDistance) {
+  PROFILE
+  return bvTree.RaycastBatch(rays, count, hitInfos, maxDistance);
+}
 bool CollisionsModule::GetIgnoreLayerCollision(int layer1, int layer2) const {
   if (layer1 < layer2)
     return ignoreCollisionLayer.test(layer1 * Layers::LAYERS_CAPACITY + layer2);
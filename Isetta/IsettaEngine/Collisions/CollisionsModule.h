@@ -17,6 +17,19 @@ class CollisionsModule {
   struct CollisionConfig {
     CVar<float> fatFactor{"collision_fat_factor", 0.2f};
     CVar<Size> bvTreeNodeSize{"bv_tree_node_size", 200};
+    /// Rotate branches on the refit path after inserts and removals
+    CVar<int> bvTreeRotations{"bv_tree_rotations", 1};
+    /// Rebuild the tree once its SAH cost is this many times the cost right
+    /// after the last rebuild, 0 to never rebuild
+    CVar<float> bvTreeRebuildRatio{"bv_tree_rebuild_ratio", 1.5f};
+    /// Run queries on the flattened four-wide copy of the tree instead of
+    /// walking the linked nodes
+    CVar<int> bvTreeFlatQueries{"bv_tree_flat_queries", 1};
+    /// Ranges the narrowphase is split into, each tested as a job of the
+    /// JobSystem. 0 uses one per job thread, 1 tests on the main thread alone
+    CVar<int> narrowphaseThreads{"collision_narrowphase_threads", 0};
+    /// Fewer broadphase pairs than this are tested on the main thread alone
+    CVar<int> narrowphaseMinPairs{"collision_narrowphase_min_pairs", 512};
   };
 
   static bool Intersection(const class BoxCollider &,
@@ -41,6 +54,8 @@ class CollisionsModule {
   bool Raycast(const class Ray &ray, class RaycastHit *const hitInfo,
                float maxDistance = 0);
   Array<RaycastHit> RaycastAll(const class Ray &ray, float maxDistance = 0);
+  Size RaycastBatch(const class Ray *rays, Size count,
+                    class RaycastHit *hitInfos, float maxDistance = 0);
 
   static float ClosestPtRaySegment(const class Ray &, const Math::Vector3 &,
                                    const Math::Vector3 &, float *const,
@@ -55,6 +70,14 @@ class CollisionsModule {
   // probably mark them as "still colliding"
   CollisionUtil::ColliderPairSet collidingPairs, lastFramePairs;
   CollisionUtil::ColliderPairSet ignoreColliderPairs;
+  /// Same pairs as collidingPairs and lastFramePairs, in broadphase order.
+  /// Callbacks and the solver walk these so they run in the same order every
+  /// time instead of in hash order
+  std::vector<CollisionUtil::CollisionPair> collidingOrder, lastFrameOrder;
+
+  /// Intersecting pairs found in each narrowphase range
+  std::vector<std::vector<CollisionUtil::CollisionPair>> narrowphaseResults;
+  CollisionUtil::NarrowphaseStats narrowphaseStats;
 
   BVTree bvTree;
   std::bitset<static_cast<int>(0.5f * Layers::LAYERS_CAPACITY *
@@ -66,6 +89,16 @@ class CollisionsModule {
   void LateUpdate(float deltaTime);
   void ShutDown();
   Array<Collider *> GetPossibleColliders(Collider *collider) const;
+  /**
+   * \brief Intersection test the broadphase pairs, split into contiguous
+   * ranges run as jobs. Results are merged in range order, which is the order
+   * of the pairs, so the outcome doesn't depend on the thread count
+   */
+  void Narrowphase(const CollisionUtil::ColliderPairBuffer &pairs);
+  /// Test pairs on the calling thread, appending the intersecting ones to out
+  void TestPairs(const CollisionUtil::CollisionPair *begin,
+                 const CollisionUtil::CollisionPair *end,
+                 std::vector<CollisionUtil::CollisionPair> *out) const;
 
   // Utilities
   bool GetIgnoreLayerCollision(int layer1, int layer2) const;
@@ -123,5 +156,6 @@ class CollisionsModule {
   friend class Collisions;
   friend class CollisionSolverModule;
   friend class StackAllocator;
+  friend class BVTreeTest;
 };
 }  // namespace Isetta
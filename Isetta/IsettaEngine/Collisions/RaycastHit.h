@@ -8,7 +8,7 @@
 namespace Isetta {
 class ISETTA_API_DECLARE RaycastHit {
  private:
-  class Collider* collider;
+  class Collider* collider{nullptr};
   float distance{INFINITY};
   Math::Vector3 point, normal;
 
@@ -14,13 +14,14 @@ void Update() override;
 protected:
 ColliderType GetType() const final { return ColliderType::SPHERE; }
 
-public:
 /**
  * @brief radius of sphere before scale
  *
  */
 float radius;
 
+public:
+
 /**
  * @brief Construct a new Sphere Collider object
  *
@@ -61,6 +62,16 @@ float GetWorldRadius() const {
   return radius * transform->GetWorldScale().Max();
 }
 
+float GetRadius() const { return radius; }
+/**
+ * @brief Set the radius, the collision tree refits the collider on its next
+ * update
+ */
+void SetRadius(const float newRadius) {
+  radius = newRadius;
+  OnShapeChanged();
+}
+
 AABB GetFatAABB() final;
 AABB GetAABB() final;
 
@@ -27,7 +27,7 @@ void Hierarchy::GuiUpdate() {
         float padding = 20;
         Transform* target = nullptr;
 
-        std::list<Entity*> entities =
+        const std::vector<Entity*>& entities =
             LevelManager::Instance().loadedLevel->GetEntities();
 
         static Func<int, Transform*> countLevel = [](Transform* t) -> int {
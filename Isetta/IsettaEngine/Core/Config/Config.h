@@ -12,6 +12,7 @@
 #include "Core/DataStructures/Array.h"
 #include "Core/Debug/Logger.h"
 #include "Core/IsettaAlias.h"
+#include "Core/Jobs/JobSystem.h"
 #include "Core/Memory/MemoryManager.h"
 #include "EngineLoop.h"
 #include "Graphics/CameraComponent.h"
@@ -45,6 +46,7 @@ class ISETTA_API Config {
   Logger::LoggerConfig logger;
   WindowModule::WindowConfig windowConfig;
   EngineLoop::LoopConfig loopConfig;
+  JobSystem::JobConfig jobConfig;
   RenderModule::RenderConfig renderConfig;
   CameraComponent::CameraConfig cameraConfig;
   LightComponent::LightConfig lightConfig;
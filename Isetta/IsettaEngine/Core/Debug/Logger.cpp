@@ -3,6 +3,7 @@
  */
 #include "Core/Debug/Logger.h"
 
+#include <mutex>
 #include <sstream>
 #include <type_traits>
 #include "Core/Config/Config.h"
@@ -22,6 +23,12 @@ std::bitset<static_cast<int>(Debug::Verbosity::All) - 1> Logger::verbosityMask =
     ~0;
 Action<const char *> Logger::outputCallback;
 
+namespace
+{
+/// Jobs can log from any thread, the buffer and streams are shared
+std::recursive_mutex logMutex;
+}  // namespace
+
 void Logger::NewSession()
 {
   std::string folder = "";
@@ -38,6 +45,7 @@ void Logger::NewSession()
 
 void Logger::ShutDown()
 {
+  std::lock_guard<std::recursive_mutex> lock{logMutex};
   channelStream.flush();
   Filesystem::Instance().WriteAsync(channelFileName, channelStream.str());
   channelStream.str("");
@@ -55,6 +63,7 @@ int Logger::VDebugPrintF(const Debug::Channel channel,
                          const Debug::Verbosity verbosity,
                          const std::string inFormat, va_list argList)
 {
+  std::lock_guard<std::recursive_mutex> lock{logMutex};
   const U32 MAX_CHARS = 1023;
   static char sBuffer[MAX_CHARS + 1];
   // TODO(Jacob) elapsed or unscaled time?
@@ -18,7 +18,10 @@
 #include "Graphics/RectTransform.h"
 #include "Input/Input.h"
 #include "Scene/Entity.h"
+#include "Scene/EntityCommandBuffer.h"
 #include "Scene/Level.h"
 #include "Scene/LevelManager.h"
+#include "Scene/Prefab.h"
+#include "Scene/Query.h"
 #include "Scene/Transform.h"
 #include "Util.h"
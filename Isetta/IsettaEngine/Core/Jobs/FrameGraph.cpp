@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Core/Jobs/FrameGraph.h"
+
+#include <thread>
+#include "Core/Debug/Assert.h"
+#include "Core/Jobs/JobSystem.h"
+#include "brofiler/ProfilerCore/Brofiler.h"
+
+namespace Isetta {
+FrameGraph::NodeId FrameGraph::AddNode(
+    const Action<>& func, const std::initializer_list<NodeId> dependencies,
+    const bool mainThread) {
+  const NodeId id = static_cast<NodeId>(nodes.size());
+  for (const NodeId dependency : dependencies) {
+    ASSERT(dependency >= 0 && dependency < id);
+    nodes[dependency].successors.push_back(id);
+  }
+  nodes.push_back(Node{func, {}, static_cast<int>(dependencies.size()),
+                       mainThread});
+  remaining.reset();
+  return id;
+}
+
+void FrameGraph::Execute() {
+  PROFILE
+  // dependencies always come first, so the order nodes were added in works
+  if (JobSystem::GetThreadCount() == 1) {
+    for (Node& node : nodes) node.func();
+    return;
+  }
+
+  const int count = static_cast<int>(nodes.size());
+  if (!remaining) remaining.reset(new std::atomic<int>[count]);
+  for (int i = 0; i < count; ++i) {
+    remaining[i].store(nodes[i].dependencyCount, std::memory_order_relaxed);
+  }
+  finishedCount.store(0, std::memory_order_relaxed);
+  exception = nullptr;
+  for (int i = 0; i < count; ++i) {
+    if (nodes[i].dependencyCount == 0) Schedule(i);
+  }
+
+  while (finishedCount.load(std::memory_order_acquire) < count) {
+    NodeId next = -1;
+    {
+      std::lock_guard<std::mutex> lock{readyMutex};
+      if (!mainReady.empty()) {
+        next = mainReady.front();
+        mainReady.pop_front();
+      }
+    }
+    if (next >= 0) {
+      RunNode(next);
+    } else if (!JobSystem::RunPendingJob()) {
+      std::this_thread::yield();
+    }
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+void FrameGraph::Clear() {
+  nodes.clear();
+  remaining.reset();
+}
+
+void FrameGraph::Schedule(const NodeId node) {
+  if (nodes[node].mainThread) {
+    std::lock_guard<std::mutex> lock{readyMutex};
+    mainReady.push_back(node);
+    return;
+  }
+  JobSystem::Run([this, node]() { RunNode(node); });
+}
+
+void FrameGraph::RunNode(const NodeId node) {
+  // the jobs of the other nodes still hold on to the graph, so the frame
+  // finishes before the exception goes anywhere
+  try {
+    nodes[node].func();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock{readyMutex};
+    if (!exception) exception = std::current_exception();
+  }
+  Finish(node);
+}
+
+void FrameGraph::Finish(const NodeId node) {
+  for (const NodeId successor : nodes[node].successors) {
+    if (remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Schedule(successor);
+    }
+  }
+  // last, Execute may return as soon as this reaches the node count
+  finishedCount.fetch_add(1, std::memory_order_release);
+}
+}  // namespace Isetta
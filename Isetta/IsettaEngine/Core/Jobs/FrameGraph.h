@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * \brief Work of a frame as nodes with dependencies. Execute runs a node once
+ * everything it depends on is done, worker nodes as jobs and main thread
+ * nodes on the calling thread, so independent nodes overlap. Without job
+ * workers everything runs on the calling thread in the order it was added
+ */
+class ISETTA_API FrameGraph {
+ public:
+  using NodeId = int;
+
+  /**
+   * \param dependencies Nodes that have to finish before this one starts,
+   * added before it
+   * \param mainThread Run on the thread calling Execute, for work that isn't
+   * safe on other threads like rendering or gameplay code
+   */
+  NodeId AddNode(const Action<>& func,
+                 std::initializer_list<NodeId> dependencies = {},
+                 bool mainThread = true);
+  /**
+   * \brief Run every node once and return when all are done. A node that
+   * throws still counts as done, the first exception is rethrown at the end
+   */
+  void Execute();
+  void Clear();
+
+  bool IsEmpty() const { return nodes.empty(); }
+
+ private:
+  struct Node {
+    Action<> func;
+    std::vector<NodeId> successors;
+    int dependencyCount;
+    bool mainThread;
+  };
+
+  void Schedule(NodeId node);
+  void RunNode(NodeId node);
+  void Finish(NodeId node);
+
+  std::vector<Node> nodes;
+  /// Dependencies left per node during Execute
+  std::unique_ptr<std::atomic<int>[]> remaining;
+  std::atomic<int> finishedCount{0};
+  std::mutex readyMutex;
+  /// Main thread nodes that can run, in the order they got ready
+  std::deque<NodeId> mainReady;
+  /// First exception a node threw during Execute
+  std::exception_ptr exception;
+};
+}  // namespace Isetta
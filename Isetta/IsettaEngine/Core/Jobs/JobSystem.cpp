@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Core/Jobs/JobSystem.h"
+
+#include "Core/Config/Config.h"
+#include "Core/Debug/Assert.h"
+#include "Core/Debug/Logger.h"
+#include "Core/Math/Util.h"
+#include "brofiler/ProfilerCore/Brofiler.h"
+
+namespace Isetta {
+namespace {
+thread_local int threadIndex = 0;
+}  // namespace
+
+JobSystem* JobSystem::instance = nullptr;
+
+JobSystem::JobSystem() { instance = this; }
+
+JobSystem::~JobSystem() {
+  ShutDown();
+  if (instance == this) instance = nullptr;
+}
+
+void JobSystem::StartUp() {
+  int workerCount = CONFIG_VAL(jobConfig.workerThreads);
+  if (workerCount < 0) {
+    workerCount = Math::Util::Max(
+        {0, static_cast<int>(std::thread::hardware_concurrency()) - 1});
+  }
+  StartUp(Math::Util::Min({workerCount, maxThreadCount - 1}));
+}
+
+void JobSystem::StartUp(const int workerCount) {
+  ASSERT(workers.empty());
+  ASSERT(workerCount < maxThreadCount);
+  queues.clear();
+  for (int i = 0; i <= workerCount; ++i) {
+    queues.push_back(std::make_unique<JobQueue>());
+  }
+  stopping = false;
+  workers.reserve(workerCount);
+  for (int i = 1; i <= workerCount; ++i) {
+    workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+  }
+}
+
+void JobSystem::ShutDown() {
+  // jobs nobody waited on still get to run
+  while (TryRunJob(0)) {
+  }
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  queues.clear();
+}
+
+void JobSystem::Run(const Action<>& job, JobCounter* const counter) {
+  if (counter != nullptr) {
+    counter->count.fetch_add(1, std::memory_order_relaxed);
+  }
+  Job newJob{job, counter};
+  if (instance == nullptr || instance->workers.empty()) {
+    Execute(&newJob);
+    return;
+  }
+
+  JobQueue& queue = *instance->queues[GetThreadIndex()];
+  {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.jobs.push_back(std::move(newJob));
+  }
+  instance->queuedJobs.fetch_add(1, std::memory_order_release);
+  {
+    // taken so a worker between its check and its wait doesn't miss this
+    std::lock_guard<std::mutex> lock{instance->sleepMutex};
+  }
+  instance->wake.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+  const int thread = GetThreadIndex();
+  while (!counter.IsDone()) {
+    if (instance == nullptr || !instance->TryRunJob(thread)) {
+      std::this_thread::yield();
+    }
+  }
+  // set before the last job of the counter finished
+  if (counter.exception) std::rethrow_exception(counter.exception);
+}
+
+bool JobSystem::RunPendingJob() {
+  return instance != nullptr && instance->TryRunJob(GetThreadIndex());
+}
+
+void JobSystem::ParallelFor(const int count, const Action<int, int>& body,
+                            const int minBatch) {
+  if (count <= 0) return;
+  // a few batches per thread so stealing can even out uneven batches
+  const int batchSize = Math::Util::Max({1, minBatch});
+  const int batchCount = Math::Util::Min(
+      {4 * GetThreadCount(), (count + batchSize - 1) / batchSize});
+  if (batchCount <= 1) {
+    body(0, count);
+    return;
+  }
+
+  const auto boundary = [count, batchCount](const int batch) {
+    return static_cast<int>(static_cast<I64>(count) * batch / batchCount);
+  };
+  JobCounter counter;
+  for (int batch = 1; batch < batchCount; ++batch) {
+    Run([&body, begin = boundary(batch),
+         end = boundary(batch + 1)]() { body(begin, end); },
+        &counter);
+  }
+  // the queued batches hold on to counter and body
+  try {
+    body(0, boundary(1));
+  } catch (...) {
+    while (!counter.IsDone()) {
+      if (!RunPendingJob()) std::this_thread::yield();
+    }
+    throw;
+  }
+  Wait(counter);
+}
+
+int JobSystem::GetThreadIndex() { return threadIndex; }
+
+int JobSystem::GetThreadCount() {
+  return instance == nullptr ? 1
+                             : static_cast<int>(instance->workers.size()) + 1;
+}
+
+bool JobSystem::Pop(const int thread, Job* const job) {
+  JobQueue& queue = *queues[thread];
+  std::lock_guard<std::mutex> lock{queue.mutex};
+  if (queue.jobs.empty()) return false;
+  *job = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  return true;
+}
+
+bool JobSystem::Steal(const int thread, Job* const job) {
+  const int queueCount = static_cast<int>(queues.size());
+  for (int i = 1; i < queueCount; ++i) {
+    JobQueue& queue = *queues[(thread + i) % queueCount];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (queue.jobs.empty()) continue;
+    *job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    return true;
+  }
+  return false;
+}
+
+bool JobSystem::TryRunJob(const int thread) {
+  if (queues.empty() || queuedJobs.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  Job job;
+  if (!Pop(thread, &job) && !Steal(thread, &job)) return false;
+  queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  Execute(&job);
+  return true;
+}
+
+void JobSystem::Execute(Job* const job) {
+  BROFILER_CATEGORY("Job", Profiler::Color::Orchid);
+  // an exception leaving a worker would terminate, and one leaving a waiting
+  // thread would skip the decrement its waiters need
+  try {
+    job->func();
+  } catch (...) {
+    if (job->counter != nullptr) {
+      std::lock_guard<std::mutex> lock{job->counter->exceptionMutex};
+      if (!job->counter->exception) {
+        job->counter->exception = std::current_exception();
+      }
+    } else {
+      LOG_ERROR(Debug::Channel::General,
+                "A job without a counter threw, nothing waits to catch it");
+    }
+  }
+  if (job->counter != nullptr) {
+    job->counter->count.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void JobSystem::WorkerLoop(const int thread) {
+  BROFILER_THREAD("Job Worker");
+  threadIndex = thread;
+  while (true) {
+    if (TryRunJob(thread)) continue;
+
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    wake.wait(lock, [this]() {
+      return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping) return;
+  }
+}
+}  // namespace Isetta
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Core/Config/CVar.h"
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * \brief Number of jobs still running in a group. Give it to every
+ * JobSystem::Run of the group, then JobSystem::Wait on it. Must outlive the
+ * jobs. Also keeps the first exception a job of the group threw
+ */
+class JobCounter {
+ public:
+  JobCounter() = default;
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  bool IsDone() const { return count.load(std::memory_order_acquire) == 0; }
+
+ private:
+  std::atomic<int> count{0};
+  std::mutex exceptionMutex;
+  std::exception_ptr exception;
+
+  friend class JobSystem;
+};
+
+/**
+ * \brief Fixed pool of worker threads running small jobs. Each thread has its
+ * own queue, takes its newest job first and steals the oldest job of another
+ * thread when it runs out. Waiting threads run jobs instead of blocking, so
+ * jobs can wait on other jobs. The main thread is thread 0 and only runs jobs
+ * while it waits
+ */
+class ISETTA_API JobSystem {
+ public:
+  struct JobConfig {
+    /// Threads besides the main thread, -1 for one less than the hardware
+    /// threads. With 0 every job runs inline when it is started
+    CVar<int> workerThreads{"job_worker_threads", -1};
+  };
+  /// Most threads there can be, workers plus the main thread, so data kept
+  /// per thread can be sized up front
+  static const int maxThreadCount = 64;
+
+  JobSystem();
+  ~JobSystem();
+
+  /**
+   * \brief Queue job on the calling thread's queue
+   * \param counter Incremented now and decremented once job is done, even if
+   * it throws. Without one, what job throws is only logged
+   */
+  static void Run(const Action<>& job, JobCounter* counter = nullptr);
+  /**
+   * \brief Run other jobs until the counter's jobs are all done, then rethrow
+   * the first exception one of them threw
+   */
+  static void Wait(const JobCounter& counter);
+  /**
+   * \brief Run one queued job if there is any, for threads that wait on
+   * something other than a counter
+   * \return Whether a job was run
+   */
+  static bool RunPendingJob();
+  /**
+   * \brief Call body(begin, end) over [0, count) split in batches of at least
+   * minBatch, and return once all are done. One batch runs on the calling
+   * thread. If a batch throws, the first exception is rethrown once every
+   * batch is done
+   */
+  static void ParallelFor(int count, const Action<int, int>& body,
+                          int minBatch = 1);
+
+  /**
+   * \brief Index of the calling thread, 0 for the main thread and any thread
+   * that isn't a worker
+   */
+  static int GetThreadIndex();
+  /// Workers plus the main thread
+  static int GetThreadCount();
+
+ private:
+  struct Job {
+    Action<> func;
+    JobCounter* counter;
+  };
+  struct JobQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  void StartUp();
+  /// Start the workers with an explicit count, for tests
+  void StartUp(int workerCount);
+  /// Finish the queued jobs and join the workers
+  void ShutDown();
+
+  /// Own queue first, newest job
+  bool Pop(int thread, Job* job);
+  /// Other queues in turn, oldest job
+  bool Steal(int thread, Job* job);
+  bool TryRunJob(int thread);
+  static void Execute(Job* job);
+  void WorkerLoop(int thread);
+
+  static JobSystem* instance;
+
+  /// One per thread, index 0 is the main thread's
+  std::vector<std::unique_ptr<JobQueue>> queues;
+  std::vector<std::thread> workers;
+  /// Jobs in all queues, workers sleep while it's 0
+  std::atomic<int> queuedJobs{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  bool stopping{false};
+
+  friend class EngineLoop;
+  friend class JobSystemTest;
+};
+}  // namespace Isetta
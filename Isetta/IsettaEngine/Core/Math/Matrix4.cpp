@@ -327,6 +327,40 @@ Matrix4 Matrix4::Inverse() const {
   return ret * (1.f / det);
 }
 
+Matrix4 Matrix4::AffineInverse() const {
+  float c11 = data[5] * data[10] - data[6] * data[9];
+  float c12 = data[6] * data[8] - data[4] * data[10];
+  float c13 = data[4] * data[9] - data[5] * data[8];
+  float det = data[0] * c11 + data[1] * c12 + data[2] * c13;
+
+  if (det == 0) {
+    throw std::out_of_range{
+        "Matrix4::AffineInverse => Cannot do inverse when the determinant is "
+        "zero."};
+  }
+
+  float invDet = 1.f / det;
+  Matrix4 ret{};
+  ret.data[0] = c11 * invDet;
+  ret.data[1] = (data[2] * data[9] - data[1] * data[10]) * invDet;
+  ret.data[2] = (data[1] * data[6] - data[2] * data[5]) * invDet;
+  ret.data[4] = c12 * invDet;
+  ret.data[5] = (data[0] * data[10] - data[2] * data[8]) * invDet;
+  ret.data[6] = (data[2] * data[4] - data[0] * data[6]) * invDet;
+  ret.data[8] = c13 * invDet;
+  ret.data[9] = (data[1] * data[8] - data[0] * data[9]) * invDet;
+  ret.data[10] = (data[0] * data[5] - data[1] * data[4]) * invDet;
+  // translation is the inverted 3x3 applied to the negated translation
+  for (int i = 0; i < 3; ++i) {
+    const int row = i << 2;
+    ret.data[row + 3] =
+        -(ret.data[row] * data[3] + ret.data[row + 1] * data[7] +
+          ret.data[row + 2] * data[11]);
+  }
+  ret.data[15] = 1;
+  return ret;
+}
+
 Matrix4 Matrix4::Transpose() const {
   Matrix4 ret{*this};
   std::swap(ret.data[1], ret.data[4]);
@@ -84,6 +84,12 @@ class ISETTA_API Matrix4 {
    * \brief Returns the inverse matrix of the matrix
    */
   Matrix4 Inverse() const;
+  /**
+   * \brief Returns the inverse of an affine matrix, one whose bottom row is
+   * (0, 0, 0, 1). Only inverts the top-left 3x3, so it's a lot cheaper than
+   * Inverse
+   */
+  Matrix4 AffineInverse() const;
   /**
    * \brief Returns the transpose matrix of the matrix
    */
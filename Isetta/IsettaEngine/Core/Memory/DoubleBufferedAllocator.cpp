@@ -18,4 +18,13 @@ void DoubleBufferedAllocator::ClearCurrentBuffer() {
   stacks[curStackIndex].Clear();
 }
 
+AllocatorStats DoubleBufferedAllocator::GetStats() const {
+  AllocatorStats stats = stacks[curStackIndex].GetStats();
+  const AllocatorStats other = stacks[!curStackIndex].GetStats();
+  stats.peakBytes =
+      stats.peakBytes > other.peakBytes ? stats.peakBytes : other.peakBytes;
+  stats.totalAllocs += other.totalAllocs;
+  return stats;
+}
+
 }  // namespace Isetta
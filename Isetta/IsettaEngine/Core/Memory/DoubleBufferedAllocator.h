@@ -43,6 +43,12 @@ class DoubleBufferedAllocator {
    */
   void ClearCurrentBuffer();
 
+  /**
+   * \brief Usage of a single buffer, as that's what the size passed in has to
+   * fit. Bytes in use are the active buffer's, peak is the higher of the two
+   */
+  AllocatorStats GetStats() const;
+
   /**
    * \brief Creates a new object on the active stack allocator, which will
    * become invalid at the end of next frame. You need to manually call
@@ -2,17 +2,96 @@
  * Copyright (c) 2018 Isetta
  */
 #include "Core/Memory/FreeListAllocator.h"
+#include <algorithm>
+#include <atomic>
 #include "Core/Config/Config.h"
 #include "Core/Memory/MemUtil.h"
 
 namespace Isetta {
 
-FreeListAllocator::FreeListAllocator(const Size size) {
+namespace {
+// Only the owning thread writes a cache's counters, so a relaxed load + store
+// is enough and keeps locked instructions off the allocation path
+template <typename T>
+void AddToCounter(std::atomic<T>* counter, const T amount) {
+  counter->store(counter->load(std::memory_order_relaxed) + amount,
+                 std::memory_order_relaxed);
+}
+
+/// Guards detaching thread caches from their allocator. It isn't a member so
+/// an exiting thread can take it after its allocator is gone
+std::mutex cacheOwnerMutex;
+}  // namespace
+
+const Size FreeListAllocator::sizeClasses[numOfSizeClasses] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+/**
+ * \brief Chunks one thread holds on to for one allocator, a bin per size class
+ */
+class FreeListAllocator::ThreadCache {
+ public:
+  explicit ThreadCache(FreeListAllocator* allocator) : allocator(allocator) {}
+
+  struct Bin {
+    ChunkNode* head = nullptr;
+    Size count = 0;
+  };
+
+  Bin bins[numOfSizeClasses];
+  /// Written by the owning thread, read by GetStats under listMutex
+  std::atomic<Size> bytesAllocated{0};
+  std::atomic<Size> bytesFreed{0};
+  std::atomic<U64> allocCount{0};
+  /// Set to nullptr under cacheOwnerMutex when the allocator is destroyed
+  /// before the thread exits
+  std::atomic<FreeListAllocator*> allocator;
+};
+
+/**
+ * \brief All caches of one thread. Caches still attached to an allocator give
+ * their chunks back when the thread exits
+ */
+struct FreeListAllocator::ThreadCacheList {
+  ~ThreadCacheList() {
+    // the allocator can't be destroyed while this is held
+    std::lock_guard<std::mutex> ownerLock{cacheOwnerMutex};
+    for (ThreadCache* cache : caches) {
+      FreeListAllocator* allocator = cache->allocator.load();
+      if (allocator != nullptr) {
+        for (U8 i = 0; i < numOfSizeClasses; ++i) {
+          allocator->ReturnChunks(i, cache, cache->bins[i].count);
+        }
+        std::lock_guard<std::mutex> lock{allocator->listMutex};
+        allocator->retiredBytesAllocated += cache->bytesAllocated;
+        allocator->retiredBytesFreed += cache->bytesFreed;
+        allocator->retiredAllocCount += cache->allocCount;
+        auto& registered = allocator->threadCaches;
+        registered.erase(
+            std::remove(registered.begin(), registered.end(), cache),
+            registered.end());
+      }
+      delete cache;
+    }
+  }
+
+  std::vector<ThreadCache*> caches;
+};
+
+FreeListAllocator::FreeListAllocator(const Size size)
+    : FreeListAllocator(size, CONFIG_VAL(memoryConfig.freeListSizeClasses),
+                        CONFIG_VAL(memoryConfig.freeListZeroMemory)) {}
+
+FreeListAllocator::FreeListAllocator(const Size size,
+                                     const bool useSizeClasses,
+                                     const bool zeroMemory)
+    : useSizeClasses(useSizeClasses), zeroMemory(zeroMemory) {
   memHead = std::malloc(size);
   head = new (memHead) Node(size);
-#if _DEBUG
-  totalSize += size;
-#endif
+  for (U8 i = 0; i < numOfSizeClasses; ++i) {
+    sizeClassArr[i].chunkSize = headerSize + sizeClasses[i];
+  }
+  totalSize = size;
 }
 
 FreeListAllocator::~FreeListAllocator() {
@@ -20,6 +99,15 @@ FreeListAllocator::~FreeListAllocator() {
     return;
   }
 
+  // chunks held by thread caches die with the slabs below
+  {
+    std::lock_guard<std::mutex> ownerLock{cacheOwnerMutex};
+    std::lock_guard<std::mutex> lock{listMutex};
+    for (ThreadCache* cache : threadCaches) {
+      cache->allocator.store(nullptr);
+    }
+  }
+
 #if _DEBUG
   if (sizeUsed > 0) {
     LOG_WARNING(Debug::Channel::Memory,
@@ -57,59 +145,25 @@ FreeListAllocator::~FreeListAllocator() {
 }
 
 void* FreeListAllocator::Alloc(const Size size, const U8 alignment) {
-  if (head == nullptr) {
-    Expand();
-    return Alloc(size, alignment);
-  }
-
   MemUtil::CheckAlignment(alignment);
+#if _DEBUG
+  std::lock_guard<std::recursive_mutex> monitorLock{monitorMutex};
+#endif
 
-  Size need = headerSize + alignment + size;
-  Node* last = nullptr;
-  Node* cur = head;
-  Node* node = nullptr;
-
-  while (cur != nullptr) {
-    if (cur->size >= need) {
-      node = cur;
-      break;
-    }
-    last = cur;
-    cur = cur->next;
-  }
-
-  if (node == nullptr) {
-    Expand();
-    return Alloc(size, alignment);
-  }
-
-  PtrInt rawAddress = reinterpret_cast<PtrInt>(node);
-  rawAddress += headerSize;  // leave size for header
-  PtrInt misAlignment = rawAddress & (alignment - 1);
-  U64 adjustment = alignment - misAlignment;
-  PtrInt alignedAddress = rawAddress + adjustment;
-  PtrInt headerAddress = alignedAddress - headerSize;
-
-  Size occupiedSize = headerSize + adjustment + size;
   Size allocSize;
+  void* ret;
+  const U8 classIndex =
+      useSizeClasses ? GetSizeClassIndex(size) : numOfSizeClasses;
 
-  if (node->size >= occupiedSize + nodeSize) {
-    // enough space to put a node here
-    Node* newNode = new (reinterpret_cast<void*>(alignedAddress + size))
-        Node(node->size - occupiedSize);
-
-    InsertNodeAt(node, newNode);
-    allocSize = occupiedSize;
+  if (classIndex < numOfSizeClasses && alignment <= MemUtil::ALIGNMENT) {
+    ret = AllocFromSizeClass(classIndex, allocSize);
   } else {
-    // not enough space left for node
-    allocSize = node->size;
+    std::lock_guard<std::mutex> lock{listMutex};
+    ret = AllocFromList(size, alignment, allocSize);
+    listBytesInUse += allocSize;
+    ++listAllocCount;
   }
 
-  RemoveNode(last, node);
-
-  // new headers will be reclaimed during "free" process
-  new (reinterpret_cast<void*>(headerAddress))
-      AllocHeader(allocSize, adjustment);
 #if _DEBUG
   sizeUsed += allocSize;
   if (monitorPureAlloc) {
@@ -127,8 +181,9 @@ void* FreeListAllocator::Alloc(const Size size, const U8 alignment) {
   }
 #endif
 
-  void* ret = reinterpret_cast<void*>(alignedAddress);
-  memset(ret, 0, size);
+  if (zeroMemory) {
+    memset(ret, 0, size);
+  }
   return ret;
 }
 
@@ -136,6 +191,7 @@ void FreeListAllocator::Free(void* memPtr) {
   PtrInt allocHeaderAdd = reinterpret_cast<PtrInt>(memPtr) - headerSize;
   auto* allocHeader = reinterpret_cast<AllocHeader*>(allocHeaderAdd);
 #if _DEBUG
+  std::lock_guard<std::recursive_mutex> monitorLock{monitorMutex};
   sizeUsed -= allocHeader->size;
   if (monitorPureAlloc) {
     numOfFrees++;
@@ -152,12 +208,17 @@ void FreeListAllocator::Free(void* memPtr) {
     }
   }
 #endif
+  if (allocHeader->adjustment == 0) {
+    FreeToSizeClass(allocHeader);
+    return;
+  }
+
   PtrInt nodeAddress = allocHeaderAdd - allocHeader->adjustment;
   auto* newNode =
       new (reinterpret_cast<void*>(nodeAddress)) Node(allocHeader->size);
 
-  memset(newNode + 1, 0x0, newNode->size - nodeSize);
-
+  std::lock_guard<std::mutex> lock{listMutex};
+  listBytesInUse -= newNode->size;
   InsertNode(newNode);
 }
 
@@ -167,22 +228,246 @@ void* FreeListAllocator::Realloc(void* memPtr, const Size newSize,
   auto* allocHeader = reinterpret_cast<AllocHeader*>(allocHeaderAdd);
 
   void* dest = Alloc(newSize, alignment);
-  memcpy(dest, memPtr, Math::Util::Min(allocHeader->size, newSize));
+  memcpy(dest, memPtr,
+         Math::Util::Min(GetUsableSize(allocHeader), newSize));
   Free(memPtr);
   return dest;
 }
 
+U8 FreeListAllocator::GetSizeClassIndex(const Size size) {
+  // indexed by size rounded up to 16 bytes, divided by 16
+  static const U8 lookup[] = {0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6,
+                              6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 8,
+                              8, 9, 9, 9, 9, 9, 9, 9, 9};
+  const Size slot = (size + 15) >> 4;
+  if (slot >= sizeof(lookup) / sizeof(lookup[0])) {
+    return numOfSizeClasses;
+  }
+  return lookup[slot];
+}
+
+void* FreeListAllocator::AllocFromSizeClass(const U8 classIndex,
+                                            Size& outAllocSize) {
+  ThreadCache* cache = GetThreadCache();
+  ThreadCache::Bin& bin = cache->bins[classIndex];
+  if (bin.head == nullptr) {
+    TakeChunks(classIndex, cache);
+  }
+
+  ChunkNode* chunk = bin.head;
+  bin.head = chunk->next;
+  --bin.count;
+
+  const Size chunkSize = sizeClassArr[classIndex].chunkSize;
+  AddToCounter(&cache->bytesAllocated, chunkSize);
+  AddToCounter<U64>(&cache->allocCount, 1);
+  new (chunk) AllocHeader(chunkSize, 0);
+  outAllocSize = chunkSize;
+  return reinterpret_cast<void*>(reinterpret_cast<PtrInt>(chunk) +
+                                 headerSize);
+}
+
+void* FreeListAllocator::AllocFromList(const Size size, const U8 alignment,
+                                       Size& outAllocSize) {
+  if (head == nullptr) {
+    Expand();
+    return AllocFromList(size, alignment, outAllocSize);
+  }
+
+  Size need = headerSize + alignment + size;
+  Node* last = nullptr;
+  Node* cur = head;
+  Node* node = nullptr;
+
+  while (cur != nullptr) {
+    if (cur->size >= need) {
+      node = cur;
+      break;
+    }
+    last = cur;
+    cur = cur->next;
+  }
+
+  if (node == nullptr) {
+    Expand();
+    return AllocFromList(size, alignment, outAllocSize);
+  }
+
+  PtrInt rawAddress = reinterpret_cast<PtrInt>(node);
+  rawAddress += headerSize;  // leave size for header
+  PtrInt misAlignment = rawAddress & (alignment - 1);
+  U64 adjustment = alignment - misAlignment;
+  PtrInt alignedAddress = rawAddress + adjustment;
+  PtrInt headerAddress = alignedAddress - headerSize;
+
+  Size occupiedSize = headerSize + adjustment + size;
+  Size allocSize;
+
+  if (node->size >= occupiedSize + nodeSize) {
+    // enough space to put a node here
+    Node* newNode = new (reinterpret_cast<void*>(alignedAddress + size))
+        Node(node->size - occupiedSize);
+
+    InsertNodeAt(node, newNode);
+    allocSize = occupiedSize;
+  } else {
+    // not enough space left for node
+    allocSize = node->size;
+  }
+
+  RemoveNode(last, node);
+
+  // new headers will be reclaimed during "free" process
+  new (reinterpret_cast<void*>(headerAddress))
+      AllocHeader(allocSize, adjustment);
+
+  outAllocSize = allocSize;
+  return reinterpret_cast<void*>(alignedAddress);
+}
+
+void FreeListAllocator::FreeToSizeClass(AllocHeader* allocHeader) {
+  const U8 classIndex = GetSizeClassIndex(allocHeader->size - headerSize);
+  ASSERT(sizeClassArr[classIndex].chunkSize == allocHeader->size);
+
+  // the chunk may come from another thread's cache, it simply joins this one
+  ThreadCache* cache = GetThreadCache();
+  ThreadCache::Bin& bin = cache->bins[classIndex];
+  AddToCounter(&cache->bytesFreed, sizeClassArr[classIndex].chunkSize);
+  bin.head = new (allocHeader) ChunkNode{bin.head};
+  if (++bin.count > maxCachedChunks) {
+    ReturnChunks(classIndex, cache, cacheBatchCount);
+  }
+}
+
+void FreeListAllocator::RefillSizeClass(SizeClass* sizeClass) {
+  // the slab itself is a regular block from the sorted list that's never freed
+  Size slabAllocSize;
+  void* slab = AllocFromList(slabSize, MemUtil::ALIGNMENT, slabAllocSize);
+  const Size count = slabSize / sizeClass->chunkSize;
+
+  PtrInt address = reinterpret_cast<PtrInt>(slab);
+  for (Size i = 0; i < count; ++i) {
+    sizeClass->head =
+        new (reinterpret_cast<void*>(address)) ChunkNode{sizeClass->head};
+    address += sizeClass->chunkSize;
+  }
+}
+
+FreeListAllocator::ThreadCache* FreeListAllocator::GetThreadCache() {
+  thread_local ThreadCacheList threadCacheList;
+
+  auto& caches = threadCacheList.caches;
+  for (ThreadCache* cache : caches) {
+    if (cache->allocator.load(std::memory_order_relaxed) == this) {
+      return cache;
+    }
+  }
+
+  // drop caches of allocators that are already gone
+  for (auto it = caches.begin(); it != caches.end();) {
+    if ((*it)->allocator.load() == nullptr) {
+      delete *it;
+      it = caches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  auto* cache = new ThreadCache{this};
+  caches.push_back(cache);
+  std::lock_guard<std::mutex> lock{listMutex};
+  threadCaches.push_back(cache);
+  return cache;
+}
+
+void FreeListAllocator::TakeChunks(const U8 classIndex, ThreadCache* cache) {
+  ThreadCache::Bin& bin = cache->bins[classIndex];
+  SizeClass& sizeClass = sizeClassArr[classIndex];
+
+  std::lock_guard<std::mutex> lock{listMutex};
+  for (Size i = 0; i < cacheBatchCount; ++i) {
+    if (sizeClass.head == nullptr) {
+      RefillSizeClass(&sizeClass);
+    }
+    ChunkNode* chunk = sizeClass.head;
+    sizeClass.head = chunk->next;
+    chunk->next = bin.head;
+    bin.head = chunk;
+    ++bin.count;
+  }
+}
+
+void FreeListAllocator::ReturnChunks(const U8 classIndex, ThreadCache* cache,
+                                     const Size count) {
+  if (count == 0) {
+    return;
+  }
+
+  // unlink the batch before taking the lock
+  ThreadCache::Bin& bin = cache->bins[classIndex];
+  ASSERT(count <= bin.count);
+  ChunkNode* first = bin.head;
+  ChunkNode* last = first;
+  for (Size i = 1; i < count; ++i) {
+    last = last->next;
+  }
+  bin.head = last->next;
+  bin.count -= count;
+
+  SizeClass& sizeClass = sizeClassArr[classIndex];
+  std::lock_guard<std::mutex> lock{listMutex};
+  last->next = sizeClass.head;
+  sizeClass.head = first;
+}
+
+Size FreeListAllocator::GetUsableSize(const AllocHeader* allocHeader) {
+  if (allocHeader->adjustment == 0) {
+    return allocHeader->size - headerSize;
+  }
+  return allocHeader->size - headerSize - allocHeader->adjustment;
+}
+
 void FreeListAllocator::Expand() {
   Size increment = CONFIG_VAL(memoryConfig.freeListIncrement);
   void* newMem = std::malloc(increment);
   Node* newNode = new (newMem) Node{increment};
   InsertNode(newNode);
   additionalMemory.push_back(newMem);
+  totalSize += increment;
+  ++expandCount;
   LOG_INFO(Debug::Channel::Memory, "Freelist just expanded by %I64u",
            increment);
-#if _DEBUG
-  totalSize += increment;
-#endif
+}
+
+AllocatorStats FreeListAllocator::GetStats() {
+  AllocatorStats stats;
+  std::lock_guard<std::mutex> lock{listMutex};
+
+  Size bytesAllocated = retiredBytesAllocated;
+  Size bytesFreed = retiredBytesFreed;
+  stats.totalAllocs = retiredAllocCount + listAllocCount;
+  for (ThreadCache* cache : threadCaches) {
+    bytesAllocated += cache->bytesAllocated.load(std::memory_order_relaxed);
+    bytesFreed += cache->bytesFreed.load(std::memory_order_relaxed);
+    stats.totalAllocs += cache->allocCount.load(std::memory_order_relaxed);
+  }
+  // a chunk can be freed by another thread than the one that allocated it, so
+  // only the sums balance out
+  stats.bytesInUse = listBytesInUse + bytesAllocated - bytesFreed;
+  stats.capacity = totalSize;
+  stats.expandCount = expandCount;
+
+  Size freeSize = 0;
+  Size largestFreeSize = 0;
+  for (Node* node = head; node != nullptr; node = node->next) {
+    freeSize += node->size;
+    largestFreeSize = std::max(largestFreeSize, node->size);
+  }
+  if (freeSize > 0) {
+    stats.fragmentation =
+        1.f - static_cast<float>(largestFreeSize) / freeSize;
+  }
+  return stats;
 }
 
 void FreeListAllocator::RemoveNode(Node* last, Node* nodeToRemove) {
@@ -241,7 +526,6 @@ void FreeListAllocator::TryMergeWithNext(Node* node) {
     // if the adjacent next address is a node
     node->size += node->next->size;
     node->next = node->next->next;
-    memset(node + 1, 0x0, node->size - nodeSize);
     // the original node->next is effectively deleted cause no one has reference
     // to it
   }
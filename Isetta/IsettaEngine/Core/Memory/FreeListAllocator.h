@@ -2,9 +2,11 @@
  * Copyright (c) 2018 Isetta
  */
 #pragma once
+#include <mutex>
 #include <vector>
 #include "Core/Debug/Assert.h"
 #include "Core/IsettaAlias.h"
+#include "Core/Memory/MemoryStats.h"
 #include "ISETTA_API.h"
 #include "MemUtil.h"
 #include "SID/sid.h"
@@ -18,6 +20,18 @@ namespace Isetta {
  * It's easy to find the next Node. Merging with last node can be done during
  * insertion
  * 3. Satisfy alignment requirement
+ *
+ * Small requests (up to the last size class, with default alignment) never
+ * touch the sorted list. They are served in O(1) from per-size-class slabs,
+ * which are carved out of the sorted list and never given back to it. Only
+ * large blocks go through the first-fit + coalescing path.
+ *
+ * Thread safety: every thread keeps its own cache of size class chunks, so
+ * small Alloc/Free don't lock. A thread takes chunks from the shared size class
+ * in batches when its cache runs dry and hands them back in batches when it
+ * holds too many, which is also how memory freed on another thread finds its
+ * way back. The sorted list and the shared size classes are behind a mutex.
+ * All threads must stop using the allocator before it is destroyed.
  */
 // TODO(YIDI): Optimize to use a red black tree as underlying structure to
 // reduce time complexity
@@ -25,13 +39,31 @@ class ISETTA_API FreeListAllocator {
  public:
   // This class is using RAII
   FreeListAllocator() = delete;
+  /**
+   * \brief Create a free list allocator, size classes and zeroing are read
+   * from memory config
+   */
   explicit FreeListAllocator(Size size);
+  /**
+   * \brief Create a free list allocator
+   * \param size Initial size in byte
+   * \param useSizeClasses Serve small allocations from size class slabs
+   * \param zeroMemory memset every allocation to 0 before returning it
+   */
+  FreeListAllocator(Size size, bool useSizeClasses, bool zeroMemory);
   ~FreeListAllocator();
 
   void* Alloc(Size size, U8 alignment);
   void Free(void* memPtr);
   void* Realloc(void* memPtr, Size newSize, U8 alignment);
 
+  /**
+   * \brief Current usage of the allocator. Counters are kept per thread cache
+   * and only summed here, so this takes the list lock and walks the sorted
+   * list to measure fragmentation. Meant to be called once per frame at most
+   */
+  AllocatorStats GetStats();
+
   template <typename T, typename... Args>
   T* New(Args... args);
   template <typename T>
@@ -48,6 +80,8 @@ class ISETTA_API FreeListAllocator {
     explicit Node(const Size size) : size(size), next(nullptr) {}
   };
 
+  // adjustment is never 0 for blocks from the sorted list, so 0 marks a
+  // block that lives in a size class slab. In that case size is the chunk size
   struct AllocHeader {
     Size size;
     U64 adjustment;  // using U64 for alignment. U8 is big enough
@@ -55,6 +89,49 @@ class ISETTA_API FreeListAllocator {
         : size(size), adjustment(adjustment) {}
   };
 
+  // Same trick as PoolAllocator, free chunks store the next pointer in place
+  union ChunkNode {
+    ChunkNode* next;
+    explicit ChunkNode(ChunkNode* next) { this->next = next; }
+  };
+
+  struct SizeClass {
+    ChunkNode* head = nullptr;
+    Size chunkSize{};  // header included
+  };
+
+  class ThreadCache;
+  struct ThreadCacheList;
+
+  static const U8 numOfSizeClasses = 10;
+  static const Size sizeClasses[numOfSizeClasses];
+  static const Size slabSize = 16384;
+  /// Number of chunks moved between a thread cache and a shared size class
+  static const Size cacheBatchCount = 32;
+  /// A thread cache returns a batch once one of its bins holds more than this
+  static const Size maxCachedChunks = 2 * cacheBatchCount;
+
+  /**
+   * \brief Index of the smallest size class that fits size, or
+   * numOfSizeClasses if it's too big for any of them
+   */
+  static U8 GetSizeClassIndex(Size size);
+  void* AllocFromSizeClass(U8 classIndex, Size& outAllocSize);
+  void* AllocFromList(Size size, U8 alignment, Size& outAllocSize);
+  void FreeToSizeClass(AllocHeader* allocHeader);
+  void RefillSizeClass(SizeClass* sizeClass);
+  static Size GetUsableSize(const AllocHeader* allocHeader);
+
+  /**
+   * \brief Get the calling thread's cache for this allocator, creating it on
+   * first use
+   */
+  ThreadCache* GetThreadCache();
+  /// Move up to cacheBatchCount chunks from the shared size class to the cache
+  void TakeChunks(U8 classIndex, ThreadCache* cache);
+  /// Move count chunks from the cache back to the shared size class
+  void ReturnChunks(U8 classIndex, ThreadCache* cache, Size count);
+
   void Expand();
   void RemoveNode(Node* last, Node* nodeToRemove);
   void InsertNode(Node* newNode);
@@ -64,6 +141,23 @@ class ISETTA_API FreeListAllocator {
   Node* head = nullptr;
   void* memHead = nullptr;
   std::vector<void*> additionalMemory;
+  SizeClass sizeClassArr[numOfSizeClasses];
+  bool useSizeClasses;
+  bool zeroMemory;
+
+  /// Guards the sorted list, the shared size classes and threadCaches
+  std::mutex listMutex;
+  std::vector<ThreadCache*> threadCaches;
+
+  // stats, all guarded by listMutex. Size class traffic is counted in the
+  // thread caches and folded into the retired counters when a thread exits
+  Size totalSize{0};
+  Size listBytesInUse{0};
+  U64 listAllocCount{0};
+  Size retiredBytesAllocated{0};
+  Size retiredBytesFreed{0};
+  U64 retiredAllocCount{0};
+  U32 expandCount{0};
 
   // A lesson learned here: if these two variables are not static, it will
   // implicitly involve in the copy constructor's copying process. But as they
@@ -73,7 +167,6 @@ class ISETTA_API FreeListAllocator {
   static const Size headerSize = sizeof(AllocHeader);
 
 #if _DEBUG
-  Size totalSize{0};
   Size sizeUsed{0};
   Size numOfNews{0};
   Size numOfDeletes{0};
@@ -85,6 +178,8 @@ class ISETTA_API FreeListAllocator {
   std::unordered_map<StringId, Allocations> monitor;
   std::unordered_map<U64, std::string> vtableToNameMap;
   bool monitorPureAlloc = true;
+  /// The leak monitor isn't thread safe, so debug builds serialize on this
+  std::recursive_mutex monitorMutex;
   void Print() const;
 #endif
 
@@ -94,6 +189,7 @@ class ISETTA_API FreeListAllocator {
 template <typename T, typename... Args>
 T* FreeListAllocator::New(Args... args) {
 #if _DEBUG
+  std::lock_guard<std::recursive_mutex> lock{monitorMutex};
   numOfNews++;
   monitorPureAlloc = false;
   T* ret = new (Alloc(sizeof(T), MemUtil::ALIGNMENT)) T(args...);
@@ -122,6 +218,7 @@ T* FreeListAllocator::New(Args... args) {
 template <typename T>
 void FreeListAllocator::Delete(T* t) {
 #if _DEBUG
+  std::lock_guard<std::recursive_mutex> lock{monitorMutex};
   numOfDeletes++;
   std::string name;
 
@@ -157,6 +254,7 @@ template <typename T>
 T* FreeListAllocator::NewArr(Size length, const U8 alignment) {
   ASSERT(length != 0);
 #if _DEBUG
+  std::lock_guard<std::recursive_mutex> lock{monitorMutex};
   monitorPureAlloc = false;
   void* alloc = Alloc(sizeof(T) * length, alignment);
   monitorPureAlloc = true;
@@ -185,14 +283,16 @@ T* FreeListAllocator::NewArr(Size length, const U8 alignment) {
   void* alloc = Alloc(sizeof(T) * length, alignment);
 #endif
 
+  // value initialize so arrays of PODs start zeroed even without zeroMemory
   char* allocAddress = static_cast<char*>(alloc);
-  for (Size i = 0; i < length; ++i) new (allocAddress + i * sizeof(T)) T;
+  for (Size i = 0; i < length; ++i) new (allocAddress + i * sizeof(T)) T();
   return static_cast<T*>(alloc);
 }
 
 template <typename T>
 void FreeListAllocator::DeleteArr(const Size length, T* ptrToDelete) {
 #if _DEBUG
+  std::lock_guard<std::recursive_mutex> lock{monitorMutex};
   numOfArrDeletes++;
   std::string name;
 
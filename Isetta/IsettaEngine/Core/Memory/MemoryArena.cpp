@@ -3,6 +3,7 @@
  */
 #include "Core/Memory/MemoryArena.h"
 
+#include <algorithm>
 #include "Core/DataStructures/Array.h"
 #include "Core/Debug/Assert.h"
 #include "Core/Debug/Logger.h"
@@ -13,8 +14,8 @@
 
 namespace Isetta {
 
-// TODO(YIDI): find a way to allow specifying from config
-HandleEntry MemoryArena::entryArr[maxHandleCount];
+std::vector<HandleEntry> MemoryArena::entryArr;
+U32 MemoryArena::freeEntryHead = invalidIndex;
 
 MemoryArena::MemoryArena(const Size size) {
   memHead = std::malloc(size);
@@ -31,13 +32,13 @@ void* MemoryArena::Alloc(const Size size, Size& outSize) {
   PtrInt lastAddress;
   Size lastSize;
 
-  if (addressIndexMap.empty()) {
+  if (addressIndex.empty()) {
     lastAddress = leftAddress;
     lastSize = 0;
   } else {
-    auto lastPair = --addressIndexMap.end();
-    lastAddress = lastPair->first;
-    lastSize = entryArr[lastPair->second].size;
+    const auto& lastEntry = entryArr[addressIndex.back()];
+    lastAddress = lastEntry.GetAddress();
+    lastSize = lastEntry.size;
   }
 
   PtrInt rawAddress = lastAddress + lastSize;
@@ -53,20 +54,35 @@ void* MemoryArena::Alloc(const Size size, Size& outSize) {
   }
 
   outSize = size + adjustment;
+  liveSize += outSize;
+  const Size usedSize = alignedAddress + size - leftAddress;
+  peakUsedSize = usedSize > peakUsedSize ? usedSize : peakUsedSize;
+  ++allocCount;
   return reinterpret_cast<void*>(alignedAddress);
 }
 
-void MemoryArena::Defragment() {
+void MemoryArena::Defragment(const Size byteBudget) {
   PROFILE
-  if (addressIndexMap.empty()) return;
+  if (compacted || addressIndex.empty()) return;
 
-  for (int i = 0; i < 6; ++i) {
-    ++curIndex;
-    if (curIndex >= addressIndexMap.size()) {
+  Size bytesMoved = 0;
+  for (Size visited = 0; visited < addressIndex.size(); ++visited) {
+    if (curIndex >= addressIndex.size()) {
       curIndex = 0;
     }
-    MoveLeft(curIndex);
-    // LOG_INFO(Debug::Channel::Memory, "Cur size: %I64u", GetUsedSize());
+    const auto& entry = entryArr[addressIndex[curIndex]];
+    if (bytesMoved > 0 && bytesMoved + entry.size > byteBudget) {
+      break;
+    }
+    const Size moved = MoveLeft(curIndex);
+    bytesMoved += moved;
+    visitedSinceMove = moved > 0 ? 0 : visitedSinceMove + 1;
+    ++curIndex;
+    // every object sits right after the one before it
+    if (visitedSinceMove >= addressIndex.size()) {
+      compacted = true;
+      break;
+    }
   }
 }
 
@@ -80,67 +96,98 @@ PtrInt NextMultiplyOfBase(const PtrInt number, const U32 base) {
   return number + adjustment;
 }
 
-void MemoryArena::MoveLeft(const U32 index) {
-  ASSERT(index <= addressIndexMap.size() - 1);
-  // LOG_INFO(Debug::Channel::Memory, "Trying to align %d", index);
+Size MemoryArena::MoveLeft(const U32 position) {
+  ASSERT(position < addressIndex.size());
 
-  Array<int> arr;
-  arr.Reserve(addressIndexMap.size());
-  for (const auto& pair : addressIndexMap) {
-    arr.PushBack(pair.second);
-  }
-
-  const auto& entry = entryArr[arr[index]];
+  const auto& entry = entryArr[addressIndex[position]];
 
   PtrInt lastAvailableAddress;
-  if (index == 0) {
+  if (position == 0) {
     lastAvailableAddress = leftAddress;
   } else {
-    const auto& lastEntry = entryArr[arr[index - 1]];
+    const auto& lastEntry = entryArr[addressIndex[position - 1]];
     lastAvailableAddress = lastEntry.GetAddress() + lastEntry.size;
   }
 
   lastAvailableAddress =
       NextMultiplyOfBase(lastAvailableAddress, MemUtil::ALIGNMENT);
 
-  if (lastAvailableAddress < entry.GetAddress()) {
-    void* newAdd = reinterpret_cast<void*>(lastAvailableAddress);
-    // remove from map and add back
-    addressIndexMap.erase(
-        addressIndexMap.find(reinterpret_cast<PtrInt>(entry.ptr)));
-    addressIndexMap.emplace(reinterpret_cast<PtrInt>(newAdd), arr[index]);
-
-    std::memmove(newAdd, entry.ptr, entry.size);
-    // LOG_INFO(Debug::Channel::Memory, "Moving from %p to %p of size %u",
-    // entry.ptr, lastAvailableAddress, entry.size);
-    entry.ptr = newAdd;
+  if (lastAvailableAddress >= entry.GetAddress()) {
+    return 0;
+  }
+
+  // never passes the entry on its left, so addressIndex stays sorted
+  void* newAdd = reinterpret_cast<void*>(lastAvailableAddress);
+  std::memmove(newAdd, entry.ptr, entry.size);
+  entry.ptr = newAdd;
+  return entry.size;
+}
+
+U32 MemoryArena::AcquireHandleEntry() {
+  if (freeEntryHead == invalidIndex) {
+    const U32 oldCount = static_cast<U32>(entryArr.size());
+    const U32 newCount = oldCount == 0 ? initialHandleCount : oldCount * 2;
+    entryArr.resize(newCount);
+    // push back to front so lower slots are handed out first
+    for (U32 i = newCount; i > oldCount; --i) {
+      entryArr[i - 1].nextFree = freeEntryHead;
+      freeEntryHead = i - 1;
+    }
+  }
+
+  const U32 index = freeEntryHead;
+  freeEntryHead = entryArr[index].nextFree;
+  entryArr[index].nextFree = invalidIndex;
+  return index;
+}
+
+void MemoryArena::ReleaseHandleEntry(const U32 index) {
+  HandleEntry& entry = entryArr[index];
+  ++entry.generation;
+  entry.nextFree = freeEntryHead;
+  freeEntryHead = index;
+}
+
+Size MemoryArena::FindAddressPosition(const PtrInt address) const {
+  auto it = std::lower_bound(addressIndex.begin(), addressIndex.end(), address,
+                             [](const U32 index, const PtrInt address) {
+                               return entryArr[index].GetAddress() < address;
+                             });
+  if (it == addressIndex.end() || entryArr[*it].GetAddress() != address) {
+    return addressIndex.size();
   }
+  return it - addressIndex.begin();
 }
 
 void MemoryArena::Print() const {
   LOG_INFO(Debug::Channel::Memory, "[address, index, size]");
   int count = 0;
-  for (const auto& pair : addressIndexMap) {
-    LOG_INFO(Debug::Channel::Memory, "%d [%p, %d, %u]", count++, pair.first,
-             pair.second, entryArr[pair.second].size);
+  for (U32 index : addressIndex) {
+    LOG_INFO(Debug::Channel::Memory, "%d [%p, %d, %u]", count++,
+             entryArr[index].ptr, index, entryArr[index].size);
   }
 }
 
 PtrInt MemoryArena::GetUsedSize() const {
-  PtrInt lastAddress;
-  Size lastSize;
-
-  if (addressIndexMap.empty()) {
-    lastAddress = leftAddress;
-    lastSize = 0;
-  } else {
-    auto lastPair = --addressIndexMap.end();
-    lastAddress = lastPair->first;
-    lastSize = entryArr[lastPair->second].size;
+  if (addressIndex.empty()) {
+    return 0;
   }
-  auto lastPair = --addressIndexMap.end();
 
-  return (lastAddress + lastSize) - leftAddress;
+  const auto& lastEntry = entryArr[addressIndex.back()];
+  return (lastEntry.GetAddress() + lastEntry.size) - leftAddress;
+}
+
+AllocatorStats MemoryArena::GetStats() const {
+  AllocatorStats stats;
+  stats.capacity = rightAddress - leftAddress;
+  stats.bytesInUse = liveSize;
+  stats.peakBytes = peakUsedSize;
+  stats.totalAllocs = allocCount;
+  const PtrInt usedSize = GetUsedSize();
+  if (usedSize > 0) {
+    stats.fragmentation = 1.f - static_cast<float>(liveSize) / usedSize;
+  }
+  return stats;
 }
 
 }  // namespace Isetta
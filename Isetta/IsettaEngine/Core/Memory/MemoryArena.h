@@ -2,13 +2,15 @@
  * Copyright (c) 2018 Isetta
  */
 #pragma once
-#include <map>
+#include <vector>
 #include "Core/IsettaAlias.h"
+#include "Core/Memory/MemoryStats.h"
 
 namespace Isetta {
 
 template <typename T>
 class ObjectHandle;
+class HandleEntry;
 
 class MemoryArena {
  private:
@@ -54,17 +56,42 @@ class MemoryArena {
 
   /**
    * \brief Defragment the memory arena. This should be called by the memory
-   * manager
+   * manager once per frame. It picks up where the last call stopped and moves
+   * at most byteBudget bytes, except that one object is always allowed to move
+   * so objects bigger than the budget don't block compaction. Once a full lap
+   * moves nothing it does nothing until the next delete
+   * \param byteBudget Max number of bytes to move in this call
    */
-  void Defragment();
+  void Defragment(Size byteBudget);
 
   /**
    * \brief A helper function used to move a memory chunk to the left, eliminate
    * free space between it and the object immediately to its left
-   * \param index
-   * Index of the entry to move
+   * \param position Position of the entry in the address index
+   * \return Number of bytes moved, 0 if it's already packed
    */
-  void MoveLeft(U32 index);
+  Size MoveLeft(U32 position);
+
+  /**
+   * \brief Take a slot from the free slot list, growing the handle table if
+   * it's empty. O(1) amortized
+   * \return Index of the slot
+   */
+  static U32 AcquireHandleEntry();
+
+  /**
+   * \brief Bump the slot's generation so outstanding handles go stale and put
+   * it back on the free slot list
+   * \param index Index of the slot
+   */
+  static void ReleaseHandleEntry(U32 index);
+
+  /**
+   * \brief Binary search the address index
+   * \return Position of the entry at address, or addressIndex.size() if no
+   * object lives there
+   */
+  Size FindAddressPosition(PtrInt address) const;
 
   /// only for internal debugging
   void Print() const;
@@ -72,15 +99,34 @@ class MemoryArena {
   /// only for internal use
   PtrInt GetUsedSize() const;
 
-  // can't be put in ObjectHandle because it creates new ones for each type
-  static const U32 maxHandleCount = 2048;
-  static inline U32 nextUniqueID = 0;
-  static class HandleEntry entryArr[];
+  /**
+   * \brief Bytes in use are the live objects, while fragmentation is the share
+   * of the used range that is gaps waiting to be defragmented
+   */
+  AllocatorStats GetStats() const;
 
-  // TODO(YIDI): Make a custom container rather than using map
-  // O(1) random access, O(log n) insert
-  std::map<PtrInt, int> addressIndexMap;
+  // can't be put in ObjectHandle because it creates new ones for each type
+  static const U32 initialHandleCount = 2048;
+  static const U32 invalidIndex = U32_MAX;
+  static std::vector<HandleEntry> entryArr;
+  /// Head of the intrusive free slot list threaded through entryArr
+  static U32 freeEntryHead;
+
+  /// Handle entry indices sorted by object address. Objects are only ever
+  /// allocated at the top and only move left without passing each other, so
+  /// the order stays valid without re-sorting
+  std::vector<U32> addressIndex;
+  /// Position in addressIndex where the next Defragment starts
   U32 curIndex = 0;
+  /// Entries Defragment visited in a row without moving any
+  Size visitedSinceMove = 0;
+  /// Nothing to move until a delete leaves a gap
+  bool compacted = true;
+  /// Bytes held by live objects, gaps left by deleted ones not included
+  Size liveSize{};
+  /// Highest GetUsedSize() so far, which is what has to fit in the arena
+  Size peakUsedSize{};
+  U64 allocCount{};
   PtrInt leftAddress{};
   PtrInt rightAddress{};
   void* memHead{};
@@ -97,18 +143,29 @@ ObjectHandle<T> MemoryArena::NewDynamic(args... argList) {
   // is optimal
   Size size;
   void* mem = Alloc(sizeof(T), size);
-  auto handle = ObjectHandle<T>{mem, nextUniqueID++, size, argList...};
-  addressIndexMap.emplace(handle.GetObjAddress(), handle.index);
+  auto handle = ObjectHandle<T>{mem, AcquireHandleEntry(), size, argList...};
+  // always allocated at the top, so it's also the last in address order
+  addressIndex.push_back(handle.index);
+  // placed right after the last object, so it leaves no gap to defragment
+  // and an arena that was compacted still is
+  visitedSinceMove = 0;
   return handle;
 }
 
 template <typename T>
 void MemoryArena::DeleteDynamic(const ObjectHandle<T>& objToDelete) {
-  auto addressIndexPair = addressIndexMap.find(objToDelete.GetObjAddress());
-
-  if (addressIndexPair != addressIndexMap.end()) {
-    addressIndexMap.erase(addressIndexPair);
+  Size position = FindAddressPosition(objToDelete.GetObjAddress());
+
+  if (position != addressIndex.size()) {
+    addressIndex.erase(addressIndex.begin() + position);
+    liveSize -= entryArr[objToDelete.index].size;
+    if (curIndex > position) {
+      --curIndex;
+    }
+    compacted = false;
+    visitedSinceMove = 0;
     objToDelete.EraseObject();
+    ReleaseHandleEntry(objToDelete.index);
   } else {
     throw std::exception{
         "MemoryArena::DeleteDynamic => Double deleting handle!"};
@@ -2,8 +2,11 @@
  * Copyright (c) 2018 Isetta
  */
 #include "Core/Memory/MemoryManager.h"
+#include <algorithm>
+#include <mutex>
 #include "Core/Config/Config.h"
 #include "Core/DataStructures/Array.h"
+#include "Core/Filesystem.h"
 #include "Core/Math/Random.h"
 #include "Core/Memory/ObjectHandle.h"
 #include "Util.h"
@@ -13,13 +16,63 @@ namespace Isetta {
 
 MemoryManager* MemoryManager::instance;
 
+namespace {
+// Guards the worker allocator lists and liveGeneration. It isn't a member so a
+// thread exiting after the memory manager is gone can still take it
+std::mutex workerAllocatorMutex;
+// Generation of the memory manager alive, 0 once it's destroyed. Told apart
+// by generation, as a new one can be created at the address of the last
+U64 liveGeneration = 0;
+U64 lastGeneration = 0;
+
+// Arenas of the calling thread, and the generation of the memory manager that
+// created them
+thread_local U64 threadAllocatorGeneration = 0;
+thread_local StackAllocator* threadSingleFrameAllocator = nullptr;
+thread_local DoubleBufferedAllocator* threadDoubleBufferedAllocator = nullptr;
+}  // namespace
+
+/// Owns the arenas of a worker thread, releasing them when the thread exits
+/// rather than holding them until shutdown
+class MemoryManager::WorkerArenas {
+ public:
+  ~WorkerArenas() { Release(); }
+
+  void Release() {
+    std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+    // otherwise the memory manager already deleted them
+    if (generation != 0 && generation == liveGeneration) {
+      MemoryManager* memoryManager = MemoryManager::instance;
+      Erase(&memoryManager->workerSingleFrameAllocators, singleFrame);
+      Erase(&memoryManager->workerDoubleBufferedAllocators, doubleBuffered);
+      delete singleFrame;
+      delete doubleBuffered;
+    }
+    generation = 0;
+    singleFrame = nullptr;
+    doubleBuffered = nullptr;
+  }
+
+  U64 generation = 0;
+  StackAllocator* singleFrame = nullptr;
+  DoubleBufferedAllocator* doubleBuffered = nullptr;
+
+ private:
+  template <typename T>
+  static void Erase(std::vector<T*>* allocators, T* allocator) {
+    allocators->erase(
+        std::remove(allocators->begin(), allocators->end(), allocator),
+        allocators->end());
+  }
+};
+
 void* MemoryManager::AllocOnSingleFrame(const Size size, const U8 alignment) {
-  return GetInstance()->singleFrameAllocator.Alloc(size, alignment);
+  return GetSingleFrameAllocator().Alloc(size, alignment);
 }
 
 void* MemoryManager::AllocOnDoubleBuffered(const Size size,
                                            const U8 alignment) {
-  return GetInstance()->doubleBufferedAllocator.Alloc(size, alignment);
+  return GetDoubleBufferedAllocator().Alloc(size, alignment);
 }
 
 void* MemoryManager::AllocOnStack(const Size size, const U8 alignment) {
@@ -45,8 +98,31 @@ MemoryManager::MemoryManager()
       doubleBufferedAllocator(
           CONFIG_VAL(memoryConfig.doubleBufferedAllocatorSize)),
       dynamicArena(CONFIG_VAL(memoryConfig.dynamicArenaSize)),
-      freeListAllocator(CONFIG_VAL(memoryConfig.freeListAllocatorSize)) {
+      freeListAllocator(CONFIG_VAL(memoryConfig.freeListAllocatorSize)),
+      stats(CONFIG_VAL(memoryConfig.memoryStatsFrameCount)) {
   instance = this;
+  {
+    std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+    generation = ++lastGeneration;
+    liveGeneration = generation;
+  }
+
+  // the thread that creates the memory manager is the main thread
+  threadAllocatorGeneration = generation;
+  threadSingleFrameAllocator = &singleFrameAllocator;
+  threadDoubleBufferedAllocator = &doubleBufferedAllocator;
+}
+
+MemoryManager::~MemoryManager() {
+  // threads exiting from now on leave their arenas to be deleted here
+  std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+  liveGeneration = 0;
+  for (StackAllocator* allocator : workerSingleFrameAllocators) {
+    delete allocator;
+  }
+  for (DoubleBufferedAllocator* allocator : workerDoubleBufferedAllocators) {
+    delete allocator;
+  }
 }
 
 // Memory Manager's update needs to be called after everything that need memory
@@ -54,10 +130,25 @@ MemoryManager::MemoryManager()
 void MemoryManager::Update() {
   BROFILER_CATEGORY("Memory Update", Profiler::Color::Teal);
 
+  if (CONFIG_VAL(memoryConfig.memoryStatsEnabled)) {
+    SampleStats();
+  }
+  ++frameCount;
+
   singleFrameAllocator.Clear();
   doubleBufferedAllocator.SwapBuffer();
   doubleBufferedAllocator.ClearCurrentBuffer();
-  dynamicArena.Defragment();
+  {
+    std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+    for (StackAllocator* allocator : workerSingleFrameAllocators) {
+      allocator->Clear();
+    }
+    for (DoubleBufferedAllocator* allocator : workerDoubleBufferedAllocators) {
+      allocator->SwapBuffer();
+      allocator->ClearCurrentBuffer();
+    }
+  }
+  dynamicArena.Defragment(CONFIG_VAL(memoryConfig.dynamicArenaDefragBudget));
 #if _DEBUG
   // freeListAllocator.Print();
 #endif
@@ -71,6 +162,91 @@ void MemoryManager::ClearLevelMemory() {
   lsrAndLevelAllocator.FreeToMarker(lvlMemStartMarker);
 }
 
+StackAllocator& MemoryManager::GetSingleFrameAllocator() {
+  MemoryManager* memoryManager = GetInstance();
+  if (threadAllocatorGeneration != memoryManager->generation) {
+    memoryManager->CreateWorkerAllocators();
+  }
+  return *threadSingleFrameAllocator;
+}
+
+DoubleBufferedAllocator& MemoryManager::GetDoubleBufferedAllocator() {
+  MemoryManager* memoryManager = GetInstance();
+  if (threadAllocatorGeneration != memoryManager->generation) {
+    memoryManager->CreateWorkerAllocators();
+  }
+  return *threadDoubleBufferedAllocator;
+}
+
+void MemoryManager::CreateWorkerAllocators() {
+  auto* singleFrame = new StackAllocator{
+      CONFIG_VAL(memoryConfig.workerSingleFrameAllocatorSize)};
+  auto* doubleBuffered = new DoubleBufferedAllocator{
+      CONFIG_VAL(memoryConfig.workerDoubleBufferedAllocatorSize)};
+
+  {
+    std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+    workerSingleFrameAllocators.push_back(singleFrame);
+    workerDoubleBufferedAllocators.push_back(doubleBuffered);
+  }
+
+  // only holds arenas of a memory manager already destroyed
+  thread_local WorkerArenas workerArenas;
+  workerArenas.Release();
+  workerArenas.generation = generation;
+  workerArenas.singleFrame = singleFrame;
+  workerArenas.doubleBuffered = doubleBuffered;
+
+  threadAllocatorGeneration = generation;
+  threadSingleFrameAllocator = singleFrame;
+  threadDoubleBufferedAllocator = doubleBuffered;
+}
+
+void MemoryManager::SampleStats() {
+  using Allocator = MemoryStats::Allocator;
+  MemoryStats::FrameSample sample;
+  sample.frame = frameCount;
+  sample[Allocator::LSRAndLevel] = lsrAndLevelAllocator.GetStats();
+  sample[Allocator::SingleFrame] = singleFrameAllocator.GetStats();
+  sample[Allocator::DoubleBuffered] = doubleBufferedAllocator.GetStats();
+  sample[Allocator::DynamicArena] = dynamicArena.GetStats();
+  sample[Allocator::FreeList] = freeListAllocator.GetStats();
+
+  // workers are reported by the busiest one, see MemoryStats::Allocator
+  auto mergeWorker = [](AllocatorStats* merged, const AllocatorStats& worker) {
+    merged->capacity = std::max(merged->capacity, worker.capacity);
+    merged->bytesInUse = std::max(merged->bytesInUse, worker.bytesInUse);
+    merged->peakBytes = std::max(merged->peakBytes, worker.peakBytes);
+    merged->totalAllocs += worker.totalAllocs;
+  };
+  std::lock_guard<std::mutex> lock{workerAllocatorMutex};
+  for (StackAllocator* allocator : workerSingleFrameAllocators) {
+    mergeWorker(&sample[Allocator::WorkerSingleFrame], allocator->GetStats());
+  }
+  for (DoubleBufferedAllocator* allocator : workerDoubleBufferedAllocators) {
+    mergeWorker(&sample[Allocator::WorkerDoubleBuffered],
+                allocator->GetStats());
+  }
+
+  stats.Record(sample);
+}
+
+const MemoryStats& MemoryManager::GetStats() {
+  return GetInstance()->stats;
+}
+
+void MemoryManager::ExportStatsCSV(const std::string& fileName) {
+  Filesystem::Instance().Touch(fileName);
+  Filesystem::Instance().WriteAsync(fileName, GetStats().ToCSV(), nullptr,
+                                    false);
+}
+
+void MemoryManager::ExportStatsJSON(const std::string& fileName) {
+  Filesystem::Instance().Touch(fileName);
+  Filesystem::Instance().WriteAsync(fileName, GetStats().ToJSON(), nullptr,
+                                    false);
+}
+
 MemoryManager* MemoryManager::GetInstance() {
   if (instance == nullptr) {
     throw std::exception{Util::StrFormat(
@@ -90,8 +266,6 @@ void MemoryManager::DefragmentTest() {
     arr.PushBack(ref);
   }
 
-  auto map = instance->dynamicArena.addressIndexMap;
-
   for (U32 i = 0; i < count / 2; ++i) {
     int index = Math::Random::GetRandomGenerator(0, arr.Size() - 1).GetValue();
     DeleteDynamic(arr[index]);
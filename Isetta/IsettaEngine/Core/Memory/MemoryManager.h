@@ -2,16 +2,26 @@
  * Copyright (c) 2018 Isetta
  */
 #pragma once
+#include <vector>
 #include "Core/Config/CVar.h"
 #include "Core/IsettaAlias.h"
 #include "Core/Memory/DoubleBufferedAllocator.h"
 #include "Core/Memory/FreeListAllocator.h"
 #include "Core/Memory/MemUtil.h"
+#include "Core/Memory/MemoryStats.h"
 #include "Core/Memory/ObjectHandle.h"
 #include "Core/Memory/StackAllocator.h"
 
 namespace Isetta {
 // TODO(YIDI): Alloc all allocators on a big stack
+/**
+ * \brief Single frame and double buffered allocations can be made from any
+ * thread. Each thread gets its own pair of arenas the first time it asks for
+ * one (the main thread uses the ones sized by single_frame_allocator_size and
+ * double_buffered_allocator_size), and all of them are reset by Update, so
+ * worker threads must be idle by then. The free list is thread safe. Stack
+ * (LSR/level) allocations and dynamic objects are main thread only
+ */
 class ISETTA_API MemoryManager {
  public:
   struct MemoryConfig {
@@ -19,12 +29,27 @@ class ISETTA_API MemoryManager {
     CVar<Size> singleFrameAllocatorSize{"single_frame_allocator_size", 10_MB};
     CVar<Size> doubleBufferedAllocatorSize{"double_buffered_allocator_size",
                                            10_MB};
+    CVar<Size> workerSingleFrameAllocatorSize{
+        "worker_single_frame_allocator_size", 1_MB};
+    CVar<Size> workerDoubleBufferedAllocatorSize{
+        "worker_double_buffered_allocator_size", 1_MB};
     CVar<Size> dynamicArenaSize{"dynamic_arena_size", 10_MB};
+    /// Max bytes the dynamic arena moves per frame while defragmenting
+    CVar<Size> dynamicArenaDefragBudget{"dynamic_arena_defrag_budget", 64_KB};
     CVar<Size> freeListAllocatorSize{"free_list_allocator_size", 10_MB};
     CVar<Size> freeListIncrement{"free_list_increment", 10_MB};
+    /// Serve small free list allocations from size class slabs
+    CVar<int> freeListSizeClasses{"free_list_size_classes", 1};
+    /// Zero every free list allocation, only turn on to chase down code that
+    /// reads uninitialized memory
+    CVar<int> freeListZeroMemory{"free_list_zero_memory", 0};
     CVar<Size> defaultPoolIncrement{"default_pool_increment", 50};
     CVar<Size> entityPoolInitialSize{"entity_pool_initial_size", 100};
     CVar<Size> entityPoolIncrement{"entity_pool_increment", 50};
+    /// Sample every allocator at the end of each frame
+    CVar<int> memoryStatsEnabled{"memory_stats_enabled", 1};
+    /// Number of frames the memory timeline keeps
+    CVar<Size> memoryStatsFrameCount{"memory_stats_frame_count", 600};
   };
 
   /**
@@ -129,6 +154,25 @@ class ISETTA_API MemoryManager {
   template <typename T>
   static void DeleteDynamic(const ObjectHandle<T>& objToDelete);
 
+  /**
+   * \brief Timeline of per allocator usage, one sample per frame while
+   * memory_stats_enabled is on. Use it to size the allocator CVars
+   */
+  static const MemoryStats& GetStats();
+
+  /**
+   * \brief Write the memory timeline to a file, one row per frame and
+   * allocator
+   * \param fileName Path of the file, it's overwritten if it exists
+   */
+  static void ExportStatsCSV(const std::string& fileName);
+
+  /**
+   * \brief Write the memory timeline to a file as a JSON array of frames
+   * \param fileName Path of the file, it's overwritten if it exists
+   */
+  static void ExportStatsJSON(const std::string& fileName);
+
  private:
   /**
    * \brief Start up the memory manager. This creates the single frame
@@ -140,7 +184,7 @@ class ISETTA_API MemoryManager {
    * \brief Free all memory, any further attempt to use objects managed by the
    * memory manager will crash the game
    */
-  ~MemoryManager() = default;
+  ~MemoryManager();
 
   /**
    * \brief Update the memory manager. This needs to be called in simulation
@@ -159,6 +203,23 @@ class ISETTA_API MemoryManager {
   /// only for internal test
   static void DefragmentTest();
 
+  /**
+   * \brief Single frame allocator of the calling thread, created on first use
+   * for worker threads
+   */
+  static StackAllocator& GetSingleFrameAllocator();
+  /**
+   * \brief Double buffered allocator of the calling thread, created on first
+   * use for worker threads
+   */
+  static DoubleBufferedAllocator& GetDoubleBufferedAllocator();
+  class WorkerArenas;
+  /// Create this thread's arenas and register them so Update resets them,
+  /// they are released when the thread exits
+  void CreateWorkerAllocators();
+  /// Record every allocator into the timeline, called before they are reset
+  void SampleStats();
+
   static MemoryManager* instance;
   StackAllocator lsrAndLevelAllocator;
   Size lvlMemStartMarker{};
@@ -167,6 +228,16 @@ class ISETTA_API MemoryManager {
   MemoryArena dynamicArena;
   FreeListAllocator freeListAllocator;
 
+  /// Tells this memory manager apart from one created later at its address
+  U64 generation{0};
+  /// Guarded by a mutex in MemoryManager.cpp, only taken when a thread
+  /// registers or exits and in Update
+  std::vector<StackAllocator*> workerSingleFrameAllocators;
+  std::vector<DoubleBufferedAllocator*> workerDoubleBufferedAllocators;
+
+  MemoryStats stats;
+  U64 frameCount{0};
+
   friend class EngineLoop;
 
   friend class TestInitialization;
@@ -174,25 +245,25 @@ class ISETTA_API MemoryManager {
 
 template <typename T, typename... Args>
 T* MemoryManager::NewOnSingleFrame(Args&&... argList) {
-  return GetInstance()->singleFrameAllocator.New<T>(
+  return GetSingleFrameAllocator().New<T>(
       std::forward<Args>(argList)...);
 }
 
 template <typename T>
 T* MemoryManager::NewArrOnSingleFrame(const Size length, const U8 alignment) {
-  return GetInstance()->singleFrameAllocator.NewArr<T>(length, alignment);
+  return GetSingleFrameAllocator().NewArr<T>(length, alignment);
 }
 
 template <typename T, typename... Args>
 T* MemoryManager::NewOnDoubleBuffered(Args&&... argList) {
-  return GetInstance()->doubleBufferedAllocator.New<T>(
+  return GetDoubleBufferedAllocator().New<T>(
       std::forward<Args>(argList)...);
 }
 
 template <typename T>
 T* MemoryManager::NewArrOnDoubleBuffered(const Size length,
                                          const U8 alignment) {
-  return GetInstance()->doubleBufferedAllocator.NewArr<T>(length, alignment);
+  return GetDoubleBufferedAllocator().NewArr<T>(length, alignment);
 }
 
 template <typename T, typename... Args>
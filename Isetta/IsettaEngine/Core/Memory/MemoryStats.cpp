@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Core/Memory/MemoryStats.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace Isetta {
+
+MemoryStats::MemoryStats(const Size frameCount) : samples(frameCount) {}
+
+void MemoryStats::Record(FrameSample sample) {
+  if (samples.empty()) {
+    return;
+  }
+
+  for (Size i = 0; i < allocatorCount; ++i) {
+    AllocatorStats& stats = sample.allocators[i];
+    stats.frameAllocs =
+        static_cast<U32>(stats.totalAllocs - lastTotalAllocs[i]);
+    lastTotalAllocs[i] = stats.totalAllocs;
+    peakBytes[i] = std::max({peakBytes[i], stats.peakBytes, stats.bytesInUse});
+    stats.peakBytes = peakBytes[i];
+  }
+
+  samples[head] = sample;
+  head = (head + 1) % samples.size();
+  count = std::min(count + 1, samples.size());
+}
+
+const MemoryStats::FrameSample& MemoryStats::GetSample(
+    const Size index) const {
+  if (index >= count) {
+    throw std::out_of_range{
+        "MemoryStats::GetSample => Index is beyond recorded frames"};
+  }
+  return samples[(head + samples.size() - count + index) % samples.size()];
+}
+
+const MemoryStats::FrameSample& MemoryStats::GetLatest() const {
+  return GetSample(count - 1);
+}
+
+std::string MemoryStats::ToCSV() const {
+  std::ostringstream stream;
+  stream << "frame,allocator,capacity,bytes_in_use,peak_bytes,frame_allocs,"
+            "total_allocs,expand_count,fragmentation\n";
+  for (Size i = 0; i < count; ++i) {
+    const FrameSample& sample = GetSample(i);
+    for (Size j = 0; j < allocatorCount; ++j) {
+      const AllocatorStats& stats = sample.allocators[j];
+      stream << sample.frame << ','
+             << GetAllocatorName(static_cast<Allocator>(j)) << ','
+             << stats.capacity << ',' << stats.bytesInUse << ','
+             << stats.peakBytes << ',' << stats.frameAllocs << ','
+             << stats.totalAllocs << ',' << stats.expandCount << ','
+             << stats.fragmentation << '\n';
+    }
+  }
+  return stream.str();
+}
+
+std::string MemoryStats::ToJSON() const {
+  std::ostringstream stream;
+  stream << "[";
+  for (Size i = 0; i < count; ++i) {
+    const FrameSample& sample = GetSample(i);
+    stream << (i == 0 ? "\n" : ",\n") << "  {\"frame\": " << sample.frame
+           << ", \"allocators\": {";
+    for (Size j = 0; j < allocatorCount; ++j) {
+      const AllocatorStats& stats = sample.allocators[j];
+      stream << (j == 0 ? "\n" : ",\n") << "    \""
+             << GetAllocatorName(static_cast<Allocator>(j))
+             << "\": {\"capacity\": " << stats.capacity
+             << ", \"bytes_in_use\": " << stats.bytesInUse
+             << ", \"peak_bytes\": " << stats.peakBytes
+             << ", \"frame_allocs\": " << stats.frameAllocs
+             << ", \"total_allocs\": " << stats.totalAllocs
+             << ", \"expand_count\": " << stats.expandCount
+             << ", \"fragmentation\": " << stats.fragmentation << "}";
+    }
+    stream << "\n  }}";
+  }
+  stream << "\n]\n";
+  return stream.str();
+}
+
+const char* MemoryStats::GetAllocatorName(const Allocator allocator) {
+  switch (allocator) {
+    case Allocator::LSRAndLevel:
+      return "lsr_and_level";
+    case Allocator::SingleFrame:
+      return "single_frame";
+    case Allocator::DoubleBuffered:
+      return "double_buffered";
+    case Allocator::WorkerSingleFrame:
+      return "worker_single_frame";
+    case Allocator::WorkerDoubleBuffered:
+      return "worker_double_buffered";
+    case Allocator::DynamicArena:
+      return "dynamic_arena";
+    case Allocator::FreeList:
+      return "free_list";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace Isetta
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * \brief Snapshot of one allocator. Allocators only keep cheap running
+ * counters, everything else is computed when the memory manager samples them
+ */
+struct AllocatorStats {
+  /// Bytes the allocator can hand out before it overflows (or expands)
+  Size capacity{};
+  /// Bytes handed out right now, alignment padding and headers included
+  Size bytesInUse{};
+  /// Highest bytesInUse seen so far
+  Size peakBytes{};
+  /// Number of allocations since the allocator was created
+  U64 totalAllocs{};
+  /// Number of allocations made during the sampled frame
+  U32 frameAllocs{};
+  /// Number of times the allocator had to grab more memory from the system
+  U32 expandCount{};
+  /// 0 when all free memory is contiguous, approaching 1 as it gets scattered
+  float fragmentation{};
+};
+
+/**
+ * \brief Per frame memory timeline kept by the memory manager. Samples live in
+ * a fixed size ring buffer that is allocated once, so recording a frame never
+ * allocates
+ */
+class ISETTA_API MemoryStats {
+ public:
+  /**
+   * \brief Allocators tracked by the memory manager. The worker entries
+   * describe the busiest worker thread (allocation counts are summed over all
+   * workers), since that's what worker_*_allocator_size has to fit. The double
+   * buffered entries describe a single buffer for the same reason
+   */
+  enum class Allocator : U8 {
+    LSRAndLevel,
+    SingleFrame,
+    DoubleBuffered,
+    WorkerSingleFrame,
+    WorkerDoubleBuffered,
+    DynamicArena,
+    FreeList,
+    Count
+  };
+  static const Size allocatorCount = static_cast<Size>(Allocator::Count);
+
+  struct FrameSample {
+    U64 frame{};
+    AllocatorStats allocators[allocatorCount];
+
+    const AllocatorStats& operator[](const Allocator allocator) const {
+      return allocators[static_cast<Size>(allocator)];
+    }
+    AllocatorStats& operator[](const Allocator allocator) {
+      return allocators[static_cast<Size>(allocator)];
+    }
+  };
+
+  /**
+   * \brief Create an empty timeline
+   * \param frameCount Number of frames kept before the oldest is overwritten
+   */
+  explicit MemoryStats(Size frameCount);
+
+  /**
+   * \brief Add a frame to the timeline. frameAllocs is derived from
+   * totalAllocs of the previous frame, and peakBytes is raised to bytesInUse
+   * for allocators that don't track their own high-water mark
+   */
+  void Record(FrameSample sample);
+
+  /// Number of frames currently held, up to the frame count
+  Size GetSampleCount() const { return count; }
+  /**
+   * \brief Get a recorded frame
+   * \param index 0 is the oldest frame still held
+   */
+  const FrameSample& GetSample(Size index) const;
+  /// Most recent frame, only valid when GetSampleCount() > 0
+  const FrameSample& GetLatest() const;
+
+  /// One row per frame and allocator, with a header row
+  std::string ToCSV() const;
+  /// Array of frames, each with an object per allocator
+  std::string ToJSON() const;
+
+  static const char* GetAllocatorName(Allocator allocator);
+
+ private:
+  std::vector<FrameSample> samples;
+  /// Position the next sample is written to
+  Size head{};
+  Size count{};
+  U64 lastTotalAllocs[allocatorCount]{};
+  Size peakBytes[allocatorCount]{};
+};
+}  // namespace Isetta
@@ -7,9 +7,7 @@ namespace Isetta {
 
 PtrInt HandleEntry::GetAddress() const { return reinterpret_cast<PtrInt>(ptr); }
 
-void HandleEntry::Set(const U32 uniqueID, void* ptr, const bool isEmpty,
-                      const Size size) {
-  this->uniqueID = uniqueID;
+void HandleEntry::Set(void* ptr, const bool isEmpty, const Size size) {
   this->ptr = ptr;
   this->isEmpty = isEmpty;
   this->size = size;
@@ -12,9 +12,10 @@ namespace Isetta {
  * about the object pointed to
  */
 class HandleEntry {
- private:
+ public:
   /**
-   * \brief Default constructor that does nothing
+   * \brief Default constructor that does nothing. Public so the handle table
+   * can grow
    */
   HandleEntry() = default;
 
@@ -23,6 +24,7 @@ class HandleEntry {
    */
   ~HandleEntry() = default;
 
+ private:
   /**
    * \brief A helper function that returns the address of pointed object
    * \return Address in type PtrInt
@@ -33,16 +35,19 @@ class HandleEntry {
    * \brief Just a help function for setting individual fields of the handle
    * entry
    *
-   * \param uniqueID
    * \param ptr
    * \param isEmpty
    * \param size
    */
-  void Set(U32 uniqueID, void* ptr, bool isEmpty, Size size);
+  void Set(void* ptr, bool isEmpty, Size size);
+
+  /// Generation of this slot, bumped every time its object is deleted. Always
+  /// compare this with the generation of ObjectHandle used to manipulate this
+  /// entry
+  U32 generation{};
 
-  /// unique ID. Always compare this with the uniqueID of ObjectHandle used to
-  /// manipulate this entry
-  U32 uniqueID{};
+  /// Next slot on the free slot list, only meaningful while this one is free
+  U32 nextFree{U32_MAX};
 
   /// Size of the object pointed to by this entry
   Size size{};
@@ -75,11 +80,11 @@ class ObjectHandle {
 
   /**
    * \brief The actual constructor that the MemoryArena uses to create new
-   * ObjectHandles \param mem Pointer to the memory \param uniqueID uniqueID for
-   * this handle \param size Size of the object in bytes
+   * ObjectHandles \param mem Pointer to the memory \param index Handle table
+   * slot acquired for this object \param size Size of the object in bytes
    */
   template <typename... args>
-  ObjectHandle(void* mem, U32 uniqueID, Size size, args...);
+  ObjectHandle(void* mem, U32 index, Size size, args...);
 
   /**
    * \brief Returns a pointer to the actual object
@@ -116,7 +121,7 @@ class ObjectHandle {
    * handle
    */
   PtrInt GetObjAddress() const;
-  U32 uniqueID{U32_MAX};
+  U32 generation{U32_MAX};
   U32 index{U32_MAX};
 
   friend class MemoryArena;
@@ -134,38 +139,23 @@ T& ObjectHandle<T>::operator*() {
 
 template <typename T>
 ObjectHandle<T>::operator bool() const {
-  if (index > MemoryArena::maxHandleCount) {
+  if (index >= MemoryArena::entryArr.size()) {
     return false;
   }
 
   HandleEntry& entry = MemoryArena::entryArr[index];
 
-  return !entry.isEmpty && uniqueID == entry.uniqueID;
+  return !entry.isEmpty && generation == entry.generation;
 }
 
 template <typename T>
 template <typename... args>
-ObjectHandle<T>::ObjectHandle(void* mem, const U32 uniqueID, const Size size,
+ObjectHandle<T>::ObjectHandle(void* mem, const U32 index, const Size size,
                               args... argList)
-    : uniqueID(uniqueID) {
-  HandleEntry* entry = nullptr;
-
-  // FUTURE: To optimize the speed of this, remember last index
-  for (U32 i = 0; i < MemoryArena::maxHandleCount; ++i) {
-    if (MemoryArena::entryArr[i].isEmpty) {
-      index = i;
-      entry = &MemoryArena::entryArr[index];
-      break;
-    }
-  }
-
-  if (entry == nullptr) {
-    throw std::out_of_range{
-        "ObjectHandle::ObjectHandle => No empty slot in handle table"};
-  }
-
+    : generation(MemoryArena::entryArr[index].generation), index(index) {
   T* t = new (mem) T{argList...};
-  entry->Set(uniqueID, static_cast<void*>(t), false, size);
+  // fetch the entry after construction, T's constructor might grow the table
+  MemoryArena::entryArr[index].Set(static_cast<void*>(t), false, size);
 }
 
 template <typename T>
@@ -178,7 +168,7 @@ T* ObjectHandle<T>::GetObjectPtr() const {
   }
 
   // prevent the problem of "stale pointer"
-  if (uniqueID != entry.uniqueID) {
+  if (generation != entry.generation) {
     throw std::exception{
         "ObjectHandle::GetObjectPtr => Object you are trying to access was "
         "replaced by a new object"};
@@ -197,7 +187,7 @@ void ObjectHandle<T>::EraseObject() const {
         "deleting handle!"};
   }
 
-  if (uniqueID != entry.uniqueID) {
+  if (generation != entry.generation) {
     throw std::exception{
         "ObjectHandle::EraseObject => ObjectHandle::DeleteObject => You are "
         "trying to delete an object you don't own!"};
@@ -36,8 +36,19 @@ void* StackAllocator::Alloc(const Size size, const U8 alignment) {
   }
 
   top = newTop;
+  peak = newTop > peak ? newTop : peak;
+  ++allocCount;
 
   return reinterpret_cast<void*>(alignedAddress);
 }
 
+AllocatorStats StackAllocator::GetStats() const {
+  AllocatorStats stats;
+  stats.capacity = totalSize;
+  stats.bytesInUse = top;
+  stats.peakBytes = peak;
+  stats.totalAllocs = allocCount;
+  return stats;
+}
+
 }  // namespace Isetta
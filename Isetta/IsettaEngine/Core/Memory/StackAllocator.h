@@ -4,6 +4,7 @@
 #pragma once
 #include "Core/IsettaAlias.h"
 #include "Core/Memory/MemUtil.h"
+#include "Core/Memory/MemoryStats.h"
 #include "ISETTA_API.h"
 
 namespace Isetta {
@@ -59,9 +60,17 @@ class ISETTA_API StackAllocator {
    */
   Marker GetMarker() const { return top; };
 
+  /**
+   * \brief Current usage of this stack. Peak is the highest the top has ever
+   * been, so it also catches memory that was freed before sampling
+   */
+  AllocatorStats GetStats() const;
+
  private:
   Marker top;
   Size totalSize;
+  Marker peak{0};
+  U64 allocCount{0};
   void* bottom;
   PtrInt bottomAddress;
 };
@@ -17,14 +17,21 @@
 #include "Core/Debug/DebugDraw.h"
 #include "Core/Debug/Logger.h"
 #include "Core/Filesystem.h"
+#include "Core/Jobs/JobSystem.h"
 #include "Core/Time/Clock.h"
 #include "Events/Events.h"
 #include "Scene/Entity.h"
 #include "Scene/Level.h"
 #include "Scene/LevelManager.h"
+#include "Scene/TransformHierarchy.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 namespace Isetta {
+namespace {
+float ToMilliseconds(const I64 nanoseconds) {
+  return static_cast<float>(nanoseconds * 1e-6);
+}
+}  // namespace
 
 EngineLoop& EngineLoop::Instance() {
   static EngineLoop instance;
@@ -48,6 +55,7 @@ EngineLoop::EngineLoop() {
 
   // Memory manager must start before everything else
   memoryManager = new MemoryManager{};
+  jobSystem = MemoryManager::NewOnStack<JobSystem>();
   windowModule = MemoryManager::NewOnStack<WindowModule>();
   renderModule = MemoryManager::NewOnStack<RenderModule>();
   inputModule = MemoryManager::NewOnStack<InputModule>();
@@ -75,6 +83,7 @@ EngineLoop::~EngineLoop() {
   audioModule->~AudioModule();
   networkingModule->~NetworkingModule();
   events->~Events();
+  jobSystem->~JobSystem();
   delete memoryManager;
 }
 
@@ -93,6 +102,8 @@ void EngineLoop::StartUp() {
   // Will be set to false when Application set it to isGameRunning
   isGameRunning = true;
 
+  // Modules can start jobs from their StartUp
+  jobSystem->StartUp();
   // Window module must start before things depend on it
   windowModule->StartUp();
   renderModule->StartUp(windowModule->winHandle);
@@ -112,14 +123,30 @@ void EngineLoop::StartUp() {
   // Actual perform the load
   LevelManager::Instance().LoadLevel();
 
+  BuildVariableUpdateGraph();
+  statsWatch.Start();
   StartGameClock();
 }
 
+/**
+ * @brief: order that matters
+ * Rebuild the graph before anything of the frame runs
+ * Pipelined render of the last frame before this frame changes the scene
+ *
+ */
 void EngineLoop::Update() {
   BROFILER_FRAME("Main Thread");
 
   GetGameClock().UpdateTime();
 
+  if ((CONFIG_VAL(loopConfig.batchTransformUpdate) != 0) !=
+          graphBatchTransforms ||
+      (CONFIG_VAL(loopConfig.pipelinedRender) != 0) != graphPipelined) {
+    BuildVariableUpdateGraph();
+  }
+  if (graphPipelined) RenderCapturedFrame();
+
+  simulationStart = statsWatch.EvaluateInNanoseconds();
   accumulateTime += GetGameClock().GetDeltaTime();
 
   for (int i = 0; i < maxSimulationCount && accumulateTime > intervalTime;
@@ -134,6 +161,7 @@ void EngineLoop::Update() {
 /**
  * @brief: order that matters
  * Level FixedUpdate must be last
+ * Transform pass before Collisions so the tree refits from clean matrices
  * CollisionSolver must be sandwiched between Collision Update and LateUpdate
  *
  */
@@ -141,12 +169,38 @@ void EngineLoop::FixedUpdate(const float deltaTime) const {
   BROFILER_CATEGORY("Fixed Update", Profiler::Color::IndianRed);
 
   networkingModule->Update(deltaTime);
+  if (CONFIG_VAL(loopConfig.batchTransformUpdate)) {
+    TransformHierarchy::Instance().UpdateWorldMatrices();
+  }
   collisionsModule->Update(deltaTime);
   collisionSolverModule->Update();
   collisionsModule->LateUpdate(deltaTime);
   LevelManager::Instance().loadedLevel->FixedUpdate();
 }
 
+/**
+ * @brief: order that matters, see BuildVariableUpdateGraph
+ * Load level after frame - more of a decision, could possibly (not probable)
+ * work in middle of frame
+ *
+ */
+void EngineLoop::VariableUpdate(const float deltaTime) {
+  BROFILER_CATEGORY("Variable Update", Profiler::Color::SteelBlue);
+
+  variableDeltaTime = deltaTime;
+  variableUpdateGraph.Execute();
+
+  if (LevelManager::Instance().pendingLoadLevel) {
+    LevelManager::Instance().UnloadLevel();
+    renderModule->ClearSnapshot();
+    inputModule->Clear();
+    audioModule->UnloadLevel();
+    DebugDraw::Clear();
+    Events::Instance().Clear();
+    LevelManager::Instance().LoadLevel();
+  }
+}
+
 /**
  * @brief: order that matters
  * Input before Level Update
@@ -154,39 +208,117 @@ void EngineLoop::FixedUpdate(const float deltaTime) const {
  * Level LateUpdate after Event
  * Audio after all Level Updates
  * Render after all Level
+ * Transform pass right before Render
  * Render before DebugDraw/GUI/Window
  * Window after Render/DebugDraw/GUI/Window
  * Memory last
- * Load level after frame - more of a decision, could possibly (not probable)
- * work in middle of frame
+ * With the transform pass, audio only reads clean world matrices so it runs
+ * on a job next to render and DebugDraw. GUI runs gameplay callbacks, so
+ * audio has to be done before it. Everything else stays on the main thread
+ * Pipelined, the capture takes render's place and the GUI is only built, both
+ * are drawn by RenderCapturedFrame at the start of the next frame. Window
+ * then presents the frame before this one
  *
  */
-void EngineLoop::VariableUpdate(const float deltaTime) const {
-  BROFILER_CATEGORY("Variable Update", Profiler::Color::SteelBlue);
+void EngineLoop::BuildVariableUpdateGraph() {
+  variableUpdateGraph.Clear();
+  graphBatchTransforms = CONFIG_VAL(loopConfig.batchTransformUpdate) != 0;
+  graphPipelined = CONFIG_VAL(loopConfig.pipelinedRender) != 0;
+  // a snapshot left from pipelined mode would be drawn over a later frame
+  if (!graphPipelined) renderModule->ClearSnapshot();
 
-  inputModule->Update(deltaTime);
-  LevelManager::Instance().loadedLevel->Update();
-  Events::Instance().Update();
-  LevelManager::Instance().loadedLevel->LateUpdate();
-  audioModule->Update(deltaTime);
-  renderModule->Update(deltaTime);
+  FrameGraph& graph = variableUpdateGraph;
+  const FrameGraph::NodeId input =
+      graph.AddNode([this]() { inputModule->Update(variableDeltaTime); });
+  const FrameGraph::NodeId update = graph.AddNode(
+      []() { LevelManager::Instance().loadedLevel->Update(); }, {input});
+  const FrameGraph::NodeId events =
+      graph.AddNode([]() { Events::Instance().Update(); }, {update});
+  const FrameGraph::NodeId lateUpdate = graph.AddNode(
+      []() { LevelManager::Instance().loadedLevel->LateUpdate(); }, {events});
+
+  const auto render = [this]() {
+    EndSimulation();
+    if (graphPipelined) {
+      renderModule->CaptureSnapshot(variableDeltaTime);
+      return;
+    }
+    const I64 renderStart = statsWatch.EvaluateInNanoseconds();
+    renderModule->Update(variableDeltaTime);
+#ifdef _EDITOR
+    DebugDraw::Update();
+#endif
+    frameStats.renderMs =
+        ToMilliseconds(statsWatch.EvaluateInNanoseconds() - renderStart);
+  };
+  FrameGraph::NodeId audio, renderNode;
+  if (graphBatchTransforms) {
+    const FrameGraph::NodeId transforms = graph.AddNode(
+        []() { TransformHierarchy::Instance().UpdateWorldMatrices(); },
+        {lateUpdate});
+    audio = graph.AddNode([this]() { audioModule->Update(variableDeltaTime); },
+                          {transforms}, false);
+    renderNode = graph.AddNode(render, {transforms});
+  } else {
+    // reading a dirty transform updates it, so audio can't overlap render
+    audio = graph.AddNode([this]() { audioModule->Update(variableDeltaTime); },
+                          {lateUpdate});
+    renderNode = graph.AddNode(render, {audio});
+  }
+  const FrameGraph::NodeId gui = graph.AddNode(
+      [this]() {
+        guiModule->Update(variableDeltaTime);
+        if (!graphPipelined) guiModule->Render();
+      },
+      {renderNode, audio});
+  const FrameGraph::NodeId window = graph.AddNode(
+      [this]() {
+        windowModule->Update(variableDeltaTime);
+        EndPresent();
+      },
+      {gui});
+  graph.AddNode([this]() { memoryManager->Update(); }, {window});
+}
+
+/**
+ * @brief: order that matters
+ * Render the snapshot before DebugDraw/GUI
+ * The GUI's draw data is the captured frame's until this frame's GUI Update,
+ * without a snapshot it's from a frame that was already drawn
+ *
+ */
+void EngineLoop::RenderCapturedFrame() {
+  BROFILER_CATEGORY("Render Captured Frame", Profiler::Color::OliveDrab);
+
+  const I64 renderStart = statsWatch.EvaluateInNanoseconds();
+  const bool captured = renderModule->HasSnapshot();
+  renderModule->RenderSnapshot();
 #ifdef _EDITOR
   DebugDraw::Update();
 #endif
-  guiModule->Update(deltaTime);
-  windowModule->Update(deltaTime);
-  memoryManager->Update();
+  if (captured) guiModule->Render();
+  renderedSimulationEnd = captured ? capturedSimulationEnd : renderStart;
+  frameStats.renderMs =
+      ToMilliseconds(statsWatch.EvaluateInNanoseconds() - renderStart);
+}
 
-  if (LevelManager::Instance().pendingLoadLevel) {
-    LevelManager::Instance().UnloadLevel();
-    inputModule->Clear();
-    audioModule->UnloadLevel();
-    DebugDraw::Clear();
-    Events::Instance().Clear();
-    LevelManager::Instance().LoadLevel();
+void EngineLoop::EndSimulation() {
+  const I64 now = statsWatch.EvaluateInNanoseconds();
+  frameStats.simulationMs = ToMilliseconds(now - simulationStart);
+  if (graphPipelined) {
+    capturedSimulationEnd = now;
+  } else {
+    renderedSimulationEnd = now;
   }
 }
 
+void EngineLoop::EndPresent() {
+  frameStats.latencyMs = ToMilliseconds(statsWatch.EvaluateInNanoseconds() -
+                                        renderedSimulationEnd);
+  frameStats.pipelined = graphPipelined;
+  ++frameStats.frame;
+}
+
 /**
  * @brief: order that matters
  * Unload level before anything else
@@ -209,6 +341,7 @@ void EngineLoop::ShutDown() {
   inputModule->ShutDown();
   renderModule->ShutDown();
   windowModule->ShutDown();
+  jobSystem->ShutDown();
   Logger::ShutDown();
 }
 
@@ -4,6 +4,8 @@
 #pragma once
 #include "Application.h"
 #include "Core/Config/CVar.h"
+#include "Core/Jobs/FrameGraph.h"
+#include "Core/Time/StopWatch.h"
 
 namespace Isetta {
 class ISETTA_API EngineLoop {
@@ -11,6 +13,25 @@ class ISETTA_API EngineLoop {
   struct LoopConfig {
     CVar<int> maxFps{"max_fps", 16};
     CVar<int> maxSimCount{"max_simulation_count", 5};
+    /// Update dirty world matrices in one pass before collisions and render
+    /// instead of only lazily when each transform is read
+    CVar<int> batchTransformUpdate{"batch_transform_update", 1};
+    /// Render each frame at the start of the next one from a snapshot, so
+    /// the GPU draws it while the next frame simulates. Adds a frame of
+    /// latency
+    CVar<int> pipelinedRender{"pipelined_render", 0};
+  };
+
+  /**
+   * \brief Timings of the last frame, in milliseconds
+   */
+  struct FrameStats {
+    U64 frame;
+    float simulationMs;
+    float renderMs;
+    /// From the end of a frame's simulation to the present showing it
+    float latencyMs;
+    bool pipelined;
   };
 
   // Start the whole game
@@ -19,6 +40,7 @@ class ISETTA_API EngineLoop {
 
   static EngineLoop& Instance();
   static class Clock& GetGameClock();
+  const FrameStats& GetFrameStats() const { return frameStats; }
 
  private:
   bool isGameRunning;
@@ -27,6 +49,7 @@ class ISETTA_API EngineLoop {
   int maxSimulationCount;
 
   class MemoryManager* memoryManager;
+  class JobSystem* jobSystem;
   class AudioModule* audioModule;
   class WindowModule* windowModule;
   class RenderModule* renderModule;
@@ -37,11 +60,32 @@ class ISETTA_API EngineLoop {
   class CollisionSolverModule* collisionSolverModule;
   class Events* events;
 
+  /// Rebuilt when batchTransformUpdate or pipelinedRender changes, see
+  /// BuildVariableUpdateGraph
+  FrameGraph variableUpdateGraph;
+  bool graphBatchTransforms;
+  bool graphPipelined;
+  float variableDeltaTime;
+
+  FrameStats frameStats{};
+  /// Engine time the frame stats are measured against
+  StopWatch statsWatch;
+  I64 simulationStart;
+  /// End of simulation of the frame waiting in the render snapshot
+  I64 capturedSimulationEnd;
+  /// End of simulation of the frame the next present shows
+  I64 renderedSimulationEnd;
+
   void Run();
   void StartUp();
   void Update();
   void FixedUpdate(float deltaTime) const;
-  void VariableUpdate(float deltaTime) const;
+  void VariableUpdate(float deltaTime);
+  void BuildVariableUpdateGraph();
+  /// Render stage of pipelined mode, draws the last captured frame
+  void RenderCapturedFrame();
+  void EndSimulation();
+  void EndPresent();
   void ShutDown();
 
   void StartGameClock() const;
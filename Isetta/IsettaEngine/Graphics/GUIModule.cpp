@@ -141,7 +141,13 @@ void GUIModule::Update(float deltaTime) {
   LevelManager::Instance().loadedLevel->GUIUpdate();
   ImGui::End();
   ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+void GUIModule::Render() {
+  BROFILER_CATEGORY("GUI Render", Profiler::Color::PowderBlue);
+  // nothing is built before the first Update
+  ImDrawData* drawData = ImGui::GetDrawData();
+  if (drawData != nullptr) ImGui_ImplOpenGL3_RenderDrawData(drawData);
 }
 
 void GUIModule::ShutDown() {
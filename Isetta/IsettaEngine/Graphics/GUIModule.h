@@ -68,7 +68,10 @@ class GUIModule {
   ~GUIModule() = default;
 
   void StartUp(const GLFWwindow* win);
+  /// Build the frame's GUI, running the level's GUIUpdate
   void Update(float deltaTime);
+  /// Draw the GUI built by the last Update
+  void Render();
   void ShutDown();
 
   // TODO(Jacob)
@@ -3,16 +3,19 @@
  */
 #include "Graphics/RenderModule.h"
 
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <string>
 #include "Core/Config/Config.h"
 #include "Core/Filesystem.h"
+#include "Core/Memory/MemoryManager.h"
 #include "Graphics/AnimationComponent.h"
 #include "Graphics/CameraComponent.h"
 #include "Graphics/LightComponent.h"
 #include "Graphics/ParticleSystemComponent.h"
 #include "Scene/Entity.h"
+#include "Scene/Transform.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 namespace Isetta {
@@ -67,6 +70,79 @@ void RenderModule::Update(float deltaTime) {
   h3dFinalizeFrame();
 }
 
+void RenderModule::CaptureSnapshot(const float deltaTime) {
+  BROFILER_CATEGORY("Render Capture", Profiler::Color::OliveDrab);
+
+  snapshot = MemoryManager::NewOnDoubleBuffered<FrameSnapshot>();
+  snapshot->transforms =
+      MemoryManager::NewArrOnDoubleBuffered<FrameSnapshot::NodeTransform>(
+          meshComponents.size() + lightComponents.size() +
+          cameraComponents.size() + particleSystemComponents.size());
+  snapshot->transformCount = 0;
+  snapshot->deltaTime = deltaTime;
+
+  const auto capture = [this](const H3DNode node, Transform* transform) {
+    FrameSnapshot::NodeTransform& nodeTransform =
+        snapshot->transforms[snapshot->transformCount++];
+    nodeTransform.node = node;
+    std::memcpy(nodeTransform.matrix,
+                transform->GetLocalToWorldMatrix().Transpose().data,
+                sizeof(nodeTransform.matrix));
+  };
+  for (const auto& mesh : meshComponents) {
+    if (mesh->entity->GetAttribute(
+            Entity::EntityAttributes::IS_TRANSFORM_DIRTY)) {
+      capture(mesh->renderNode, mesh->transform);
+    }
+  }
+  for (const auto& light : lightComponents) {
+    if (light->entity->GetAttribute(
+            Entity::EntityAttributes::IS_TRANSFORM_DIRTY)) {
+      capture(light->renderNode, light->transform);
+    }
+  }
+  for (const auto& cam : cameraComponents) {
+    capture(cam->renderNode, cam->transform);
+  }
+  for (const auto& particle : particleSystemComponents) {
+    if (particle->entity->GetAttribute(
+            Entity::EntityAttributes::IS_TRANSFORM_DIRTY)) {
+      capture(particle->renderNode, particle->transform);
+    }
+  }
+
+  ASSERT(!cameraComponents.empty());
+  CameraComponent::_main = cameraComponents.front();
+  snapshot->camera = CameraComponent::_main->renderNode;
+}
+
+void RenderModule::RenderSnapshot() {
+  BROFILER_CATEGORY("Render Snapshot", Profiler::Color::OliveDrab);
+
+  if (snapshot == nullptr) {
+    Update(0);
+  } else {
+    for (int i = 0; i < snapshot->transformCount; ++i) {
+      h3dSetNodeTransMat(snapshot->transforms[i].node,
+                         snapshot->transforms[i].matrix);
+    }
+    for (const auto& anim : animationComponents) {
+      anim->UpdateAnimation(snapshot->deltaTime);
+    }
+    for (const auto& particle : particleSystemComponents) {
+      if (particle->hasStarted) {
+        particle->UpdateEmitter(snapshot->deltaTime);
+      }
+    }
+    h3dRender(snapshot->camera);
+    h3dFinalizeFrame();
+    snapshot = nullptr;
+  }
+  // the GPU works on the frame while the next one simulates, the swap comes
+  // after that
+  glFlush();
+}
+
 void RenderModule::ShutDown() {
   if (winHandle) {
     h3dRelease();
@@ -39,10 +39,42 @@ class ISETTA_API_DECLARE RenderModule {
   RenderModule() = default;
   ~RenderModule() = default;
 
+  /**
+   * \brief Node transforms and camera of a finished simulation frame, enough
+   * to render it after the next frame's simulation has changed the scene.
+   * Lives on the double buffered allocator, so it lasts through the next
+   * frame
+   */
+  struct FrameSnapshot {
+    struct NodeTransform {
+      H3DNode node;
+      /// Transposed world matrix, the way Horde3D takes it
+      float matrix[16];
+    };
+    NodeTransform* transforms;
+    int transformCount;
+    H3DNode camera;
+    float deltaTime;
+  };
+
   void StartUp(GLFWwindow* win);
   void Update(float deltaTime);
   void ShutDown();
 
+  /**
+   * \brief Pipelined render stage, first half: record the transforms of the
+   * frame that just finished simulating
+   */
+  void CaptureSnapshot(float deltaTime);
+  /**
+   * \brief Pipelined render stage, second half: render the captured frame
+   * and flush it to the GPU without waiting. Renders the live scene if
+   * nothing was captured, after a level load for example
+   */
+  void RenderSnapshot();
+  bool HasSnapshot() const { return snapshot != nullptr; }
+  void ClearSnapshot() { snapshot = nullptr; }
+
   int renderInterface;
 
   void InitRenderConfig();
@@ -55,6 +87,7 @@ class ISETTA_API_DECLARE RenderModule {
 
   H3DRes pipelineRes;
   GLFWwindow* winHandle;
+  FrameSnapshot* snapshot{nullptr};
 
   friend class CameraComponent;
   friend class EngineLoop;
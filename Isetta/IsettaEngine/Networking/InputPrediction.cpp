@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/InputPrediction.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Core/Math/Util.h"
+
+namespace Isetta {
+namespace {
+/// Whether sequence a is newer than b, counting wraparound
+bool IsNewer(const U16 a, const U16 b) {
+  return a != b && static_cast<U16>(a - b) < 0x8000;
+}
+}  // namespace
+
+void InputPrediction::Configure(const float positionTolerance,
+                                const float rotationTolerance) {
+  this->positionTolerance = positionTolerance;
+  this->rotationTolerance = rotationTolerance;
+}
+
+void InputPrediction::Reset(const PredictedState& state) {
+  this->state = state;
+  history.clear();
+  hasAck = false;
+}
+
+InputCommand InputPrediction::Predict(const InputCommand& command,
+                                      const Simulation& simulate,
+                                      const float deltaTime) {
+  InputCommand numbered = command;
+  numbered.sequence = nextSequence++;
+  state = simulate(state, numbered, deltaTime);
+
+  if (static_cast<int>(history.size()) >= historySize) {
+    history.erase(history.begin());
+  }
+  history.push_back(Entry{numbered, state});
+  return numbered;
+}
+
+bool InputPrediction::Reconcile(const U16 sequence, const PredictedState& state,
+                                const Simulation& simulate,
+                                const float deltaTime) {
+  // acks can arrive out of order, an older one says nothing new
+  if (hasAck && !IsNewer(sequence, lastAck)) return false;
+  hasAck = true;
+  lastAck = sequence;
+
+  const auto acked = std::find_if(
+      history.begin(), history.end(),
+      [sequence](const Entry& entry) {
+        return entry.command.sequence == sequence;
+      });
+  if (acked != history.end()) {
+    const bool matches = Matches(acked->state, state);
+    history.erase(history.begin(), acked + 1);
+    if (matches) return false;
+  } else {
+    // dropped from the history, so there's nothing to compare to
+    history.erase(std::remove_if(history.begin(), history.end(),
+                                 [sequence](const Entry& entry) {
+                                   return !IsNewer(entry.command.sequence,
+                                                   sequence);
+                                 }),
+                  history.end());
+  }
+
+  // rewind to the server's state and run what it hasn't seen yet again
+  PredictedState replayed = state;
+  for (Entry& entry : history) {
+    replayed = simulate(replayed, entry.command, deltaTime);
+    entry.state = replayed;
+  }
+  this->state = replayed;
+  return true;
+}
+
+int InputPrediction::GetUnacknowledged(InputCommand* commands,
+                                       const int maxCount) const {
+  const int count =
+      Math::Util::Min({static_cast<int>(history.size()), maxCount});
+  const int first = static_cast<int>(history.size()) - count;
+  for (int i = 0; i < count; ++i) {
+    commands[i] = history[first + i].command;
+  }
+  return count;
+}
+
+bool InputPrediction::Matches(const PredictedState& a,
+                              const PredictedState& b) const {
+  return (a.localPos - b.localPos).SqrMagnitude() <=
+             positionTolerance * positionTolerance &&
+         Math::Quaternion::AngleDeg(a.localRot, b.localRot) <=
+             rotationTolerance;
+}
+
+void InputQueue::Reset() {
+  pending.clear();
+  hasProcessed = false;
+  credit = 0;
+}
+
+void InputQueue::Receive(const InputCommand* commands, const int count) {
+  for (int i = 0; i < count; ++i) {
+    const InputCommand& command = commands[i];
+    if (hasProcessed && !IsNewer(command.sequence, lastProcessed)) continue;
+    // NaN gets through any clamp and would spread to the server's state
+    if (!std::isfinite(command.move.x) || !std::isfinite(command.move.y) ||
+        !std::isfinite(command.move.z)) {
+      continue;
+    }
+
+    const auto position = std::find_if(
+        pending.begin(), pending.end(), [&command](const InputCommand& other) {
+          return !IsNewer(command.sequence, other.sequence);
+        });
+    // sent again because the ack for it hasn't arrived yet
+    if (position != pending.end() && position->sequence == command.sequence) {
+      continue;
+    }
+    pending.insert(position, command);
+    if (static_cast<int>(pending.size()) > maxPending) {
+      pending.erase(pending.begin());
+    }
+  }
+}
+
+int InputQueue::Tick(const Action<const InputCommand&>& run) {
+  credit = Math::Util::Min({credit + 1, maxBurst});
+  int ran = 0;
+  while (credit > 0 && !pending.empty()) {
+    const InputCommand command = pending.front();
+    pending.erase(pending.begin());
+    run(command);
+    hasProcessed = true;
+    lastProcessed = command.sequence;
+    --credit;
+    ++ran;
+  }
+  return ran;
+}
+}  // namespace Isetta
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * @brief Input of one player for one fixed update, numbered by the client in
+ * the order it was sampled.
+ */
+struct InputCommand {
+  U16 sequence = 0;
+  /// Movement axes, each within -1 and 1
+  Math::Vector3 move;
+  /// Held buttons, one bit each as the game defines them
+  U32 buttons = 0;
+};
+
+/**
+ * @brief Local transform that input commands move.
+ */
+struct PredictedState {
+  Math::Vector3 localPos;
+  Math::Quaternion localRot = Math::Quaternion::identity;
+};
+
+/**
+ * @brief Client side of input replication. Runs every input command on the
+ * client's state right away, so the player doesn't wait for the server, and
+ * keeps the commands the server hasn't acknowledged. When an acknowledged
+ * state differs from what was predicted for that command, the client rewinds
+ * to the server's state and replays the commands after it.
+ */
+class ISETTA_API InputPrediction {
+ public:
+  /// Moves a state by a command over a time step. It must only depend on its
+  /// arguments, or the client and server won't agree
+  using Simulation =
+      Func<PredictedState, const PredictedState&, const InputCommand&, float>;
+
+  /// Unacknowledged commands kept at most, the oldest goes first
+  static const int historySize = 64;
+
+  /**
+   * @param positionTolerance Distance a prediction can be off by before it is
+   * replayed
+   * @param rotationTolerance Same for rotation, in degrees
+   */
+  void Configure(float positionTolerance, float rotationTolerance);
+  /**
+   * @brief Forget every command and continue from the given state.
+   */
+  void Reset(const PredictedState& state);
+  /**
+   * @brief Number a command and run it on the predicted state.
+   *
+   * @return The command with its sequence number, to send to the server
+   */
+  InputCommand Predict(const InputCommand& command, const Simulation& simulate,
+                       float deltaTime);
+  /**
+   * @brief The server ran the commands up to sequence and ended up at state.
+   * Drops those commands, and replays the rest from state if the prediction
+   * was off.
+   *
+   * @return true if the prediction was replayed
+   */
+  bool Reconcile(U16 sequence, const PredictedState& state,
+                 const Simulation& simulate, float deltaTime);
+  /**
+   * @brief Copy the newest unacknowledged commands, oldest first, so a lost
+   * message is made up for by the next one.
+   *
+   * @return Number of commands copied
+   */
+  int GetUnacknowledged(InputCommand* commands, int maxCount) const;
+
+  const PredictedState& GetState() const { return state; }
+  int GetUnacknowledgedCount() const {
+    return static_cast<int>(history.size());
+  }
+
+ private:
+  struct Entry {
+    InputCommand command;
+    /// State after running command
+    PredictedState state;
+  };
+
+  bool Matches(const PredictedState& a, const PredictedState& b) const;
+
+  std::vector<Entry> history;
+  PredictedState state;
+  U16 nextSequence = 0;
+  bool hasAck = false;
+  U16 lastAck = 0;
+  float positionTolerance = 0.01f;
+  float rotationTolerance = 1;
+};
+
+/**
+ * @brief Server side of input replication. Takes the commands of one client
+ * in any order and with repeats, and runs each once, in order. A client can't
+ * run more commands than fixed updates pass, save for a few it falls behind
+ * by, so sending extra commands doesn't make it faster.
+ */
+class ISETTA_API InputQueue {
+ public:
+  /// Commands waiting at most, the oldest goes first
+  static const int maxPending = 32;
+  /// Commands a client can run in one fixed update after falling behind
+  static const int maxBurst = 4;
+
+  void Reset();
+  /**
+   * @brief Queue the commands not run yet. Commands moving by anything but a
+   * finite number are dropped.
+   */
+  void Receive(const InputCommand* commands, int count);
+  /**
+   * @brief Run the commands due this fixed update, oldest first. Commands
+   * never received are skipped.
+   *
+   * @return Number of commands run
+   */
+  int Tick(const Action<const InputCommand&>& run);
+
+  bool HasProcessed() const { return hasProcessed; }
+  /// Sequence of the last command run
+  U16 GetLastProcessed() const { return lastProcessed; }
+  int GetPendingCount() const { return static_cast<int>(pending.size()); }
+
+ private:
+  std::vector<InputCommand> pending;
+  bool hasProcessed = false;
+  U16 lastProcessed = 0;
+  int credit = 0;
+};
+}  // namespace Isetta
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/InterestManagement.h"
+
+#include "Core/Math/Util.h"
+
+namespace Isetta {
+void InterestManagement::Configure(const float radius,
+                                   const float irrelevantPriority) {
+  this->radius = radius;
+  this->irrelevantPriority = irrelevantPriority;
+}
+
+void InterestManagement::Begin(const int clientCount) {
+  grid.clear();
+  clients.resize(clientCount);
+}
+
+void InterestManagement::AddEntity(const U32 netId,
+                                   const Math::Vector3& position) {
+  if (radius <= 0) return;
+  grid[GetCellKey(GetCell(position))].emplace_back(netId, position);
+}
+
+void InterestManagement::UpdateClient(const int clientIdx,
+                                      const std::vector<Math::Vector3>& focus) {
+  ClientInterest& client = clients[clientIdx];
+  client.relevant.clear();
+  client.everything = radius <= 0 || focus.empty();
+  if (client.everything) return;
+
+  // cells are as big as the radius, so the neighbors cover it
+  const float sqrRadius = radius * radius;
+  for (const Math::Vector3& position : focus) {
+    const Cell center = GetCell(position);
+    for (int x = center.x - 1; x <= center.x + 1; ++x) {
+      for (int y = center.y - 1; y <= center.y + 1; ++y) {
+        for (int z = center.z - 1; z <= center.z + 1; ++z) {
+          const auto cell = grid.find(GetCellKey(Cell{x, y, z}));
+          if (cell == grid.end()) continue;
+          for (const auto& [netId, entityPosition] : cell->second) {
+            if ((entityPosition - position).SqrMagnitude() <= sqrRadius) {
+              client.relevant.insert(netId);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+bool InterestManagement::IsRelevant(const int clientIdx,
+                                    const U32 netId) const {
+  if (clientIdx < 0 || clientIdx >= static_cast<int>(clients.size())) {
+    return true;
+  }
+  const ClientInterest& client = clients[clientIdx];
+  return client.everything || client.relevant.count(netId) > 0;
+}
+
+bool InterestManagement::ShouldSend(const int clientIdx, const U32 netId) {
+  if (clientIdx < 0 || clientIdx >= static_cast<int>(clients.size())) {
+    return true;
+  }
+  ClientInterest& client = clients[clientIdx];
+  if (client.everything || client.relevant.count(netId) > 0) {
+    client.priority.erase(netId);
+    return true;
+  }
+
+  // an update the client never got doesn't count
+  float& priority = client.priority[netId];
+  if (priority >= 1) return true;
+  priority += irrelevantPriority;
+  return priority >= 1;
+}
+
+void InterestManagement::Acknowledge(const int clientIdx, const U32 netId) {
+  if (clientIdx < 0 || clientIdx >= static_cast<int>(clients.size())) return;
+  clients[clientIdx].priority.erase(netId);
+}
+
+void InterestManagement::ResetClient(const int clientIdx) {
+  if (clientIdx < 0 || clientIdx >= static_cast<int>(clients.size())) return;
+  clients[clientIdx] = ClientInterest{};
+}
+
+void InterestManagement::Forget(const U32 netId) {
+  for (ClientInterest& client : clients) {
+    client.relevant.erase(netId);
+    client.priority.erase(netId);
+  }
+}
+
+InterestManagement::Cell InterestManagement::GetCell(
+    const Math::Vector3& position) const {
+  return Cell{Math::Util::FloorToInt(position.x / radius),
+              Math::Util::FloorToInt(position.y / radius),
+              Math::Util::FloorToInt(position.z / radius)};
+}
+
+U64 InterestManagement::GetCellKey(const Cell& cell) {
+  // 21 bits per axis
+  const U64 mask = (1ull << 21) - 1;
+  return (static_cast<U64>(cell.x) & mask) |
+         (static_cast<U64>(cell.y) & mask) << 21 |
+         (static_cast<U64>(cell.z) & mask) << 42;
+}
+}  // namespace Isetta
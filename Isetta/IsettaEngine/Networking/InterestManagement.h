@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Vector3.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * @brief Decides which networked entities each client hears about. Entities
+ * are put in a uniform grid, and an entity is relevant to a client when it is
+ * within the relevancy radius of any entity that client has authority over.
+ * Irrelevant entities gain a little priority every update and are sent once it
+ * adds up, so they are never starved for good.
+ */
+class ISETTA_API InterestManagement {
+ public:
+  InterestManagement() = default;
+
+  /**
+   * @brief Set how interest sets are computed.
+   *
+   * @param radius Distance within which entities are relevant, everything is
+   * relevant if it isn't positive
+   * @param irrelevantPriority Priority an irrelevant entity gains every update,
+   * it is sent once it reaches 1. It is never sent if this is 0
+   */
+  void Configure(float radius, float irrelevantPriority);
+  /**
+   * @brief Start a new update, clearing the grid and resizing to the number of
+   * clients.
+   */
+  void Begin(int clientCount);
+  /**
+   * @brief Put an entity in the grid for this update.
+   */
+  void AddEntity(U32 netId, const Math::Vector3& position);
+  /**
+   * @brief Compute the interest set of a client from the positions of the
+   * entities it has authority over. A client without any finds everything
+   * relevant.
+   */
+  void UpdateClient(int clientIdx, const std::vector<Math::Vector3>& focus);
+
+  bool IsRelevant(int clientIdx, U32 netId) const;
+  /**
+   * @brief Whether clientIdx should get an update of netId this update,
+   * accumulating priority for the irrelevant ones that shouldn't yet. Once an
+   * irrelevant one is due it stays due until Acknowledge.
+   */
+  bool ShouldSend(int clientIdx, U32 netId);
+  /**
+   * @brief Reset the priority of an irrelevant entity once clientIdx
+   * acknowledged an update of it.
+   */
+  void Acknowledge(int clientIdx, U32 netId);
+
+  /**
+   * @brief Drop everything about a client, for when its slot is free.
+   */
+  void ResetClient(int clientIdx);
+  /**
+   * @brief Drop everything about a network ID, for when it is created or
+   * removed.
+   */
+  void Forget(U32 netId);
+
+ private:
+  struct ClientInterest {
+    bool everything = true;
+    std::unordered_set<U32> relevant;
+    /// Priority accumulated by irrelevant entities since the client last
+    /// acknowledged them
+    std::unordered_map<U32, float> priority;
+  };
+  struct Cell {
+    int x, y, z;
+  };
+
+  Cell GetCell(const Math::Vector3& position) const;
+  static U64 GetCellKey(const Cell& cell);
+
+  float radius = 0;
+  float irrelevantPriority = 0;
+  std::unordered_map<U64, std::vector<std::pair<U32, Math::Vector3>>> grid;
+  std::vector<ClientInterest> clients;
+};
+}  // namespace Isetta
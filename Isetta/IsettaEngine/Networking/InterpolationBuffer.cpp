@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/InterpolationBuffer.h"
+
+#include <algorithm>
+#include "Core/Math/Util.h"
+
+namespace Isetta {
+namespace {
+/// Weight of a new arrival in the clock's averages, the same as RTP's jitter
+const float clockGain = 1.f / 16;
+/// Longest delay the clock adapts to, in seconds
+const float maxDelay = 1;
+
+/// Shortest path slerp that also extrapolates for t past 1
+Math::Quaternion Interpolate(const Math::Quaternion& a,
+                             const Math::Quaternion& b, const float t) {
+  float dot = Math::Quaternion::Dot(a, b);
+  Math::Quaternion end = b;
+  if (dot < 0) {
+    end = b * -1;
+    dot = -dot;
+  }
+  // nearly the same, slerp would divide by almost 0
+  if (dot > 0.9995f) {
+    return (a * (1 - t) + end * t).Normalized();
+  }
+  const float theta = Math::Util::Acos(dot);
+  const float sinTheta = Math::Util::Sin(theta);
+  return (a * (Math::Util::Sin((1 - t) * theta) / sinTheta) +
+          end * (Math::Util::Sin(t * theta) / sinTheta))
+      .Normalized();
+}
+
+InterpolationBuffer::State Interpolate(const InterpolationBuffer::State& a,
+                                       const InterpolationBuffer::State& b,
+                                       const float time) {
+  const float t = (time - a.time) / (b.time - a.time);
+  InterpolationBuffer::State state;
+  state.time = time;
+  state.localPos = a.localPos + (b.localPos - a.localPos) * t;
+  state.localRot = Interpolate(a.localRot, b.localRot, t);
+  state.localScale = a.localScale + (b.localScale - a.localScale) * t;
+  return state;
+}
+}  // namespace
+
+void InterpolationBuffer::Push(const State& state) {
+  const auto position = std::lower_bound(
+      states.begin(), states.end(), state.time,
+      [](const State& other, const float time) { return other.time < time; });
+  if (position != states.end() && position->time == state.time) return;
+  if (static_cast<int>(states.size()) >= maxStates) {
+    if (position == states.begin()) return;
+    states.insert(position, state);
+    states.erase(states.begin());
+    return;
+  }
+  states.insert(position, state);
+}
+
+bool InterpolationBuffer::Sample(const float time, const float maxExtrapolation,
+                                 State* state) const {
+  if (states.empty()) return false;
+
+  if (time <= states.front().time) {
+    *state = states.front();
+    return true;
+  }
+
+  if (time >= states.back().time) {
+    if (states.size() < 2) {
+      *state = states.back();
+      return true;
+    }
+    // keep going the way the last two went, for a while
+    const float extrapolated =
+        states.back().time + Math::Util::Min(time - states.back().time,
+                                             maxExtrapolation);
+    *state = Interpolate(states[states.size() - 2], states.back(),
+                         extrapolated);
+    return true;
+  }
+
+  const auto next = std::upper_bound(
+      states.begin(), states.end(), time,
+      [](const float time, const State& other) { return time < other.time; });
+  *state = Interpolate(*(next - 1), *next, time);
+  return true;
+}
+
+void InterpolationClock::Configure(const float minDelay,
+                                   const float jitterFactor) {
+  this->minDelay = minDelay;
+  this->jitterFactor = jitterFactor;
+}
+
+void InterpolationClock::Receive(const float serverTime,
+                                 const float localTime) {
+  const float sample = serverTime - localTime;
+  if (!hasTime) {
+    hasTime = true;
+    offset = sample;
+    jitter = 0;
+    delay = minDelay;
+    return;
+  }
+
+  jitter += (Math::Util::Abs(sample - offset) - jitter) * clockGain;
+  offset += (sample - offset) * clockGain;
+  const float targetDelay =
+      Math::Util::Min(minDelay + jitterFactor * jitter, maxDelay);
+  delay += (targetDelay - delay) * clockGain;
+}
+
+void InterpolationClock::Reset() {
+  hasTime = false;
+  offset = 0;
+  jitter = 0;
+  delay = 0;
+}
+}  // namespace Isetta
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <vector>
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+/**
+ * @brief The last states of a remote transform, each stamped with the server
+ * time it was sent at. Sampling between them gives a smooth path no matter
+ * when the states arrived.
+ */
+class ISETTA_API InterpolationBuffer {
+ public:
+  struct State {
+    float time = 0;
+    Math::Vector3 localPos;
+    Math::Quaternion localRot = Math::Quaternion::identity;
+    Math::Vector3 localScale = Math::Vector3::one;
+  };
+
+  /// States kept at most, the oldest goes first
+  static const int maxStates = 16;
+
+  /**
+   * @brief Add a state, in time order with the others. A state for a time the
+   * buffer already has, or older than all of a full buffer, is ignored.
+   */
+  void Push(const State& state);
+  /**
+   * @brief The state at the given time. Between two states it is interpolated,
+   * before the first it is the first. After the last it is extrapolated from
+   * the last two, at most maxExtrapolation seconds past the last.
+   *
+   * @return false if there are no states
+   */
+  bool Sample(float time, float maxExtrapolation, State* state) const;
+  void Clear() { states.clear(); }
+
+  bool IsEmpty() const { return states.empty(); }
+  const State& GetNewest() const { return states.back(); }
+
+ private:
+  std::vector<State> states;
+};
+
+/**
+ * @brief Estimates the server's time from when its snapshots were sent and
+ * when they arrived, and how far behind it remote entities should be shown.
+ * The delay grows with how much the arrivals jitter, so the interpolation
+ * buffers hold a state past the shown time even when one is late.
+ */
+class ISETTA_API InterpolationClock {
+ public:
+  /**
+   * @param minDelay Smallest delay behind the server's time, in seconds
+   * @param jitterFactor Delay added per second of measured jitter
+   */
+  void Configure(float minDelay, float jitterFactor);
+  /**
+   * @brief Measure a snapshot the server sent at serverTime that arrived at
+   * localTime.
+   */
+  void Receive(float serverTime, float localTime);
+  void Reset();
+
+  bool HasTime() const { return hasTime; }
+  float GetServerTime(float localTime) const { return localTime + offset; }
+  /// Time remote entities should be shown at
+  float GetRenderTime(float localTime) const {
+    return GetServerTime(localTime) - delay;
+  }
+  float GetDelay() const { return delay; }
+  float GetJitter() const { return jitter; }
+
+ private:
+  bool hasTime = false;
+  /// Server time minus local time, averaged over the arrivals
+  float offset = 0;
+  /// Mean deviation of the arrivals from offset
+  float jitter = 0;
+  float delay = 0;
+  float minDelay = 0.1f;
+  float jitterFactor = 3;
+};
+}  // namespace Isetta
@@ -8,6 +8,7 @@
 #include "Networking/NetworkId.h"
 #include "Networking/NetworkTransform.h"
 #include "Networking/NetworkingModule.h"
+#include "Networking/SnapshotReplication.h"
 #include "Scene/Entity.h"
 
 namespace Isetta {
@@ -40,6 +41,31 @@ bool NetworkManager::IsClientConnected(const int clientIdx) const {
   return networkingModule->IsClientConnected(clientIdx);
 }
 
+bool NetworkManager::IsRelevant(const int clientIdx, const U32 netId) const {
+  return networkingModule->snapshotReplication->interest.IsRelevant(clientIdx,
+                                                                    netId);
+}
+
+float NetworkManager::GetInterpolationTime() const {
+  return networkingModule->snapshotReplication->GetInterpolationTime();
+}
+
+SendScheduler::Stats NetworkManager::GetServerSendStats(
+    const int clientIdx) const {
+  return networkingModule->GetServerSendStats(clientIdx);
+}
+
+SendScheduler::Stats NetworkManager::GetClientSendStats() const {
+  return networkingModule->GetClientSendStats();
+}
+
+const SendScheduler::MessageInfo& NetworkManager::GetMessageScheduling(
+    const int type) const {
+  static const SendScheduler::MessageInfo control;
+  const auto it = messageScheduling.find(type);
+  return it == messageScheduling.end() ? control : it->second;
+}
+
 int NetworkManager::GetMaxClients() {
   return CONFIG_VAL(networkConfig.maxClients);
 }
@@ -179,9 +205,15 @@ U32 NetworkManager::CreateNetworkId(NetworkId* networkId) {
   U32 netId = networkIds.GetHandle();
   networkId->id = netId;
   networkIdToComponentMap[netId] = networkId;
-  NetworkTransform::serverPosTimestamps[netId] = 0;
-  NetworkTransform::serverRotTimestamps[netId] = 0;
-  NetworkTransform::serverScaleTimestamps[netId] = 0;
+  // the handle can be one a removed object had
+  networkingModule->snapshotReplication->Forget(netId);
+  return netId;
+}
+
+void NetworkManager::RecordPredictedState(const int clientIdx, const U32 netId,
+                                          const PredictedState& state) {
+  networkingModule->snapshotReplication->RecordPredictedState(clientIdx, netId,
+                                                              state);
 }
 
 U32 NetworkManager::AssignNetworkId(U32 netId, NetworkId* networkId) {
@@ -205,6 +237,7 @@ void NetworkManager::RemoveNetworkId(NetworkId* networkId) {
         "Cannot remove network id on a nonexistent network object"));
   }
   networkIdToComponentMap.erase(networkId->id);
+  networkingModule->snapshotReplication->Forget(networkId->id);
   networkIds.ReturnHandle(networkId->id);
   networkId->id = NULL;
 }
@@ -13,12 +13,14 @@
 #include "Core/IsettaAlias.h"
 #include "ISETTA_API.h"
 #include "Networking/ClientInfo.h"
+#include "Networking/SendScheduler.h"
 #include "yojimbo/yojimbo.h"
 
 namespace Isetta {
 
 class Entity;
 class NetworkId;
+struct PredictedState;
 /**
  * @brief Wrapper class for NetworkingModule so that other engine components can
  * use networking features.
@@ -97,6 +99,16 @@ class ISETTA_API_DECLARE NetworkManager {
   template <typename T>
   void SendMessageFromServerToAllButClient(int clientIdx,
                                            yojimbo::Message* refMessage);
+  /**
+   * @brief Populates a message using a reference message and sends it from the
+   * server to the clients the entity with the given network ID is relevant to.
+   *
+   * @tparam T Class of the message to be sent
+   * @param netId Network ID of the entity the message is about
+   * @param refMessage Message to populate our own message with
+   */
+  template <typename T>
+  void SendMessageFromServerToRelevant(U32 netId, yojimbo::Message* refMessage);
 
   /**
    * @brief Registers a callback function on the server for when we receive a
@@ -141,6 +153,26 @@ class ISETTA_API_DECLARE NetworkManager {
   template <typename T>
   void UnregisterClientCallback(int handle);
 
+  /**
+   * @brief Sets how messages of the given type are scheduled when they are
+   * sent. Messages are reliable control messages unless set otherwise.
+   *
+   * @tparam T Class of the message to set the scheduling for
+   * @param info Priority, importance and coalescing of the messages
+   */
+  template <typename T>
+  void SetMessageScheduling(const SendScheduler::MessageInfo& info);
+  /**
+   * @brief Queue depth, drops and other counters of the messages the server
+   * sends to the client at the given index.
+   */
+  SendScheduler::Stats GetServerSendStats(int clientIdx) const;
+  /**
+   * @brief Queue depth, drops and other counters of the messages the local
+   * client sends to the server.
+   */
+  SendScheduler::Stats GetClientSendStats() const;
+
   /**
    * @brief Get the entity corresonding to the given network ID
    *
@@ -211,6 +243,16 @@ class ISETTA_API_DECLARE NetworkManager {
   bool IsClientRunning() const;
   bool IsServerRunning() const;
   bool IsClientConnected(int clientIdx) const;
+  /**
+   * @brief Whether the entity with the given network ID was relevant to the
+   * client at the last snapshot, see InterestManagement
+   */
+  bool IsRelevant(int clientIdx, U32 netId) const;
+  /**
+   * @brief Server time remote entities are shown at on this client, behind the
+   * estimated server time by the interpolation delay. See InterpolationClock
+   */
+  float GetInterpolationTime() const;
 
   static int GetMaxClients();
   int GetClientIndex() const;
@@ -298,6 +340,7 @@ class ISETTA_API_DECLARE NetworkManager {
 
   template <typename T>
   int GetMessageTypeId();
+  const SendScheduler::MessageInfo& GetMessageScheduling(int type) const;
   std::list<std::pair<U16, Action<yojimbo::Message*>>> GetClientFunctions(
       int type);
   std::list<std::pair<U16, Action<int, yojimbo::Message*>>> GetServerFunctions(
@@ -305,6 +348,12 @@ class ISETTA_API_DECLARE NetworkManager {
   U32 CreateNetworkId(NetworkId* networkId);
   U32 AssignNetworkId(U32 netId, NetworkId* networkId);
   void RemoveNetworkId(NetworkId* networkId);
+  /**
+   * @brief Record the state the server simulated an entity to, for snapshots
+   * to replicate it to everyone but the client with authority over it.
+   */
+  void RecordPredictedState(int clientIdx, U32 netId,
+                            const PredictedState& state);
   static U16 GetServerPort();
 
   class NetworkingModule* networkingModule{nullptr};
@@ -315,6 +364,7 @@ class ISETTA_API_DECLARE NetworkManager {
   std::unordered_map<int, std::pair<U64, Func<yojimbo::Message*, void*>>>
       factories;
   std::unordered_map<std::type_index, int> typeMap;
+  std::unordered_map<int, SendScheduler::MessageInfo> messageScheduling;
 
   std::unordered_map<int, std::list<std::pair<U16, Action<yojimbo::Message*>>>>
       clientCallbacks;
@@ -325,6 +375,7 @@ class ISETTA_API_DECLARE NetworkManager {
   std::unordered_map<U32, NetworkId*> networkIdToComponentMap;
 
   friend class NetworkId;
+  friend class NetworkPrediction;
   friend class NetworkingModule;
   friend class NetworkMessageFactory;
   friend class CustomAdapter;
@@ -429,6 +480,26 @@ void NetworkManager::SendMessageFromServerToAllButClient(
     SendMessageFromServer(i, newMessage);
   }
 }
+
+template <typename T>
+void NetworkManager::SendMessageFromServerToRelevant(
+    const U32 netId, yojimbo::Message* refMessage) {
+  if (!IsServerRunning()) {
+    LOG_ERROR(Debug::Channel::Networking,
+              "Cannot send message from server to relevant clients, server "
+              "not running");
+    return;
+  }
+  for (int i = 0; i < GetMaxClients(); ++i) {
+    if (!IsClientConnected(i) || !IsRelevant(i, netId)) {
+      continue;
+    }
+
+    yojimbo::Message* newMessage = GenerateMessageFromServer<T>(i);
+    newMessage->Copy(refMessage);
+    SendMessageFromServer(i, newMessage);
+  }
+}
 template <typename T>
 bool NetworkManager::RegisterMessageType(
     U64 size, Func<yojimbo::Message*, void*> factory) {
@@ -438,6 +509,11 @@ bool NetworkManager::RegisterMessageType(
       .second;
 }
 template <typename T>
+void NetworkManager::SetMessageScheduling(
+    const SendScheduler::MessageInfo& info) {
+  messageScheduling[GetMessageTypeId<T>()] = info;
+}
+template <typename T>
 int NetworkManager::RegisterServerCallback(
     Action<int, yojimbo::Message*> func) {
   serverCallbacks[GetMessageTypeId<T>()].push_back(
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/NetworkPrediction.h"
+
+#include <cmath>
+#include "Core/Math/Util.h"
+#include "Core/Time/Time.h"
+#include "Networking/NetworkId.h"
+#include "Networking/NetworkManager.h"
+#include "Scene/Entity.h"
+#include "Scene/Transform.h"
+
+namespace Isetta {
+namespace {
+/// Within -1 and 1, NaN fails both of Clamp's comparisons
+float ClampAxis(const float axis) {
+  return std::isfinite(axis) ? Math::Util::Clamp(-1.f, 1.f, axis) : 0;
+}
+
+/// The server doesn't trust the client's input, so both clamp it the same
+InputCommand Clamped(const InputCommand& command) {
+  InputCommand clamped = command;
+  clamped.move.x = ClampAxis(command.move.x);
+  clamped.move.y = ClampAxis(command.move.y);
+  clamped.move.z = ClampAxis(command.move.z);
+  return clamped;
+}
+
+/// Only the latest message for an entity matters, the newest input message
+/// repeats what the ones before it had
+template <typename T>
+SendScheduler::MessageInfo PredictionScheduling() {
+  SendScheduler::MessageInfo info;
+  info.priority = SendScheduler::Priority::STATE;
+  info.importance = 2;
+  info.coalesceKey = [](const yojimbo::Message* message) {
+    return static_cast<U64>(reinterpret_cast<const T*>(message)->netId);
+  };
+  return info;
+}
+}  // namespace
+
+bool NetworkPrediction::registeredCallbacks = false;
+
+void NetworkPrediction::Start() {
+  if (!registeredCallbacks) {
+    NetworkManager& networkManager = NetworkManager::Instance();
+    networkManager.SetMessageScheduling<InputMessage>(
+        PredictionScheduling<InputMessage>());
+    networkManager.SetMessageScheduling<PredictionAckMessage>(
+        PredictionScheduling<PredictionAckMessage>());
+
+    networkManager.RegisterServerCallback<InputMessage>(
+        [](int clientIdx, yojimbo::Message* message) {
+          InputMessage* inputMessage = reinterpret_cast<InputMessage*>(message);
+
+          NetworkId* netId =
+              NetworkManager::Instance().GetNetworkId(inputMessage->netId);
+          if (!netId) {
+            return;
+          }
+          // only the client with authority gets to move it
+          if (netId->clientAuthorityId != clientIdx) {
+            LOG_WARNING(Debug::Channel::Networking,
+                        "Client [%d] sent input for network ID [%d] it "
+                        "doesn't have authority over",
+                        clientIdx, inputMessage->netId);
+            return;
+          }
+
+          NetworkPrediction* np =
+              netId->entity->GetComponent<NetworkPrediction>();
+          if (!np) {
+            return;
+          }
+          np->inputQueue.Receive(inputMessage->commands,
+                                 inputMessage->commandCount);
+        });
+
+    networkManager.RegisterClientCallback<PredictionAckMessage>(
+        [](yojimbo::Message* message) {
+          PredictionAckMessage* ackMessage =
+              reinterpret_cast<PredictionAckMessage*>(message);
+
+          NetworkId* netId =
+              NetworkManager::Instance().GetNetworkId(ackMessage->netId);
+          if (!netId || !netId->HasClientAuthority()) {
+            return;
+          }
+
+          NetworkPrediction* np =
+              netId->entity->GetComponent<NetworkPrediction>();
+          if (!np) {
+            return;
+          }
+          np->Reconcile(ackMessage->sequence, ackMessage->state);
+        });
+
+    NetworkPrediction::registeredCallbacks = true;
+  }
+
+  PredictedState state;
+  state.localPos = entity->transform->GetLocalPos();
+  state.localRot = entity->transform->GetLocalRot();
+  prediction.Configure(positionTolerance, rotationTolerance);
+  prediction.Reset(state);
+  inputQueue.Reset();
+  serverState = state;
+
+  netId = entity->GetComponent<NetworkId>();
+
+  if (netId == nullptr) {
+    LOG_ERROR(Debug::Channel::Networking,
+              "Didn't find a NetId component on Entity [%s], "
+              "NetworkPrediction needs NetId to function properly",
+              entity->GetName().c_str());
+    return;
+  }
+}
+
+void NetworkPrediction::FixedUpdate() {
+  if (netId == nullptr || !simulate) {
+    return;
+  }
+
+  const float deltaTime = static_cast<float>(Time::GetFixedDeltaTime());
+  NetworkManager& networkManager = NetworkManager::Instance();
+  if (networkManager.IsServerRunning()) {
+    ServerFixedUpdate(deltaTime);
+  }
+  if (networkManager.IsClientRunning() && netId->HasClientAuthority() &&
+      sampleInput) {
+    ClientFixedUpdate(deltaTime);
+  }
+}
+
+void NetworkPrediction::ClientFixedUpdate(const float deltaTime) {
+  prediction.Configure(positionTolerance, rotationTolerance);
+  prediction.Predict(Clamped(sampleInput()), simulate, deltaTime);
+  SetState(prediction.GetState());
+
+  NetworkManager::Instance().SendMessageFromClient<InputMessage>(
+      [this](InputMessage* message) {
+        message->netId = netId->id;
+        message->commandCount = prediction.GetUnacknowledged(
+            message->commands, InputMessage::maxCommands);
+      });
+}
+
+void NetworkPrediction::ServerFixedUpdate(const float deltaTime) {
+  const int ran =
+      inputQueue.Tick([this, deltaTime](const InputCommand& command) {
+        serverState = simulate(serverState, Clamped(command), deltaTime);
+      });
+  if (ran == 0) {
+    return;
+  }
+
+  NetworkManager& networkManager = NetworkManager::Instance();
+  // a host's own entity already shows its prediction
+  if (!networkManager.IsClientRunning() || !netId->HasClientAuthority()) {
+    SetState(serverState);
+  }
+  networkManager.RecordPredictedState(netId->clientAuthorityId, netId->id,
+                                      serverState);
+
+  if (!networkManager.IsClientConnected(netId->clientAuthorityId)) {
+    return;
+  }
+  networkManager.SendMessageFromServer<PredictionAckMessage>(
+      netId->clientAuthorityId, [this](PredictionAckMessage* message) {
+        message->netId = netId->id;
+        message->sequence = inputQueue.GetLastProcessed();
+        message->state = serverState;
+      });
+}
+
+void NetworkPrediction::Reconcile(const U16 sequence,
+                                  const PredictedState& state) {
+  if (!simulate) {
+    return;
+  }
+  if (prediction.Reconcile(sequence, state, simulate,
+                           static_cast<float>(Time::GetFixedDeltaTime()))) {
+    SetState(prediction.GetState());
+  }
+}
+
+void NetworkPrediction::SetState(const PredictedState& state) {
+  entity->transform->SetLocalPos(state.localPos);
+  entity->transform->SetLocalRot(state.localRot);
+}
+}  // namespace Isetta
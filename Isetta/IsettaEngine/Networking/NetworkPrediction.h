@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include "Core/Config/Config.h"
+#include "ISETTA_API.h"
+#include "Networking/InputPrediction.h"
+#include "Networking/Messages.h"
+#include "Scene/Component.h"
+
+namespace Isetta {
+/**
+ * @brief Moves an entity by the input of the client with authority over it,
+ * without trusting that client with its transform. Each fixed update the
+ * client samples an input command, runs it right away and sends it to the
+ * server. The server runs the commands on its own state and sends back where
+ * the entity ended up, which the client reconciles its prediction with. Other
+ * clients get the server's state in snapshots, through the NetworkTransform.
+ *
+ * The entity should only be moved by simulate, anything else is overwritten by
+ * the next command.
+ */
+DEFINE_COMPONENT(NetworkPrediction, Component, true)
+public:
+void Start() override;
+void FixedUpdate() override;
+
+/// Samples the local player's input, on the client with authority
+Func<InputCommand> sampleInput;
+/// Moves the entity by one command, on that client and on the server
+InputPrediction::Simulation simulate;
+/// Distance the prediction can be off by before it is replayed
+float positionTolerance = 0.01f;
+/// Angle the prediction can be off by before it is replayed, in degrees
+float rotationTolerance = 1;
+
+private:
+void ClientFixedUpdate(float deltaTime);
+void ServerFixedUpdate(float deltaTime);
+void Reconcile(U16 sequence, const PredictedState& state);
+void SetState(const PredictedState& state);
+
+InputPrediction prediction;
+InputQueue inputQueue;
+/// The server's authoritative state, kept apart from the transform a host
+/// also shows the entity with
+PredictedState serverState;
+
+static bool registeredCallbacks;
+class NetworkId* netId = nullptr;
+friend class NetworkPrediction;
+DEFINE_COMPONENT_END(NetworkPrediction, Component)
+
+/**
+ * @brief InputMessage is sent from the client with authority over an entity
+ * to the server every fixed update. It holds the newest commands the server
+ * hasn't acknowledged, so a lost message is made up for by the next.
+ *
+ */
+DEFINE_NETWORK_MESSAGE(InputMessage)
+template <typename Stream>
+bool Serialize(Stream* stream) {
+  serialize_int(stream, netId, 0,
+                Config::Instance().networkConfig.maxNetID.GetVal());
+  serialize_int(stream, commandCount, 0, maxCommands);
+
+  for (int i = 0; i < commandCount; ++i) {
+    InputCommand& command = commands[i];
+    serialize_bits(stream, command.sequence, 16);
+    serialize_float(stream, command.move.x);
+    serialize_float(stream, command.move.y);
+    serialize_float(stream, command.move.z);
+    serialize_uint32(stream, command.buttons);
+  }
+  return true;
+}
+
+void Copy(const yojimbo::Message* otherMessage) override {
+  const InputMessage* message =
+      reinterpret_cast<const InputMessage*>(otherMessage);
+
+  netId = message->netId;
+  commandCount = message->commandCount;
+  for (int i = 0; i < commandCount; ++i) {
+    commands[i] = message->commands[i];
+  }
+}
+
+public:
+/// Commands one message carries
+static const int maxCommands = 8;
+
+int netId = 0;
+int commandCount = 0;
+InputCommand commands[maxCommands];
+DEFINE_NETWORK_MESSAGE_END
+
+/**
+ * @brief PredictionAckMessage is sent from the server to the client with
+ * authority over an entity after running its commands, holding the last one
+ * it ran and the state that left the entity in.
+ *
+ */
+DEFINE_NETWORK_MESSAGE(PredictionAckMessage)
+template <typename Stream>
+bool Serialize(Stream* stream) {
+  serialize_int(stream, netId, 0,
+                Config::Instance().networkConfig.maxNetID.GetVal());
+  serialize_bits(stream, sequence, 16);
+
+  // sent as is, a rounded state would never match the prediction
+  serialize_float(stream, state.localPos.x);
+  serialize_float(stream, state.localPos.y);
+  serialize_float(stream, state.localPos.z);
+  serialize_float(stream, state.localRot.w);
+  serialize_float(stream, state.localRot.x);
+  serialize_float(stream, state.localRot.y);
+  serialize_float(stream, state.localRot.z);
+  return true;
+}
+
+void Copy(const yojimbo::Message* otherMessage) override {
+  const PredictionAckMessage* message =
+      reinterpret_cast<const PredictionAckMessage*>(otherMessage);
+
+  netId = message->netId;
+  sequence = message->sequence;
+  state = message->state;
+}
+
+public:
+int netId = 0;
+U16 sequence = 0;
+PredictedState state;
+DEFINE_NETWORK_MESSAGE_END
+}  // namespace Isetta
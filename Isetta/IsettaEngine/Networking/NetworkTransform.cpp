@@ -8,168 +8,50 @@
 #include <unordered_map>
 #include "Core/Time/Time.h"
 #include "Networking/NetworkId.h"
+#include "Networking/NetworkPrediction.h"
 #include "Scene/Entity.h"
 #include "Scene/Level.h";
 #include "Scene/LevelManager.h"
 #include "Scene/Transform.h"
 
 namespace Isetta {
+namespace {
+/// Transform messages only need their latest state to arrive, so queued ones
+/// are coalesced per network ID
+template <typename T>
+SendScheduler::MessageInfo TransformScheduling(const float importance) {
+  SendScheduler::MessageInfo info;
+  info.priority = SendScheduler::Priority::STATE;
+  info.importance = importance;
+  info.coalesceKey = [](const yojimbo::Message* message) {
+    return static_cast<U64>(reinterpret_cast<const T*>(message)->netId);
+  };
+  return info;
+}
+}  // namespace
 
 bool NetworkTransform::registeredCallbacks = false;
-std::unordered_map<int, float> NetworkTransform::serverPosTimestamps;
-std::unordered_map<int, float> NetworkTransform::serverRotTimestamps;
-std::unordered_map<int, float> NetworkTransform::serverScaleTimestamps;
 
 void NetworkTransform::Start() {
   if (!registeredCallbacks) {
-    // Position callbacks
-    NetworkManager::Instance().RegisterClientCallback<PositionMessage>(
-        [&](yojimbo::Message* message) {
-          PositionMessage* positionMessage =
-              reinterpret_cast<PositionMessage*>(message);
-
-          NetworkId* netId =
-              NetworkManager::Instance().GetNetworkId(positionMessage->netId);
-          if (!netId || netId->HasClientAuthority()) {
-            return;
-          }
-
-          Entity* entity = netId->entity;
-          NetworkTransform* nt = entity->GetComponent<NetworkTransform>();
-
-          if (nt && positionMessage->timestamp < nt->lastPosMessage) {
-            return;
-          }
-
-          if (entity) {
-            Transform* t = entity->transform;
-            nt->targetPos = positionMessage->localPos;
-
-            nt->posInterpolation = 0;
-
-            if ((Math::Vector3::Scale(t->GetWorldScale(),
-                                      t->GetLocalPos() - nt->targetPos))
-                    .SqrMagnitude() >= nt->snapDistance * nt->snapDistance) {
-              t->SetLocalPos(positionMessage->localPos);
-              nt->posInterpolation = 1;
-            }
-
-            nt->prevPos = t->GetLocalPos();
-            nt->lastPosMessage = positionMessage->timestamp;
-          }
-        });
-
-    NetworkManager::Instance().RegisterServerCallback<PositionMessage>(
-        [](int clientIdx, yojimbo::Message* message) {
-          PositionMessage* positionMessage =
-              reinterpret_cast<PositionMessage*>(message);
-
-          if (serverScaleTimestamps[positionMessage->netId] <=
-              positionMessage->timestamp) {
-            serverScaleTimestamps[positionMessage->netId] =
-                positionMessage->timestamp;
-            NetworkManager::Instance()
-                .SendMessageFromServerToAll<PositionMessage>(positionMessage);
-          }
-        });
-
-    // Rotation callbacks
-    NetworkManager::Instance().RegisterClientCallback<RotationMessage>(
-        [&](yojimbo::Message* message) {
-          RotationMessage* rotationMessage =
-              reinterpret_cast<RotationMessage*>(message);
-
-          NetworkId* netId =
-              NetworkManager::Instance().GetNetworkId(rotationMessage->netId);
-          if (!netId || netId->HasClientAuthority()) {
-            return;
-          }
-
-          Entity* entity = netId->entity;
-          NetworkTransform* nt = entity->GetComponent<NetworkTransform>();
-
-          if (nt && rotationMessage->timestamp < nt->lastRotMessage) {
-            return;
-          }
-
-          if (entity) {
-            Transform* t = entity->transform;
-            nt->targetRot = rotationMessage->localRot;
-
-            nt->rotInterpolation = 0;
-
-            if (abs(Math::Quaternion::AngleDeg(
-                    t->GetLocalRot(), nt->targetRot)) >= nt->snapRotation) {
-              t->SetLocalRot(rotationMessage->localRot);
-              nt->rotInterpolation = 1;
-            }
-
-            nt->prevRot = t->GetLocalRot();
-            nt->lastRotMessage = rotationMessage->timestamp;
-          }
-        });
-
-    NetworkManager::Instance().RegisterServerCallback<RotationMessage>(
-        [](int clientIdx, yojimbo::Message* message) {
-          RotationMessage* rotationMessage =
-              reinterpret_cast<RotationMessage*>(message);
-
-          if (serverScaleTimestamps[rotationMessage->netId] <=
-              rotationMessage->timestamp) {
-            serverScaleTimestamps[rotationMessage->netId] =
-                rotationMessage->timestamp;
-            NetworkManager::Instance()
-                .SendMessageFromServerToAll<RotationMessage>(rotationMessage);
-          }
-        });
-
-    // Scale callbacks
-    NetworkManager::Instance().RegisterClientCallback<ScaleMessage>(
-        [&](yojimbo::Message* message) {
-          ScaleMessage* scaleMessage = reinterpret_cast<ScaleMessage*>(message);
-
-          NetworkId* netId =
-              NetworkManager::Instance().GetNetworkId(scaleMessage->netId);
-          if (!netId || netId->HasClientAuthority()) {
-            return;
-          }
-
-          Entity* entity = netId->entity;
-          NetworkTransform* nt = entity->GetComponent<NetworkTransform>();
-
-          if (nt && scaleMessage->timestamp < nt->lastScaleMessage) {
-            return;
-          }
-
-          if (entity) {
-            Transform* t = entity->transform;
-            nt->targetScale = scaleMessage->localScale;
-
-            nt->scaleInterpolation = 0;
-
-            if ((t->GetLocalScale() - nt->targetScale).SqrMagnitude() >=
-                nt->snapScale * nt->snapScale) {
-              t->SetLocalScale(scaleMessage->localScale);
-              nt->scaleInterpolation = 1;
-            }
-
-            nt->prevScale = t->GetLocalScale();
-            nt->lastScaleMessage = scaleMessage->timestamp;
-          }
-        });
-
-    NetworkManager::Instance().RegisterServerCallback<ScaleMessage>(
-        [](int clientIdx, yojimbo::Message* message) {
-          ScaleMessage* scaleMessage = reinterpret_cast<ScaleMessage*>(message);
-
-          if (serverScaleTimestamps[scaleMessage->netId] <=
-              scaleMessage->timestamp) {
-            serverScaleTimestamps[scaleMessage->netId] =
-                scaleMessage->timestamp;
-            NetworkManager::Instance().SendMessageFromServerToAll<ScaleMessage>(
-                scaleMessage);
-          }
-        });
+    NetworkManager& networkManager = NetworkManager::Instance();
+    networkManager.SetMessageScheduling<PositionMessage>(
+        TransformScheduling<PositionMessage>(1));
+    networkManager.SetMessageScheduling<RotationMessage>(
+        TransformScheduling<RotationMessage>(1));
+    networkManager.SetMessageScheduling<ScaleMessage>(
+        TransformScheduling<ScaleMessage>(1));
+    // forced transforms matter more, and a snap is a teleport that a later
+    // move doesn't make up for, so it goes reliably
+    SendScheduler::MessageInfo transformInfo =
+        TransformScheduling<TransformMessage>(2);
+    transformInfo.isControl = [](const yojimbo::Message* message) {
+      return reinterpret_cast<const TransformMessage*>(message)->snap;
+    };
+    networkManager.SetMessageScheduling<TransformMessage>(transformInfo);
+
+    // Position, rotation and scale messages only go to the server, clients
+    // get them back in snapshots, see SnapshotReplication
 
     // Transform callbacks
     NetworkManager::Instance().RegisterClientCallback<TransformMessage>(
@@ -193,6 +75,8 @@ void NetworkTransform::Start() {
           // Snapping
           if (transformMessage->snap) {
             Transform* t = entity->transform;
+            // the buffered states lead back to where it was
+            nt->interpolationBuffer.Clear();
 
             // Position
             if (transformMessage->timestamp >= nt->lastPosMessage) {
@@ -209,7 +93,8 @@ void NetworkTransform::Start() {
             }
 
             // Scale
-            if (transformMessage->timestamp >= nt->lastScaleMessage) {
+            if (transformMessage->hasScale &&
+                transformMessage->timestamp >= nt->lastScaleMessage) {
               t->SetLocalScale(transformMessage->localScale);
               nt->prevScale = t->GetLocalScale();
               nt->lastScaleMessage = transformMessage->timestamp;
@@ -219,54 +104,22 @@ void NetworkTransform::Start() {
             nt->rotInterpolation = 1;
             nt->scaleInterpolation = 1;
           } else {  // Not snapping
-            Transform* t = entity->transform;
-
             // Position
             if (transformMessage->timestamp >= nt->lastPosMessage) {
-              nt->targetPos = transformMessage->localPos;
-
-              nt->posInterpolation = 0;
-
-              if ((Math::Vector3::Scale(t->GetWorldScale(),
-                                        t->GetLocalPos() - nt->targetPos))
-                      .SqrMagnitude() >= nt->snapDistance * nt->snapDistance) {
-                t->SetLocalPos(transformMessage->localPos);
-                nt->posInterpolation = 1;
-              }
-
-              nt->prevPos = t->GetLocalPos();
+              nt->ReceivePosition(transformMessage->localPos);
               nt->lastPosMessage = transformMessage->timestamp;
             }
 
             // Rotation
             if (transformMessage->timestamp >= nt->lastRotMessage) {
-              nt->targetRot = transformMessage->localRot;
-
-              nt->rotInterpolation = 0;
-
-              if (abs(Math::Quaternion::AngleDeg(
-                      t->GetLocalRot(), nt->targetRot)) >= nt->snapRotation) {
-                t->SetLocalRot(transformMessage->localRot);
-                nt->rotInterpolation = 1;
-              }
-
-              nt->prevRot = t->GetLocalRot();
+              nt->ReceiveRotation(transformMessage->localRot);
               nt->lastRotMessage = transformMessage->timestamp;
             }
 
             // Scale
-            if (transformMessage->timestamp >= nt->lastScaleMessage) {
-              nt->targetScale = transformMessage->localScale;
-
-              nt->scaleInterpolation = 0;
-
-              if ((t->GetLocalScale() - nt->targetScale).SqrMagnitude() >=
-                  nt->snapScale * nt->snapScale) {
-                t->SetLocalScale(transformMessage->localScale);
-                nt->scaleInterpolation = 1;
-              }
-
-              nt->prevScale = t->GetLocalScale();
+            if (transformMessage->hasScale &&
+                transformMessage->timestamp >= nt->lastScaleMessage) {
+              nt->ReceiveScale(transformMessage->localScale);
               nt->lastScaleMessage = transformMessage->timestamp;
             }
           }
@@ -278,7 +131,8 @@ void NetworkTransform::Start() {
               reinterpret_cast<TransformMessage*>(message);
 
           NetworkManager::Instance()
-              .SendMessageFromServerToAll<TransformMessage>(transformMessage);
+              .SendMessageFromServerToRelevant<TransformMessage>(
+                  transformMessage->netId, transformMessage);
         });
 
     // Parenting callbacks
@@ -328,6 +182,7 @@ void NetworkTransform::Start() {
   lastRotMessage = 0;
   lastScaleMessage = 0;
 
+  inputDriven = entity->GetComponent<NetworkPrediction>() != nullptr;
   netId = entity->GetComponent<NetworkId>();
 
   if (netId == nullptr) {
@@ -340,6 +195,19 @@ void NetworkTransform::Start() {
 }
 
 void NetworkTransform::Update() {
+  if (!interpolationBuffer.IsEmpty() && netId &&
+      !netId->HasClientAuthority()) {
+    InterpolationBuffer::State state;
+    interpolationBuffer.Sample(
+        NetworkManager::Instance().GetInterpolationTime(),
+        CONFIG_VAL(networkConfig.maxExtrapolation), &state);
+    Transform* t = entity->transform;
+    t->SetLocalPos(state.localPos);
+    t->SetLocalRot(state.localRot);
+    t->SetLocalScale(state.localScale);
+    return;
+  }
+
   if (posInterpolation < 1 || rotInterpolation < 1 || scaleInterpolation < 1) {
     Transform* t = entity->transform;
 
@@ -380,7 +248,7 @@ void NetworkTransform::FixedUpdate() {
     }
   }
 
-  if (netId->HasClientAuthority()) {
+  if (netId->HasClientAuthority() && !inputDriven) {
     ++updateCounter;
 
     if (updateCounter >= netId->updateInterval) {
@@ -396,6 +264,7 @@ void NetworkTransform::FixedUpdate() {
         NetworkManager::Instance().SendMessageFromClient<PositionMessage>(
             [t, this](PositionMessage* message) {
               message->timestamp = Time::GetElapsedTime();
+              message->precision = precision;
               message->localPos = t->GetLocalPos();
               message->netId = this->netId->id;
             });
@@ -408,18 +277,20 @@ void NetworkTransform::FixedUpdate() {
         NetworkManager::Instance().SendMessageFromClient<RotationMessage>(
             [t, this](RotationMessage* message) {
               message->timestamp = Time::GetElapsedTime();
+              message->precision = precision;
               message->localRot = t->GetLocalRot();
               message->netId = this->netId->id;
             });
       }
       // Scale
-      if ((t->GetLocalScale() - prevScale).SqrMagnitude() >=
-          updateScale * updateScale) {
+      if (syncScale && (t->GetLocalScale() - prevScale).SqrMagnitude() >=
+                           updateScale * updateScale) {
         prevScale = t->GetLocalScale();
 
         NetworkManager::Instance().SendMessageFromClient<ScaleMessage>(
             [t, this](ScaleMessage* message) {
               message->timestamp = Time::GetElapsedTime();
+              message->precision = precision;
               message->localScale = t->GetLocalScale();
               message->netId = this->netId->id;
             });
@@ -428,7 +299,69 @@ void NetworkTransform::FixedUpdate() {
   }
 }
 
+void NetworkTransform::ReceivePosition(const Math::Vector3& localPos) {
+  Transform* t = entity->transform;
+  targetPos = localPos;
+
+  posInterpolation = 0;
+
+  if ((Math::Vector3::Scale(t->GetWorldScale(), t->GetLocalPos() - targetPos))
+          .SqrMagnitude() >= snapDistance * snapDistance) {
+    t->SetLocalPos(localPos);
+    posInterpolation = 1;
+  }
+
+  prevPos = t->GetLocalPos();
+}
+
+void NetworkTransform::ReceiveRotation(const Math::Quaternion& localRot) {
+  Transform* t = entity->transform;
+  targetRot = localRot;
+
+  rotInterpolation = 0;
+
+  if (abs(Math::Quaternion::AngleDeg(t->GetLocalRot(), targetRot)) >=
+      snapRotation) {
+    t->SetLocalRot(localRot);
+    rotInterpolation = 1;
+  }
+
+  prevRot = t->GetLocalRot();
+}
+
+void NetworkTransform::ReceiveScale(const Math::Vector3& localScale) {
+  Transform* t = entity->transform;
+  targetScale = localScale;
+
+  scaleInterpolation = 0;
+
+  if ((t->GetLocalScale() - targetScale).SqrMagnitude() >=
+      snapScale * snapScale) {
+    t->SetLocalScale(localScale);
+    scaleInterpolation = 1;
+  }
+
+  prevScale = t->GetLocalScale();
+}
+
+void NetworkTransform::ReceiveState(const InterpolationBuffer::State& state) {
+  if (!interpolationBuffer.IsEmpty() &&
+      (state.localPos - interpolationBuffer.GetNewest().localPos)
+              .SqrMagnitude() >= snapDistance * snapDistance) {
+    interpolationBuffer.Clear();
+  }
+  interpolationBuffer.Push(state);
+}
+
 void NetworkTransform::SnapLocalTransform() {
+  if (!interpolationBuffer.IsEmpty()) {
+    const InterpolationBuffer::State& newest = interpolationBuffer.GetNewest();
+    targetPos = newest.localPos;
+    targetRot = newest.localRot;
+    targetScale = newest.localScale;
+    interpolationBuffer.Clear();
+  }
+
   Transform* t = entity->transform;
   t->SetLocalPos(targetPos);
   t->SetLocalRot(targetRot);
@@ -462,6 +395,8 @@ void NetworkTransform::ForceSendTransform(bool snap) {
         [t, snap, this](TransformMessage* message) {
           message->timestamp = Time::GetElapsedTime();
           message->snap = snap;
+          message->hasScale = syncScale;
+          message->precision = precision;
           message->localPos = t->GetLocalPos();
           message->localRot = t->GetLocalRot();
           message->localScale = t->GetLocalScale();
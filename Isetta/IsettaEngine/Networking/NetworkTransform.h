@@ -5,7 +5,9 @@
 #include "Core/Config/Config.h"
 #include "Core/Math/Math.h"
 #include "ISETTA_API.h"
+#include "Networking/InterpolationBuffer.h"
 #include "Networking/Messages.h"
+#include "Networking/TransformQuantization.h"
 #include "Scene/Component.h"
 
 namespace Isetta {
@@ -53,8 +55,25 @@ float snapDistance = 5;
 float snapRotation = 30;
 /// Size that the entityi can scale from our current scale before our transform snaps to its target scale
 float snapScale = 1;
+/// How precisely the transform is sent, see TransformPrecision
+TransformPrecision precision;
+/// Whether scale is sent at all
+bool syncScale = true;
 
 private:
+/**
+ * @brief Interpolate toward a position received from the network, or snap to
+ * it when it is too far away. Same for rotation and scale.
+ */
+void ReceivePosition(const Math::Vector3& localPos);
+void ReceiveRotation(const Math::Quaternion& localRot);
+void ReceiveScale(const Math::Vector3& localScale);
+/**
+ * @brief Buffer a state from a snapshot to be shown once the interpolation
+ * time reaches it. A state too far from the last one is snapped to instead.
+ */
+void ReceiveState(const InterpolationBuffer::State& state);
+
 int updateCounter = 0;
 float lastPosMessage = 0;
 float lastRotMessage = 0;
@@ -70,14 +89,17 @@ Math::Quaternion targetRot = Math::Quaternion::identity;
 Math::Quaternion prevRot = Math::Quaternion::identity;
 Math::Vector3 targetScale;
 Math::Vector3 prevScale;
+/// Moved by input commands, see NetworkPrediction, so the transform isn't sent
+bool inputDriven = false;
+
+/// States from snapshots, shown interpolated instead of the targets above
+InterpolationBuffer interpolationBuffer;
 
 static bool registeredCallbacks;
-static std::unordered_map<int, float> serverPosTimestamps;
-static std::unordered_map<int, float> serverRotTimestamps;
-static std::unordered_map<int, float> serverScaleTimestamps;
 class NetworkId* netId;
 friend class NetworkTransform;
 friend class NetworkManager;
+friend class SnapshotReplication;
 DEFINE_COMPONENT_END(NetworkTransform, Component)
 
 // TODO(Caleb): ParentMessage
@@ -112,9 +134,8 @@ bool Serialize(Stream* stream) {
 
   serialize_float(stream, timestamp);
 
-  serialize_float(stream, localPos.x);
-  serialize_float(stream, localPos.y);
-  serialize_float(stream, localPos.z);
+  serialize_transform_precision(stream, precision);
+  serialize_quantized_position(stream, localPos, precision);
   return true;
 }
 
@@ -124,12 +145,14 @@ void Copy(const yojimbo::Message* otherMessage) override {
 
   netId = message->netId;
   timestamp = message->timestamp;
+  precision = message->precision;
   localPos = message->localPos;
 }
 
 public:
 int netId = 0;
 float timestamp = 0;
+TransformPrecision precision;
 Math::Vector3 localPos;
 DEFINE_NETWORK_MESSAGE_END
 
@@ -141,10 +164,8 @@ bool Serialize(Stream* stream) {
 
   serialize_float(stream, timestamp);
 
-  serialize_float(stream, localRot.x);
-  serialize_float(stream, localRot.y);
-  serialize_float(stream, localRot.z);
-  serialize_float(stream, localRot.w);
+  serialize_transform_precision(stream, precision);
+  serialize_quantized_rotation(stream, localRot, precision);
   return true;
 }
 
@@ -154,12 +175,14 @@ void Copy(const yojimbo::Message* otherMessage) override {
 
   netId = message->netId;
   timestamp = message->timestamp;
+  precision = message->precision;
   localRot = message->localRot;
 }
 
 public:
 int netId = 0;
 float timestamp = 0;
+TransformPrecision precision;
 Math::Quaternion localRot;
 DEFINE_NETWORK_MESSAGE_END
 
@@ -171,9 +194,8 @@ bool Serialize(Stream* stream) {
 
   serialize_float(stream, timestamp);
 
-  serialize_float(stream, localScale.x);
-  serialize_float(stream, localScale.y);
-  serialize_float(stream, localScale.z);
+  serialize_transform_precision(stream, precision);
+  serialize_quantized_scale(stream, localScale, precision);
   return true;
 }
 
@@ -183,12 +205,14 @@ void Copy(const yojimbo::Message* otherMessage) override {
 
   netId = message->netId;
   timestamp = message->timestamp;
+  precision = message->precision;
   localScale = message->localScale;
 }
 
 public:
 int netId = 0;
 float timestamp = 0;
+TransformPrecision precision;
 Math::Vector3 localScale;
 DEFINE_NETWORK_MESSAGE_END
 
@@ -201,19 +225,14 @@ bool Serialize(Stream* stream) {
   serialize_float(stream, timestamp);
 
   serialize_bool(stream, snap);
-
-  serialize_float(stream, localPos.x);
-  serialize_float(stream, localPos.y);
-  serialize_float(stream, localPos.z);
-
-  serialize_float(stream, localRot.x);
-  serialize_float(stream, localRot.y);
-  serialize_float(stream, localRot.z);
-  serialize_float(stream, localRot.w);
-
-  serialize_float(stream, localScale.x);
-  serialize_float(stream, localScale.y);
-  serialize_float(stream, localScale.z);
+  serialize_bool(stream, hasScale);
+
+  serialize_transform_precision(stream, precision);
+  serialize_quantized_position(stream, localPos, precision);
+  serialize_quantized_rotation(stream, localRot, precision);
+  if (hasScale) {
+    serialize_quantized_scale(stream, localScale, precision);
+  }
   return true;
 }
 
@@ -224,6 +243,8 @@ void Copy(const yojimbo::Message* otherMessage) override {
   netId = message->netId;
   timestamp = message->timestamp;
   snap = message->snap;
+  hasScale = message->hasScale;
+  precision = message->precision;
   localPos = message->localPos;
   localRot = message->localRot;
   localScale = message->localScale;
@@ -233,6 +254,8 @@ public:
 int netId = 0;
 float timestamp = 0;
 bool snap = false;
+bool hasScale = true;
+TransformPrecision precision;
 Math::Vector3 localPos;
 Math::Quaternion localRot;
 Math::Vector3 localScale;
@@ -13,6 +13,7 @@
 #include "Core/SystemInfo.h"
 #include "Networking/BuiltinMessages.h"
 #include "Networking/NetworkManager.h"
+#include "Networking/SnapshotReplication.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 // F Windows
@@ -33,9 +34,11 @@ void NetworkingModule::StartUp() {
   }
   srand(static_cast<unsigned int>(time(nullptr)));
 
-  // TODO(Caleb): Figure out some more robust channel settings
-  yojimboConfig.numChannels = 1;
-  yojimboConfig.channel[0].type = yojimbo::CHANNEL_TYPE_UNRELIABLE_UNORDERED;
+  yojimboConfig.numChannels = NUM_CHANNELS;
+  yojimboConfig.channel[RELIABLE_CHANNEL].type =
+      yojimbo::CHANNEL_TYPE_RELIABLE_ORDERED;
+  yojimboConfig.channel[UNRELIABLE_CHANNEL].type =
+      yojimbo::CHANNEL_TYPE_UNRELIABLE_UNORDERED;
   yojimboConfig.timeout = CONFIG_VAL(networkConfig.timeout);
 
   privateKey = new (MemoryManager::AllocOnStack(
@@ -60,9 +63,11 @@ void NetworkingModule::StartUp() {
                            CONFIG_VAL(networkConfig.clientPort)),
           yojimboConfig, NetworkAdapter, clock.GetElapsedTime());
 
-  clientSendBuffer =
-      MemoryManager::NewArrOnFreeList<RingBuffer<yojimbo::Message*>>(
-          CONFIG_VAL(networkConfig.clientQueueSize));
+  clientScheduler = MemoryManager::NewOnFreeList<SendScheduler>(
+      CONFIG_VAL(networkConfig.clientQueueSize),
+      [this](yojimbo::Message* message) { client->ReleaseMessage(message); });
+
+  snapshotReplication = MemoryManager::NewOnStack<SnapshotReplication>();
 }
 
 void NetworkingModule::Update(float deltaTime) {
@@ -73,6 +78,11 @@ void NetworkingModule::Update(float deltaTime) {
   // Check for new connections
   PumpClientServerUpdate(clock.GetElapsedTime());
 
+  // Snapshots go out with this update's messages
+  if (IsServerRunning()) {
+    snapshotReplication->ServerUpdate();
+  }
+
   // Send out our messages
   SendClientToServerMessages();
   int maxClients = CONFIG_VAL(networkConfig.maxClients);
@@ -98,6 +108,7 @@ void NetworkingModule::Update(float deltaTime) {
   // State monitor
   if (wasClientRunningLastFrame && !IsClientRunning()) {
     // client dropped out
+    clientScheduler->Clear();
     onDisconnectedFromServer.Invoke();
   }
   wasClientRunningLastFrame = IsClientRunning();
@@ -106,6 +117,7 @@ void NetworkingModule::Update(float deltaTime) {
     for (int i = 0; i < maxClients; ++i) {
       if (wasClientConnectedLastFrame[i] && !IsClientConnected(i)) {
         // client just disconnected
+        serverSchedulers[i]->Clear();
         onClientDisconnected.Invoke(clientInfos[i]);
       }
       wasClientConnectedLastFrame[i] = IsClientConnected(i);
@@ -124,16 +136,15 @@ void NetworkingModule::ShutDown() {
   } catch (std::exception& e) {
   }
 
+  MemoryManager::DeleteOnFreeList<SendScheduler>(clientScheduler);
   ShutdownYojimbo();
   client->~Client();
-  MemoryManager::DeleteArrOnFreeList<RingBuffer<yojimbo::Message*>>(
-      CONFIG_VAL(networkConfig.clientQueueSize), clientSendBuffer);
   clientAllocator->~NetworkAllocator();
+  snapshotReplication->~SnapshotReplication();
 }
 
-// NOTE: Deletes the oldest message in the queue if the queue is
-// overflowing--it would be nice to return it, but then we wouldn't
-// be able to guarantee the memory is reused
+// NOTE: The scheduler drops the least urgent message in the queue if the
+// queue is overflowing
 void NetworkingModule::AddClientToServerMessage(
     yojimbo::Message* message) const {
   if (!IsClientRunning()) {
@@ -141,16 +152,13 @@ void NetworkingModule::AddClientToServerMessage(
               "Cannot send message from client cause client is not running");
     return;
   }
-  if (clientSendBuffer->IsFull()) {
-    client->ReleaseMessage(
-        clientSendBuffer->Get());  // This may be horribly wrong
-  }
-  clientSendBuffer->Put(message);
+  clientScheduler->Push(
+      message, message->GetType(), MeasureMessage(message),
+      NetworkManager::Instance().GetMessageScheduling(message->GetType()));
 }
 
-// NOTE: Deletes the oldest message in the queue if the queue is
-// overflowing--it would be nice to return it, but then we wouldn't
-// be able to guarantee the memory is reused
+// NOTE: The scheduler drops the least urgent message in the queue if the
+// queue is overflowing
 void NetworkingModule::AddServerToClientMessage(int clientIdx,
                                                 yojimbo::Message* message) {
   if (!IsServerRunning()) {
@@ -158,14 +166,20 @@ void NetworkingModule::AddServerToClientMessage(int clientIdx,
               "Cannot send message from server cause server is not running");
     return;
   }
-  if (serverSendBufferArray[clientIdx].IsFull()) {
-    server->ReleaseMessage(
-        clientIdx,
-        serverSendBufferArray[clientIdx]
-            .Get());  // TODO(Caleb): This may be horribly wrong; test that
-                      // ReleaseMessage works from source
-  }
-  serverSendBufferArray[clientIdx].Put(message);
+  serverSchedulers[clientIdx]->Push(
+      message, message->GetType(), MeasureMessage(message),
+      NetworkManager::Instance().GetMessageScheduling(message->GetType()));
+}
+
+int NetworkingModule::MeasureMessage(yojimbo::Message* message) {
+  yojimbo::MeasureStream stream{yojimbo::GetDefaultAllocator()};
+  message->SerializeInternal(stream);
+  return stream.GetBytesProcessed();
+}
+
+int NetworkingModule::GetChannel(const SendScheduler::Priority priority) {
+  return priority == SendScheduler::Priority::CONTROL ? RELIABLE_CHANNEL
+                                                      : UNRELIABLE_CHANNEL;
 }
 
 void NetworkingModule::PumpClientServerUpdate(double time) {
@@ -187,64 +201,66 @@ void NetworkingModule::PumpClientServerUpdate(double time) {
 }
 
 void NetworkingModule::SendClientToServerMessages() const {
-  const int channelIdx = 0;  // TODO(Caleb): Upgrade the channel indexing
-  while (!clientSendBuffer->IsEmpty()) {
-    if (!client->CanSendMessage(channelIdx)) {
-      break;
-    }
-
-    yojimbo::Message* message = clientSendBuffer->Get();
-    client->SendMessage(channelIdx, message);  // bugged out
-  }
+  clientScheduler->Send(
+      CONFIG_VAL(networkConfig.clientSendBudget),
+      [this](const SendScheduler::Priority priority) {
+        return client->CanSendMessage(GetChannel(priority));
+      },
+      [this](yojimbo::Message* message,
+             const SendScheduler::Priority priority) {
+        client->SendMessage(GetChannel(priority), message);
+      });
 }
 
 void NetworkingModule::SendServerToClientMessages(int clientIdx) const {
-  const int channelIdx = 0;  // TODO(Caleb): Upgrade the channel indexing
-  while (!serverSendBufferArray[clientIdx].IsEmpty()) {
-    if (!server->CanSendMessage(clientIdx, channelIdx)) {
-      break;
-    }
-
-    yojimbo::Message* message = serverSendBufferArray[clientIdx].Get();
-    server->SendMessage(clientIdx, channelIdx, message);
-  }
+  serverSchedulers[clientIdx]->Send(
+      CONFIG_VAL(networkConfig.serverSendBudget),
+      [this, clientIdx](const SendScheduler::Priority priority) {
+        return server->CanSendMessage(clientIdx, GetChannel(priority));
+      },
+      [this, clientIdx](yojimbo::Message* message,
+                        const SendScheduler::Priority priority) {
+        server->SendMessage(clientIdx, GetChannel(priority), message);
+      });
 }
 
 void NetworkingModule::ProcessClientToServerMessages(int clientIdx) const {
-  const int channelIdx = 0;  // TODO(Caleb): Upgrade the channel indexing
-  for (;;) {
-    yojimbo::Message* message = server->ReceiveMessage(clientIdx, channelIdx);
+  for (int channelIdx = 0; channelIdx < NUM_CHANNELS; ++channelIdx) {
+    for (;;) {
+      yojimbo::Message* message = server->ReceiveMessage(clientIdx, channelIdx);
 
-    if (!message) {
-      break;
-    }
+      if (!message) {
+        break;
+      }
 
-    auto serverFunctions =
-        NetworkManager::Instance().GetServerFunctions(message->GetType());
-    for (const auto& function : serverFunctions) {
-      function.second(clientIdx, message);
-    }
+      auto serverFunctions =
+          NetworkManager::Instance().GetServerFunctions(message->GetType());
+      for (const auto& function : serverFunctions) {
+        function.second(clientIdx, message);
+      }
 
-    server->ReleaseMessage(clientIdx, message);
+      server->ReleaseMessage(clientIdx, message);
+    }
   }
 }
 
 void NetworkingModule::ProcessServerToClientMessages() const {
-  const int channelIdx = 0;  // TODO(Caleb): Upgrade the channel indexing
-  for (;;) {
-    yojimbo::Message* message = client->ReceiveMessage(channelIdx);
+  for (int channelIdx = 0; channelIdx < NUM_CHANNELS; ++channelIdx) {
+    for (;;) {
+      yojimbo::Message* message = client->ReceiveMessage(channelIdx);
 
-    if (!message) {
-      break;
-    }
+      if (!message) {
+        break;
+      }
 
-    auto clientFunctions =
-        NetworkManager::Instance().GetClientFunctions(message->GetType());
-    for (const auto& function : clientFunctions) {
-      function.second(message);
-    }
+      auto clientFunctions =
+          NetworkManager::Instance().GetClientFunctions(message->GetType());
+      for (const auto& function : clientFunctions) {
+        function.second(message);
+      }
 
-    client->ReleaseMessage(message);
+      client->ReleaseMessage(message);
+    }
   }
 }
 
@@ -290,6 +306,7 @@ void NetworkingModule::Connect(const char* serverAddress, int serverPort,
   client->InsecureConnect(privateKey, clientId, address, internalCallback);
 
   // Register callbacks
+  snapshotReplication->StartClient();
   loadLevelCallbackHandle =
       NetworkManager::Instance().RegisterClientCallback<LoadLevelMessage>(
           [](yojimbo::Message* inMessage) {
@@ -301,10 +318,13 @@ void NetworkingModule::Connect(const char* serverAddress, int serverPort,
 
 void NetworkingModule::Disconnect() const {
   if (client->IsConnected()) {
+    // queued messages belong to the connection
+    clientScheduler->Clear();
     client->Disconnect();
     // Unregister callbacks
     NetworkManager::Instance().UnregisterClientCallback<LoadLevelMessage>(
         loadLevelCallbackHandle);
+    snapshotReplication->StopClient();
 
   } else if (!client->IsConnecting()) {
     return;
@@ -333,14 +353,16 @@ void NetworkingModule::CreateServer(const char* address, int port) {
       NetworkAllocator(MemoryManager::AllocOnStack(serverMemorySize),
                        serverMemorySize);
 
-  // Create the buffers for the server messages
+  // Create the schedulers for the server messages
   int maxClients = CONFIG_VAL(networkConfig.maxClients);
-  serverSendBufferArray =
-      MemoryManager::NewArrOnFreeList<RingBuffer<yojimbo::Message*>>(
-          maxClients);
-  for (int i = 0; i < CONFIG_VAL(networkConfig.maxClients); ++i) {
-    serverSendBufferArray[i] = RingBuffer<yojimbo::Message*>(
-        CONFIG_VAL(networkConfig.serverQueueSizePerClient));
+  serverSchedulers =
+      MemoryManager::NewArrOnFreeList<SendScheduler*>(maxClients);
+  for (int i = 0; i < maxClients; ++i) {
+    serverSchedulers[i] = MemoryManager::NewOnFreeList<SendScheduler>(
+        CONFIG_VAL(networkConfig.serverQueueSizePerClient),
+        [this, i](yojimbo::Message* message) {
+          server->ReleaseMessage(i, message);
+        });
   }
 
   serverAddress = yojimbo::Address(address, port);
@@ -373,6 +395,7 @@ void NetworkingModule::CreateServer(const char* address, int port) {
             this->clientInfos[clientIndex] = info;
             this->onClientConnected.Invoke(info);
           });
+  snapshotReplication->StartServer(maxClients);
 }
 
 void NetworkingModule::CloseServer() {
@@ -385,17 +408,35 @@ void NetworkingModule::CloseServer() {
   MemoryManager::DeleteArrOnFreeList<ClientInfo>(
       CONFIG_VAL(networkConfig.maxClients), clientInfos);
   clientInfos = nullptr;
+  snapshotReplication->StopServer();
+  // queued messages have to go back before the server frees them
+  for (int i = 0; i < CONFIG_VAL(networkConfig.maxClients); ++i) {
+    MemoryManager::DeleteOnFreeList<SendScheduler>(serverSchedulers[i]);
+  }
+  MemoryManager::DeleteArrOnFreeList<SendScheduler*>(
+      CONFIG_VAL(networkConfig.maxClients), serverSchedulers);
   server->Stop();
   MemoryManager::DeleteOnFreeList<yojimbo::Server>(server);
   server = nullptr;
-  MemoryManager::DeleteArrOnFreeList<RingBuffer<yojimbo::Message*>>(
-      CONFIG_VAL(networkConfig.maxClients), serverSendBufferArray);
   serverAllocator->~NetworkAllocator();
 
   NetworkManager::Instance().UnregisterClientCallback<ClientConnectedMessage>(
       clientConnectedCallbackHandle);
 }
 
+SendScheduler::Stats NetworkingModule::GetServerSendStats(
+    const int clientIndex) const {
+  if (!IsServerRunning() || clientIndex < 0 ||
+      clientIndex >= CONFIG_VAL(networkConfig.maxClients)) {
+    return SendScheduler::Stats{};
+  }
+  return serverSchedulers[clientIndex]->GetStats();
+}
+
+SendScheduler::Stats NetworkingModule::GetClientSendStats() const {
+  return clientScheduler->GetStats();
+}
+
 bool NetworkingModule::IsClient() const {
   return client->IsConnected() && !server || (server && !server->IsRunning());
 }
@@ -6,10 +6,10 @@
 #include <functional>
 #include "Core/Config/CVar.h"
 #include "Core/DataStructures/Delegate.h"
-#include "Core/DataStructures/RingBuffer.h"
 #include "Core/Time/Clock.h"
 #include "Networking/ClientInfo.h"
 #include "Networking/Messages.h"
+#include "Networking/SendScheduler.h"
 #include "yojimbo/yojimbo.h"
 
 namespace Isetta {
@@ -42,16 +42,36 @@ class NetworkingModule {
     CVar<int> keyBytes{"key_bytes", 32};
     /// Maximum number of clients the server will support.
     CVar<int> maxClients{"max_clients", 4};
-    /// Number of messages the client can have in its send queue before messages
-    /// will be overwritten.
+    /// Number of messages the client can have in its send queue before the
+    /// least urgent one is dropped.
     CVar<int> clientQueueSize{"client_queue_size", 256};
     /// Number of messages the server can have in its send queue to an
-    /// individual client before messages will be overwritten.
+    /// individual client before the least urgent one is dropped.
     CVar<int> serverQueueSizePerClient{"server_queue_size_per_client", 256};
+    /// Bytes of messages the client sends each network update, unlimited if
+    /// it isn't positive
+    CVar<int> clientSendBudget{"client_send_budget", 2048};
+    /// Bytes of messages the server sends each client each network update,
+    /// unlimited if it isn't positive
+    CVar<int> serverSendBudget{"server_send_budget", 4096};
     /// Number of possible networked IDs
     CVar<int> maxNetID{"max_network_id", 65000};
     /// Timeout for client disconnect
     CVar<int> timeout{"network_timeout", 20};
+    /// Network updates between two snapshots the server sends each client
+    CVar<int> snapshotInterval{"snapshot_interval", 3};
+    /// Distance within which a client's entities make others relevant to it,
+    /// everything is relevant if it isn't positive
+    CVar<float> relevancyRadius{"relevancy_radius", 0};
+    /// Priority an irrelevant entity gains each snapshot, it is sent to the
+    /// client when it reaches 1 and never if this is 0
+    CVar<float> irrelevantPriority{"irrelevant_priority", 0.2f};
+    /// Seconds remote entities are shown behind the server at least
+    CVar<float> interpolationDelay{"interpolation_delay", 0.1f};
+    /// Seconds of delay added per second of measured snapshot jitter
+    CVar<float> interpolationJitterFactor{"interpolation_jitter_factor", 3};
+    /// Seconds a remote entity keeps moving past its last snapshot
+    CVar<float> maxExtrapolation{"max_extrapolation", 0.25f};
   };
 
  private:
@@ -67,15 +87,20 @@ class NetworkingModule {
   /// Key used to join the server.
   U8* privateKey;
 
+  /// Control messages go on the reliable channel, state on the unreliable one
+  enum Channel { RELIABLE_CHANNEL, UNRELIABLE_CHANNEL, NUM_CHANNELS };
+
+  /// Replicates networked transforms from the server to the clients.
+  class SnapshotReplication* snapshotReplication;
+
   // ------------------- Server Stuff -------------------
   /// Local server's current address and port.
   yojimbo::Address serverAddress;
   /// Local server.
   yojimbo::Server* server;
   NetworkAllocator* serverAllocator;
-  /// Queue of messages to be sent from the local server in the next network
-  /// update.
-  RingBuffer<yojimbo::Message*>* serverSendBufferArray;
+  /// Schedules the messages to be sent from the local server, one per client.
+  SendScheduler** serverSchedulers;
   ClientInfo* clientInfos;
   Delegate<ClientInfo> onClientConnected;
   Delegate<ClientInfo> onClientDisconnected;
@@ -92,9 +117,8 @@ class NetworkingModule {
   NetworkAllocator* clientAllocator;
   /// Identifier for the client on its remote server (might be unused).
   U64 clientId;
-  /// Queue of messages to be sent from the local client in the next network
-  /// update.
-  RingBuffer<yojimbo::Message*>* clientSendBuffer;
+  /// Schedules the messages to be sent from the local client.
+  SendScheduler* clientScheduler;
   Delegate<> onConnectedToServer;
   Delegate<> onDisconnectedFromServer;
   bool wasClientRunningLastFrame;
@@ -144,6 +168,12 @@ class NetworkingModule {
    */
   void AddServerToClientMessage(int clientIdx, yojimbo::Message* message);
 
+  /**
+   * @brief Serialized size of the message in bytes, for the send budget.
+   */
+  static int MeasureMessage(yojimbo::Message* message);
+  static int GetChannel(SendScheduler::Priority priority);
+
   /**
    * @brief Checks for connecting clients in the local Server, then sends queued
    * packets, then receives incoming packets. The received packets are
@@ -154,12 +184,13 @@ class NetworkingModule {
   void PumpClientServerUpdate(double time);
 
   /**
-   * @brief Sends the local Client's queued messages.
+   * @brief Sends the local Client's queued messages that fit in its budget.
    *
    */
   void SendClientToServerMessages() const;
   /**
-   * @brief Sends the local Server's queued messages for the given client.
+   * @brief Sends the local Server's queued messages for the given client that
+   * fit in its budget.
    *
    * @param clientIdx Index of the client who will receive the sent messages.
    */
@@ -219,6 +250,8 @@ class NetworkingModule {
   bool IsClientRunning() const;
   bool IsServerRunning() const;
   bool IsClientConnected(int clientIndex) const;
+  SendScheduler::Stats GetServerSendStats(int clientIndex) const;
+  SendScheduler::Stats GetClientSendStats() const;
 
   friend class NetworkManager;
   friend class EngineLoop;
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/SendScheduler.h"
+
+#include <algorithm>
+
+namespace Isetta {
+SendScheduler::SendScheduler(const int capacity,
+                             const Action<yojimbo::Message*>& release)
+    : capacity{capacity}, release{release} {
+  queue.reserve(capacity);
+}
+
+SendScheduler::~SendScheduler() { Clear(); }
+
+void SendScheduler::Push(yojimbo::Message* message, const int type,
+                         const int bytes, const MessageInfo& info) {
+  const Priority priority =
+      info.priority == Priority::STATE && info.isControl &&
+              info.isControl(message)
+          ? Priority::CONTROL
+          : info.priority;
+  const U64 key = priority == Priority::STATE && info.coalesceKey
+                      ? info.coalesceKey(message)
+                      : 0;
+  if (key != 0) {
+    for (Entry& entry : queue) {
+      if (entry.priority != Priority::STATE || entry.type != type ||
+          entry.key != key) {
+        continue;
+      }
+      // the newer one takes the older one's place, and how long it waited
+      release(entry.message);
+      entry.message = message;
+      entry.bytes = bytes;
+      ++stats.coalesced;
+      return;
+    }
+  }
+
+  const Entry incoming{
+      message, priority, info.importance, type, key, bytes, update};
+  if (static_cast<int>(queue.size()) >= capacity) {
+    // the state message least likely to be sent soon goes, which can be the
+    // incoming one. Control messages are never dropped
+    int victim = -1;
+    float lowest = 0;
+    for (int i = 0; i < static_cast<int>(queue.size()); ++i) {
+      if (queue[i].priority != Priority::STATE) continue;
+      const float score = Score(queue[i]);
+      if (victim < 0 || score < lowest) {
+        victim = i;
+        lowest = score;
+      }
+    }
+    if (incoming.priority == Priority::STATE &&
+        (victim < 0 || Score(incoming) <= lowest)) {
+      release(message);
+      ++stats.dropped;
+      return;
+    }
+    if (victim >= 0) {
+      Remove(victim, true);
+      ++stats.dropped;
+    }
+  }
+
+  queue.push_back(incoming);
+  stats.queueDepth = static_cast<int>(queue.size());
+}
+
+void SendScheduler::Send(const int budget, const Func<bool, Priority>& canSend,
+                         const Action<yojimbo::Message*, Priority>& send) {
+  ++update;
+  int sentBytes = 0;
+  const auto fits = [budget, &sentBytes](const int bytes) {
+    return budget <= 0 || sentBytes == 0 || sentBytes + bytes <= budget;
+  };
+
+  // control messages keep their order, so stop at the first that can't go
+  for (int i = 0; i < static_cast<int>(queue.size());) {
+    const Entry& entry = queue[i];
+    if (entry.priority != Priority::CONTROL) {
+      ++i;
+      continue;
+    }
+    if (!canSend(Priority::CONTROL) || !fits(entry.bytes)) break;
+    send(entry.message, Priority::CONTROL);
+    sentBytes += entry.bytes;
+    ++stats.sent;
+    Remove(i, false);
+  }
+
+  std::vector<int> order;
+  for (int i = 0; i < static_cast<int>(queue.size()); ++i) {
+    if (queue[i].priority == Priority::STATE) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [this](const int a, const int b) {
+                     return Score(queue[a]) > Score(queue[b]);
+                   });
+
+  for (const int i : order) {
+    if (!canSend(Priority::STATE)) break;
+    Entry& entry = queue[i];
+    // a smaller one further down can still fit
+    if (!fits(entry.bytes)) continue;
+    send(entry.message, Priority::STATE);
+    sentBytes += entry.bytes;
+    ++stats.sent;
+    entry.message = nullptr;
+  }
+  queue.erase(std::remove_if(queue.begin(), queue.end(),
+                             [](const Entry& entry) {
+                               return entry.message == nullptr;
+                             }),
+              queue.end());
+
+  stats.lastSentBytes = sentBytes;
+  stats.queueDepth = static_cast<int>(queue.size());
+}
+
+void SendScheduler::Clear() {
+  for (const Entry& entry : queue) release(entry.message);
+  queue.clear();
+  stats.queueDepth = 0;
+}
+
+float SendScheduler::Score(const Entry& entry) const {
+  // a message queued this update has waited one
+  return static_cast<float>(update - entry.queuedUpdate + 1) *
+         entry.importance;
+}
+
+void SendScheduler::Remove(const int index, const bool releaseMessage) {
+  if (releaseMessage) release(queue[index].message);
+  queue.erase(queue.begin() + index);
+}
+}  // namespace Isetta
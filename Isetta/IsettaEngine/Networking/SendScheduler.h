@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+
+namespace yojimbo {
+class Message;
+}
+
+namespace Isetta {
+/**
+ * @brief Queue of the messages going to one receiver, deciding each network
+ * update which of them go out. Control messages go first and in order, then
+ * state messages by how long they waited times how important they are, as
+ * long as the byte budget lasts. A state message for something that still has
+ * one queued replaces it instead of queueing behind it.
+ */
+class ISETTA_API SendScheduler {
+ public:
+  enum class Priority {
+    /// Sent reliably and in order, before anything else
+    CONTROL,
+    /// Sent unreliably, only the latest one for the same thing matters
+    STATE
+  };
+
+  /**
+   * @brief How messages of one type are scheduled.
+   */
+  struct MessageInfo {
+    Priority priority = Priority::CONTROL;
+    /// Scales how quickly a waiting state message rises in the queue
+    float importance = 1;
+    /// Queued state messages of the same type and key are coalesced, 0 never
+    /// is. Usually the network ID the message is about
+    Func<U64, const yojimbo::Message*> coalesceKey;
+    /// State messages it returns true for are one-off events that nothing
+    /// replaces, and are sent as control messages instead
+    Func<bool, const yojimbo::Message*> isControl;
+  };
+
+  /**
+   * @brief Counters of what happened to the messages given to a scheduler.
+   */
+  struct Stats {
+    /// Messages waiting to be sent
+    int queueDepth = 0;
+    /// Bytes sent in the last network update
+    int lastSentBytes = 0;
+    U64 sent = 0;
+    /// Messages replaced by a newer one for the same thing
+    U64 coalesced = 0;
+    /// State messages thrown away because the queue was full
+    U64 dropped = 0;
+  };
+
+  /**
+   * @param capacity Messages that can wait at once. Control messages are never
+   * dropped, the queue grows past it when only they are waiting
+   * @param release Gives a message that won't be sent back to its owner
+   */
+  SendScheduler(int capacity, const Action<yojimbo::Message*>& release);
+  ~SendScheduler();
+
+  SendScheduler(const SendScheduler&) = delete;
+  SendScheduler& operator=(const SendScheduler&) = delete;
+
+  /**
+   * @brief Queue a message. The scheduler owns it until it is sent or
+   * released.
+   *
+   * @param type Message type, coalescing only happens within the same type
+   * @param bytes Serialized size of the message
+   */
+  void Push(yojimbo::Message* message, int type, int bytes,
+            const MessageInfo& info);
+  /**
+   * @brief Send what fits in this network update. The first message of an
+   * update always goes if it can, so nothing is too big to ever be sent.
+   *
+   * @param budget Bytes to send at most, unlimited if it isn't positive
+   * @param canSend Whether the connection takes another message of the
+   * priority right now
+   * @param send Takes ownership of a message and sends it
+   */
+  void Send(int budget, const Func<bool, Priority>& canSend,
+            const Action<yojimbo::Message*, Priority>& send);
+  /**
+   * @brief Release every queued message.
+   */
+  void Clear();
+
+  const Stats& GetStats() const { return stats; }
+
+ private:
+  struct Entry {
+    yojimbo::Message* message;
+    Priority priority;
+    float importance;
+    int type;
+    U64 key;
+    int bytes;
+    /// Update the message was first queued in, kept when coalescing
+    U64 queuedUpdate;
+  };
+
+  float Score(const Entry& entry) const;
+  void Remove(int index, bool releaseMessage);
+
+  int capacity;
+  Action<yojimbo::Message*> release;
+  std::vector<Entry> queue;
+  U64 update = 0;
+  Stats stats;
+};
+}  // namespace Isetta
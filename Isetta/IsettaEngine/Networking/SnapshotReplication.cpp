@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/SnapshotReplication.h"
+
+#include <algorithm>
+#include <limits>
+#include "Core/Time/Time.h"
+#include "Networking/NetworkId.h"
+#include "Networking/NetworkManager.h"
+#include "Networking/NetworkPrediction.h"
+#include "Networking/NetworkTransform.h"
+#include "Scene/Entity.h"
+#include "Scene/Transform.h"
+#include "brofiler/ProfilerCore/Brofiler.h"
+
+namespace Isetta {
+namespace {
+/// Whether sequence a is newer than b, counting wraparound
+bool IsNewer(const U16 a, const U16 b) {
+  return a != b && static_cast<U16>(a - b) < 0x8000;
+}
+
+/// Fields of current that baseline doesn't have or has a different value for
+U8 ChangedFields(const ReplicatedTransform& baseline,
+                 const ReplicatedTransform& current) {
+  U8 changed = current.fields & ~baseline.fields;
+  const U8 shared = current.fields & baseline.fields;
+  if ((shared & ReplicatedTransform::POSITION) &&
+      current.localPos != baseline.localPos) {
+    changed |= ReplicatedTransform::POSITION;
+  }
+  if ((shared & ReplicatedTransform::ROTATION) &&
+      current.localRot != baseline.localRot) {
+    changed |= ReplicatedTransform::ROTATION;
+  }
+  if ((shared & ReplicatedTransform::SCALE) &&
+      current.localScale != baseline.localScale) {
+    changed |= ReplicatedTransform::SCALE;
+  }
+  return changed;
+}
+
+/// Copy the given fields of from into to, along with its precision
+void CopyFields(const ReplicatedTransform& from, const U8 fields,
+                ReplicatedTransform* to) {
+  if (fields & ReplicatedTransform::POSITION) to->localPos = from.localPos;
+  if (fields & ReplicatedTransform::ROTATION) to->localRot = from.localRot;
+  if (fields & ReplicatedTransform::SCALE) to->localScale = from.localScale;
+  to->fields |= fields;
+  to->precision = from.precision;
+}
+
+/// Remove a transform the receiver has, unless the delta is full
+void RemoveEntry(const ReplicatedTransform& old, const int maxEntries,
+                 std::vector<ReplicatedTransform>* delta,
+                 std::vector<ReplicatedTransform>* view) {
+  if (static_cast<int>(delta->size()) >= maxEntries) {
+    view->push_back(old);
+    return;
+  }
+  ReplicatedTransform removed;
+  removed.netId = old.netId;
+  delta->push_back(removed);
+}
+}  // namespace
+
+SnapshotReplication::SnapshotReplication() {
+  // every snapshot holds everything since the acknowledged baseline, so a
+  // queued one is only ever replaced by a newer one, same for acks
+  SendScheduler::MessageInfo info;
+  info.priority = SendScheduler::Priority::STATE;
+  info.importance = 2;
+  info.coalesceKey = [](const yojimbo::Message*) { return U64{1}; };
+  NetworkManager::Instance().SetMessageScheduling<SnapshotMessage>(info);
+  info.importance = 1;
+  NetworkManager::Instance().SetMessageScheduling<SnapshotAckMessage>(info);
+}
+
+void SnapshotReplication::EncodeDelta(
+    const std::vector<ReplicatedTransform>& baseline,
+    const std::vector<ReplicatedTransform>& current, const int maxEntries,
+    std::vector<ReplicatedTransform>* delta,
+    std::vector<ReplicatedTransform>* view) {
+  delta->clear();
+  view->clear();
+  const ReplicatedTransform none;
+
+  auto base = baseline.begin();
+  for (const ReplicatedTransform& transform : current) {
+    for (; base != baseline.end() && base->netId < transform.netId; ++base) {
+      RemoveEntry(*base, maxEntries, delta, view);
+    }
+    const bool inBaseline = base != baseline.end() &&
+                            base->netId == transform.netId;
+    const ReplicatedTransform& old = inBaseline ? *base++ : none;
+
+    const U8 changed = ChangedFields(old, transform);
+    if (changed == 0 || static_cast<int>(delta->size()) >= maxEntries) {
+      // the receiver keeps what it had
+      if (inBaseline) view->push_back(old);
+      continue;
+    }
+
+    ReplicatedTransform entry;
+    entry.netId = transform.netId;
+    CopyFields(transform, changed, &entry);
+    delta->push_back(entry);
+
+    ReplicatedTransform updated = old;
+    updated.netId = transform.netId;
+    CopyFields(transform, changed, &updated);
+    view->push_back(updated);
+  }
+  for (; base != baseline.end(); ++base) {
+    RemoveEntry(*base, maxEntries, delta, view);
+  }
+}
+
+void SnapshotReplication::DecodeDelta(
+    const std::vector<ReplicatedTransform>& baseline,
+    const ReplicatedTransform* delta, const int deltaCount,
+    std::vector<ReplicatedTransform>* state) {
+  state->clear();
+  state->reserve(baseline.size() + deltaCount);
+
+  // both are sorted, merge them
+  auto base = baseline.begin();
+  for (int i = 0; i < deltaCount; ++i) {
+    const ReplicatedTransform& entry = delta[i];
+    while (base != baseline.end() && base->netId < entry.netId) {
+      state->push_back(*base++);
+    }
+    if (entry.fields == 0) {
+      // removed
+      if (base != baseline.end() && base->netId == entry.netId) ++base;
+      continue;
+    }
+    if (base != baseline.end() && base->netId == entry.netId) {
+      state->push_back(*base++);
+    } else {
+      ReplicatedTransform added;
+      added.netId = entry.netId;
+      state->push_back(added);
+    }
+    CopyFields(entry, entry.fields, &state->back());
+  }
+  state->insert(state->end(), base, baseline.end());
+}
+
+void SnapshotReplication::StartServer(const int maxClients) {
+  authorityTransforms.clear();
+  clientSnapshots.clear();
+  clientSnapshots.resize(maxClients);
+  ticksSinceSnapshot = 0;
+
+  positionCallbackHandle =
+      NetworkManager::Instance().RegisterServerCallback<PositionMessage>(
+          [this](const int clientIdx, yojimbo::Message* message) {
+            auto* positionMessage = reinterpret_cast<PositionMessage*>(message);
+            AuthorityTransform* authority =
+                AcceptAuthority(clientIdx, positionMessage->netId);
+            if (!authority) return;
+            if (authority->posTimestamp > positionMessage->timestamp) return;
+            authority->posTimestamp = positionMessage->timestamp;
+            authority->transform.localPos = positionMessage->localPos;
+            authority->transform.precision = positionMessage->precision;
+            authority->transform.fields |= ReplicatedTransform::POSITION;
+          });
+  rotationCallbackHandle =
+      NetworkManager::Instance().RegisterServerCallback<RotationMessage>(
+          [this](const int clientIdx, yojimbo::Message* message) {
+            auto* rotationMessage = reinterpret_cast<RotationMessage*>(message);
+            AuthorityTransform* authority =
+                AcceptAuthority(clientIdx, rotationMessage->netId);
+            if (!authority) return;
+            if (authority->rotTimestamp > rotationMessage->timestamp) return;
+            authority->rotTimestamp = rotationMessage->timestamp;
+            authority->transform.localRot = rotationMessage->localRot;
+            authority->transform.precision = rotationMessage->precision;
+            authority->transform.fields |= ReplicatedTransform::ROTATION;
+          });
+  scaleCallbackHandle =
+      NetworkManager::Instance().RegisterServerCallback<ScaleMessage>(
+          [this](const int clientIdx, yojimbo::Message* message) {
+            auto* scaleMessage = reinterpret_cast<ScaleMessage*>(message);
+            AuthorityTransform* authority =
+                AcceptAuthority(clientIdx, scaleMessage->netId);
+            if (!authority) return;
+            if (authority->scaleTimestamp > scaleMessage->timestamp) return;
+            authority->scaleTimestamp = scaleMessage->timestamp;
+            authority->transform.localScale = scaleMessage->localScale;
+            authority->transform.precision = scaleMessage->precision;
+            authority->transform.fields |= ReplicatedTransform::SCALE;
+          });
+  // forced transforms still go to everyone right away, snapshots just
+  // shouldn't move them back later
+  transformCallbackHandle =
+      NetworkManager::Instance().RegisterServerCallback<TransformMessage>(
+          [this](const int clientIdx, yojimbo::Message* message) {
+            auto* transformMessage =
+                reinterpret_cast<TransformMessage*>(message);
+            AuthorityTransform* authority =
+                AcceptAuthority(clientIdx, transformMessage->netId);
+            if (!authority) return;
+            ReplicatedTransform& transform = authority->transform;
+            transform.precision = transformMessage->precision;
+            if (authority->posTimestamp <= transformMessage->timestamp) {
+              authority->posTimestamp = transformMessage->timestamp;
+              transform.localPos = transformMessage->localPos;
+              transform.fields |= ReplicatedTransform::POSITION;
+            }
+            if (authority->rotTimestamp <= transformMessage->timestamp) {
+              authority->rotTimestamp = transformMessage->timestamp;
+              transform.localRot = transformMessage->localRot;
+              transform.fields |= ReplicatedTransform::ROTATION;
+            }
+            if (transformMessage->hasScale &&
+                authority->scaleTimestamp <= transformMessage->timestamp) {
+              authority->scaleTimestamp = transformMessage->timestamp;
+              transform.localScale = transformMessage->localScale;
+              transform.fields |= ReplicatedTransform::SCALE;
+            }
+          });
+  ackCallbackHandle =
+      NetworkManager::Instance().RegisterServerCallback<SnapshotAckMessage>(
+          [this](const int clientIdx, yojimbo::Message* message) {
+            auto* ackMessage = reinterpret_cast<SnapshotAckMessage*>(message);
+            ReceiveAck(clientIdx, ackMessage->sequence);
+          });
+}
+
+void SnapshotReplication::StopServer() {
+  NetworkManager& networkManager = NetworkManager::Instance();
+  networkManager.UnregisterServerCallback<PositionMessage>(
+      positionCallbackHandle);
+  networkManager.UnregisterServerCallback<RotationMessage>(
+      rotationCallbackHandle);
+  networkManager.UnregisterServerCallback<ScaleMessage>(scaleCallbackHandle);
+  networkManager.UnregisterServerCallback<TransformMessage>(
+      transformCallbackHandle);
+  networkManager.UnregisterServerCallback<SnapshotAckMessage>(
+      ackCallbackHandle);
+  authorityTransforms.clear();
+  clientSnapshots.clear();
+}
+
+void SnapshotReplication::StartClient() {
+  for (Snapshot& snapshot : received) snapshot.valid = false;
+  hasReceived = false;
+  clock.Reset();
+
+  snapshotCallbackHandle =
+      NetworkManager::Instance().RegisterClientCallback<SnapshotMessage>(
+          [this](yojimbo::Message* message) {
+            ReceiveSnapshot(*reinterpret_cast<SnapshotMessage*>(message));
+          });
+}
+
+void SnapshotReplication::StopClient() {
+  NetworkManager::Instance().UnregisterClientCallback<SnapshotMessage>(
+      snapshotCallbackHandle);
+  for (Snapshot& snapshot : received) snapshot.transforms.clear();
+}
+
+void SnapshotReplication::ServerUpdate() {
+  BROFILER_CATEGORY("Snapshot Replication", Profiler::Color::Orange);
+
+  if (++ticksSinceSnapshot < CONFIG_VAL(networkConfig.snapshotInterval)) {
+    return;
+  }
+  ticksSinceSnapshot = 0;
+
+  const U16 sequence = nextSequence++;
+  const std::vector<ReplicatedTransform> noBaseline;
+  std::vector<ReplicatedTransform> current;
+  std::vector<ReplicatedTransform> delta;
+  std::vector<U32> due;
+  current.reserve(authorityTransforms.size());
+  UpdateInterest();
+
+  for (int i = 0; i < static_cast<int>(clientSnapshots.size()); ++i) {
+    ClientSnapshots& client = clientSnapshots[i];
+    if (!NetworkManager::Instance().IsClientConnected(i)) {
+      // a client joining in this slot starts over
+      client.hasAck = false;
+      client.hasSent = false;
+      interest.ResetClient(i);
+      continue;
+    }
+
+    // the new snapshot takes the slot of the one historySize before it
+    const Snapshot* baseline = nullptr;
+    if (client.hasAck &&
+        static_cast<U16>(sequence - client.ackedSequence) < historySize) {
+      const Snapshot& acked = client.sent[client.ackedSequence % historySize];
+      if (acked.valid && acked.sequence == client.ackedSequence) {
+        baseline = &acked;
+      }
+    }
+    const std::vector<ReplicatedTransform>& baseTransforms =
+        baseline ? baseline->transforms : noBaseline;
+
+    // what the client has once the last snapshot arrives, which can be newer
+    // than the baseline
+    const std::vector<ReplicatedTransform>& lastTransforms =
+        client.hasSent ? client.sent[client.lastSent % historySize].transforms
+                       : baseTransforms;
+
+    // a client doesn't need its own entities back, and the ones it isn't
+    // interested in stay as it was last sent them
+    current.clear();
+    due.clear();
+    auto last = lastTransforms.begin();
+    for (const auto& [netId, authority] : authorityTransforms) {
+      if (authority.clientIdx == i) continue;
+      if (interest.ShouldSend(i, netId)) {
+        current.push_back(authority.transform);
+        if (!interest.IsRelevant(i, netId)) due.push_back(netId);
+        continue;
+      }
+      while (last != lastTransforms.end() && last->netId < netId) ++last;
+      if (last != lastTransforms.end() && last->netId == netId) {
+        current.push_back(*last);
+      }
+    }
+
+    Snapshot& snapshot = client.sent[sequence % historySize];
+    EncodeDelta(baseTransforms, current, SnapshotMessage::maxEntries, &delta,
+                &snapshot.transforms);
+    snapshot.sequence = sequence;
+    client.hasSent = true;
+    client.lastSent = sequence;
+
+    // the due entities a full delta left out are still due
+    snapshot.due.clear();
+    auto entry = delta.begin();
+    for (const U32 netId : due) {
+      while (entry != delta.end() && entry->netId < netId) ++entry;
+      if (entry != delta.end() && entry->netId == netId) {
+        snapshot.due.push_back(netId);
+      }
+    }
+    // nothing new for a client that is up to date
+    snapshot.valid = !delta.empty() || baseline == nullptr;
+    if (!snapshot.valid) continue;
+
+    NetworkManager::Instance().SendMessageFromServer<SnapshotMessage>(
+        i, [&](SnapshotMessage* message) {
+          message->sequence = sequence;
+          message->serverTime = static_cast<float>(Time::GetElapsedTime());
+          message->hasBaseline = baseline != nullptr;
+          message->baseline = baseline ? baseline->sequence : 0;
+          message->entryCount = static_cast<int>(delta.size());
+          std::copy(delta.begin(), delta.end(), message->entries);
+        });
+  }
+}
+
+void SnapshotReplication::UpdateInterest() {
+  interest.Configure(CONFIG_VAL(networkConfig.relevancyRadius),
+                     CONFIG_VAL(networkConfig.irrelevantPriority));
+  interest.Begin(static_cast<int>(clientSnapshots.size()));
+
+  std::vector<std::vector<Math::Vector3>> focus(clientSnapshots.size());
+  for (const auto& [netId, authority] : authorityTransforms) {
+    // the server's own copy knows where the entity is in the world, without
+    // one the local position is the best guess
+    Entity* entity = NetworkManager::Instance().GetNetworkEntity(netId);
+    const Math::Vector3 position = entity
+                                       ? entity->transform->GetWorldPos()
+                                       : authority.transform.localPos;
+    interest.AddEntity(netId, position);
+    if (authority.clientIdx >= 0 &&
+        authority.clientIdx < static_cast<int>(focus.size())) {
+      focus[authority.clientIdx].push_back(position);
+    }
+  }
+
+  for (int i = 0; i < static_cast<int>(focus.size()); ++i) {
+    if (NetworkManager::Instance().IsClientConnected(i)) {
+      interest.UpdateClient(i, focus[i]);
+    }
+  }
+}
+
+void SnapshotReplication::Forget(const U32 netId) {
+  authorityTransforms.erase(netId);
+  interest.Forget(netId);
+}
+
+SnapshotReplication::AuthorityTransform* SnapshotReplication::RecordAuthority(
+    const int clientIdx, const U32 netId) {
+  AuthorityTransform& authority = authorityTransforms[netId];
+  authority.clientIdx = clientIdx;
+  authority.transform.netId = netId;
+  return &authority;
+}
+
+SnapshotReplication::AuthorityTransform* SnapshotReplication::AcceptAuthority(
+    const int clientIdx, const U32 netId) {
+  // a client only moves what it has authority over, and never what the
+  // server simulates from its input
+  NetworkId* networkId = NetworkManager::Instance().GetNetworkId(netId);
+  if (!networkId || networkId->clientAuthorityId != clientIdx ||
+      networkId->entity->GetComponent<NetworkPrediction>()) {
+    return nullptr;
+  }
+  return RecordAuthority(clientIdx, netId);
+}
+
+void SnapshotReplication::RecordPredictedState(const int clientIdx,
+                                               const U32 netId,
+                                               const PredictedState& state) {
+  AuthorityTransform* authority = RecordAuthority(clientIdx, netId);
+  // transform messages are timed by the sender's clock, none of them should
+  // win over the server's own state
+  authority->posTimestamp = std::numeric_limits<float>::max();
+  authority->rotTimestamp = std::numeric_limits<float>::max();
+  ReplicatedTransform& transform = authority->transform;
+  transform.localPos = state.localPos;
+  transform.localRot = state.localRot;
+  transform.fields |=
+      ReplicatedTransform::POSITION | ReplicatedTransform::ROTATION;
+}
+
+void SnapshotReplication::ReceiveAck(const int clientIdx, const U16 sequence) {
+  if (clientIdx < 0 || clientIdx >= static_cast<int>(clientSnapshots.size())) {
+    return;
+  }
+  ClientSnapshots& client = clientSnapshots[clientIdx];
+  const Snapshot& snapshot = client.sent[sequence % historySize];
+  if (!snapshot.valid || snapshot.sequence != sequence) return;
+  for (const U32 netId : snapshot.due) interest.Acknowledge(clientIdx, netId);
+  if (client.hasAck && !IsNewer(sequence, client.ackedSequence)) return;
+  client.hasAck = true;
+  client.ackedSequence = sequence;
+}
+
+void SnapshotReplication::ReceiveSnapshot(const SnapshotMessage& message) {
+  // the channel is unordered, a newer snapshot already has everything
+  if (hasReceived && !IsNewer(message.sequence, lastReceived)) return;
+
+  const std::vector<ReplicatedTransform> noBaseline;
+  const std::vector<ReplicatedTransform>* baseline = &noBaseline;
+  if (message.hasBaseline) {
+    const Snapshot& acked = received[message.baseline % historySize];
+    // dropped from the history, the server sends everything again once the
+    // acks for the newer snapshots arrive
+    if (!acked.valid || acked.sequence != message.baseline ||
+        static_cast<U16>(message.sequence - message.baseline) >= historySize) {
+      return;
+    }
+    baseline = &acked.transforms;
+  }
+
+  Snapshot& snapshot = received[message.sequence % historySize];
+  DecodeDelta(*baseline, message.entries, message.entryCount,
+              &snapshot.transforms);
+  snapshot.sequence = message.sequence;
+  snapshot.valid = true;
+
+  clock.Configure(CONFIG_VAL(networkConfig.interpolationDelay),
+                  CONFIG_VAL(networkConfig.interpolationJitterFactor));
+  clock.Receive(message.serverTime,
+                static_cast<float>(Time::GetElapsedTime()));
+  // unchanged transforms too, an entity that stopped needs a state saying so
+  // or it would be extrapolated past where it stopped
+  for (const ReplicatedTransform& transform : snapshot.transforms) {
+    Apply(transform, message.serverTime);
+  }
+  hasReceived = true;
+  lastReceived = message.sequence;
+
+  NetworkManager::Instance().SendMessageFromClient<SnapshotAckMessage>(
+      [&message](SnapshotAckMessage* ack) {
+        ack->sequence = message.sequence;
+      });
+}
+
+float SnapshotReplication::GetInterpolationTime() const {
+  return clock.GetRenderTime(static_cast<float>(Time::GetElapsedTime()));
+}
+
+void SnapshotReplication::Apply(const ReplicatedTransform& transform,
+                                const float serverTime) {
+  NetworkId* netId = NetworkManager::Instance().GetNetworkId(transform.netId);
+  if (!netId || netId->HasClientAuthority()) {
+    return;
+  }
+  NetworkTransform* nt = netId->entity->GetComponent<NetworkTransform>();
+  if (!nt) {
+    return;
+  }
+
+  // fields the server doesn't know yet stay the way they are
+  InterpolationBuffer::State state;
+  if (nt->interpolationBuffer.IsEmpty()) {
+    Transform* t = nt->entity->transform;
+    state.localPos = t->GetLocalPos();
+    state.localRot = t->GetLocalRot();
+    state.localScale = t->GetLocalScale();
+  } else {
+    state = nt->interpolationBuffer.GetNewest();
+  }
+  state.time = serverTime;
+  if (transform.fields & ReplicatedTransform::POSITION) {
+    state.localPos = transform.localPos;
+  }
+  if (transform.fields & ReplicatedTransform::ROTATION) {
+    state.localRot = transform.localRot;
+  }
+  if (transform.fields & ReplicatedTransform::SCALE) {
+    state.localScale = transform.localScale;
+  }
+  nt->ReceiveState(state);
+}
+}  // namespace Isetta
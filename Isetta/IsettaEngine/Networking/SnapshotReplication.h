@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <map>
+#include <vector>
+#include "Core/Config/Config.h"
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "Networking/InputPrediction.h"
+#include "Networking/InterestManagement.h"
+#include "Networking/InterpolationBuffer.h"
+#include "Networking/Messages.h"
+#include "Networking/TransformQuantization.h"
+
+namespace Isetta {
+/**
+ * @brief Local transform of a networked entity the way snapshots carry it.
+ * Only the parts in fields are known, or included in a delta. A delta entry
+ * without fields removes the transform.
+ */
+struct ReplicatedTransform {
+  enum Field : U8 {
+    POSITION = 1 << 0,
+    ROTATION = 1 << 1,
+    SCALE = 1 << 2,
+    ALL = POSITION | ROTATION | SCALE
+  };
+
+  U32 netId = 0;
+  U8 fields = 0;
+  TransformPrecision precision;
+  Math::Vector3 localPos;
+  Math::Quaternion localRot;
+  Math::Vector3 localScale;
+};
+
+/**
+ * @brief SnapshotMessage is sent from the server to one client every snapshot
+ * tick. It holds the transforms that changed since the baseline snapshot,
+ * which the client acknowledged before, or every transform without one.
+ *
+ */
+DEFINE_NETWORK_MESSAGE(SnapshotMessage)
+template <typename Stream>
+bool Serialize(Stream* stream) {
+  serialize_bits(stream, sequence, 16);
+  serialize_float(stream, serverTime);
+  serialize_bool(stream, hasBaseline);
+  if (hasBaseline) {
+    serialize_bits(stream, baseline, 16);
+  }
+  serialize_int(stream, entryCount, 0, maxEntries);
+
+  for (int i = 0; i < entryCount; ++i) {
+    ReplicatedTransform& entry = entries[i];
+    serialize_int(stream, entry.netId, 0,
+                  Config::Instance().networkConfig.maxNetID.GetVal());
+    serialize_bits(stream, entry.fields, 3);
+    serialize_transform_precision(stream, entry.precision);
+    if (entry.fields & ReplicatedTransform::POSITION) {
+      serialize_quantized_position(stream, entry.localPos, entry.precision);
+    }
+    if (entry.fields & ReplicatedTransform::ROTATION) {
+      serialize_quantized_rotation(stream, entry.localRot, entry.precision);
+    }
+    if (entry.fields & ReplicatedTransform::SCALE) {
+      serialize_quantized_scale(stream, entry.localScale, entry.precision);
+    }
+  }
+  return true;
+}
+
+void Copy(const yojimbo::Message* otherMessage) override {
+  const SnapshotMessage* message =
+      reinterpret_cast<const SnapshotMessage*>(otherMessage);
+
+  sequence = message->sequence;
+  serverTime = message->serverTime;
+  hasBaseline = message->hasBaseline;
+  baseline = message->baseline;
+  entryCount = message->entryCount;
+  for (int i = 0; i < entryCount; ++i) {
+    entries[i] = message->entries[i];
+  }
+}
+
+public:
+/// Transforms one snapshot can carry, the rest go in later snapshots
+static const int maxEntries = 64;
+
+U16 sequence = 0;
+/// Server's time when the snapshot was taken
+float serverTime = 0;
+bool hasBaseline = false;
+U16 baseline = 0;
+int entryCount = 0;
+ReplicatedTransform entries[maxEntries];
+DEFINE_NETWORK_MESSAGE_END
+
+/**
+ * @brief SnapshotAckMessage is sent from the client to the server for every
+ * snapshot the client applied, so later snapshots can be deltas against it.
+ *
+ */
+DEFINE_NETWORK_MESSAGE(SnapshotAckMessage)
+template <typename Stream>
+bool Serialize(Stream* stream) {
+  serialize_bits(stream, sequence, 16);
+  return true;
+}
+
+void Copy(const yojimbo::Message* otherMessage) override {
+  const SnapshotAckMessage* message =
+      reinterpret_cast<const SnapshotAckMessage*>(otherMessage);
+
+  sequence = message->sequence;
+}
+
+public:
+U16 sequence = 0;
+DEFINE_NETWORK_MESSAGE_END
+
+/**
+ * @brief Replicates the transforms of networked entities with snapshots. The
+ * server keeps the latest transform each authority sent, and every snapshot
+ * tick sends each client one SnapshotMessage holding only what changed since
+ * the last snapshot that client acknowledged. Entities a client isn't
+ * interested in are sent less often, see InterestManagement. The client
+ * rebuilds the full snapshot from that baseline, hands every transform in it
+ * to the interpolation buffer of its NetworkTransform and acknowledges it.
+ */
+class SnapshotReplication {
+ public:
+  /// Snapshots kept per client to delta against. A client whose last
+  /// acknowledged snapshot is older gets everything again
+  static const int historySize = 32;
+
+  /**
+   * @brief Find the transforms of current that differ from baseline, both
+   * sorted by network ID, and the ones of baseline that current doesn't have.
+   *
+   * @param maxEntries Changes to write at most, the rest stay as they are in
+   * view so a later delta picks them up
+   * @param delta Changed transforms, holding only the changed fields
+   * @param view State of the receiver once it applies delta on baseline
+   */
+  static void EncodeDelta(const std::vector<ReplicatedTransform>& baseline,
+                          const std::vector<ReplicatedTransform>& current,
+                          int maxEntries,
+                          std::vector<ReplicatedTransform>* delta,
+                          std::vector<ReplicatedTransform>* view);
+  /**
+   * @brief Rebuild the state a delta was made for, baseline sorted by network
+   * ID. The result is sorted too.
+   */
+  static void DecodeDelta(const std::vector<ReplicatedTransform>& baseline,
+                          const ReplicatedTransform* delta, int deltaCount,
+                          std::vector<ReplicatedTransform>* state);
+
+ private:
+  struct Snapshot {
+    bool valid = false;
+    U16 sequence = 0;
+    std::vector<ReplicatedTransform> transforms;
+    /// Irrelevant entities the snapshot carries an update of, see
+    /// InterestManagement::Acknowledge
+    std::vector<U32> due;
+  };
+  /// What the server sent a client
+  struct ClientSnapshots {
+    bool hasAck = false;
+    U16 ackedSequence = 0;
+    bool hasSent = false;
+    U16 lastSent = 0;
+    Snapshot sent[historySize];
+  };
+  /// Latest transform the authority of an entity sent the server
+  struct AuthorityTransform {
+    int clientIdx = -1;
+    float posTimestamp = 0;
+    float rotTimestamp = 0;
+    float scaleTimestamp = 0;
+    ReplicatedTransform transform;
+  };
+
+  SnapshotReplication();
+  ~SnapshotReplication() = default;
+
+  /**
+   * @brief Start recording the transforms clients send and answering acks.
+   */
+  void StartServer(int maxClients);
+  void StopServer();
+  /**
+   * @brief Start applying the snapshots the server sends.
+   */
+  void StartClient();
+  void StopClient();
+  /**
+   * @brief Send every connected client its snapshot if this network update is
+   * a snapshot tick.
+   */
+  void ServerUpdate();
+  /**
+   * @brief Recompute what each client is interested in from where the entities
+   * are.
+   */
+  void UpdateInterest();
+  /**
+   * @brief Drop what the server knows about a network ID, for when it is
+   * created or removed.
+   */
+  void Forget(U32 netId);
+  /**
+   * @brief Server time the client shows remote entities at.
+   */
+  float GetInterpolationTime() const;
+
+  AuthorityTransform* RecordAuthority(int clientIdx, U32 netId);
+  /**
+   * @brief Record a transform message from the client at clientIdx, nullptr
+   * if that client doesn't have authority over netId or the server simulates
+   * the entity itself with a NetworkPrediction.
+   */
+  AuthorityTransform* AcceptAuthority(int clientIdx, U32 netId);
+  /**
+   * @brief Record the state the server simulated an entity with input from
+   * the client at clientIdx to, see NetworkPrediction.
+   */
+  void RecordPredictedState(int clientIdx, U32 netId,
+                            const PredictedState& state);
+  void ReceiveAck(int clientIdx, U16 sequence);
+  void ReceiveSnapshot(const SnapshotMessage& message);
+  static void Apply(const ReplicatedTransform& transform, float serverTime);
+
+  // ------------------- Server Stuff -------------------
+  /// Sorted by network ID, the order snapshots are in
+  std::map<U32, AuthorityTransform> authorityTransforms;
+  std::vector<ClientSnapshots> clientSnapshots;
+  InterestManagement interest;
+  U16 nextSequence = 0;
+  int ticksSinceSnapshot = 0;
+  int positionCallbackHandle = -1;
+  int rotationCallbackHandle = -1;
+  int scaleCallbackHandle = -1;
+  int transformCallbackHandle = -1;
+  int ackCallbackHandle = -1;
+
+  // ------------------- Client Stuff -------------------
+  Snapshot received[historySize];
+  bool hasReceived = false;
+  U16 lastReceived = 0;
+  InterpolationClock clock;
+  int snapshotCallbackHandle = -1;
+
+  friend class NetworkingModule;
+  friend class NetworkManager;
+  friend class StackAllocator;
+};
+}  // namespace Isetta
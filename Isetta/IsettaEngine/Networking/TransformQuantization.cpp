@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Networking/TransformQuantization.h"
+
+#include "Core/Math/Util.h"
+
+namespace Isetta {
+namespace {
+/// Components other than the largest of a unit quaternion are in this range
+const float rotationBound = 0.70710678f;
+
+/// Steps between -bound and bound. An even count puts 0 on a step, so values
+/// that are exactly 0 stay that way, the top code is left unused for it
+U32 StepCount(const int bits) { return (1u << bits) - 2; }
+}  // namespace
+
+bool TransformPrecision::operator==(const TransformPrecision& rhs) const {
+  return positionBound == rhs.positionBound &&
+         positionBits == rhs.positionBits &&
+         rotationBits == rhs.rotationBits && scaleBound == rhs.scaleBound &&
+         scaleBits == rhs.scaleBits;
+}
+
+U32 TransformQuantization::QuantizeFloat(const float value, const float bound,
+                                         const int bits) {
+  const U32 maxValue = StepCount(bits);
+  const float normalized =
+      (Math::Util::Clamp(-bound, bound, value) + bound) / (2 * bound);
+  return static_cast<U32>(normalized * maxValue + 0.5f);
+}
+
+float TransformQuantization::DequantizeFloat(const U32 value, const float bound,
+                                             const int bits) {
+  const U32 maxValue = StepCount(bits);
+  // the unused top code from a bad packet still lands in bounds
+  const U32 step = value < maxValue ? value : maxValue;
+  return static_cast<float>(step) / maxValue * (2 * bound) - bound;
+}
+
+float TransformQuantization::MaxError(const float bound, const int bits) {
+  // half a step
+  return bound / StepCount(bits);
+}
+
+void TransformQuantization::QuantizeRotation(const Math::Quaternion& rotation,
+                                             const int bits, U32* largest,
+                                             U32 values[3]) {
+  const Math::Quaternion normalized = rotation.Normalized();
+  const float components[4] = {normalized.x, normalized.y, normalized.z,
+                               normalized.w};
+  int largestIndex = 0;
+  for (int i = 1; i < 4; ++i) {
+    if (Math::Util::Abs(components[i]) >
+        Math::Util::Abs(components[largestIndex])) {
+      largestIndex = i;
+    }
+  }
+
+  // q and -q are the same rotation, flip so the left out one is positive
+  const float sign = components[largestIndex] < 0 ? -1.f : 1.f;
+  int value = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i == largestIndex) continue;
+    values[value++] = QuantizeFloat(sign * components[i], rotationBound, bits);
+  }
+  *largest = static_cast<U32>(largestIndex);
+}
+
+Math::Quaternion TransformQuantization::DequantizeRotation(
+    const U32 largest, const U32 values[3], const int bits) {
+  float components[4];
+  float squareSum = 0;
+  int value = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i == static_cast<int>(largest)) continue;
+    components[i] = DequantizeFloat(values[value++], rotationBound, bits);
+    squareSum += components[i] * components[i];
+  }
+  components[largest] =
+      Math::Util::Sqrt(Math::Util::Max(0.f, 1 - squareSum));
+
+  Math::Quaternion rotation{components[0], components[1], components[2],
+                            components[3]};
+  rotation.Normalize();
+  return rotation;
+}
+
+int TransformQuantization::BitsPerTransform(const TransformPrecision& precision,
+                                            const bool withScale) {
+  int bits = 1;  // precision flag
+  if (precision != TransformPrecision{}) {
+    bits += 16 + 5 + 4 + 16 + 5;
+  }
+  bits += 3 * precision.positionBits;
+  bits += 2 + 3 * precision.rotationBits;
+  if (withScale) bits += 3 * precision.scaleBits;
+  return bits;
+}
+}  // namespace Isetta
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "ISETTA_API.h"
+#include "yojimbo/yojimbo.h"
+
+namespace Isetta {
+/**
+ * @brief How precisely a networked transform is sent. Positions and scales are
+ * fixed point within [-bound, bound] on each axis, rotations are sent as their
+ * three smallest quaternion components. Anything but the defaults is sent
+ * along with the transform.
+ */
+struct ISETTA_API TransformPrecision {
+  static const int minBits = 4;
+  static const int maxBits = 24;
+  static const int maxRotationBits = 15;
+  static const int maxBound = 65535;
+
+  /// Largest local position sent on each axis, further out is clamped
+  int positionBound = 512;
+  /// Bits per position axis
+  int positionBits = 20;
+  /// Bits per quaternion component, three are sent
+  int rotationBits = 10;
+  /// Largest local scale sent on each axis
+  int scaleBound = 64;
+  /// Bits per scale axis
+  int scaleBits = 16;
+
+  bool operator==(const TransformPrecision& rhs) const;
+  bool operator!=(const TransformPrecision& rhs) const {
+    return !(*this == rhs);
+  }
+};
+
+/**
+ * @brief Quantization and bit packing of transforms for network messages.
+ */
+class ISETTA_API TransformQuantization {
+ public:
+  /**
+   * @brief Map value from [-bound, bound] to an integer of the given bits,
+   * rounding to the closest step. Values outside are clamped, and 0 maps to
+   * a step of its own so it comes back exactly.
+   */
+  static U32 QuantizeFloat(float value, float bound, int bits);
+  static float DequantizeFloat(U32 value, float bound, int bits);
+  /// Largest difference between a value in bounds and its round trip
+  static float MaxError(float bound, int bits);
+
+  /**
+   * @brief Smallest three compression. The largest component is left out and
+   * rebuilt from the others, which all fall in [-1/sqrt(2), 1/sqrt(2)].
+   *
+   * @param largest Index of the left out component, x y z w
+   * @param values The other three, in order
+   */
+  static void QuantizeRotation(const Math::Quaternion& rotation, int bits,
+                               U32* largest, U32 values[3]);
+  static Math::Quaternion DequantizeRotation(U32 largest, const U32 values[3],
+                                             int bits);
+
+  /**
+   * @brief Bits one transform takes in a message, with the precision flag
+   * but without the network ID
+   */
+  static int BitsPerTransform(const TransformPrecision& precision,
+                              bool withScale);
+
+  /**
+   * @brief Serialize the precision, a single bit for the defaults.
+   */
+  template <typename Stream>
+  static bool SerializePrecision(Stream* stream,
+                                 TransformPrecision* precision);
+  /**
+   * @brief Serialize a position, leaving it at the value the other side gets.
+   */
+  template <typename Stream>
+  static bool SerializePosition(Stream* stream, Math::Vector3* position,
+                                const TransformPrecision& precision);
+  template <typename Stream>
+  static bool SerializeRotation(Stream* stream, Math::Quaternion* rotation,
+                                const TransformPrecision& precision);
+  template <typename Stream>
+  static bool SerializeScale(Stream* stream, Math::Vector3* scale,
+                             const TransformPrecision& precision);
+
+ private:
+  template <typename Stream>
+  static bool SerializeVector(Stream* stream, Math::Vector3* vector,
+                              float bound, int bits);
+};
+
+/**
+ * @brief Serialization macros in the style of yojimbo's, returning false from
+ * the enclosing Serialize when they fail
+ */
+#define serialize_transform_precision(stream, precision)                      \
+  do {                                                                        \
+    if (!Isetta::TransformQuantization::SerializePrecision(stream,           \
+                                                           &(precision))) {  \
+      return false;                                                           \
+    }                                                                         \
+  } while (0)
+#define serialize_quantized_position(stream, position, precision)           \
+  do {                                                                      \
+    if (!Isetta::TransformQuantization::SerializePosition(stream, &(position), \
+                                                          precision)) {     \
+      return false;                                                         \
+    }                                                                       \
+  } while (0)
+#define serialize_quantized_rotation(stream, rotation, precision)           \
+  do {                                                                      \
+    if (!Isetta::TransformQuantization::SerializeRotation(stream, &(rotation), \
+                                                          precision)) {     \
+      return false;                                                         \
+    }                                                                       \
+  } while (0)
+#define serialize_quantized_scale(stream, scale, precision)                 \
+  do {                                                                      \
+    if (!Isetta::TransformQuantization::SerializeScale(stream, &(scale),    \
+                                                       precision)) {        \
+      return false;                                                         \
+    }                                                                       \
+  } while (0)
+
+template <typename Stream>
+bool TransformQuantization::SerializePrecision(
+    Stream* stream, TransformPrecision* precision) {
+  bool custom = *precision != TransformPrecision{};
+  serialize_bool(stream, custom);
+  if (!custom) {
+    *precision = TransformPrecision{};
+    return true;
+  }
+  serialize_int(stream, precision->positionBound, 1,
+                TransformPrecision::maxBound);
+  serialize_int(stream, precision->positionBits, TransformPrecision::minBits,
+                TransformPrecision::maxBits);
+  serialize_int(stream, precision->rotationBits, TransformPrecision::minBits,
+                TransformPrecision::maxRotationBits);
+  serialize_int(stream, precision->scaleBound, 1, TransformPrecision::maxBound);
+  serialize_int(stream, precision->scaleBits, TransformPrecision::minBits,
+                TransformPrecision::maxBits);
+  return true;
+}
+
+template <typename Stream>
+bool TransformQuantization::SerializePosition(
+    Stream* stream, Math::Vector3* position,
+    const TransformPrecision& precision) {
+  return SerializeVector(stream, position,
+                         static_cast<float>(precision.positionBound),
+                         precision.positionBits);
+}
+
+template <typename Stream>
+bool TransformQuantization::SerializeRotation(
+    Stream* stream, Math::Quaternion* rotation,
+    const TransformPrecision& precision) {
+  U32 largest;
+  U32 values[3];
+  QuantizeRotation(*rotation, precision.rotationBits, &largest, values);
+  serialize_bits(stream, largest, 2);
+  for (U32& value : values) {
+    serialize_bits(stream, value, precision.rotationBits);
+  }
+  *rotation = DequantizeRotation(largest, values, precision.rotationBits);
+  return true;
+}
+
+template <typename Stream>
+bool TransformQuantization::SerializeScale(
+    Stream* stream, Math::Vector3* scale, const TransformPrecision& precision) {
+  return SerializeVector(stream, scale,
+                         static_cast<float>(precision.scaleBound),
+                         precision.scaleBits);
+}
+
+template <typename Stream>
+bool TransformQuantization::SerializeVector(Stream* stream,
+                                            Math::Vector3* vector,
+                                            const float bound,
+                                            const int bits) {
+  for (int i = 0; i < 3; ++i) {
+    U32 value = QuantizeFloat((*vector)[i], bound, bits);
+    serialize_bits(stream, value, bits);
+    (*vector)[i] = DequantizeFloat(value, bound, bits);
+  }
+  return true;
+}
+}  // namespace Isetta
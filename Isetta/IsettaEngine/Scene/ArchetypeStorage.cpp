@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Scene/ArchetypeStorage.h"
+#include <cstring>
+#include <stdexcept>
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Memory/MemoryManager.h"
+#include "Scene/Entity.h"
+#include "Util.h"
+#include "brofiler/ProfilerCore/Brofiler.h"
+
+namespace Isetta {
+namespace {
+Size AlignUp(const Size value, const Size alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+ArchetypeStorage::~ArchetypeStorage() { Clear(); }
+
+ArchetypeStorage::TypeRegistry& ArchetypeStorage::typeRegistry() {
+  static TypeRegistry registry{};
+  return registry;
+}
+
+int ArchetypeStorage::GetTypeId(const std::type_index type, const Size size,
+                                const Size alignment) {
+  TypeRegistry& registry = typeRegistry();
+  auto it = registry.ids.find(type);
+  if (it != registry.ids.end()) {
+    return it->second;
+  }
+
+  const char* const name = type.name();
+  std::vector<TypeInfo>& infos = registry.infos;
+  if (infos.size() >= maxTypeCount) {
+    throw std::length_error(Util::StrFormat(
+        "ArchetypeStorage::GetTypeId => Too many data types to add %s",
+        name));
+  }
+  if (alignment > MemUtil::ALIGNMENT) {
+    throw std::invalid_argument(Util::StrFormat(
+        "ArchetypeStorage::GetTypeId => %s is aligned to more than %d",
+        name, MemUtil::ALIGNMENT));
+  }
+  infos.push_back(TypeInfo{size, alignment, name});
+  const int id = static_cast<int>(infos.size()) - 1;
+  registry.ids.emplace(type, id);
+  return id;
+}
+
+void ArchetypeStorage::RemoveAll(Entity* const entity) {
+  if (entity->dataArchetype < 0) return;
+  RemoveRow(entity->dataArchetype, entity->dataChunk, entity->dataRow);
+  entity->dataArchetype = -1;
+}
+
+void ArchetypeStorage::AddRow(Entity* const entity, const TypeMask& mask,
+                              const void* const* values) {
+  if (entity->dataArchetype >= 0) {
+    throw std::logic_error(Util::StrFormat(
+        "ArchetypeStorage::AddRow => %s already has data",
+        entity->GetName().c_str()));
+  }
+  MoveEntity(entity, GetArchetype(mask));
+  for (int i = 0; i < maxTypeCount; ++i) {
+    if (mask.test(i)) {
+      std::memcpy(GetRaw(entity, i), values[i], typeInfos()[i].size);
+    }
+  }
+}
+
+void ArchetypeStorage::Clear() {
+  for (Archetype& archetype : archetypes) {
+    for (Chunk& chunk : archetype.chunks) {
+      // rows still point at entities, but those are gone with the level
+      MemoryManager::FreeOnFreeList(chunk.data);
+    }
+  }
+  archetypes.clear();
+  archetypeIndices.clear();
+}
+
+void* ArchetypeStorage::AddRaw(Entity* const entity, const int typeId) {
+  TypeMask mask;
+  if (entity->dataArchetype >= 0) {
+    mask = archetypes[entity->dataArchetype].mask;
+    if (mask.test(typeId)) {
+      throw std::logic_error(Util::StrFormat(
+          "ArchetypeStorage::Add => %s already has %s",
+          entity->GetName().c_str(), typeInfos()[typeId].name));
+    }
+  }
+  mask.set(typeId);
+  MoveEntity(entity, GetArchetype(mask));
+  return GetRaw(entity, typeId);
+}
+
+void* ArchetypeStorage::GetRaw(const Entity* const entity, const int typeId) {
+  if (entity->dataArchetype < 0) return nullptr;
+  const Archetype& archetype = archetypes[entity->dataArchetype];
+  const int column = archetype.columns[typeId];
+  if (column < 0) return nullptr;
+  return archetype.chunks[entity->dataChunk].data + archetype.offsets[column] +
+         entity->dataRow * typeInfos()[typeId].size;
+}
+
+void ArchetypeStorage::RemoveRaw(Entity* const entity, const int typeId) {
+  if (entity->dataArchetype < 0) return;
+  TypeMask mask = archetypes[entity->dataArchetype].mask;
+  if (!mask.test(typeId)) return;
+  mask.reset(typeId);
+  if (mask.none()) {
+    RemoveAll(entity);
+  } else {
+    MoveEntity(entity, GetArchetype(mask));
+  }
+}
+
+void ArchetypeStorage::ParallelForChunks(
+    const std::vector<int>& matching,
+    const Action<int, const Archetype&, const Chunk&>& job) {
+  parallelChunks.clear();
+  for (const int archetype : matching) {
+    for (Size i = 0; i < archetypes[archetype].chunks.size(); ++i) {
+      parallelChunks.emplace_back(archetype, static_cast<int>(i));
+    }
+  }
+
+  JobSystem::ParallelFor(
+      static_cast<int>(parallelChunks.size()),
+      [&](const int begin, const int end) {
+        BROFILER_CATEGORY("Query Job", Profiler::Color::Orchid);
+        const int thread = JobSystem::GetThreadIndex();
+        for (int i = begin; i < end; ++i) {
+          const Archetype& archetype = archetypes[parallelChunks[i].first];
+          job(thread, archetype, archetype.chunks[parallelChunks[i].second]);
+        }
+      });
+}
+
+int ArchetypeStorage::GetArchetype(const TypeMask& mask) {
+  auto it = archetypeIndices.find(mask);
+  if (it != archetypeIndices.end()) return it->second;
+
+  const std::vector<TypeInfo>& infos = typeInfos();
+  Archetype archetype;
+  archetype.mask = mask;
+  Size rowSize = sizeof(Entity*);
+  int columnCount = 0;
+  for (int i = 0; i < maxTypeCount; ++i) {
+    archetype.columns[i] = mask.test(i) ? columnCount++ : -1;
+    if (mask.test(i)) rowSize += infos[i].size;
+  }
+
+  // every column starts aligned, leave room for that padding
+  archetype.capacity = static_cast<int>(
+      (chunkSize - (columnCount + 1) * MemUtil::ALIGNMENT) / rowSize);
+  if (archetype.capacity < 1) {
+    throw std::length_error(
+        "ArchetypeStorage::GetArchetype => Data too big for a chunk");
+  }
+  Size offset = 0;
+  for (int i = 0; i < maxTypeCount; ++i) {
+    if (!mask.test(i)) continue;
+    archetype.offsets.push_back(offset);
+    offset = AlignUp(offset + archetype.capacity * infos[i].size,
+                     MemUtil::ALIGNMENT);
+  }
+  archetype.entityOffset = offset;
+
+  archetypes.push_back(std::move(archetype));
+  const int index = static_cast<int>(archetypes.size()) - 1;
+  archetypeIndices.emplace(mask, index);
+  return index;
+}
+
+void ArchetypeStorage::MoveEntity(Entity* const entity,
+                                  const int archetypeIndex) {
+  Archetype& archetype = archetypes[archetypeIndex];
+  if (archetype.chunks.empty() ||
+      archetype.chunks.back().count == archetype.capacity) {
+    archetype.chunks.push_back(Chunk{
+        static_cast<U8*>(MemoryManager::AllocOnFreeList(chunkSize)), 0});
+  }
+  const int chunkIndex = static_cast<int>(archetype.chunks.size()) - 1;
+  Chunk& chunk = archetype.chunks.back();
+  const int row = chunk.count++;
+  EntityColumn(archetype, chunk)[row] = entity;
+
+  if (entity->dataArchetype >= 0) {
+    const std::vector<TypeInfo>& infos = typeInfos();
+    const Archetype& old = archetypes[entity->dataArchetype];
+    const Chunk& oldChunk = old.chunks[entity->dataChunk];
+    for (int i = 0; i < maxTypeCount; ++i) {
+      if (archetype.columns[i] < 0 || old.columns[i] < 0) continue;
+      const Size size = infos[i].size;
+      std::memcpy(
+          chunk.data + archetype.offsets[archetype.columns[i]] + row * size,
+          oldChunk.data + old.offsets[old.columns[i]] +
+              entity->dataRow * size,
+          size);
+    }
+    RemoveRow(entity->dataArchetype, entity->dataChunk, entity->dataRow);
+  }
+
+  entity->dataArchetype = archetypeIndex;
+  entity->dataChunk = chunkIndex;
+  entity->dataRow = row;
+}
+
+void ArchetypeStorage::RemoveRow(const int archetypeIndex,
+                                 const int chunkIndex, const int row) {
+  Archetype& archetype = archetypes[archetypeIndex];
+  Chunk& chunk = archetype.chunks[chunkIndex];
+  Chunk& last = archetype.chunks.back();
+  const int lastRow = last.count - 1;
+
+  if (&chunk != &last || row != lastRow) {
+    const std::vector<TypeInfo>& infos = typeInfos();
+    for (int i = 0; i < maxTypeCount; ++i) {
+      const int column = archetype.columns[i];
+      if (column < 0) continue;
+      const Size size = infos[i].size;
+      const Size offset = archetype.offsets[column];
+      std::memcpy(chunk.data + offset + row * size,
+                  last.data + offset + lastRow * size, size);
+    }
+    Entity* moved = EntityColumn(archetype, last)[lastRow];
+    EntityColumn(archetype, chunk)[row] = moved;
+    moved->dataChunk = chunkIndex;
+    moved->dataRow = row;
+  }
+
+  if (--last.count == 0) {
+    MemoryManager::FreeOnFreeList(last.data);
+    archetype.chunks.pop_back();
+  }
+}
+}  // namespace Isetta
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <bitset>
+#include <new>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+
+namespace Isetta {
+class Entity;
+
+/**
+ * \brief Plain-data components of the level's entities, kept apart from the
+ * classic Component objects. Entities with the same set of data types share an
+ * archetype, whose rows are packed into fixed size chunks holding one array per
+ * type. Queries walk those arrays instead of chasing components on the heap.
+ * Data types have to be trivially copyable, rows are moved with memcpy
+ */
+class ISETTA_API ArchetypeStorage {
+ public:
+  static const int maxTypeCount = 64;
+  typedef std::bitset<maxTypeCount> TypeMask;
+  static const Size chunkSize = 16 * 1024;
+
+  struct Chunk {
+    U8* data;
+    int count;
+  };
+  struct Archetype {
+    TypeMask mask;
+    /// Column of each type id, -1 for types the archetype doesn't have
+    int columns[maxTypeCount];
+    std::vector<Size> offsets;
+    /// Offset of the column of owning entities
+    Size entityOffset;
+    int capacity;
+    /// Every chunk but the last is full
+    std::vector<Chunk> chunks;
+  };
+
+  ArchetypeStorage() = default;
+  ArchetypeStorage(const ArchetypeStorage&) = delete;
+  ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+  ~ArchetypeStorage();
+
+  /**
+   * \brief Dense id of the data type, registering it if it's new. Ids come
+   * from one registry in the engine, so every module agrees on them
+   */
+  template <typename T>
+  static int GetTypeId();
+
+  /**
+   * \brief Construct T in the entity's row. Pointers to data are only good
+   * until the next data is added to or removed from any entity
+   */
+  template <typename T, typename... Args>
+  T* Add(Entity* entity, Args&&... args);
+  template <typename T>
+  T* Get(const Entity* entity);
+  template <typename T>
+  void Remove(Entity* entity);
+  void RemoveAll(Entity* entity);
+  /**
+   * \brief Give an entity without data a row with every type in mask at once,
+   * copying each value from values indexed by type id
+   */
+  void AddRow(Entity* entity, const TypeMask& mask,
+              const void* const* values);
+  /**
+   * \brief Free every chunk
+   */
+  void Clear();
+
+  const std::vector<Archetype>& GetArchetypes() const { return archetypes; }
+
+  template <typename T>
+  static T* Column(const Archetype& archetype, const Chunk& chunk) {
+    return reinterpret_cast<T*>(
+        chunk.data + archetype.offsets[archetype.columns[GetTypeId<T>()]]);
+  }
+  static Entity** EntityColumn(const Archetype& archetype,
+                               const Chunk& chunk) {
+    return reinterpret_cast<Entity**>(chunk.data + archetype.entityOffset);
+  }
+
+ private:
+  struct TypeInfo {
+    Size size;
+    Size alignment;
+    const char* name;
+  };
+  struct TypeRegistry {
+    std::unordered_map<std::type_index, int> ids;
+    /// Indexed by type id
+    std::vector<TypeInfo> infos;
+  };
+  /// Defined out of line, so modules using the engine share it
+  static TypeRegistry& typeRegistry();
+  static const std::vector<TypeInfo>& typeInfos() {
+    return typeRegistry().infos;
+  }
+  /// Id of the type, registered with its layout if it's new
+  static int GetTypeId(std::type_index type, Size size, Size alignment);
+
+  void* AddRaw(Entity* entity, int typeId);
+  void* GetRaw(const Entity* entity, int typeId);
+  void RemoveRaw(Entity* entity, int typeId);
+
+  /**
+   * \brief Run job on every chunk of the given archetypes as jobs of the
+   * JobSystem, with the index of the thread running it, and return once all
+   * are done
+   */
+  void ParallelForChunks(
+      const std::vector<int>& matching,
+      const Action<int, const Archetype&, const Chunk&>& job);
+
+  int GetArchetype(const TypeMask& mask);
+  /// Move the entity's row to another archetype, keeping the shared columns
+  void MoveEntity(Entity* entity, int archetypeIndex);
+  /// Fill the row with the archetype's last one
+  void RemoveRow(int archetypeIndex, int chunkIndex, int row);
+
+  std::vector<Archetype> archetypes;
+  std::unordered_map<TypeMask, int> archetypeIndices;
+  /// (archetype, chunk) of every chunk a parallel query runs on
+  std::vector<std::pair<int, int>> parallelChunks;
+
+  template <typename... Ts>
+  friend class Query;
+};
+
+template <typename T>
+int ArchetypeStorage::GetTypeId() {
+  static_assert(std::is_trivially_copyable<T>::value &&
+                    std::is_trivially_destructible<T>::value,
+                "ArchetypeStorage data has to be plain data");
+  static const int id =
+      GetTypeId(std::type_index(typeid(T)), sizeof(T), alignof(T));
+  return id;
+}
+
+template <typename T, typename... Args>
+T* ArchetypeStorage::Add(Entity* entity, Args&&... args) {
+  return new (AddRaw(entity, GetTypeId<T>())) T{std::forward<Args>(args)...};
+}
+
+template <typename T>
+T* ArchetypeStorage::Get(const Entity* entity) {
+  return static_cast<T*>(GetRaw(entity, GetTypeId<T>()));
+}
+
+template <typename T>
+void ArchetypeStorage::Remove(Entity* entity) {
+  RemoveRaw(entity, GetTypeId<T>());
+}
+}  // namespace Isetta
@@ -2,69 +2,81 @@
  * Copyright (c) 2018 Isetta
  */
 #include "Scene/Component.h"
+#include <stdexcept>
 #include "Scene/Entity.h"
+#include "Scene/Level.h"
+#include "Scene/LevelManager.h"
 #include "Scene/Transform.h"
 
 namespace Isetta {
 
-bool Component::isFlattened = false;
-
 bool Component::RegisterComponent(std::type_index curr, std::type_index base,
                                   bool isUnique) {
-  if (isUnique) uniqueComponents().insert(curr);
-  std::unordered_map<std::type_index, std::list<std::type_index>>& children =
-      childrenTypes();
+  TypeRegistry& registry = typeRegistry();
+  const int id = GetTypeId(curr);
+  registry.parents[id] = GetTypeId(base);
+  if (isUnique) registry.uniques.set(id);
+  // a base can register after the types derived from it, so all of them are
+  // built again rather than just this one
+  BuildAncestors();
+  return true;
+}
 
-  if (children.count(curr) > 0) {
-    children.at(curr).push_front(curr);
-  } else {
-    children.insert({curr, std::list<std::type_index>{curr}});
+int Component::GetTypeId(const std::type_index type) {
+  TypeRegistry& registry = typeRegistry();
+  auto it = registry.ids.find(type);
+  if (it != registry.ids.end()) {
+    return it->second;
   }
 
-  if (children.count(base) > 0) {
-    children.at(base).emplace_back(curr);
-  } else {
-    children.insert({base, std::list<std::type_index>{curr}});
+  const int id = static_cast<int>(registry.parents.size());
+  if (id >= maxTypeCount) {
+    throw std::length_error{
+        "Component::GetTypeId => Too many component types, raise "
+        "maxTypeCount"};
   }
-  return true;
+  registry.ids.emplace(type, id);
+  registry.parents.push_back(-1);
+  // no base until the type registers
+  TypeMask self;
+  self.set(id);
+  registry.ancestors.push_back(self);
+  return id;
 }
 
-void Component::FlattenComponentList() {
-  if (isFlattened) return;
-  isFlattened = true;
-  std::unordered_map<std::type_index, std::list<std::type_index>>& children =
-      childrenTypes();
-  std::type_index componentIndex{typeid(Component)};
-  std::list<std::type_index>* componentList = &children.at(componentIndex);
-  for (auto& childList : *componentList) {
-    if (childList != componentIndex) {
-      FlattenHelper(componentIndex, childList);
+void Component::BuildAncestors() {
+  TypeRegistry& registry = typeRegistry();
+  registry.ancestors.assign(registry.parents.size(), TypeMask{});
+  for (Size id = 0; id < registry.parents.size(); ++id) {
+    for (int type = static_cast<int>(id); type >= 0;
+         type = registry.parents[type]) {
+      registry.ancestors[id].set(type);
     }
   }
 }
 
-void Component::FlattenHelper(std::type_index parent, std::type_index curr) {
-  std::unordered_map<std::type_index, std::list<std::type_index>>& children =
-      childrenTypes();
-  std::list<std::type_index>* parentList = &children.at(parent);
-  std::list<std::type_index>* componentList = &children.at(curr);
-  for (auto& childList : *componentList) {
-    if (childList != curr) {
-      parentList->push_back(childList);
-      FlattenHelper(curr, childList);
-    }
-  }
+bool Component::IsTypeOf(const int typeId, const int baseTypeId) {
+  if (typeId == baseTypeId) return true;
+  return typeRegistry().ancestors[typeId].test(baseTypeId);
 }
 
-Component::Component()
-    : attributes{0b1111001}, entity{nullptr}, transform(nullptr) {
-  if (!isFlattened) {
-    FlattenComponentList();
-  }
+bool Component::IsUnique(const int typeId) {
+  return typeRegistry().uniques.test(typeId);
 }
 
+Component::Component()
+    : attributes{0b1111001}, entity{nullptr}, transform(nullptr) {}
+
 void Component::SetAttribute(ComponentAttributes attr, bool value) {
   attributes.set(static_cast<int>(attr), value);
+  // a component that wants an update phase again has to get back into its
+  // bucket, leaving one is handled by the bucket itself
+  if (value && entity != nullptr &&
+      (attr == ComponentAttributes::NEED_UPDATE ||
+       attr == ComponentAttributes::NEED_FIXED_UPDATE ||
+       attr == ComponentAttributes::NEED_LATE_UPDATE)) {
+    LevelManager::Instance().loadedLevel->AddComponentToUpdate(this);
+  }
 }
 
 bool Component::GetAttribute(ComponentAttributes attr) const {
@@ -92,5 +104,6 @@ bool Component::GetActive() const {
 
 void Component::Destroy(Component* component) {
   component->SetAttribute(ComponentAttributes::NEED_DESTROY, true);
+  LevelManager::Instance().loadedLevel->AddEntityToCheck(component->entity);
 }
 }  // namespace Isetta
@@ -3,9 +3,10 @@
  */
 #pragma once
 #include <bitset>
-#include <set>
 #include <typeindex>
 #include <unordered_map>
+#include <vector>
+#include "Core/IsettaAlias.h"
 #include "ISETTA_API.h"
 
 #define DEFINE_COMPONENT(NAME, BASE, UNIQUE)                   \
@@ -49,24 +50,56 @@ struct ISETTA_API_DECLARE ComponentRegistry {};
 
 class ISETTA_API Component {
   friend class Entity;
+  friend class EntityCommandBuffer;
+  friend class Level;
+  friend class Prefab;
 
   std::bitset<7> attributes;
 
-  static std::unordered_map<std::type_index, std::list<std::type_index>>&
-  childrenTypes() {
-    static std::unordered_map<std::type_index, std::list<std::type_index>>
-        children{};
-    return children;
-  }
+  /// Bucket of this component's type in the level and the slot in it for
+  /// each update phase, -1 while not in the phase
+  int updateBucket{-1};
+  int updateSlots[3]{-1, -1, -1};
+  /// Set by the entity when attached, unique among the components its entity
+  /// ever had, so a command buffer can refer to it without its address
+  U32 generation{0};
 
-  static std::set<std::type_index>& uniqueComponents() {
-    static std::set<std::type_index> uniques{};
-    return uniques;
+  static const int maxTypeCount = 256;
+  typedef std::bitset<maxTypeCount> TypeMask;
+  /**
+   * \brief Dense ids handed out to component types as they register, with
+   * each type's base and, per id, the mask of the type and all its bases
+   */
+  struct TypeRegistry {
+    std::unordered_map<std::type_index, int> ids;
+    std::vector<int> parents;
+    /// Rebuilt by every registration, which all happen during static
+    /// initialization, so lookups only ever read it
+    std::vector<TypeMask> ancestors;
+    TypeMask uniques;
+  };
+  static TypeRegistry& typeRegistry() {
+    static TypeRegistry registry{};
+    return registry;
   }
+  /// Fill in the ancestor masks of every type from their parents
+  static void BuildAncestors();
 
-  static void FlattenComponentList();
-  static void FlattenHelper(std::type_index parent, std::type_index curr);
-  static bool isFlattened;
+  /**
+   * \brief Id of the component type, registering it if it's new
+   */
+  static int GetTypeId(std::type_index type);
+  template <typename T>
+  static int GetTypeId() {
+    static const int id = GetTypeId(std::type_index(typeid(T)));
+    return id;
+  }
+  /**
+   * \brief Whether a component of type typeId is a baseTypeId, either the type
+   * itself or derived from it
+   */
+  static bool IsTypeOf(int typeId, int baseTypeId);
+  static bool IsUnique(int typeId);
 
  protected:
   enum class ComponentAttributes {
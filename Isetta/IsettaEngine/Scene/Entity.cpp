@@ -7,6 +7,7 @@
 #include "LevelManager.h"
 #include "Scene/Component.h"
 #include "Scene/Layers.h"
+#include "Scene/Prefab.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 namespace Isetta {
@@ -76,6 +77,7 @@ void Entity::CheckDestroy() {
       if (comp->GetAttribute(Component::ComponentAttributes::NEED_DESTROY)) {
         if (comp->GetActive()) comp->OnDisable();
         comp->OnDestroy();
+        LevelManager::Instance().loadedLevel->RemoveComponentFromUpdate(comp);
         comp->~Component();
         MemoryManager::DeleteOnFreeList<Component>(comp);
         components.Erase(compIter);
@@ -113,6 +115,50 @@ Entity::Entity(const std::string &name, const bool entityStatic)
   OnEnable();
 }
 
+Entity::Entity(const std::string &name, const bool entityStatic,
+               const GUID &id)
+    : internalTransform(this),
+      attributes{0b101},
+      entityId{id},
+      entityName{name},
+      transform(&internalTransform),
+      isStatic{entityStatic} {
+  OnEnable();
+}
+
+GUID Entity::NextBatchId() {
+  static const GUID base = []() {
+    GUID guid;
+    CoCreateGuid(&guid);
+    return guid;
+  }();
+  static U64 counter = 0;
+  ++counter;
+  GUID id = base;
+  for (int i = 0; i < 8; ++i) {
+    id.Data4[i] ^= static_cast<U8>(counter >> (8 * i));
+  }
+  return id;
+}
+
+void Entity::AttachComponent(Component *const component, const int typeId,
+                             const bool isActive) {
+  (Entity *&)(component->entity) = this;
+  (Transform *&)(component->transform) = transform;
+  component->generation = ++componentGeneration;
+  component->SetActive(isActive);
+  if (isActive) {
+    component->Awake();
+    component->SetAttribute(Component::ComponentAttributes::HAS_AWAKEN, true);
+    component->OnEnable();
+  }
+  componentTypes.emplace_back(typeId);
+  components.EmplaceBack(component);
+
+  LevelManager::Instance().loadedLevel->AddComponentToStart(component);
+  LevelManager::Instance().loadedLevel->AddComponentToUpdate(component);
+}
+
 Entity::~Entity() {
   Destroy(this);
   CheckDestroy();
@@ -151,6 +197,9 @@ void Entity::Destroy(Entity *entity) {
 
 void Entity::DestroyHelper(Entity *entity) {
   Array<Transform *> removingChildren;
+  if (!entity->GetAttribute(EntityAttributes::NEED_DESTROY)) {
+    LevelManager::Instance().loadedLevel->AddEntityToRemove(entity);
+  }
   entity->SetAttribute(EntityAttributes::NEED_DESTROY, true);
   for (Transform *child : entity->transform->children) {
     removingChildren.PushBack(child);
@@ -167,6 +216,7 @@ void Entity::DestroyImmediately(Entity *entity) {
     comp->OnDestroy();
   }
   for (auto &comp : entity->components) {
+    LevelManager::Instance().loadedLevel->RemoveComponentFromUpdate(comp);
     MemoryManager::DeleteOnFreeList<Component>(comp);
   }
   entity->components.Clear();
@@ -175,14 +225,36 @@ void Entity::DestroyImmediately(Entity *entity) {
   }
 }
 
+std::vector<Entity *> Entity::InstantiateBatch(const Prefab &prefab,
+                                               const int count,
+                                               Entity *parent) {
+  return LevelManager::Instance().loadedLevel->AddEntities(prefab, count,
+                                                           parent);
+}
+
 Entity *Entity::GetEntityByName(const std::string &name) {
   return LevelManager::Instance().loadedLevel->GetEntityByName(name);
 }
 
-std::list<Entity *> Entity::GetEntitiesByName(const std::string &name) {
+std::vector<Entity *> Entity::GetEntitiesByName(const std::string &name) {
   return LevelManager::Instance().loadedLevel->GetEntitiesByName(name);
 }
 
+Entity *Entity::GetEntity(const EntityHandle handle) {
+  return LevelManager::Instance().loadedLevel->GetEntity(handle);
+}
+
+void Entity::SetName(const std::string_view name) {
+  if (levelIndex < 0) {
+    entityName = name;
+    return;
+  }
+  Level *level = LevelManager::Instance().loadedLevel;
+  level->RemoveEntityName(this);
+  entityName = name;
+  level->AddEntityName(this);
+}
+
 void Entity::SetActive(const bool inActive) {
   bool isActive = GetAttribute(EntityAttributes::IS_ACTIVE);
   SetAttribute(EntityAttributes::IS_ACTIVE, inActive);
@@ -3,14 +3,15 @@
  */
 #pragma once
 #include <Windows.h>
+#include <algorithm>
 #include <array>
 #include <bitset>
-#include <execution>
 #include <typeindex>
 #include <typeinfo>
 #include "Component.h"
 #include "Core/DataStructures/Array.h"
 #include "Core/Memory/MemoryManager.h"
+#include "EntityHandle.h"
 #include "LevelManager.h"
 #include "Scene/Level.h"
 #include "Scene/LevelManager.h"
@@ -25,9 +26,15 @@ class ISETTA_API_DECLARE Entity {
 
   friend class RenderModule;
   friend class Level;
+  friend class ArchetypeStorage;
+  friend class EntityCommandBuffer;
+  friend class TestLevel;
 
-  std::vector<std::type_index> componentTypes;
+  /// Component type ids, parallel to components
+  std::vector<int> componentTypes;
   Array<class Component *> components;
+  /// Last generation handed to an attached component
+  U32 componentGeneration{0};
   Transform internalTransform;
 
   void OnEnable();
@@ -44,10 +51,34 @@ class ISETTA_API_DECLARE Entity {
   std::string entityName;
   int layer{0};
 
+  /// Position in the level's entity array, -1 when not in it
+  int levelIndex{-1};
+  /// Position in the level's list of entities with this name
+  int nameIndex{-1};
+  EntityHandle handle;
+
+  /// Row of this entity's data in the level's ArchetypeStorage, no row when
+  /// dataArchetype is -1
+  int dataArchetype{-1};
+  int dataChunk{0};
+  int dataRow{0};
+
   void SetAttribute(EntityAttributes attr, bool value);
   bool GetAttribute(EntityAttributes attr) const;
 
   Entity(const std::string &name, bool entityStatic = false);
+  /// Skips CoCreateGuid, for entities instantiated in a batch
+  Entity(const std::string &name, bool entityStatic, const GUID &id);
+  /**
+   * \brief Cheap id for batch instantiation: one real GUID per run, made
+   * unique per entity by a counter
+   */
+  static GUID NextBatchId();
+  /**
+   * \brief Hook an already constructed component up to this entity, the part
+   * of AddComponent that comes after the checks
+   */
+  void AttachComponent(class Component *component, int typeId, bool isActive);
   friend Level;
   friend class MemoryManager;
   friend class TemplatePoolAllocator<Entity>;
@@ -60,9 +91,13 @@ class ISETTA_API_DECLARE Entity {
   /// Points to this entity's transform
   Transform *transform{};
 
-  void SetName(std::string_view name) { entityName = name; }
+  void SetName(std::string_view name);
   std::string GetName() const { return entityName; }
   GUID GetEntityId() const { return entityId; }
+  /**
+   * \brief Get a handle that stays safe to hold after this entity is destroyed
+   */
+  EntityHandle GetHandle() const { return handle; }
   /**
    * \brief Get a unique string that represents this entity's id
    */
@@ -77,6 +112,19 @@ class ISETTA_API_DECLARE Entity {
    */
   static Entity *Instantiate(std::string name, class Entity *parent = nullptr,
                              bool entityStatic = false);
+  /**
+   * \brief Instantiate count copies of the prefab at once. Faster than
+   * instantiating them one by one: storage is reserved up front, the
+   * prefab's checks were done when it was recorded, and entities get a cheap
+   * counter-based id instead of a new GUID each
+   * \param prefab Entity to copy
+   * \param count Number of copies
+   * \param parent Parent of every copy, the level root if nullptr
+   * \return The new entities, in creation order
+   */
+  static std::vector<Entity *> InstantiateBatch(const class Prefab &prefab,
+                                                int count,
+                                                class Entity *parent = nullptr);
   /**
    * \brief Destroy the entity. The entity will be actually destroyed at the end
    * of frame
@@ -98,13 +146,30 @@ class ISETTA_API_DECLARE Entity {
   /**
    * \brief Get all entities that have the input name
    */
-  static std::list<Entity *> GetEntitiesByName(const std::string &name);
+  static std::vector<Entity *> GetEntitiesByName(const std::string &name);
+  /**
+   * \brief Get the entity the handle refers to, nullptr if it has been
+   * destroyed
+   */
+  static Entity *GetEntity(EntityHandle handle);
 
   void SetActive(bool inActive);
   bool GetActive() const;
 
   bool IsMoveable() const;
 
+  /**
+   * \brief Add plain data, stored with the level's other entity data instead
+   * of as a Component. The returned pointer is only good until data is next
+   * added to or removed from any entity
+   */
+  template <typename T, typename... Args>
+  T *AddData(Args &&... args);
+  template <typename T>
+  T *GetData();
+  template <typename T>
+  void RemoveData();
+
   template <typename T, typename... Args>
   T *AddComponent(Args &&... args);
   template <typename T, bool IsActive, typename... Args>
@@ -164,6 +229,22 @@ class ISETTA_API_DECLARE Entity {
   const bool isStatic;
 };
 
+template <typename T, typename... Args>
+T *Entity::AddData(Args &&... args) {
+  return LevelManager::Instance().loadedLevel->entityData.Add<T>(
+      this, std::forward<Args>(args)...);
+}
+
+template <typename T>
+T *Entity::GetData() {
+  return LevelManager::Instance().loadedLevel->entityData.Get<T>(this);
+}
+
+template <typename T>
+void Entity::RemoveData() {
+  LevelManager::Instance().loadedLevel->entityData.Remove<T>(this);
+}
+
 template <typename T, typename... Args>
 T *Entity::AddComponent(Args &&... args) {
   T *component = AddComponent<T, true>(std::forward<Args>(args)...);
@@ -178,46 +259,25 @@ T *Entity::AddComponent(Args &&... args) {
                         "from Component class",
                         typeid(T).name));
   } else {
-    std::type_index typeIndex{typeid(T)};
-    if (std::any_of(
-            std::execution::par, Component::uniqueComponents().begin(),
-            Component::uniqueComponents().end(),
-            [typeIndex](std::type_index type) { return type == typeIndex; }) &&
-        std::any_of(
-            std::execution::par, componentTypes.begin(), componentTypes.end(),
-            [typeIndex](std::type_index type) { return type == typeIndex; })) {
+    const int typeId = Component::GetTypeId<T>();
+    if (Component::IsUnique(typeId) &&
+        std::find(componentTypes.begin(), componentTypes.end(), typeId) !=
+            componentTypes.end()) {
       throw std::logic_error(Util::StrFormat(
           "Entity::AddComponent => Adding multiple excluded components %s",
-          typeIndex.name()));
+          typeid(T).name()));
     }
     T *component = MemoryManager::NewOnFreeList<T>(std::forward<Args>(args)...);
-    (Entity *&)(component->entity) = this;
-    (Transform *&)(component->transform) = transform;
-    component->SetActive(IsActive);
-    if (IsActive) {
-      component->Awake();
-      component->SetAttribute(Component::ComponentAttributes::HAS_AWAKEN, true);
-      component->OnEnable();
-    }
-    componentTypes.emplace_back(typeIndex);
-    components.EmplaceBack(component);
-
-    LevelManager::Instance().loadedLevel->AddComponentToStart(component);
+    AttachComponent(component, typeId, IsActive);
     return component;
   }
 }
 
 template <typename T>
 T *Entity::GetComponent() {
-  auto types = Component::childrenTypes();
-  std::list<std::type_index> availableTypes =
-      types.at(std::type_index(typeid(T)));
+  const int typeId = Component::GetTypeId<T>();
   for (int i = 0; i < componentTypes.size(); ++i) {
-    std::type_index componentType = componentTypes[i];
-    if (std::any_of(std::execution::par, availableTypes.begin(),
-                    availableTypes.end(), [componentType](std::type_index x) {
-                      return x == componentType;
-                    })) {
+    if (Component::IsTypeOf(componentTypes[i], typeId)) {
       return static_cast<T *>(components[i]);
     }
   }
@@ -226,16 +286,11 @@ T *Entity::GetComponent() {
 
 template <typename T>
 Array<T *> Entity::GetComponents() {
-  std::list<std::type_index> availableTypes =
-      Component::childrenTypes().at(std::type_index(typeid(T)));
+  const int typeId = Component::GetTypeId<T>();
   Array<T *> returnValue;
   returnValue.Reserve(componentTypes.size());
   for (int i = 0; i < componentTypes.size(); ++i) {
-    std::type_index componentType = componentTypes[i];
-    if (std::any_of(std::execution::par, availableTypes.begin(),
-                    availableTypes.end(), [componentType](std::type_index x) {
-                      return x == componentType;
-                    })) {
+    if (Component::IsTypeOf(componentTypes[i], typeId)) {
       returnValue.EmplaceBack(static_cast<T *>(components[i]));
     }
   }
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Scene/EntityCommandBuffer.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+#include "Scene/Level.h"
+#include "Scene/LevelManager.h"
+#include "Scene/Prefab.h"
+#include "Scene/Transform.h"
+
+namespace Isetta {
+EntityCommandBuffer& EntityCommandBuffer::Get() {
+  return Get(JobSystem::GetThreadIndex());
+}
+
+EntityCommandBuffer& EntityCommandBuffer::Get(const int thread) {
+  return LevelManager::Instance().loadedLevel->GetCommandBuffer(thread);
+}
+
+void EntityCommandBuffer::Instantiate(
+    std::string name, const EntityHandle parent, const bool entityStatic,
+    const Action<Entity*>& onCreated) {
+  Command command{CommandType::INSTANTIATE};
+  command.parent = parent;
+  command.action = [name = std::move(name), entityStatic,
+                    onCreated](Entity* parentEntity) {
+    Entity* entity = Entity::Instantiate(name, parentEntity, entityStatic);
+    if (onCreated) onCreated(entity);
+  };
+  commands.push_back(std::move(command));
+}
+
+void EntityCommandBuffer::InstantiateBatch(
+    const Prefab& prefab, const int count, const EntityHandle parent,
+    const Action<const std::vector<Entity*>&>& onCreated) {
+  Command command{CommandType::INSTANTIATE};
+  command.parent = parent;
+  command.action = [prefab, count, onCreated](Entity* parentEntity) {
+    const std::vector<Entity*> entities =
+        Entity::InstantiateBatch(prefab, count, parentEntity);
+    if (onCreated) onCreated(entities);
+  };
+  commands.push_back(std::move(command));
+}
+
+void EntityCommandBuffer::Destroy(const EntityHandle entity) {
+  commands.push_back(Command{CommandType::DESTROY, entity});
+}
+
+void EntityCommandBuffer::DestroyComponent(const EntityHandle entity,
+                                           Component* const component) {
+  Command command{CommandType::DESTROY_COMPONENT, entity};
+  command.componentGeneration = component->generation;
+  commands.push_back(std::move(command));
+}
+
+void EntityCommandBuffer::SetParent(const EntityHandle entity,
+                                    const EntityHandle parent,
+                                    const bool inheritTransform) {
+  Command command{CommandType::SET_PARENT, entity};
+  command.parent = parent;
+  command.inheritTransform = inheritTransform;
+  commands.push_back(std::move(command));
+}
+
+void EntityCommandBuffer::PlayBack(Level* const level) {
+  // indexed, playing a command back can record more
+  for (Size i = 0; i < commands.size(); ++i) {
+    Command command = std::move(commands[i]);
+    if (command.type == CommandType::INSTANTIATE) {
+      command.action(level->GetEntity(command.parent));
+      continue;
+    }
+
+    Entity* entity = level->GetEntity(command.entity);
+    if (entity == nullptr) continue;
+    switch (command.type) {
+      case CommandType::DESTROY:
+        Entity::Destroy(entity);
+        break;
+      case CommandType::DESTROY_COMPONENT:
+        for (Component* component : entity->components) {
+          if (component->generation == command.componentGeneration) {
+            Component::Destroy(component);
+            break;
+          }
+        }
+        break;
+      case CommandType::SET_PARENT: {
+        Entity* parent = level->GetEntity(command.parent);
+        entity->transform->SetParent(
+            parent != nullptr ? parent->transform : nullptr,
+            command.inheritTransform);
+        break;
+      }
+      default:
+        // entities being destroyed don't get new data or components
+        if (!entity->GetAttribute(Entity::EntityAttributes::NEED_DESTROY)) {
+          command.action(entity);
+        }
+        break;
+    }
+  }
+  commands.clear();
+}
+}  // namespace Isetta
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "ISETTA_API.h"
+#include "Scene/EntityHandle.h"
+
+namespace Isetta {
+/**
+ * \brief Structural changes recorded during an update phase and played back
+ * at the level's sync point at the end of it. Every thread gets its own
+ * buffer, so recording needs no lock, and buffers are played back in thread
+ * order so the result doesn't depend on scheduling. Entities are referred to
+ * by handle: a command on an entity that is gone by playback is dropped
+ */
+class ISETTA_API EntityCommandBuffer {
+ public:
+  /**
+   * \brief Buffer of the calling thread in the loaded level, see
+   * JobSystem::GetThreadIndex
+   */
+  static EntityCommandBuffer& Get();
+  /**
+   * \brief Buffer of the given thread in the loaded level. Thread 0 is the
+   * main thread
+   */
+  static EntityCommandBuffer& Get(int thread);
+
+  /**
+   * \brief Instantiate an entity at playback
+   * \param parent Parent of the entity, the level root if invalid or gone
+   * \param onCreated Called with the new entity, to finish setting it up
+   */
+  void Instantiate(std::string name, EntityHandle parent = EntityHandle{},
+                   bool entityStatic = false,
+                   const Action<class Entity*>& onCreated = nullptr);
+  /**
+   * \brief Instantiate count copies of the prefab at playback, see
+   * Entity::InstantiateBatch. The prefab is copied
+   */
+  void InstantiateBatch(
+      const class Prefab& prefab, int count,
+      EntityHandle parent = EntityHandle{},
+      const Action<const std::vector<class Entity*>&>& onCreated = nullptr);
+  void Destroy(EntityHandle entity);
+  /**
+   * \brief Destroy a component at playback, if its entity is still alive and
+   * still has it. The component is found by its generation in the entity, so
+   * another component allocated at the same address isn't destroyed instead
+   */
+  void DestroyComponent(EntityHandle entity, class Component* component);
+  /**
+   * \param parent New parent, the level root if invalid
+   */
+  void SetParent(EntityHandle entity, EntityHandle parent,
+                 bool inheritTransform = false);
+
+  /**
+   * \brief Add a component at playback, constructed from a copy of args
+   */
+  template <typename T, bool IsActive = true, typename... Args>
+  void AddComponent(EntityHandle entity, Args&&... args);
+  template <typename T>
+  void AddData(EntityHandle entity, const T& value);
+  template <typename T>
+  void RemoveData(EntityHandle entity);
+
+  bool IsEmpty() const { return commands.empty(); }
+
+ private:
+  enum class CommandType {
+    INSTANTIATE,
+    DESTROY,
+    DESTROY_COMPONENT,
+    SET_PARENT,
+    EDIT,
+  };
+  struct Command {
+    CommandType type;
+    EntityHandle entity;
+    /// Parent for INSTANTIATE and SET_PARENT
+    EntityHandle parent;
+    /// Generation of the component in the entity for DESTROY_COMPONENT
+    U32 componentGeneration;
+    bool inheritTransform;
+    /// Run on the entity for EDIT. For INSTANTIATE, run on the parent, nullptr
+    /// for the level root, and does the instantiating
+    Action<class Entity*> action;
+  };
+
+  /**
+   * \brief Apply and clear the commands. Commands recorded while playing back,
+   * by an Awake for example, are played back too
+   */
+  void PlayBack(class Level* level);
+
+  std::vector<Command> commands;
+
+  friend class Level;
+};
+
+template <typename T, bool IsActive, typename... Args>
+void EntityCommandBuffer::AddComponent(const EntityHandle entity,
+                                       Args&&... args) {
+  // generic lambdas so Entity only has to be complete where this is used
+  Command command{CommandType::EDIT, entity};
+  command.action = [values = std::make_tuple(std::forward<Args>(args)...)](
+                       auto* target) {
+    std::apply(
+        [target](const auto&... value) {
+          target->template AddComponent<T, IsActive>(value...);
+        },
+        values);
+  };
+  commands.push_back(std::move(command));
+}
+
+template <typename T>
+void EntityCommandBuffer::AddData(const EntityHandle entity, const T& value) {
+  Command command{CommandType::EDIT, entity};
+  command.action = [value](auto* target) {
+    target->template AddData<T>(value);
+  };
+  commands.push_back(std::move(command));
+}
+
+template <typename T>
+void EntityCommandBuffer::RemoveData(const EntityHandle entity) {
+  Command command{CommandType::EDIT, entity};
+  command.action = [](auto* target) { target->template RemoveData<T>(); };
+  commands.push_back(std::move(command));
+}
+}  // namespace Isetta
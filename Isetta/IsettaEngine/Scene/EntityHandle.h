@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include "Core/IsettaAlias.h"
+
+namespace Isetta {
+/**
+ * \brief Stable reference to an entity in the loaded level. Unlike an Entity*,
+ * a handle can be kept after the entity is destroyed: it just stops resolving,
+ * even when the slot is reused by a new entity
+ */
+struct EntityHandle {
+  U32 index{0};
+  /// Generation 0 is never given out, so a default handle is always invalid
+  U32 generation{0};
+
+  bool operator==(const EntityHandle& rhs) const {
+    return index == rhs.index && generation == rhs.generation;
+  }
+  bool operator!=(const EntityHandle& rhs) const { return !(*this == rhs); }
+};
+}  // namespace Isetta
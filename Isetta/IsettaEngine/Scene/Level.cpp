@@ -2,29 +2,53 @@
  * Copyright (c) 2018 Isetta
  */
 #include "Scene/Level.h"
+#include <algorithm>
+#include <stdexcept>
 #include "Audio/AudioModule.h"
 #include "Core/Config/Config.h"
+#include "Core/Debug/Assert.h"
+#include "Core/Math/Util.h"
+#include "Scene/Component.h"
 #include "Scene/Entity.h"
+#include "Scene/Prefab.h"
 #include "Scene/Transform.h"
+#include "Util.h"
 #include "brofiler/ProfilerCore/Brofiler.h"
 
 namespace Isetta {
+namespace {
+/// Reserve room for extra more elements, still growing geometrically so
+/// many small batches don't copy the vector every time
+template <typename T>
+void ReserveMore(std::vector<T>* values, const Size extra) {
+  const Size needed = values->size() + extra;
+  if (needed > values->capacity()) {
+    values->reserve(std::max(needed, 2 * values->capacity()));
+  }
+}
+}  // namespace
 
 Entity* Level::GetEntityByName(const std::string_view name) {
-  for (const auto& entity : entities) {
-    if (entity->entityName == name) {
-      return entity;
+  const std::string nameString{name};
+  auto it = entityNames.find(SID(nameString.c_str()));
+  if (it != entityNames.end()) {
+    for (Entity* entity : it->second) {
+      // guard against hash collisions
+      if (entity->entityName == name) return entity;
     }
   }
-  LOG_WARNING(Debug::Channel::General, "Entity %s not found!", name.data());
+  LOG_WARNING(Debug::Channel::General, "Entity %s not found!",
+              nameString.c_str());
   return nullptr;
 }
 
-std::list<Entity*> Level::GetEntitiesByName(const std::string_view name) {
-  std::list<Entity*> returnEntities;
-  for (const auto& entity : entities) {
-    if (entity->entityName == name) {
-      returnEntities.emplace_back(entity);
+std::vector<Entity*> Level::GetEntitiesByName(const std::string_view name) {
+  std::vector<Entity*> returnEntities;
+  const std::string nameString{name};
+  auto it = entityNames.find(SID(nameString.c_str()));
+  if (it != entityNames.end()) {
+    for (Entity* entity : it->second) {
+      if (entity->entityName == name) returnEntities.push_back(entity);
     }
   }
   return returnEntities;
@@ -32,16 +56,31 @@ std::list<Entity*> Level::GetEntitiesByName(const std::string_view name) {
 
 bool Level::IsLevelLoaded() const { return isLevelLoaded; }
 
-std::list<class Entity*> Level::GetEntities() const { return entities; }
+const std::vector<Entity*>& Level::GetEntities() const { return entities; }
+
+Entity* Level::GetEntity(const EntityHandle handle) const {
+  if (handle.index >= entitySlots.size()) return nullptr;
+  const EntitySlot& slot = entitySlots[handle.index];
+  return slot.generation == handle.generation ? slot.entity : nullptr;
+}
 
 void Level::Unload() {
   PROFILE
   OnUnload();
   pool.Free(levelRoot);
-  for (auto& entity : entities) {
-    pool.Free(entity);
-    entity = nullptr;
+  for (Size i = 0; i < entities.size(); ++i) {
+    pool.Free(entities[i]);
   }
+  entities.clear();
+  entitiesToRemove.clear();
+  entitiesToCheck.clear();
+  entitySlots.clear();
+  freeEntitySlots.clear();
+  entityNames.clear();
+  entityData.Clear();
+  for (EntityCommandBuffer& buffer : commandBuffers) buffer.commands.clear();
+  componentBuckets.clear();
+  componentBucketIndices.clear();
 }
 
 void Level::AddComponentToStart(Component* component) {
@@ -56,59 +95,320 @@ void Level::StartComponents() {
   }
 }
 
+void Level::AddComponentToUpdate(Component* component) {
+  if (component->updateBucket < 0) {
+    std::type_index type{typeid(*component)};
+    auto it = componentBucketIndices.find(type);
+    if (it == componentBucketIndices.end()) {
+      it = componentBucketIndices
+               .emplace(type, static_cast<int>(componentBuckets.size()))
+               .first;
+      componentBuckets.emplace_back();
+    }
+    component->updateBucket = it->second;
+  }
+
+  const Component::ComponentAttributes attributes[] = {
+      Component::ComponentAttributes::NEED_UPDATE,
+      Component::ComponentAttributes::NEED_FIXED_UPDATE,
+      Component::ComponentAttributes::NEED_LATE_UPDATE};
+  ComponentBucket& bucket = componentBuckets[component->updateBucket];
+  for (int phase = 0; phase < 3; ++phase) {
+    if (component->updateSlots[phase] < 0 &&
+        component->GetAttribute(attributes[phase])) {
+      component->updateSlots[phase] =
+          static_cast<int>(bucket.phases[phase].size());
+      bucket.phases[phase].push_back(component);
+    }
+  }
+}
+
+void Level::RemoveComponentFromUpdate(Component* component) {
+  if (component->updateBucket < 0) return;
+  ComponentBucket& bucket = componentBuckets[component->updateBucket];
+  for (int phase = 0; phase < 3; ++phase) {
+    int& slot = component->updateSlots[phase];
+    if (slot >= 0) {
+      bucket.phases[phase][slot] = nullptr;
+      slot = -1;
+    }
+  }
+}
+
+void Level::UpdateComponents(const UpdatePhase phase) {
+  PROFILE
+  const int p = static_cast<int>(phase);
+  Component::ComponentAttributes attribute;
+  void (Component::*update)();
+  switch (phase) {
+    case UpdatePhase::UPDATE:
+      attribute = Component::ComponentAttributes::NEED_UPDATE;
+      update = &Component::Update;
+      break;
+    case UpdatePhase::FIXED_UPDATE:
+      attribute = Component::ComponentAttributes::NEED_FIXED_UPDATE;
+      update = &Component::FixedUpdate;
+      break;
+    default:
+      attribute = Component::ComponentAttributes::NEED_LATE_UPDATE;
+      update = &Component::LateUpdate;
+      break;
+  }
+
+  // components can be added, even with new types, while updating, so the
+  // buckets are indexed again after every call instead of held on to
+  for (Size b = 0; b < componentBuckets.size(); ++b) {
+    if (componentBuckets[b].phases[p].empty()) continue;
+    Size write = 0;
+    for (Size read = 0; read < componentBuckets[b].phases[p].size(); ++read) {
+      Component* component = componentBuckets[b].phases[p][read];
+      if (component == nullptr) continue;
+      // only Update used to skip inactive entities
+      if (component->GetActive() &&
+          (phase != UpdatePhase::UPDATE || component->entity->GetActive())) {
+        (component->*update)();
+      }
+
+      std::vector<Component*>& components = componentBuckets[b].phases[p];
+      // destroyed during its own update
+      if (components[read] == nullptr) continue;
+      if (!component->GetAttribute(attribute)) {
+        component->updateSlots[p] = -1;
+        continue;
+      }
+      component->updateSlots[p] = static_cast<int>(write);
+      components[write++] = component;
+    }
+    componentBuckets[b].phases[p].resize(write);
+  }
+}
+
 Entity* Level::AddEntity(std::string name, Entity* parent, bool entityStatic) {
   PROFILE
   Entity* entity = pool.Get(name, entityStatic);
   entity->transform->SetParent(parent != nullptr ? parent->transform
                                                  : levelRoot->transform);
-  entities.push_back(entity);
+  RegisterEntity(entity);
+  AddEntityName(entity);
   return entity;
 }
 
+std::vector<Entity*> Level::AddEntities(const Prefab& prefab, const int count,
+                                        Entity* parent) {
+  PROFILE
+  std::vector<Entity*> batch;
+  batch.reserve(count);
+  ReserveMore(&entities, count);
+  if (static_cast<Size>(count) > freeEntitySlots.size()) {
+    ReserveMore(&entitySlots, count - freeEntitySlots.size());
+  }
+  std::vector<Entity*>& named = entityNames[SID(prefab.name.c_str())];
+  ReserveMore(&named, count);
+
+  Transform* parentTransform =
+      parent != nullptr ? parent->transform : levelRoot->transform;
+  parentTransform->children.Reserve(Math::Util::NextPowerOfTwo(
+      static_cast<int>(parentTransform->children.Size()) + count));
+
+  // values of the prefab's data indexed by type id, as AddRow takes them
+  const void* dataValues[ArchetypeStorage::maxTypeCount]{};
+  for (const auto& record : prefab.data) {
+    dataValues[record.typeId] = record.value.data();
+  }
+  // buckets are looked up once per component type instead of per instance
+  std::vector<int> updateBuckets(prefab.components.size(), -1);
+
+  for (int i = 0; i < count; ++i) {
+    Entity* entity =
+        pool.Get(prefab.name, prefab.entityStatic, Entity::NextBatchId());
+    entity->transform->InitializeChild(parentTransform, prefab.localPos,
+                                       prefab.localRot, prefab.localScale);
+    entity->layer = prefab.layer;
+    RegisterEntity(entity);
+    entity->nameIndex = static_cast<int>(named.size());
+    named.push_back(entity);
+
+    entity->componentTypes.reserve(prefab.components.size());
+    entity->components.Reserve(static_cast<int>(prefab.components.size()));
+    for (Size c = 0; c < prefab.components.size(); ++c) {
+      const auto& record = prefab.components[c];
+      Component* component = record.create();
+      component->updateBucket = updateBuckets[c];
+      entity->AttachComponent(component, record.typeId, record.isActive);
+      updateBuckets[c] = component->updateBucket;
+    }
+    if (prefab.dataMask.any()) {
+      entityData.AddRow(entity, prefab.dataMask, dataValues);
+    }
+    if (!prefab.active) entity->SetActive(false);
+    batch.push_back(entity);
+  }
+  return batch;
+}
+
+void Level::RegisterEntity(Entity* entity) {
+  U32 slotIndex;
+  if (freeEntitySlots.empty()) {
+    slotIndex = static_cast<U32>(entitySlots.size());
+    entitySlots.emplace_back();
+  } else {
+    slotIndex = freeEntitySlots.back();
+    freeEntitySlots.pop_back();
+  }
+  EntitySlot& slot = entitySlots[slotIndex];
+  slot.entity = entity;
+  entity->handle = EntityHandle{slotIndex, slot.generation};
+
+  entity->levelIndex = static_cast<int>(entities.size());
+  entities.push_back(entity);
+}
+
+void Level::RemoveEntity(Entity* entity) {
+  // the level root is never in the array
+  if (entity->levelIndex < 0) return;
+
+  Entity* last = entities.back();
+  entities[entity->levelIndex] = last;
+  last->levelIndex = entity->levelIndex;
+  entities.pop_back();
+  entity->levelIndex = -1;
+
+  EntitySlot& slot = entitySlots[entity->handle.index];
+  slot.entity = nullptr;
+  // skip 0 on wrap around, it marks an invalid handle
+  if (++slot.generation == 0) slot.generation = 1;
+  freeEntitySlots.push_back(entity->handle.index);
+  entity->handle = EntityHandle{};
+
+  RemoveEntityName(entity);
+  entityData.RemoveAll(entity);
+}
+
+void Level::AddEntityName(Entity* entity) {
+  std::vector<Entity*>& named = entityNames[SID(entity->entityName.c_str())];
+  entity->nameIndex = static_cast<int>(named.size());
+  named.push_back(entity);
+}
+
+void Level::RemoveEntityName(Entity* entity) {
+  if (entity->nameIndex < 0) return;
+  auto it = entityNames.find(SID(entity->entityName.c_str()));
+  ASSERT(it != entityNames.end());
+  std::vector<Entity*>& named = it->second;
+  ASSERT(named[entity->nameIndex] == entity);
+  // the last entity of the name fills its place, like in the entity array
+  Entity* last = named.back();
+  named[entity->nameIndex] = last;
+  last->nameIndex = entity->nameIndex;
+  named.pop_back();
+  entity->nameIndex = -1;
+  if (named.empty()) entityNames.erase(it);
+}
+
+void Level::AddEntityToRemove(Entity* entity) {
+  if (entity->levelIndex < 0) return;
+  entitiesToRemove.push_back(entity);
+  entitiesToCheck.push_back(entity->handle);
+}
+
+void Level::AddEntityToCheck(Entity* entity) {
+  if (entity->levelIndex < 0) return;
+  entitiesToCheck.push_back(entity->handle);
+}
+
+EntityCommandBuffer& Level::GetCommandBuffer(const int thread) {
+  if (thread < 0 || thread >= maxCommandThreads) {
+    throw std::out_of_range(Util::StrFormat(
+        "Level::GetCommandBuffer => No command buffer for thread %d, there "
+        "are %d",
+        thread, maxCommandThreads));
+  }
+  return commandBuffers[thread];
+}
+
+void Level::PlayBackCommands() {
+  PROFILE
+  // a command can record into an earlier thread's buffer, by destroying an
+  // entity whose OnDestroy records for example, so go until all are empty
+  bool playedBack = true;
+  while (playedBack) {
+    playedBack = false;
+    for (EntityCommandBuffer& buffer : commandBuffers) {
+      if (buffer.IsEmpty()) continue;
+      buffer.PlayBack(this);
+      playedBack = true;
+    }
+  }
+}
+
 void Level::Update() {
   BROFILER_CATEGORY("Level Update", Profiler::Color::GoldenRod);
 
   StartComponents();
-  for (const auto& entity : entities) {
-    if (entity->GetActive()) entity->Update();
+  if (CONFIG_VAL(levelConfig.componentUpdateBuckets)) {
+    UpdateComponents(UpdatePhase::UPDATE);
+  } else {
+    // entities can be instantiated while updating, which may grow the array
+    for (Size i = 0; i < entities.size(); ++i) {
+      if (entities[i]->GetActive()) entities[i]->Update();
+    }
   }
+  PlayBackCommands();
 }
 
 void Level::FixedUpdate() {
   BROFILER_CATEGORY("Level Fixed Update", Profiler::Color::DarkSeaGreen);
 
   StartComponents();
-  for (const auto& entity : entities) {
-    entity->FixedUpdate();
+  if (CONFIG_VAL(levelConfig.componentUpdateBuckets)) {
+    UpdateComponents(UpdatePhase::FIXED_UPDATE);
+  } else {
+    for (Size i = 0; i < entities.size(); ++i) {
+      entities[i]->FixedUpdate();
+    }
   }
+  PlayBackCommands();
 }
 
 void Level::GUIUpdate() {
   PROFILE
-  for (const auto& entity : entities) {
-    entity->GuiUpdate();
+  for (Size i = 0; i < entities.size(); ++i) {
+    entities[i]->GuiUpdate();
   }
 }
 
 void Level::LateUpdate() {
   BROFILER_CATEGORY("Level Late Update", Profiler::Color::LightCyan);
 
-  for (const auto& entity : entities) {
-    entity->LateUpdate();
-  }
-
-  for (auto& entity : entities) {
-    if (entity->GetAttribute(Entity::EntityAttributes::NEED_DESTROY)) {
-      pool.Free(entity);
-      entity = nullptr;
+  if (CONFIG_VAL(levelConfig.componentUpdateBuckets)) {
+    UpdateComponents(UpdatePhase::LATE_UPDATE);
+    // deferred destroys land in this frame's destroy pass
+    PlayBackCommands();
+    // only entities that had an entity or component destroyed this frame
+    for (Size i = 0; i < entitiesToCheck.size(); ++i) {
+      Entity* entity = GetEntity(entitiesToCheck[i]);
+      if (entity != nullptr) entity->CheckDestroy();
+    }
+  } else {
+    for (Size i = 0; i < entities.size(); ++i) {
+      entities[i]->LateUpdate();
     }
+    PlayBackCommands();
   }
+  entitiesToCheck.clear();
 
-  entities.remove_if([](Entity*& entity) { return entity == nullptr; });
+  // freeing an entity can destroy more, those are freed in this loop too
+  for (Size i = 0; i < entitiesToRemove.size(); ++i) {
+    Entity* entity = entitiesToRemove[i];
+    RemoveEntity(entity);
+    pool.Free(entity);
+  }
+  entitiesToRemove.clear();
 }
 
 Level::Level()
-    : pool(CONFIG_VAL(memoryConfig.entityPoolInitialSize),
+    : commandBuffers(maxCommandThreads),
+      pool(CONFIG_VAL(memoryConfig.entityPoolInitialSize),
            CONFIG_VAL(memoryConfig.entityPoolIncrement)),
       levelRoot(pool.Get("Root")) {}
 }  // namespace Isetta
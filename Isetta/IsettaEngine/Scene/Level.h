@@ -2,12 +2,19 @@
  * Copyright (c) 2018 Isetta
  */
 #pragma once
-#include <list>
 #include <queue>
 #include <set>
 #include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "Core/Jobs/JobSystem.h"
 #include "Core/Memory/TemplatePoolAllocator.h"
 #include "ISETTA_API.h"
+#include "SID/sid.h"
+#include "Scene/ArchetypeStorage.h"
+#include "Scene/EntityCommandBuffer.h"
+#include "Scene/EntityHandle.h"
 
 #define DEFINE_LEVEL(NAME)                                                \
   class NAME : public Isetta::Level, public Isetta::LevelRegistry<NAME> { \
@@ -28,12 +35,73 @@
 namespace Isetta {
 class ISETTA_API Level {
  private:
-  std::list<class Entity*> entitiesToRemove;
+  /// Entities marked for destruction, freed at the end of LateUpdate
+  std::vector<class Entity*> entitiesToRemove;
+  /// Entities that have something to destroy, checked in LateUpdate. Held by
+  /// handle since one can be freed before the check gets to it
+  std::vector<EntityHandle> entitiesToCheck;
+
+  /**
+   * \brief Slot map behind the entity handles. A slot's generation is bumped
+   * every time its entity is removed, which invalidates old handles to it
+   */
+  struct EntitySlot {
+    class Entity* entity{nullptr};
+    U32 generation{1};
+  };
+  std::vector<EntitySlot> entitySlots;
+  std::vector<U32> freeEntitySlots;
+  std::unordered_map<StringId, std::vector<class Entity*>> entityNames;
+  ArchetypeStorage entityData;
+  /// One per recording thread, index 0 is the main thread
+  std::vector<EntityCommandBuffer> commandBuffers;
+
+  /**
+   * \brief Take the entity out of the entity array, the slot map and the name
+   * index. The last entity of the array fills its place
+   */
+  void RemoveEntity(class Entity* entity);
+  void AddEntityName(class Entity* entity);
+  void RemoveEntityName(class Entity* entity);
+  /// Queue the entity's pending destruction for the end of the frame
+  void AddEntityToRemove(class Entity* entity);
+  void AddEntityToCheck(class Entity* entity);
   void AddComponentToStart(class Component* component);
   void StartComponents();
 
+  enum class UpdatePhase { UPDATE, FIXED_UPDATE, LATE_UPDATE };
+  /**
+   * \brief Components of one type that still need each update phase. Removed
+   * components leave a nullptr that the next pass over the phase compacts
+   */
+  struct ComponentBucket {
+    std::vector<class Component*> phases[3];
+  };
+  std::vector<ComponentBucket> componentBuckets;
+  std::unordered_map<std::type_index, int> componentBucketIndices;
+  /**
+   * \brief Put the component in its type's bucket for every update phase it
+   * needs and isn't in yet
+   */
+  void AddComponentToUpdate(class Component* component);
+  void RemoveComponentFromUpdate(class Component* component);
+  /**
+   * \brief Run one update phase bucket by bucket, dropping components that
+   * don't need it anymore
+   */
+  void UpdateComponents(UpdatePhase phase);
+  /**
+   * \brief The sync point at the end of each update phase: play back every
+   * command buffer, in thread order
+   */
+  void PlayBackCommands();
+
   class Entity* AddEntity(std::string name, class Entity* parent,
                           bool entityStatic = false);
+  std::vector<class Entity*> AddEntities(const class Prefab& prefab, int count,
+                                         class Entity* parent);
+  /// Slot map and name index side of adding an entity
+  void RegisterEntity(class Entity* entity);
 
   void Unload();
   void Update();
@@ -46,16 +114,22 @@ class ISETTA_API Level {
   TemplatePoolAllocator<Entity> pool;
 
   friend class Entity;
+  friend class Component;
   friend class EngineLoop;
   friend class GUIModule;
   friend class LevelManager;
+  friend class TestLevel;
 
  protected:
-  std::list<class Entity*> entities;
+  /// Dense, in no particular order since removal swaps the last entity in
+  std::vector<class Entity*> entities;
   std::queue<class Component*> componentsToStart;
   std::set<class Component*> componentsToDestroy;
 
  public:
+  /// Command buffers a level has, one per job thread
+  static const int maxCommandThreads = JobSystem::maxThreadCount;
+
   class Entity* levelRoot;
   Level();
   virtual ~Level() = default;
@@ -64,7 +138,20 @@ class ISETTA_API Level {
   /**
    * \brief Get all entities in the level
    */
-  class std::list<class Entity*> GetEntities() const;
+  const std::vector<class Entity*>& GetEntities() const;
+  /**
+   * \brief Get the entity the handle refers to, nullptr if it has been
+   * destroyed
+   */
+  class Entity* GetEntity(EntityHandle handle) const;
+  /**
+   * \brief Plain-data components of the level's entities, see Query
+   */
+  ArchetypeStorage& GetEntityData() { return entityData; }
+  /**
+   * \brief Command buffer of the thread, see EntityCommandBuffer
+   */
+  EntityCommandBuffer& GetCommandBuffer(int thread = 0);
   /**
    * \brief Get entitiy by name in the level, if multiple will return first
    * found
@@ -73,7 +160,7 @@ class ISETTA_API Level {
   /**
    * \brief Get all entities with the name in the level
    */
-  class std::list<class Entity*> GetEntitiesByName(const std::string_view);
+  std::vector<class Entity*> GetEntitiesByName(const std::string_view);
 
   /**
    * \brief This is where we put our "level loading script". This function is
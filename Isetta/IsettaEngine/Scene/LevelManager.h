@@ -29,6 +29,9 @@ class ISETTA_API LevelManager {
  public:
   struct LevelConfig {
     CVarString startLevel{"start_level", "EmptyLevel"};
+    /// Update components type by type from the level's buckets instead of
+    /// entity by entity
+    CVar<int> componentUpdateBuckets{"component_update_buckets", 1};
   };
 
   /// Access the current loaded level
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Scene/Prefab.h"
+#include "Scene/Layers.h"
+
+namespace Isetta {
+Prefab::Prefab(std::string name, const bool entityStatic)
+    : name{std::move(name)}, entityStatic{entityStatic} {}
+
+Prefab& Prefab::SetTransform(const Math::Vector3& localPos,
+                             const Math::Vector3& localEulerAngles,
+                             const Math::Vector3& localScale) {
+  this->localPos = localPos;
+  localRot = Math::Quaternion::FromEulerAngles(localEulerAngles);
+  this->localScale = localScale;
+  return *this;
+}
+
+Prefab& Prefab::SetActive(const bool active) {
+  this->active = active;
+  return *this;
+}
+
+Prefab& Prefab::SetLayer(const int layer) {
+  this->layer = Layers::CheckLayer(layer);
+  return *this;
+}
+}  // namespace Isetta
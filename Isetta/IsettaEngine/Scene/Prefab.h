@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "Core/Memory/MemoryManager.h"
+#include "ISETTA_API.h"
+#include "Scene/ArchetypeStorage.h"
+#include "Scene/Component.h"
+#include "Util.h"
+
+namespace Isetta {
+/**
+ * \brief Recipe for an entity: its name, transform, components and data with
+ * their constructor arguments. Checks that only need to happen once, like
+ * component uniqueness, are done while recording, so Entity::InstantiateBatch
+ * can stamp out many copies without them
+ */
+class ISETTA_API Prefab {
+ public:
+  explicit Prefab(std::string name, bool entityStatic = false);
+
+  /**
+   * \brief Record a component, constructed from a copy of args for every
+   * instance
+   */
+  template <typename T, typename... Args>
+  Prefab& AddComponent(Args&&... args);
+  template <typename T, bool IsActive, typename... Args>
+  Prefab& AddComponent(Args&&... args);
+  /**
+   * \brief Record plain data, copied into every instance's row
+   */
+  template <typename T, typename... Args>
+  Prefab& AddData(Args&&... args);
+
+  /**
+   * \brief Local transform of every instance, relative to the parent they are
+   * instantiated under
+   */
+  Prefab& SetTransform(
+      const Math::Vector3& localPos = Math::Vector3::zero,
+      const Math::Vector3& localEulerAngles = Math::Vector3::zero,
+      const Math::Vector3& localScale = Math::Vector3::one);
+  /**
+   * \brief Whether instances start active. Inactive instances still get their
+   * components awoken and enabled first, then disabled, like calling
+   * SetActive(false) right after Instantiate
+   */
+  Prefab& SetActive(bool active);
+  /**
+   * \brief Checked here once instead of for every instance
+   */
+  Prefab& SetLayer(int layer);
+
+  const std::string& GetName() const { return name; }
+
+ private:
+  struct ComponentRecord {
+    int typeId;
+    bool isActive;
+    Func<Component*> create;
+  };
+  struct DataRecord {
+    int typeId;
+    std::vector<U8> value;
+  };
+
+  std::string name;
+  bool entityStatic;
+  bool active{true};
+  int layer{0};
+  Math::Vector3 localPos;
+  Math::Quaternion localRot{Math::Quaternion::identity};
+  Math::Vector3 localScale{Math::Vector3::one};
+
+  std::vector<ComponentRecord> components;
+  std::vector<DataRecord> data;
+  ArchetypeStorage::TypeMask dataMask;
+
+  friend class Level;
+};
+
+template <typename T, typename... Args>
+Prefab& Prefab::AddComponent(Args&&... args) {
+  return AddComponent<T, true>(std::forward<Args>(args)...);
+}
+
+template <typename T, bool IsActive, typename... Args>
+Prefab& Prefab::AddComponent(Args&&... args) {
+  static_assert(std::is_base_of<Component, T>::value,
+                "Prefab::AddComponent => T has to derive from Component");
+  const int typeId = Component::GetTypeId<T>();
+  if (Component::IsUnique(typeId)) {
+    for (const ComponentRecord& record : components) {
+      if (record.typeId == typeId) {
+        throw std::logic_error(Util::StrFormat(
+            "Prefab::AddComponent => Adding multiple excluded components %s",
+            typeid(T).name()));
+      }
+    }
+  }
+  components.push_back(ComponentRecord{
+      typeId, IsActive,
+      [values = std::make_tuple(std::forward<Args>(args)...)]() {
+        return static_cast<Component*>(std::apply(
+            [](const auto&... value) {
+              return MemoryManager::NewOnFreeList<T>(value...);
+            },
+            values));
+      }});
+  return *this;
+}
+
+template <typename T, typename... Args>
+Prefab& Prefab::AddData(Args&&... args) {
+  const int typeId = ArchetypeStorage::GetTypeId<T>();
+  if (dataMask.test(typeId)) {
+    throw std::logic_error(Util::StrFormat(
+        "Prefab::AddData => %s already has %s", name.c_str(),
+        typeid(T).name()));
+  }
+  const T value{std::forward<Args>(args)...};
+  DataRecord record{typeId, std::vector<U8>(sizeof(T))};
+  std::memcpy(record.value.data(), &value, sizeof(T));
+  data.push_back(std::move(record));
+  dataMask.set(typeId);
+  return *this;
+}
+}  // namespace Isetta
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Scene/ArchetypeStorage.h"
+#include "Scene/Level.h"
+#include "Scene/LevelManager.h"
+
+namespace Isetta {
+/**
+ * \brief Iterates every entity in the storage that has all of Ts, chunk by
+ * chunk. Keep a query around between frames: it only looks at archetypes
+ * created since its last run. Adding or removing data while a query runs is
+ * not supported
+ */
+template <typename... Ts>
+class Query {
+ public:
+  /// Query the loaded level's data
+  Query() : Query{&LevelManager::Instance().loadedLevel->GetEntityData()} {}
+  explicit Query(ArchetypeStorage* storage);
+
+  /**
+   * \brief Call func(Ts&...) for every matching entity
+   */
+  template <typename Function>
+  void ForEach(Function func);
+  /**
+   * \brief Call func(Entity*, Ts&...) for every matching entity, which lets
+   * data be written back to the entity's transform or components
+   */
+  template <typename Function>
+  void ForEachEntity(Function func);
+  /**
+   * \brief Like ForEach, with the chunks run as jobs of the JobSystem. func
+   * runs concurrently, so it should only touch the data it is given
+   */
+  template <typename Function>
+  void ParallelForEach(Function func);
+  /**
+   * \brief Like ForEachEntity, in parallel: func(int thread, Entity*, Ts&...).
+   * Entities can't be changed from the job threads, record the changes in
+   * EntityCommandBuffer::Get(thread) instead
+   */
+  template <typename Function>
+  void ParallelForEachEntity(Function func);
+
+  /**
+   * \brief Number of matching entities
+   */
+  int Count();
+
+ private:
+  /// Pick up the archetypes created since the last call
+  void Refresh();
+
+  template <typename Function, Size... I>
+  static void RunChunk(const ArchetypeStorage::Archetype& archetype,
+                       const ArchetypeStorage::Chunk& chunk, Function& func,
+                       std::index_sequence<I...>);
+  template <typename Function, Size... I>
+  static void RunChunkEntity(const ArchetypeStorage::Archetype& archetype,
+                             const ArchetypeStorage::Chunk& chunk,
+                             Function& func, std::index_sequence<I...>);
+
+  ArchetypeStorage* storage;
+  ArchetypeStorage::TypeMask mask;
+  std::vector<int> archetypes;
+  Size checkedCount{0};
+};
+
+template <typename... Ts>
+Query<Ts...>::Query(ArchetypeStorage* const storage) : storage{storage} {
+  (mask.set(ArchetypeStorage::GetTypeId<Ts>()), ...);
+}
+
+template <typename... Ts>
+template <typename Function>
+void Query<Ts...>::ForEach(Function func) {
+  Refresh();
+  for (const int index : archetypes) {
+    const ArchetypeStorage::Archetype& archetype = storage->archetypes[index];
+    for (const ArchetypeStorage::Chunk& chunk : archetype.chunks) {
+      RunChunk(archetype, chunk, func, std::index_sequence_for<Ts...>{});
+    }
+  }
+}
+
+template <typename... Ts>
+template <typename Function>
+void Query<Ts...>::ForEachEntity(Function func) {
+  Refresh();
+  for (const int index : archetypes) {
+    const ArchetypeStorage::Archetype& archetype = storage->archetypes[index];
+    for (const ArchetypeStorage::Chunk& chunk : archetype.chunks) {
+      RunChunkEntity(archetype, chunk, func, std::index_sequence_for<Ts...>{});
+    }
+  }
+}
+
+template <typename... Ts>
+template <typename Function>
+void Query<Ts...>::ParallelForEach(Function func) {
+  Refresh();
+  storage->ParallelForChunks(
+      archetypes, [&func](int, const ArchetypeStorage::Archetype& archetype,
+                          const ArchetypeStorage::Chunk& chunk) {
+        RunChunk(archetype, chunk, func, std::index_sequence_for<Ts...>{});
+      });
+}
+
+template <typename... Ts>
+template <typename Function>
+void Query<Ts...>::ParallelForEachEntity(Function func) {
+  Refresh();
+  storage->ParallelForChunks(
+      archetypes, [&func](const int thread,
+                          const ArchetypeStorage::Archetype& archetype,
+                          const ArchetypeStorage::Chunk& chunk) {
+        auto threadFunc = [&func, thread](Entity* entity, Ts&... values) {
+          func(thread, entity, values...);
+        };
+        RunChunkEntity(archetype, chunk, threadFunc,
+                       std::index_sequence_for<Ts...>{});
+      });
+}
+
+template <typename... Ts>
+int Query<Ts...>::Count() {
+  Refresh();
+  int count = 0;
+  for (const int index : archetypes) {
+    for (const ArchetypeStorage::Chunk& chunk :
+         storage->archetypes[index].chunks) {
+      count += chunk.count;
+    }
+  }
+  return count;
+}
+
+template <typename... Ts>
+void Query<Ts...>::Refresh() {
+  const std::vector<ArchetypeStorage::Archetype>& all = storage->archetypes;
+  // the storage was cleared since
+  if (checkedCount > all.size()) {
+    archetypes.clear();
+    checkedCount = 0;
+  }
+  for (; checkedCount < all.size(); ++checkedCount) {
+    if ((all[checkedCount].mask & mask) == mask) {
+      archetypes.push_back(static_cast<int>(checkedCount));
+    }
+  }
+}
+
+template <typename... Ts>
+template <typename Function, Size... I>
+void Query<Ts...>::RunChunk(const ArchetypeStorage::Archetype& archetype,
+                            const ArchetypeStorage::Chunk& chunk,
+                            Function& func, std::index_sequence<I...>) {
+  const std::tuple<Ts*...> columns{
+      ArchetypeStorage::Column<Ts>(archetype, chunk)...};
+  for (int i = 0; i < chunk.count; ++i) {
+    func(std::get<I>(columns)[i]...);
+  }
+}
+
+template <typename... Ts>
+template <typename Function, Size... I>
+void Query<Ts...>::RunChunkEntity(const ArchetypeStorage::Archetype& archetype,
+                                  const ArchetypeStorage::Chunk& chunk,
+                                  Function& func, std::index_sequence<I...>) {
+  Entity** entities = ArchetypeStorage::EntityColumn(archetype, chunk);
+  const std::tuple<Ts*...> columns{
+      ArchetypeStorage::Column<Ts>(archetype, chunk)...};
+  for (int i = 0; i < chunk.count; ++i) {
+    func(entities[i], std::get<I>(columns)[i]...);
+  }
+}
+}  // namespace Isetta
@@ -2,6 +2,7 @@
  * Copyright (c) 2018 Isetta
  */
 #include "Scene/Transform.h"
+#include "Collisions/Collider.h"
 #include "Core/Debug/DebugDraw.h"
 #include "Core/Debug/Logger.h"
 #include "Core/Math/Matrix3.h"
@@ -10,17 +11,28 @@
 #include "Scene/Entity.h"
 #include "Scene/Level.h"
 #include "Scene/LevelManager.h"
+#include "Scene/TransformHierarchy.h"
 #include "Util.h"
 
 namespace Isetta {
-Transform::Transform(Entity* const entity) : entity(entity) {}
+namespace {
+TransformHierarchy& Hierarchy() { return TransformHierarchy::Instance(); }
+}  // namespace
+
+Transform::Transform(Entity* const entity) : entity(entity) {
+  hierarchyIndex = Hierarchy().Register(this);
+}
+
+Transform::~Transform() { Hierarchy().Unregister(hierarchyIndex); }
 
 void Transform::SetLocalToWorldMatrix(const Math::Matrix4& newMatrix) {
   if (!entity->IsMoveable()) return;
 
-  localToWorldMatrix = newMatrix;
+  TransformHierarchy& hierarchy = Hierarchy();
+  hierarchy.localToWorld[hierarchyIndex] = newMatrix;
   for (int i = 0; i < Math::Matrix3::ROW_COUNT; ++i) {
-    axis[i] = localToWorldMatrix.GetCol(i).GetVector3().Normalized();
+    hierarchy.axes[hierarchyIndex].axis[i] =
+        newMatrix.GetCol(i).GetVector3().Normalized();
   }
   SetDirty();
 }
@@ -29,12 +41,15 @@ Math::Vector3 Transform::GetWorldPos() {
   return GetLocalToWorldMatrix().GetCol(3).GetVector3();
 }
 
-Math::Vector3 Transform::GetLocalPos() const { return localPos; }
+Math::Vector3 Transform::GetLocalPos() const {
+  return Hierarchy().localPos[hierarchyIndex];
+}
 
 void Transform::SetWorldPos(const Math::Vector3& newWorldPos) {
   if (!entity->IsMoveable()) return;
   SetDirty();
 
+  Math::Vector3& localPos = Hierarchy().localPos[hierarchyIndex];
   if (parent == nullptr) {
     localPos = newWorldPos;
   } else {
@@ -46,7 +61,7 @@ void Transform::SetWorldPos(const Math::Vector3& newWorldPos) {
 void Transform::SetLocalPos(const Math::Vector3& newLocalPos) {
   if (!entity->IsMoveable()) return;
 
-  localPos = newLocalPos;
+  Hierarchy().localPos[hierarchyIndex] = newLocalPos;
   SetDirty();
 }
 
@@ -55,39 +70,36 @@ void Transform::TranslateWorld(const Math::Vector3& delta) {
 }
 
 void Transform::TranslateLocal(const Math::Vector3& delta) {
-  SetLocalPos(localPos + delta);
+  SetLocalPos(GetLocalPos() + delta);
 }
 
 Math::Quaternion Transform::GetWorldRot() {
-  if (parent == nullptr) {
-    worldRot = localRot;
-  } else {
-    worldRot = parent->GetWorldRot() * localRot;
-  }
-
-  return worldRot;
+  GetLocalToWorldMatrix();
+  return Hierarchy().worldRot[hierarchyIndex];
 }
 
-Math::Quaternion Transform::GetLocalRot() const { return localRot; }
+Math::Quaternion Transform::GetLocalRot() const {
+  return Hierarchy().localRot[hierarchyIndex];
+}
 
 Math::Vector3 Transform::GetWorldEulerAngles() {
   return GetWorldRot().GetEulerAngles();
 }
 
 Math::Vector3 Transform::GetLocalEulerAngles() const {
-  return localRot.GetEulerAngles();
+  return GetLocalRot().GetEulerAngles();
 }
 
 void Transform::SetWorldRot(const Math::Quaternion& newWorldRot) {
   if (!entity->IsMoveable()) return;
 
-  worldRot = newWorldRot;
   SetDirty();
 
+  Math::Quaternion& localRot = Hierarchy().localRot[hierarchyIndex];
   if (parent == nullptr) {
-    localRot = worldRot;
+    localRot = newWorldRot;
   } else {
-    localRot = parent->GetWorldRot().GetInverse() * worldRot;
+    localRot = parent->GetWorldRot().GetInverse() * newWorldRot;
   }
 }
 
@@ -98,7 +110,7 @@ void Transform::SetWorldRot(const Math::Vector3& worldEulers) {
 void Transform::SetLocalRot(const Math::Quaternion& newLocalRot) {
   if (!entity->IsMoveable()) return;
 
-  localRot = newLocalRot;
+  Hierarchy().localRot[hierarchyIndex] = newLocalRot;
   SetDirty();
 }
 
@@ -133,7 +145,7 @@ void Transform::RotateLocal(const Math::Vector3& eulerAngles) {
   SetLocalRot(Math::Quaternion::FromEulerAngles(left * eulerAngles.x +
                                                 up * eulerAngles.y +
                                                 forward * eulerAngles.z) *
-              localRot);
+              GetLocalRot());
 }
 
 void Transform::RotateLocal(const Math::Vector3& axisWorldSpace,
@@ -143,42 +155,49 @@ void Transform::RotateLocal(const Math::Vector3& axisWorldSpace,
   Math::Vector3 localAxis =
       GetParent() != nullptr ? GetParent()->LocalDirFromWorldDir(axisWorldSpace)
                              : axisWorldSpace;
-  SetLocalRot(Math::Quaternion::FromAngleAxis(localAxis, angle) * localRot);
+  SetLocalRot(Math::Quaternion::FromAngleAxis(localAxis, angle) *
+              GetLocalRot());
 }
 
 Math::Vector3 Transform::GetWorldScale() {
-  if (parent == nullptr) {
-    worldScale = localScale;
-  } else {
-    worldScale = Math::Vector3::Scale(parent->GetWorldScale(), localScale);
-  }
-
-  return worldScale;
+  GetLocalToWorldMatrix();
+  return Hierarchy().worldScale[hierarchyIndex];
 }
 
-Math::Vector3 Transform::GetLocalScale() const { return localScale; }
+Math::Vector3 Transform::GetLocalScale() const {
+  return Hierarchy().localScale[hierarchyIndex];
+}
 
 void Transform::SetLocalScale(const Math::Vector3& newScale) {
   if (!entity->IsMoveable()) return;
 
-  localScale = newScale;
+  Hierarchy().localScale[hierarchyIndex] = newScale;
   SetDirty();
 }
 
 void Transform::SetWorldScale(const Math::Vector3& newWorldScale) {
   if (!entity->IsMoveable()) return;
 
-  worldScale = newWorldScale;
   SetDirty();
 
+  Math::Vector3& localScale = Hierarchy().localScale[hierarchyIndex];
   if (parent == nullptr) {
-    localScale = worldScale;
+    localScale = newWorldScale;
   } else {
     localScale =
-        Math::Vector3::ReverseScale(worldScale, parent->GetWorldScale());
+        Math::Vector3::ReverseScale(newWorldScale, parent->GetWorldScale());
   }
 }
 
+void Transform::GetWorldTRS(Math::Vector3* const position,
+                            Math::Quaternion* const rotation,
+                            Math::Vector3* const scale) {
+  TransformHierarchy& hierarchy = Hierarchy();
+  *position = hierarchy.GetLocalToWorld(hierarchyIndex).GetCol(3).GetVector3();
+  *rotation = hierarchy.worldRot[hierarchyIndex];
+  *scale = hierarchy.worldScale[hierarchyIndex];
+}
+
 void Transform::SetParent(Transform* const transform, bool inheritTransform) {
   if (!entity->IsMoveable()) return;
 
@@ -197,9 +216,7 @@ void Transform::SetParent(Transform* const transform, bool inheritTransform) {
   Math::Vector3 originalPos, originalScale;
   Math::Quaternion originalRot;
   if (!inheritTransform) {
-    originalPos = GetWorldPos();
-    originalRot = GetWorldRot();
-    originalScale = GetWorldScale();
+    GetWorldTRS(&originalPos, &originalRot, &originalScale);
   }
 
   if (parent != nullptr) {
@@ -219,22 +236,22 @@ void Transform::SetParent(Transform* const transform, bool inheritTransform) {
 
 Math::Vector3 Transform::GetForward() {
   GetLocalToWorldMatrix();
-  return axis[2];
+  return Hierarchy().axes[hierarchyIndex].axis[2];
 }
 
 Math::Vector3 Transform::GetUp() {
   GetLocalToWorldMatrix();
-  return axis[1];
+  return Hierarchy().axes[hierarchyIndex].axis[1];
 }
 
 Math::Vector3 Transform::GetLeft() {
   GetLocalToWorldMatrix();
-  return axis[0];
+  return Hierarchy().axes[hierarchyIndex].axis[0];
 }
 
 Math::Vector3 Transform::GetAxis(const int i) {
   GetLocalToWorldMatrix();
-  return axis[i];
+  return Hierarchy().axes[hierarchyIndex].axis[i];
 }
 
 void Transform::LookAt(const Math::Vector3& target,
@@ -314,48 +331,36 @@ void Transform::SetH3DNodeTransform(const H3DNode node, Transform& transform) {
   h3dSetNodeTransMat(node, transform.GetLocalToWorldMatrix().Transpose().data);
 }
 
-const Math::Matrix4& Transform::GetLocalToWorldMatrix() {
-  if (isDirty) {
-    RecalculateLocalToWorldMatrix();
-    isDirty = false;
-  }
-  return localToWorldMatrix;
+Math::Matrix4 Transform::GetLocalToWorldMatrix() {
+  return Hierarchy().GetLocalToWorld(hierarchyIndex);
 }
 
-const Math::Matrix4& Transform::GetWorldToLocalMatrix() {
-  if (isWorldToLocalDirty) {
-    worldToLocalMatrix = GetLocalToWorldMatrix().Inverse();
-    isWorldToLocalDirty = false;
-  }
-  return worldToLocalMatrix;
+Math::Matrix4 Transform::GetWorldToLocalMatrix() {
+  return Hierarchy().GetWorldToLocal(hierarchyIndex);
 }
-void Transform::RecalculateLocalToWorldMatrix() {
-  Math::Matrix4 localToParentMatrix{};
-  localToParentMatrix.SetTopLeftMatrix3(localRot.GetMatrix3());  // rotation
-  Math::Matrix4 temp;
-  temp.SetDiagonal(localScale.x, localScale.y, localScale.z, 1);
-  localToParentMatrix = localToParentMatrix * temp;  // scale
-  localToParentMatrix.SetCol(3, localPos, 1);
-
-  if (parent != nullptr) {
-    localToWorldMatrix = parent->GetLocalToWorldMatrix() * localToParentMatrix;
-  } else {
-    localToWorldMatrix = localToParentMatrix;
-  }
-  for (int i = 0; i < Math::Matrix3::ROW_COUNT; ++i) {
-    axis[i] = localToWorldMatrix.GetCol(i).GetVector3().Normalized();
-  }
+void Transform::InitializeChild(Transform* const newParent,
+                                const Math::Vector3& localPos,
+                                const Math::Quaternion& localRot,
+                                const Math::Vector3& localScale) {
+  TransformHierarchy& hierarchy = Hierarchy();
+  hierarchy.localPos[hierarchyIndex] = localPos;
+  hierarchy.localRot[hierarchyIndex] = localRot;
+  hierarchy.localScale[hierarchyIndex] = localScale;
+  parent = newParent;
+  newParent->AddChild(this);
 }
 
 void Transform::AddChild(Transform* transform) {
   // duplicate child check is in SetParent
   children.PushBack(transform);
+  Hierarchy().SetParent(transform->hierarchyIndex, hierarchyIndex);
 }
 
 void Transform::RemoveChild(Transform* transform) {
   for (auto it = children.begin(); it != children.end(); ++it) {
     if (*it == transform) {
       children.Erase(it);
+      Hierarchy().SetParent(transform->hierarchyIndex, -1);
       return;
     }
   }
@@ -366,14 +371,36 @@ void Transform::RemoveChild(Transform* transform) {
 }
 
 void Transform::SetDirty() {
-  // TODO(YIDI): Don't need to traverse all children, if one child is dirty, all
-  // children all also dirty
-  isDirty = true;
-  isWorldToLocalDirty = true;
-  ForDescendants([](Transform* trans) {
-    trans->isDirty = true;
-    trans->isWorldToLocalDirty = true;
-  });
+  TransformHierarchy& hierarchy = Hierarchy();
+  NotifyColliders();
+  if (hierarchy.IsWorldDirty(hierarchyIndex)) {
+    // descendants of a dirty transform are already dirty
+    hierarchy.flags[hierarchyIndex] |= TransformHierarchy::inverseDirtyBit;
+    return;
+  }
+
+  // explicit stack instead of ForDescendants, and whole subtrees that are
+  // already dirty are skipped
+  std::vector<Transform*>& stack = hierarchy.dirtyStack;
+  stack.push_back(this);
+  while (!stack.empty()) {
+    Transform* transform = stack.back();
+    stack.pop_back();
+    hierarchy.flags[transform->hierarchyIndex] |=
+        TransformHierarchy::worldDirtyBit | TransformHierarchy::inverseDirtyBit;
+    if (transform != this) transform->NotifyColliders();
+    for (Transform* child : transform->children) {
+      if (!hierarchy.IsWorldDirty(child->hierarchyIndex)) {
+        stack.push_back(child);
+      }
+    }
+  }
+}
+
+void Transform::NotifyColliders() {
+  for (Collider* collider : colliders) {
+    collider->OnTransformDirty();
+  }
 }
 
 }  // namespace Isetta
@@ -9,14 +9,23 @@
 #include "Core/Math/Vector3.h"
 
 namespace Isetta {
+/**
+ * \brief Facade over a slot in TransformHierarchy, which holds the local and
+ * world state of every transform in contiguous arrays
+ */
 class ISETTA_API_DECLARE Transform {
   friend class Entity;
+  friend class Collider;
+  friend class TransformHierarchy;
+  friend class Level;
 
  public:
   // constructors
   Transform() = delete;
   explicit Transform(class Entity* const entity);
-  ~Transform() = default;
+  Transform(const Transform&) = delete;
+  Transform& operator=(const Transform&) = delete;
+  ~Transform();
 
   // position
   Math::Vector3 GetWorldPos();
@@ -61,6 +70,13 @@ class ISETTA_API_DECLARE Transform {
   void SetLocalScale(const Math::Vector3& newScale);
   void SetWorldScale(const Math::Vector3& newWorldScale);
 
+  /**
+   * \brief Get world position, world rotation, and world scale of this
+   * transform with one cache check
+   */
+  void GetWorldTRS(Math::Vector3* position, Math::Quaternion* rotation,
+                   Math::Vector3* scale);
+
   // hierarchy
   void SetParent(Transform* const transform, bool inheritTransform = true);
   Transform* GetParent() const { return parent; }
@@ -73,11 +89,11 @@ class ISETTA_API_DECLARE Transform {
   /**
    * \brief Get a Matrix4 that transform objects from local space to world space
    */
-  const Math::Matrix4& GetLocalToWorldMatrix();
+  Math::Matrix4 GetLocalToWorldMatrix();
   /**
    * \brief Get a Matrix4 that transform objects from world space to local space
    */
-  const Math::Matrix4& GetWorldToLocalMatrix();
+  Math::Matrix4 GetWorldToLocalMatrix();
   void SetLocalToWorldMatrix(const Math::Matrix4& newMatrix);
 
   // other
@@ -157,29 +173,26 @@ class ISETTA_API_DECLARE Transform {
   class Entity* const entity{nullptr};
 
  private:
-  void RecalculateLocalToWorldMatrix();
-
-  // cached results
-  Math::Quaternion worldRot;
-  Math::Vector3 worldScale;
-  Math::Matrix4 localToWorldMatrix{};
-  Math::Matrix4 worldToLocalMatrix{};
-  // union
-  Math::Vector3 axis[3];
-  Math::Vector3& left = axis[0];
-  Math::Vector3& up = axis[1];
-  Math::Vector3& forward = axis[2];
-
-  // local storage
-  Math::Vector3 localPos{Math::Vector3::zero};
-  Math::Quaternion localRot{Math::Quaternion::identity};
-  Math::Vector3 localScale{Math::Vector3::one};
-
-  // marked when anything local changed
-  // cleared when matrix recalculated
+  // marked when anything local changed, on this transform and its
+  // descendants. Cleared when the matrix is recalculated
   void SetDirty();
-  bool isDirty{true};
-  bool isWorldToLocalDirty{true};
+
+  /**
+   * \brief Fast path for a transform that was just created. It has no
+   * children and is still dirty from registering, so the local values and the
+   * parent are written straight into the hierarchy
+   */
+  void InitializeChild(Transform* newParent, const Math::Vector3& localPos,
+                       const Math::Quaternion& localRot,
+                       const Math::Vector3& localScale);
+
+  /// Slot in TransformHierarchy, kept up to date when the hierarchy reorders
+  int hierarchyIndex;
+
+  // colliders on this transform's entity, told whenever it is marked dirty so
+  // the collision tree only refits what moved
+  void NotifyColliders();
+  Array<class Collider*> colliders;
 
   Transform* parent{nullptr};
   Array<Transform*> children;
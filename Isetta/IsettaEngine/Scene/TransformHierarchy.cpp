@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Scene/TransformHierarchy.h"
+#include <algorithm>
+#include "Core/Debug/Assert.h"
+#include "Core/Math/Matrix3.h"
+#include "Core/Math/Vector4.h"
+#include "Scene/Transform.h"
+#include "brofiler/ProfilerCore/Brofiler.h"
+
+namespace Isetta {
+namespace {
+template <typename T>
+void Permute(std::vector<T>* values, const std::vector<int>& remap,
+             const Size newCount) {
+  std::vector<T> sorted(newCount);
+  for (Size i = 0; i < remap.size(); ++i) {
+    if (remap[i] >= 0) sorted[remap[i]] = std::move((*values)[i]);
+  }
+  values->swap(sorted);
+}
+}  // namespace
+
+TransformHierarchy& TransformHierarchy::Instance() {
+  static TransformHierarchy instance;
+  return instance;
+}
+
+void TransformHierarchy::UpdateWorldMatrices() {
+  PROFILE
+  if (orderDirty || deadCount * 2 > owners.size()) {
+    Reorder();
+  }
+  UpdateRange(0, static_cast<int>(owners.size()));
+}
+
+int TransformHierarchy::Register(Transform* const owner) {
+  if (!freeSlots.empty()) {
+    // a reused slot has no parent yet, so it can't break the order until
+    // SetParent says so
+    const int index = freeSlots.back();
+    freeSlots.pop_back();
+    --deadCount;
+    localPos[index] = Math::Vector3::zero;
+    localRot[index] = Math::Quaternion::identity;
+    localScale[index] = Math::Vector3::one;
+    worldRot[index] = Math::Quaternion::identity;
+    worldScale[index] = Math::Vector3::one;
+    parents[index] = -1;
+    flags[index] = worldDirtyBit | inverseDirtyBit;
+    owners[index] = owner;
+    return index;
+  }
+
+  localPos.push_back(Math::Vector3::zero);
+  localRot.push_back(Math::Quaternion::identity);
+  localScale.push_back(Math::Vector3::one);
+  worldRot.push_back(Math::Quaternion::identity);
+  worldScale.push_back(Math::Vector3::one);
+  localToWorld.emplace_back();
+  worldToLocal.emplace_back();
+  axes.emplace_back();
+  parents.push_back(-1);
+  flags.push_back(worldDirtyBit | inverseDirtyBit);
+  owners.push_back(owner);
+  return static_cast<int>(owners.size()) - 1;
+}
+
+void TransformHierarchy::Unregister(const int index) {
+  // the slot stays so no other index moves, Register reuses it or Reorder
+  // drops it later
+  owners[index] = nullptr;
+  parents[index] = -1;
+  flags[index] = 0;
+  freeSlots.push_back(index);
+  ++deadCount;
+}
+
+void TransformHierarchy::SetParent(const int index, const int parentIndex) {
+  parents[index] = parentIndex;
+  if (parentIndex > index) {
+    orderDirty = true;
+  }
+}
+
+Math::Matrix4 TransformHierarchy::GetLocalToWorld(const int index) {
+  if (IsWorldDirty(index)) {
+    CleanWorld(index);
+  }
+  return localToWorld[index];
+}
+
+void TransformHierarchy::CleanWorld(const int index) {
+  // a dirty transform can have dirty ancestors, they go first. Recursing
+  // keeps the chain on this call's stack rather than in shared scratch space
+  const int parent = parents[index];
+  if (parent >= 0 && IsWorldDirty(parent)) {
+    CleanWorld(parent);
+  }
+  Recalculate(index);
+}
+
+Math::Matrix4 TransformHierarchy::GetWorldToLocal(const int index) {
+  if ((flags[index] & inverseDirtyBit) != 0) {
+    worldToLocal[index] = GetLocalToWorld(index).AffineInverse();
+    flags[index] &= ~inverseDirtyBit;
+  }
+  return worldToLocal[index];
+}
+
+void TransformHierarchy::Recalculate(const int index) {
+  Math::Matrix4 localToParentMatrix{};
+  localToParentMatrix.SetTopLeftMatrix3(
+      localRot[index].GetMatrix3());  // rotation
+  Math::Matrix4 temp;
+  const Math::Vector3& scale = localScale[index];
+  temp.SetDiagonal(scale.x, scale.y, scale.z, 1);
+  localToParentMatrix = localToParentMatrix * temp;  // scale
+  localToParentMatrix.SetCol(3, localPos[index], 1);
+
+  Math::Matrix4& matrix = localToWorld[index];
+  const int parent = parents[index];
+  if (parent >= 0) {
+    matrix = localToWorld[parent] * localToParentMatrix;
+    worldRot[index] = worldRot[parent] * localRot[index];
+    worldScale[index] = Math::Vector3::Scale(worldScale[parent], scale);
+  } else {
+    matrix = localToParentMatrix;
+    worldRot[index] = localRot[index];
+    worldScale[index] = scale;
+  }
+  for (int i = 0; i < Math::Matrix3::ROW_COUNT; ++i) {
+    axes[index].axis[i] = matrix.GetCol(i).GetVector3().Normalized();
+  }
+  flags[index] &= ~worldDirtyBit;
+}
+
+void TransformHierarchy::UpdateRange(const int begin, const int end) {
+  // parents come first, so their matrices are clean by the time a child
+  // reads them
+  for (int i = begin; i < end; ++i) {
+    if (IsWorldDirty(i)) {
+      Recalculate(i);
+    }
+  }
+}
+
+void TransformHierarchy::Reorder() {
+  PROFILE
+  const int count = static_cast<int>(owners.size());
+
+  // depth of every slot, walking up only as far as the first known depth
+  depths.assign(count, -1);
+  int maxDepth = 0;
+  for (int i = 0; i < count; ++i) {
+    if (depths[i] >= 0) continue;
+    dirtyChain.clear();
+    int cur = i;
+    while (cur >= 0 && depths[cur] < 0) {
+      dirtyChain.push_back(cur);
+      cur = parents[cur];
+    }
+    int depth = cur >= 0 ? depths[cur] : -1;
+    for (auto it = dirtyChain.rbegin(); it != dirtyChain.rend(); ++it) {
+      depths[*it] = ++depth;
+    }
+    maxDepth = std::max(maxDepth, depth);
+  }
+
+  // counting sort by depth, which is stable
+  std::vector<int> levelStarts(maxDepth + 2, 0);
+  for (int i = 0; i < count; ++i) {
+    if (owners[i] != nullptr) ++levelStarts[depths[i] + 1];
+  }
+  for (int depth = 1; depth <= maxDepth + 1; ++depth) {
+    levelStarts[depth] += levelStarts[depth - 1];
+  }
+  std::vector<int> remap(count, -1);
+  for (int i = 0; i < count; ++i) {
+    if (owners[i] != nullptr) remap[i] = levelStarts[depths[i]]++;
+  }
+
+  const Size liveCount = owners.size() - deadCount;
+  Permute(&localPos, remap, liveCount);
+  Permute(&localRot, remap, liveCount);
+  Permute(&localScale, remap, liveCount);
+  Permute(&worldRot, remap, liveCount);
+  Permute(&worldScale, remap, liveCount);
+  Permute(&localToWorld, remap, liveCount);
+  Permute(&worldToLocal, remap, liveCount);
+  Permute(&axes, remap, liveCount);
+  Permute(&parents, remap, liveCount);
+  Permute(&flags, remap, liveCount);
+  Permute(&owners, remap, liveCount);
+
+  for (Size i = 0; i < liveCount; ++i) {
+    int& parent = parents[i];
+    parent = parent >= 0 ? remap[parent] : -1;
+    ASSERT(parent < static_cast<int>(i));
+    owners[i]->hierarchyIndex = static_cast<int>(i);
+  }
+
+  freeSlots.clear();
+  deadCount = 0;
+  orderDirty = false;
+}
+}  // namespace Isetta
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <vector>
+#include "Core/IsettaAlias.h"
+#include "Core/Math/Matrix4.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+
+namespace Isetta {
+/**
+ * \brief Contiguous storage behind every Transform. Local TRS, world matrices
+ * and dirty bits live in parallel arrays ordered so parents always come before
+ * their children, which lets one linear pass bring every world matrix up to
+ * date. The order is rebuilt sorted by hierarchy depth whenever a reparent
+ * breaks it or too many destroyed transforms pile up. Slots of destroyed
+ * transforms are reused until then.
+ *
+ * Reading a dirty transform recalculates it, so only the main thread may read
+ * transforms that can be dirty. Other threads can read clean ones, which is
+ * why the narrowphase reads its pairs' matrices before it is split
+ */
+class TransformHierarchy {
+  friend class Transform;
+  friend class TransformHierarchyTest;
+
+ public:
+  static TransformHierarchy& Instance();
+
+  /**
+   * \brief Recalculate all dirty world matrices in one pass over the arrays.
+   * Transforms of the same depth don't depend on each other, so the range of
+   * one depth can be split across threads once the order is depth-sorted
+   */
+  void UpdateWorldMatrices();
+
+  /**
+   * \brief Number of slots in the arrays, destroyed transforms included
+   */
+  Size GetSlotCount() const { return owners.size(); }
+
+ private:
+  TransformHierarchy() = default;
+
+  static const U8 worldDirtyBit = 0b01;
+  static const U8 inverseDirtyBit = 0b10;
+
+  int Register(class Transform* owner);
+  void Unregister(int index);
+  void SetParent(int index, int parentIndex);
+
+  bool IsWorldDirty(const int index) const {
+    return (flags[index] & worldDirtyBit) != 0;
+  }
+  /**
+   * \brief Bring the world matrix of index up to date, cleaning its dirty
+   * ancestors on the way. Returned by value, the arrays can grow and move as
+   * soon as another transform is created
+   */
+  Math::Matrix4 GetLocalToWorld(int index);
+  Math::Matrix4 GetWorldToLocal(int index);
+  /// Recalculate index after its dirty ancestors, top-down
+  void CleanWorld(int index);
+
+  /// Assumes the parent's world matrix is already clean
+  void Recalculate(int index);
+  void UpdateRange(int begin, int end);
+  /**
+   * \brief Drop destroyed slots and sort the rest by depth, keeping the
+   * relative order of transforms of the same depth
+   */
+  void Reorder();
+
+  // local storage
+  std::vector<Math::Vector3> localPos;
+  std::vector<Math::Quaternion> localRot;
+  std::vector<Math::Vector3> localScale;
+
+  // cached results
+  std::vector<Math::Quaternion> worldRot;
+  std::vector<Math::Vector3> worldScale;
+  std::vector<Math::Matrix4> localToWorld;
+  std::vector<Math::Matrix4> worldToLocal;
+  struct Axes {
+    Math::Vector3 axis[3];
+  };
+  std::vector<Axes> axes;
+
+  std::vector<int> parents;
+  std::vector<U8> flags;
+  /// nullptr for the slot of a destroyed transform
+  std::vector<class Transform*> owners;
+
+  /// Slots of destroyed transforms that Register hands out again
+  std::vector<int> freeSlots;
+  Size deadCount{0};
+  bool orderDirty{false};
+
+  // scratch space reused between calls, main thread only
+  std::vector<int> dirtyChain;
+  std::vector<int> depths;
+  std::vector<class Transform*> dirtyStack;
+};
+}  // namespace Isetta
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "../Scene/TestLevel.h"
+#include "Collisions/BVTree.h"
+#include "Collisions/CollisionsModule.h"
+#include "Collisions/RaycastHit.h"
+#include "Collisions/SphereCollider.h"
+#include "Core/Geometry/Ray.h"
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// in the engine namespace, BVTree, Collider and CollisionsModule befriend it
+// so colliders can register with a module that isn't started
+namespace Isetta {
+TEST_CLASS(BVTreeTest) {
+ public:
+  TEST_METHOD(NearestHitAcrossOverlappingBoxes) {
+    CollisionsModule module;
+    Collider::collisionsModule = &module;
+    TestLevel level;
+    // the ray enters the big sphere's box first but hits the small one first
+    Collider* big = AddSphere(Math::Vector3{10, 4, 0}, 5);
+    Collider* small = AddSphere(Math::Vector3{6.5f, 0, 0}, 0.3f);
+    for (int i = 0; i < 16; ++i) {
+      AddSphere(Math::Vector3{i * 3.f, 0, 20}, 1);
+      AddSphere(Math::Vector3{i * 3.f, 8, 4}, 1);
+    }
+    BVTree& tree = module.bvTree;
+    tree.Update();
+
+    const Ray ray{Math::Vector3{-5, 0, 0}, Math::Vector3{1, 0, 0}};
+    RaycastHit flat, linked;
+    Assert::IsTrue(tree.Raycast(ray, &flat, maxDistance));
+    Assert::IsTrue(flat.GetCollider() == small);
+    Assert::IsTrue(tree.Raycast(tree.root, ray, &linked, maxDistance));
+    Assert::IsTrue(linked.GetCollider() == small);
+
+    // and the big one once the ray passes the small one
+    const Ray above{Math::Vector3{-5, 1, 0}, Math::Vector3{1, 0, 0}};
+    RaycastHit hit;
+    Assert::IsTrue(tree.Raycast(above, &hit, maxDistance));
+    Assert::IsTrue(hit.GetCollider() == big);
+  }
+
+  TEST_METHOD(FlatAndLinkedTraversalsAgree) {
+    CollisionsModule module;
+    Collider::collisionsModule = &module;
+    TestLevel level;
+    std::vector<Collider*> colliders = AddRandomSpheres(200);
+    BVTree& tree = module.bvTree;
+    tree.Update();
+
+    std::mt19937 random{7};
+    for (int i = 0; i < 500; ++i) {
+      const Ray ray = RandomRay(&random);
+      RaycastHit flat, linked;
+      const bool flatHit = tree.Raycast(ray, &flat, maxDistance);
+      const bool linkedHit = tree.Raycast(tree.root, ray, &linked, maxDistance);
+      Assert::AreEqual(linkedHit, flatHit);
+      Assert::IsTrue(flat.GetCollider() == linked.GetCollider());
+
+      // both find what testing every collider finds
+      RaycastHit nearest;
+      for (Collider* collider : colliders) {
+        RaycastHit hit;
+        if (collider->Raycast(ray, &hit, maxDistance) &&
+            hit.GetDistance() < nearest.GetDistance()) {
+          nearest = std::move(hit);
+        }
+      }
+      Assert::IsTrue(flat.GetCollider() == nearest.GetCollider());
+    }
+  }
+
+  TEST_METHOD(RaycastBatchMatchesRaycast) {
+    CollisionsModule module;
+    Collider::collisionsModule = &module;
+    TestLevel level;
+    AddRandomSpheres(200);
+    BVTree& tree = module.bvTree;
+    tree.Update();
+
+    std::mt19937 random{11};
+    // not a multiple of the packet size, so the last packet is partial
+    const Size count = 8 * BVTree::packetSize + 3;
+    std::vector<Ray> rays;
+    for (Size i = 0; i < count; ++i) rays.push_back(RandomRay(&random));
+    RaycastHit hits[count];
+    const Size hitCount =
+        tree.RaycastBatch(rays.data(), count, hits, maxDistance);
+
+    Size expectedCount = 0;
+    for (Size i = 0; i < count; ++i) {
+      RaycastHit hit;
+      expectedCount += tree.Raycast(rays[i], &hit, maxDistance);
+      Assert::IsTrue(hits[i].GetCollider() == hit.GetCollider());
+    }
+    Assert::AreEqual(static_cast<int>(expectedCount),
+                     static_cast<int>(hitCount));
+    Assert::IsTrue(hitCount > 0);
+  }
+
+  TEST_METHOD(CollisionPairsMatchBruteForce) {
+    CollisionsModule module;
+    Collider::collisionsModule = &module;
+    TestLevel level;
+    std::mt19937 random{5};
+    std::uniform_real_distribution<float> position{-20, 20};
+    std::uniform_real_distribution<float> radius{0.5f, 3};
+    std::vector<Collider*> colliders;
+    for (int i = 0; i < 150; ++i) {
+      colliders.push_back(AddSphere(
+          Math::Vector3{position(random), position(random), position(random)},
+          radius(random), i % 3 == 0));
+    }
+    BVTree& tree = module.bvTree;
+    tree.Update();
+
+    using Pair = std::pair<Collider*, Collider*>;
+    const auto ordered = [](Collider* a, Collider* b) {
+      return a < b ? Pair{a, b} : Pair{b, a};
+    };
+    std::set<Pair> expected;
+    for (Size i = 0; i < colliders.size(); ++i) {
+      for (Size j = i + 1; j < colliders.size(); ++j) {
+        Collider* a = colliders[i];
+        Collider* b = colliders[j];
+        if (a->entity->isStatic && b->entity->isStatic) continue;
+        if (a->GetFatAABB().Intersect(b->GetFatAABB())) {
+          expected.insert(ordered(a, b));
+        }
+      }
+    }
+
+    std::set<Pair> found;
+    for (const auto& [a, b] : tree.GetCollisionPairs()) {
+      Assert::IsFalse(a->entity->isStatic && b->entity->isStatic);
+      // each pair once
+      Assert::IsTrue(found.insert(ordered(a, b)).second);
+    }
+    Assert::IsTrue(found == expected);
+    Assert::IsFalse(expected.empty());
+  }
+
+ private:
+  static constexpr float maxDistance = 200;
+
+  /// The collider's center places it, so static entities can be placed too
+  static Collider* AddSphere(const Math::Vector3& center, const float radius,
+                             const bool isStatic = false) {
+    Entity* entity = Entity::Instantiate("sphere", nullptr, isStatic);
+    return entity->AddComponent<SphereCollider>(center, radius);
+  }
+
+  static std::vector<Collider*> AddRandomSpheres(const int count) {
+    std::mt19937 random{3};
+    std::uniform_real_distribution<float> position{-50, 50};
+    std::uniform_real_distribution<float> radius{0.5f, 4};
+    std::vector<Collider*> colliders;
+    for (int i = 0; i < count; ++i) {
+      colliders.push_back(AddSphere(
+          Math::Vector3{position(random), position(random), position(random)},
+          radius(random)));
+    }
+    return colliders;
+  }
+
+  /// From outside the spheres toward somewhere inside their range
+  static Ray RandomRay(std::mt19937* random) {
+    std::uniform_real_distribution<float> position{-50, 50};
+    const Math::Vector3 origin{position(*random), position(*random), -60};
+    const Math::Vector3 target{position(*random), position(*random),
+                               position(*random)};
+    return Ray{origin, target - origin};
+  }
+};
+}  // namespace Isetta
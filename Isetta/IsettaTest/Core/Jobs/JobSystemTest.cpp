@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Core/Jobs/FrameGraph.h"
+#include "Core/Jobs/JobSystem.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// in the engine namespace, JobSystem befriends it to start its workers
+namespace Isetta {
+TEST_CLASS(JobSystemTest) {
+ public:
+  TEST_METHOD(ParallelFor) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(3);
+    std::vector<int> values(10007, 0);
+    JobSystem::ParallelFor(static_cast<int>(values.size()),
+                           [&values](const int begin, const int end) {
+                             for (int i = begin; i < end; ++i) values[i] += i;
+                           },
+                           16);
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+      Assert::AreEqual(i, values[i]);
+    }
+    jobSystem.ShutDown();
+  }
+
+  TEST_METHOD(NestedWait) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(3);
+    std::atomic<int> sum{0};
+    JobCounter counter;
+    for (int i = 0; i < 50; ++i) {
+      JobSystem::Run(
+          [&sum]() {
+            JobCounter inner;
+            for (int j = 0; j < 10; ++j) {
+              JobSystem::Run([&sum]() { ++sum; }, &inner);
+            }
+            JobSystem::Wait(inner);
+          },
+          &counter);
+    }
+    JobSystem::Wait(counter);
+    Assert::IsTrue(counter.IsDone());
+    Assert::AreEqual(500, sum.load());
+    jobSystem.ShutDown();
+  }
+
+  TEST_METHOD(ExceptionsWaitForTheOtherJobs) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(3);
+    // thrown by the calling thread's batch, then by a queued one
+    for (const int thrower : {0, 900}) {
+      std::atomic<int> visited{0};
+      Assert::ExpectException<std::runtime_error>([&visited, thrower]() {
+        JobSystem::ParallelFor(
+            1000, [&visited, thrower](const int begin, const int end) {
+              visited += end - begin;
+              if (begin <= thrower && thrower < end) {
+                throw std::runtime_error{"batch"};
+              }
+            });
+      });
+      // only once every batch is done
+      Assert::AreEqual(1000, visited.load());
+    }
+
+    JobCounter counter;
+    JobSystem::Run([]() { throw std::runtime_error{"job"}; }, &counter);
+    JobSystem::Run([]() {}, &counter);
+    Assert::ExpectException<std::runtime_error>(
+        [&counter]() { JobSystem::Wait(counter); });
+    Assert::IsTrue(counter.IsDone());
+    jobSystem.ShutDown();
+  }
+
+  TEST_METHOD(InlineWithoutWorkers) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(0);
+    int value = 0;
+    JobSystem::Run([&value]() { value = 1; });
+    Assert::AreEqual(1, value);
+    Assert::AreEqual(1, JobSystem::GetThreadCount());
+    jobSystem.ShutDown();
+  }
+
+  TEST_METHOD(FrameGraphOrder) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(3);
+    FrameGraph graph;
+    std::string order;
+    std::mutex mutex;
+    const auto append = [&order, &mutex](const char c) {
+      std::lock_guard<std::mutex> lock{mutex};
+      order += c;
+    };
+    const FrameGraph::NodeId a = graph.AddNode([&]() { append('a'); });
+    const FrameGraph::NodeId b =
+        graph.AddNode([&]() { append('b'); }, {a}, false);
+    const FrameGraph::NodeId c = graph.AddNode([&]() { append('c'); }, {a});
+    graph.AddNode([&]() { append('d'); }, {b, c});
+    for (int frame = 0; frame < 3; ++frame) {
+      order.clear();
+      graph.Execute();
+      Assert::AreEqual(Size{4}, order.size());
+      Assert::AreEqual('a', order.front());
+      Assert::AreEqual('d', order.back());
+    }
+    jobSystem.ShutDown();
+  }
+
+  TEST_METHOD(FrameGraphNodeThrows) {
+    JobSystem jobSystem;
+    jobSystem.StartUp(3);
+    FrameGraph graph;
+    std::atomic<int> ran{0};
+    const FrameGraph::NodeId a = graph.AddNode([&]() { ++ran; });
+    const FrameGraph::NodeId b = graph.AddNode(
+        [&]() {
+          ++ran;
+          throw std::runtime_error{"node"};
+        },
+        {a}, false);
+    graph.AddNode([&]() { ++ran; }, {b});
+    // the rest of the frame still runs
+    Assert::ExpectException<std::runtime_error>(
+        [&graph]() { graph.Execute(); });
+    Assert::AreEqual(3, ran.load());
+    jobSystem.ShutDown();
+  }
+};
+}  // namespace Isetta
@@ -0,0 +1,34 @@
+#include "Core/Math/Matrix4.h"
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Util.h"
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace MathTest {
+namespace {
+bool Near(const float a, const float b) {
+  return Math::Util::Abs(a - b) < 1e-5f;
+}
+}  // namespace
+
+TEST_CLASS(Matrix4Test) {
+ public:
+  TEST_METHOD(AffineInverse) {
+    Math::Matrix4 mat =
+        Math::Matrix4::Translate(Math::Vector3{1.f, 2.f, 3.f}) *
+        Math::Matrix4{Math::Quaternion::FromEulerAngles(
+            Math::Vector3{30.f, 45.f, 60.f})} *
+        Math::Matrix4::Scale(Math::Vector3{2.f, 3.f, 4.f});
+    Math::Matrix4 affine{mat.AffineInverse()};
+    Math::Matrix4 inverse{mat.Inverse()};
+    Math::Matrix4 identity{mat * affine};
+    for (int i = 0; i < Math::Matrix4::ELEMENT_COUNT; ++i) {
+      Assert::IsTrue(Near(affine.data[i], inverse.data[i]));
+      Assert::IsTrue(Near(identity.data[i], Math::Matrix4::identity.data[i]));
+    }
+  }
+};
+}  // namespace MathTest
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Core/Memory/FreeListAllocator.h"
+#include "Core/Time/StopWatch.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace MemoryTest {
+TEST_CLASS(FreeListAllocatorTest) {
+ public:
+  TEST_METHOD(SizeClassReuse) {
+    FreeListAllocator allocator{1_MB, true, false};
+    void* first = allocator.Alloc(40, MemUtil::ALIGNMENT);
+    allocator.Free(first);
+    void* second = allocator.Alloc(48, MemUtil::ALIGNMENT);
+    Assert::IsTrue(first == second);
+    allocator.Free(second);
+  }
+
+  TEST_METHOD(Alignment) {
+    FreeListAllocator allocator{1_MB, true, false};
+    const Size sizes[] = {1, 24, 200, 512, 513, 4096};
+    for (U8 alignment = 8; alignment != 0 && alignment <= 128;
+         alignment <<= 1) {
+      for (Size size : sizes) {
+        void* mem = allocator.Alloc(size, alignment);
+        Assert::IsTrue((reinterpret_cast<PtrInt>(mem) & (alignment - 1)) ==
+                       0);
+        allocator.Free(mem);
+      }
+    }
+  }
+
+  TEST_METHOD(LargeBlocksCoalesce) {
+    FreeListAllocator allocator{1_MB, true, false};
+    void* a = allocator.Alloc(1024, MemUtil::ALIGNMENT);
+    void* b = allocator.Alloc(1024, MemUtil::ALIGNMENT);
+    void* c = allocator.Alloc(1024, MemUtil::ALIGNMENT);
+    allocator.Free(b);
+    allocator.Free(a);
+    allocator.Free(c);
+    void* big = allocator.Alloc(3000, MemUtil::ALIGNMENT);
+    Assert::IsTrue(big == a);
+    allocator.Free(big);
+  }
+
+  TEST_METHOD(Realloc) {
+    FreeListAllocator allocator{1_MB, true, false};
+    auto* small = static_cast<U8*>(allocator.Alloc(32, MemUtil::ALIGNMENT));
+    for (U8 i = 0; i < 32; ++i) small[i] = i;
+    auto* large = static_cast<U8*>(
+        allocator.Realloc(small, 2048, MemUtil::ALIGNMENT));
+    for (int i = 0; i < 32; ++i) {
+      Assert::AreEqual(i, static_cast<int>(large[i]));
+    }
+    auto* shrunk =
+        static_cast<U8*>(allocator.Realloc(large, 16, MemUtil::ALIGNMENT));
+    for (int i = 0; i < 16; ++i) {
+      Assert::AreEqual(i, static_cast<int>(shrunk[i]));
+    }
+    allocator.Free(shrunk);
+  }
+
+  TEST_METHOD(ZeroMemory) {
+    FreeListAllocator allocator{1_MB, true, true};
+    auto* mem = static_cast<U8*>(allocator.Alloc(64, MemUtil::ALIGNMENT));
+    memset(mem, 0xFF, 64);
+    allocator.Free(mem);
+    mem = static_cast<U8*>(allocator.Alloc(64, MemUtil::ALIGNMENT));
+    for (int i = 0; i < 64; ++i) {
+      Assert::AreEqual(0, static_cast<int>(mem[i]));
+    }
+    allocator.Free(mem);
+  }
+
+  TEST_METHOD(CrossThreadFree) {
+    FreeListAllocator allocator{1_MB, true, false};
+    std::vector<void*> allocated(1000, nullptr);
+    std::thread producer{[&]() {
+      for (void*& mem : allocated) {
+        mem = allocator.Alloc(64, MemUtil::ALIGNMENT);
+      }
+    }};
+    producer.join();
+    std::thread consumer{[&]() {
+      for (void* mem : allocated) allocator.Free(mem);
+    }};
+    consumer.join();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i) {
+      workers.emplace_back([&allocator, i]() {
+        std::vector<void*> live;
+        for (int j = 0; j < 10000; ++j) {
+          live.push_back(allocator.Alloc(16 + (i * 37 + j) % 600, 16));
+          if (live.size() > 64) {
+            allocator.Free(live.front());
+            live.erase(live.begin());
+          }
+        }
+        for (void* mem : live) allocator.Free(mem);
+      });
+    }
+    for (auto& worker : workers) worker.join();
+  }
+
+  // Spawns and destroys components of typical sizes in random order, the way
+  // AddComponent/Destroy hit the free list during gameplay. Legacy settings are
+  // first-fit only with zeroing, which is how the allocator used to behave
+  TEST_METHOD(ComponentChurnBenchmark) {
+    const float legacy = RunChurn(false, true);
+    const float sizeClasses = RunChurn(true, false);
+    Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(
+        ("[Benchmark] Component churn, legacy free list: " +
+         std::to_string(legacy) + "s, size classes: " +
+         std::to_string(sizeClasses) + "s\n")
+            .c_str());
+  }
+
+ private:
+  static float RunChurn(const bool useSizeClasses, const bool zeroMemory) {
+    const int liveCount = 4000;
+    const int churnCount = 200000;
+    const Size componentSizes[] = {48, 64, 96, 120, 160, 200, 256, 320, 1024};
+
+    FreeListAllocator allocator{8_MB, useSizeClasses, zeroMemory};
+    std::vector<void*> live(liveCount, nullptr);
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> slotDist{0, liveCount - 1};
+    std::uniform_int_distribution<int> sizeDist{
+        0, sizeof(componentSizes) / sizeof(componentSizes[0]) - 1};
+
+    StopWatch stopWatch;
+    stopWatch.Start();
+    for (int i = 0; i < liveCount; ++i) {
+      live[i] =
+          allocator.Alloc(componentSizes[sizeDist(random)], MemUtil::ALIGNMENT);
+    }
+    for (int i = 0; i < churnCount; ++i) {
+      const int slot = slotDist(random);
+      allocator.Free(live[slot]);
+      live[slot] =
+          allocator.Alloc(componentSizes[sizeDist(random)], MemUtil::ALIGNMENT);
+    }
+    for (void* mem : live) allocator.Free(mem);
+    return stopWatch.EvaluateInSecond();
+  }
+};
+}  // namespace MemoryTest
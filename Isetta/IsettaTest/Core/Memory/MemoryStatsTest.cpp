@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <string>
+#include "Core/Memory/FreeListAllocator.h"
+#include "Core/Memory/MemoryStats.h"
+#include "Core/Memory/StackAllocator.h"
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace MemoryTest {
+TEST_CLASS(MemoryStatsTest) {
+ public:
+  TEST_METHOD(StackAllocatorStats) {
+    StackAllocator allocator{1024};
+    allocator.Alloc(100, MemUtil::ALIGNMENT);
+    allocator.Alloc(200, MemUtil::ALIGNMENT);
+    allocator.Clear();
+    allocator.Alloc(50, MemUtil::ALIGNMENT);
+
+    AllocatorStats stats = allocator.GetStats();
+    Assert::IsTrue(stats.capacity == 1024);
+    Assert::IsTrue(stats.bytesInUse >= 50);
+    Assert::IsTrue(stats.peakBytes >= 300);
+    Assert::IsTrue(stats.totalAllocs == 3);
+  }
+
+  TEST_METHOD(FreeListStats) {
+    FreeListAllocator allocator{1_MB, true, false};
+    void* small = allocator.Alloc(64, MemUtil::ALIGNMENT);
+    void* large = allocator.Alloc(4096, MemUtil::ALIGNMENT);
+
+    AllocatorStats stats = allocator.GetStats();
+    Assert::IsTrue(stats.capacity == 1_MB);
+    Assert::IsTrue(stats.bytesInUse >= 64 + 4096);
+    Assert::IsTrue(stats.totalAllocs == 2);
+    Assert::IsTrue(stats.expandCount == 0);
+
+    // freeing the first large block leaves a hole before the second one
+    void* pinned = allocator.Alloc(4096, MemUtil::ALIGNMENT);
+    allocator.Free(large);
+    stats = allocator.GetStats();
+    Assert::IsTrue(stats.fragmentation > 0.f && stats.fragmentation < 1.f);
+
+    allocator.Free(pinned);
+    allocator.Free(small);
+    stats = allocator.GetStats();
+    Assert::IsTrue(stats.bytesInUse == 0);
+    Assert::IsTrue(stats.fragmentation == 0.f);
+  }
+
+  TEST_METHOD(RingBufferWrapsAround) {
+    MemoryStats timeline{4};
+    for (U64 frame = 0; frame < 10; ++frame) {
+      MemoryStats::FrameSample sample;
+      sample.frame = frame;
+      AllocatorStats& stats = sample[MemoryStats::Allocator::FreeList];
+      stats.totalAllocs = frame * 3;
+      stats.bytesInUse = frame == 5 ? 1000 : 10;
+      timeline.Record(sample);
+    }
+
+    Assert::IsTrue(timeline.GetSampleCount() == 4);
+    Assert::IsTrue(timeline.GetSample(0).frame == 6);
+    Assert::IsTrue(timeline.GetLatest().frame == 9);
+
+    const AllocatorStats& latest =
+        timeline.GetLatest()[MemoryStats::Allocator::FreeList];
+    Assert::IsTrue(latest.frameAllocs == 3);
+    Assert::IsTrue(latest.peakBytes == 1000);
+  }
+
+  TEST_METHOD(Export) {
+    MemoryStats timeline{8};
+    MemoryStats::FrameSample sample;
+    timeline.Record(sample);
+    sample.frame = 1;
+    timeline.Record(sample);
+
+    std::string csv = timeline.ToCSV();
+    Size lines = 0;
+    for (char c : csv) lines += c == '\n';
+    Assert::IsTrue(lines == 1 + 2 * MemoryStats::allocatorCount);
+    Assert::IsTrue(csv.find("free_list") != std::string::npos);
+
+    std::string json = timeline.ToJSON();
+    Assert::IsTrue(json.front() == '[');
+    Assert::IsTrue(json.find("\"frame\": 1") != std::string::npos);
+  }
+};
+}  // namespace MemoryTest
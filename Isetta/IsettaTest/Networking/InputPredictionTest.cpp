@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+#include "Networking/InputPrediction.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace {
+const float tickTime = 1.f / 60;
+
+/// Moves at 3 units a second along the input
+PredictedState Move(const PredictedState& state, const InputCommand& command,
+                    const float deltaTime) {
+  PredictedState moved = state;
+  moved.localPos += command.move * 3 * deltaTime;
+  return moved;
+}
+
+InputCommand MakeCommand(const float x) {
+  InputCommand command;
+  command.move = Math::Vector3{x, 0, 0};
+  return command;
+}
+
+bool Near(const Math::Vector3& a, const Math::Vector3& b) {
+  return (a - b).Magnitude() < 1e-4f;
+}
+}  // namespace
+
+namespace NetworkingTest {
+TEST_CLASS(InputPredictionTest) {
+ public:
+  TEST_METHOD(PredictsRightAway) {
+    InputPrediction prediction;
+    prediction.Reset(PredictedState{});
+    const InputCommand first = prediction.Predict(MakeCommand(1), Move, 1);
+    const InputCommand second = prediction.Predict(MakeCommand(1), Move, 1);
+
+    Assert::AreEqual(0, static_cast<int>(first.sequence));
+    Assert::AreEqual(1, static_cast<int>(second.sequence));
+    Assert::IsTrue(Near(prediction.GetState().localPos,
+                        Math::Vector3{6, 0, 0}));
+    Assert::AreEqual(2, prediction.GetUnacknowledgedCount());
+  }
+
+  TEST_METHOD(MatchingAckOnlyDropsCommands) {
+    InputPrediction prediction;
+    prediction.Reset(PredictedState{});
+    for (int i = 0; i < 3; ++i) prediction.Predict(MakeCommand(1), Move, 1);
+
+    PredictedState server;
+    server.localPos = Math::Vector3{3, 0, 0};
+    Assert::IsFalse(prediction.Reconcile(0, server, Move, 1));
+    Assert::AreEqual(2, prediction.GetUnacknowledgedCount());
+    Assert::IsTrue(Near(prediction.GetState().localPos,
+                        Math::Vector3{9, 0, 0}));
+
+    InputCommand commands[8];
+    Assert::AreEqual(2, prediction.GetUnacknowledged(commands, 8));
+    Assert::AreEqual(1, static_cast<int>(commands[0].sequence));
+    Assert::AreEqual(1, prediction.GetUnacknowledged(commands, 1));
+    Assert::AreEqual(2, static_cast<int>(commands[0].sequence));
+  }
+
+  TEST_METHOD(MismatchReplaysFromServer) {
+    InputPrediction prediction;
+    prediction.Reset(PredictedState{});
+    for (int i = 0; i < 3; ++i) prediction.Predict(MakeCommand(1), Move, 1);
+
+    // something pushed the entity on the server
+    PredictedState server;
+    server.localPos = Math::Vector3{3, 5, 0};
+    Assert::IsTrue(prediction.Reconcile(0, server, Move, 1));
+    Assert::IsTrue(Near(prediction.GetState().localPos,
+                        Math::Vector3{9, 5, 0}));
+
+    // an older ack arriving late changes nothing
+    Assert::IsFalse(prediction.Reconcile(0, PredictedState{}, Move, 1));
+    Assert::IsTrue(Near(prediction.GetState().localPos,
+                        Math::Vector3{9, 5, 0}));
+  }
+
+  TEST_METHOD(QueueRunsEachCommandOnceInOrder) {
+    InputQueue queue;
+    std::vector<int> ran;
+    const auto run = [&ran](const InputCommand& command) {
+      ran.push_back(command.sequence);
+    };
+
+    InputCommand commands[3];
+    commands[0].sequence = 2;
+    commands[1].sequence = 0;
+    commands[2].sequence = 1;
+    queue.Receive(commands, 3);
+    queue.Receive(commands, 3);
+    for (int i = 0; i < 3; ++i) queue.Tick(run);
+    // already run
+    queue.Receive(commands, 3);
+    queue.Tick(run);
+
+    Assert::AreEqual(3, static_cast<int>(ran.size()));
+    for (int i = 0; i < 3; ++i) Assert::AreEqual(i, ran[i]);
+    Assert::AreEqual(2, static_cast<int>(queue.GetLastProcessed()));
+  }
+
+  TEST_METHOD(QueueLimitsCommandsPerTick) {
+    InputQueue queue;
+    InputCommand commands[InputQueue::maxPending];
+    for (int i = 0; i < InputQueue::maxPending; ++i) {
+      commands[i].sequence = static_cast<U16>(i);
+    }
+    queue.Receive(commands, InputQueue::maxPending);
+
+    // a client sending too many commands doesn't get to run them all at once
+    int ran = 0;
+    const auto run = [&ran](const InputCommand&) { ++ran; };
+    for (int i = 0; i < 10; ++i) queue.Tick(run);
+    Assert::AreEqual(10, ran);
+
+    // while one that fell behind catches up by a few
+    InputQueue idle;
+    for (int i = 0; i < 10; ++i) idle.Tick(run);
+    idle.Receive(commands, InputQueue::maxPending);
+    ran = 0;
+    idle.Tick(run);
+    Assert::AreEqual(static_cast<int>(InputQueue::maxBurst), ran);
+  }
+
+  TEST_METHOD(QueueDropsNonFiniteInput) {
+    InputQueue queue;
+    InputCommand commands[4];
+    for (int i = 0; i < 4; ++i) {
+      commands[i] = MakeCommand(1);
+      commands[i].sequence = static_cast<U16>(i);
+    }
+    commands[1].move.x = std::numeric_limits<float>::quiet_NaN();
+    commands[2].move.y = std::numeric_limits<float>::infinity();
+    queue.Receive(commands, 4);
+    Assert::AreEqual(2, queue.GetPendingCount());
+
+    PredictedState state;
+    for (int i = 0; i < 2; ++i) {
+      queue.Tick([&state](const InputCommand& command) {
+        state = Move(state, command, 1);
+      });
+    }
+    Assert::IsTrue(Near(state.localPos, Math::Vector3{6, 0, 0}));
+    Assert::AreEqual(3, static_cast<int>(queue.GetLastProcessed()));
+  }
+
+  TEST_METHOD(LoopbackConvergesToServer) {
+    // 3 fixed updates of latency each way, and a tenth of the messages lost
+    // until the last few commands
+    const int latency = 3;
+    std::mt19937 random{2018};
+    std::uniform_real_distribution<float> loss{0, 1};
+
+    struct Ack {
+      U16 sequence;
+      PredictedState state;
+    };
+    std::deque<std::pair<int, std::vector<InputCommand>>> toServer;
+    std::deque<std::pair<int, Ack>> toClient;
+
+    InputPrediction client;
+    client.Reset(PredictedState{});
+    InputQueue queue;
+    PredictedState server;
+    int replays = 0;
+    int replaysBeforePush = 0;
+
+    const auto lost = [&random, &loss](const int tick) {
+      return tick < 180 && loss(random) < 0.1f;
+    };
+    for (int tick = 0; tick < 300; ++tick) {
+      if (tick < 200) {
+        const float x = tick % 60 < 30 ? 1.f : -0.5f;
+        client.Predict(MakeCommand(x), Move, tickTime);
+        InputCommand commands[8];
+        const int count = client.GetUnacknowledged(commands, 8);
+        if (!lost(tick)) {
+          toServer.emplace_back(
+              tick + latency,
+              std::vector<InputCommand>{commands, commands + count});
+        }
+      }
+
+      while (!toServer.empty() && toServer.front().first <= tick) {
+        const std::vector<InputCommand>& commands = toServer.front().second;
+        queue.Receive(commands.data(), static_cast<int>(commands.size()));
+        toServer.pop_front();
+      }
+      // the server knocks the entity back once
+      if (tick == 100) server.localPos.y += 1;
+      const int ran = queue.Tick([&server](const InputCommand& command) {
+        server = Move(server, command, tickTime);
+      });
+      if (ran > 0 && !lost(tick)) {
+        toClient.emplace_back(tick + latency,
+                              Ack{queue.GetLastProcessed(), server});
+      }
+
+      while (!toClient.empty() && toClient.front().first <= tick) {
+        const Ack& ack = toClient.front().second;
+        if (client.Reconcile(ack.sequence, ack.state, Move, tickTime)) {
+          ++replays;
+          if (tick < 100) ++replaysBeforePush;
+        }
+        toClient.pop_front();
+      }
+    }
+
+    // the prediction was right until the server did something it couldn't
+    // know about, then it caught up and agrees with the server
+    Assert::AreEqual(0, replaysBeforePush);
+    Assert::IsTrue(replays > 0);
+    Assert::AreEqual(0, client.GetUnacknowledgedCount());
+    Assert::IsTrue(Near(client.GetState().localPos, server.localPos));
+  }
+};
+}  // namespace NetworkingTest
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <vector>
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+#include "Networking/InterestManagement.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace NetworkingTest {
+TEST_CLASS(InterestManagementTest) {
+ public:
+  TEST_METHOD(RelevantWithinRadius) {
+    InterestManagement interest;
+    interest.Configure(10, 0);
+    interest.Begin(1);
+    interest.AddEntity(1, Math::Vector3{0, 0, 0});
+    interest.AddEntity(2, Math::Vector3{9, 0, 0});
+    interest.AddEntity(3, Math::Vector3{-7, 7, 0});
+    interest.AddEntity(4, Math::Vector3{11, 0, 0});
+    interest.AddEntity(5, Math::Vector3{100, 0, 0});
+    interest.UpdateClient(0, {Math::Vector3{0, 0, 0}});
+
+    Assert::IsTrue(interest.IsRelevant(0, 1));
+    Assert::IsTrue(interest.IsRelevant(0, 2));
+    Assert::IsTrue(interest.IsRelevant(0, 3));
+    Assert::IsFalse(interest.IsRelevant(0, 4));
+    Assert::IsFalse(interest.IsRelevant(0, 5));
+  }
+
+  TEST_METHOD(EverythingWithoutFocusOrRadius) {
+    InterestManagement interest;
+    interest.Configure(10, 0);
+    interest.Begin(1);
+    interest.AddEntity(1, Math::Vector3{100, 0, 0});
+    interest.UpdateClient(0, {});
+    Assert::IsTrue(interest.IsRelevant(0, 1));
+
+    interest.Configure(0, 0);
+    interest.Begin(1);
+    interest.AddEntity(1, Math::Vector3{100, 0, 0});
+    interest.UpdateClient(0, {Math::Vector3::zero});
+    Assert::IsTrue(interest.IsRelevant(0, 1));
+  }
+
+  TEST_METHOD(IrrelevantPriorityAccumulates) {
+    InterestManagement interest;
+    interest.Configure(10, 0.25f);
+    interest.Begin(1);
+    interest.AddEntity(1, Math::Vector3{100, 0, 0});
+    interest.UpdateClient(0, {Math::Vector3::zero});
+
+    // due until the client acknowledges an update
+    std::vector<bool> sent;
+    for (int i = 0; i < 6; ++i) sent.push_back(interest.ShouldSend(0, 1));
+    interest.Acknowledge(0, 1);
+    for (int i = 0; i < 4; ++i) sent.push_back(interest.ShouldSend(0, 1));
+    const std::vector<bool> expected{false, false, false, true,  true,
+                                     true,  false, false, false, true};
+    Assert::IsTrue(sent == expected);
+  }
+
+  TEST_METHOD(IrrelevantDroppedWithoutPriority) {
+    InterestManagement interest;
+    interest.Configure(10, 0);
+    interest.Begin(1);
+    interest.AddEntity(1, Math::Vector3{100, 0, 0});
+    interest.UpdateClient(0, {Math::Vector3::zero});
+    for (int i = 0; i < 100; ++i) {
+      Assert::IsFalse(interest.ShouldSend(0, 1));
+    }
+  }
+};
+}  // namespace NetworkingTest
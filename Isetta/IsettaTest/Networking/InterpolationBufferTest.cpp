@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Util.h"
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+#include "Networking/InterpolationBuffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace {
+const float speed = 5;
+const float snapshotPeriod = 0.05f;
+const float framePeriod = 1.f / 60;
+const float latency = 0.1f;
+
+InterpolationBuffer::State MakeState(const float time, const float x) {
+  InterpolationBuffer::State state;
+  state.time = time;
+  state.localPos = Math::Vector3{x, 0, 0};
+  return state;
+}
+
+/**
+ * @brief Server moving an entity along x at a constant speed, sending its
+ * position every snapshot period over a link with the given jitter and loss,
+ * and a client showing it at 60 frames per second. Nothing is sent after
+ * stopTime. Returns where the client showed the entity each frame.
+ */
+std::vector<float> SimulateLoopback(const float jitter, const float lossRate,
+                                    const float duration,
+                                    const float stopTime) {
+  struct Packet {
+    float arrival;
+    float serverTime;
+  };
+  std::mt19937 random{2018};
+  std::uniform_real_distribution<float> jitterDistribution{-jitter, jitter};
+  std::uniform_real_distribution<float> lossDistribution{0, 1};
+
+  std::vector<Packet> packets;
+  for (float time = 0; time < Math::Util::Min(duration, stopTime);
+       time += snapshotPeriod) {
+    const float delay = latency + jitterDistribution(random);
+    if (lossDistribution(random) < lossRate) continue;
+    packets.push_back(Packet{time + delay, time});
+  }
+  std::sort(packets.begin(), packets.end(),
+            [](const Packet& a, const Packet& b) {
+              return a.arrival < b.arrival;
+            });
+
+  // the client started a while after the server
+  const float clientStart = 7;
+  InterpolationClock clock;
+  clock.Configure(0.1f, 3);
+  InterpolationBuffer buffer;
+  std::vector<float> shown;
+  auto next = packets.begin();
+  for (float time = 0; time < duration; time += framePeriod) {
+    for (; next != packets.end() && next->arrival <= time; ++next) {
+      clock.Receive(next->serverTime, next->arrival - clientStart);
+      buffer.Push(MakeState(next->serverTime, next->serverTime * speed));
+    }
+    InterpolationBuffer::State state;
+    if (!buffer.Sample(clock.GetRenderTime(time - clientStart), 0.25f,
+                       &state)) {
+      continue;
+    }
+    shown.push_back(state.localPos.x);
+  }
+  return shown;
+}
+}  // namespace
+
+namespace NetworkingTest {
+TEST_CLASS(InterpolationBufferTest) {
+ public:
+  TEST_METHOD(InterpolatesBetweenStates) {
+    InterpolationBuffer buffer;
+    InterpolationBuffer::State first = MakeState(1, 0);
+    InterpolationBuffer::State second = MakeState(2, 10);
+    second.localRot = Math::Quaternion::FromEulerAngles(0, 90, 0);
+    // out of order, and a repeat that is ignored
+    buffer.Push(second);
+    buffer.Push(first);
+    buffer.Push(MakeState(2, 100));
+
+    InterpolationBuffer::State state;
+    Assert::IsTrue(buffer.Sample(1.25f, 0, &state));
+    Assert::IsTrue(Math::Util::Abs(state.localPos.x - 2.5f) < 1e-4f);
+    const Math::Quaternion expected =
+        Math::Quaternion::FromEulerAngles(0, 22.5f, 0);
+    Assert::IsTrue(
+        Math::Util::Abs(Math::Quaternion::AngleDeg(state.localRot, expected)) <
+        0.1f);
+
+    Assert::IsTrue(buffer.Sample(0, 0, &state));
+    Assert::AreEqual(0.f, state.localPos.x);
+  }
+
+  TEST_METHOD(ExtrapolationBounded) {
+    InterpolationBuffer buffer;
+    InterpolationBuffer::State state;
+    Assert::IsFalse(buffer.Sample(0, 0.25f, &state));
+
+    buffer.Push(MakeState(0, 0));
+    buffer.Push(MakeState(1, 10));
+    Assert::IsTrue(buffer.Sample(1.1f, 0.25f, &state));
+    Assert::IsTrue(Math::Util::Abs(state.localPos.x - 11) < 1e-3f);
+    Assert::IsTrue(buffer.Sample(5, 0.25f, &state));
+    Assert::IsTrue(Math::Util::Abs(state.localPos.x - 12.5f) < 1e-3f);
+  }
+
+  TEST_METHOD(KeepsNewestStates) {
+    InterpolationBuffer buffer;
+    for (int i = 0; i < 2 * InterpolationBuffer::maxStates; ++i) {
+      buffer.Push(MakeState(static_cast<float>(i), static_cast<float>(i)));
+    }
+    // too old to fit
+    buffer.Push(MakeState(0.5f, 100));
+
+    InterpolationBuffer::State state;
+    buffer.Sample(0, 0, &state);
+    Assert::AreEqual(
+        static_cast<float>(InterpolationBuffer::maxStates), state.localPos.x);
+  }
+
+  TEST_METHOD(DelayAdaptsToJitter) {
+    InterpolationClock steady;
+    InterpolationClock jittery;
+    steady.Configure(0.1f, 3);
+    jittery.Configure(0.1f, 3);
+    std::mt19937 random{2018};
+    std::uniform_real_distribution<float> jitter{-0.03f, 0.03f};
+    for (int i = 0; i < 200; ++i) {
+      const float serverTime = i * snapshotPeriod;
+      steady.Receive(serverTime, serverTime + latency);
+      jittery.Receive(serverTime, serverTime + latency + jitter(random));
+    }
+
+    Assert::IsTrue(Math::Util::Abs(steady.GetDelay() - 0.1f) < 1e-4f);
+    Assert::IsTrue(jittery.GetJitter() > 0.01f);
+    Assert::IsTrue(jittery.GetDelay() > steady.GetDelay() + 0.03f);
+    // the server's time is found despite the latency
+    Assert::IsTrue(Math::Util::Abs(steady.GetServerTime(10 + latency) - 10) <
+                   1e-3f);
+  }
+
+  TEST_METHOD(SmoothUnderJitterAndLoss) {
+    const std::vector<float> shown = SimulateLoopback(0.03f, 0.05f, 10, 10);
+    // once the clock settled, every frame moves forward by about a frame of
+    // motion, even though snapshots arrive late, early and not at all
+    const float expectedStep = speed * framePeriod;
+    float worstError = 0;
+    for (int i = 2 * 60; i < static_cast<int>(shown.size()); ++i) {
+      const float step = shown[i] - shown[i - 1];
+      Assert::IsTrue(step >= 0);
+      worstError = Math::Util::Max(worstError,
+                                   Math::Util::Abs(step - expectedStep));
+    }
+    Logger::WriteMessage(
+        ("worst step error " + std::to_string(worstError)).c_str());
+    Assert::IsTrue(worstError < 0.25f * expectedStep);
+  }
+
+  TEST_METHOD(ExtrapolatesBrieflyWhenSnapshotsStop) {
+    const float stopTime = 5;
+    const std::vector<float> shown =
+        SimulateLoopback(0.03f, 0, 8, stopTime);
+    // keeps going for at most the extrapolation window, then holds
+    Assert::IsTrue(shown.back() > speed * stopTime);
+    Assert::IsTrue(shown.back() <= speed * (stopTime + 0.25f) + 1e-3f);
+    Assert::AreEqual(shown[shown.size() - 2], shown.back());
+  }
+};
+}  // namespace NetworkingTest
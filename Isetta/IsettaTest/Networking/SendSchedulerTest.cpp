@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <vector>
+#include "CppUnitTest.h"
+#include "Networking/SendScheduler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace NetworkingTest {
+TEST_CLASS(SendSchedulerTest) {
+ public:
+  TEST_METHOD(ControlBeforeState) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{16, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    scheduler.Push(Fake(0), stateType, 10, State(1));
+    scheduler.Push(Fake(1), controlType, 10, Control());
+    scheduler.Push(Fake(2), controlType, 10, Control());
+
+    std::vector<yojimbo::Message*> sent = SendAll(&scheduler, 0);
+    Assert::AreEqual(Size{3}, sent.size());
+    Assert::IsTrue(sent[0] == Fake(1));
+    Assert::IsTrue(sent[1] == Fake(2));
+    Assert::IsTrue(sent[2] == Fake(0));
+    Assert::IsTrue(released.empty());
+  }
+
+  TEST_METHOD(CoalesceSameKey) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{16, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    scheduler.Push(Fake(0), stateType, 10, State(1));
+    scheduler.Push(Fake(1), stateType, 10, State(2));
+    scheduler.Push(Fake(2), stateType, 10, State(1));
+
+    Assert::AreEqual(2, scheduler.GetStats().queueDepth);
+    Assert::AreEqual(U64{1}, scheduler.GetStats().coalesced);
+    Assert::AreEqual(Size{1}, released.size());
+    Assert::IsTrue(released[0] == Fake(0));
+
+    // the replacement keeps the place of the one it replaced
+    std::vector<yojimbo::Message*> sent = SendAll(&scheduler, 0);
+    Assert::AreEqual(Size{2}, sent.size());
+    Assert::IsTrue(sent[0] == Fake(2));
+    Assert::IsTrue(sent[1] == Fake(1));
+  }
+
+  TEST_METHOD(BudgetDefersStaleFirst) {
+    SendScheduler scheduler{16, [](yojimbo::Message*) {}};
+    scheduler.Push(Fake(0), stateType, 60, State(1));
+    scheduler.Push(Fake(1), stateType, 60, State(2));
+    std::vector<yojimbo::Message*> sent = SendAll(&scheduler, 100);
+    Assert::AreEqual(Size{1}, sent.size());
+    Assert::IsTrue(sent[0] == Fake(0));
+    Assert::AreEqual(60, scheduler.GetStats().lastSentBytes);
+    Assert::AreEqual(1, scheduler.GetStats().queueDepth);
+
+    // the deferred one waited longer than a new one
+    scheduler.Push(Fake(2), stateType, 60, State(3));
+    sent = SendAll(&scheduler, 100);
+    Assert::AreEqual(Size{1}, sent.size());
+    Assert::IsTrue(sent[0] == Fake(1));
+
+    // unless the new one is important enough
+    SendScheduler::MessageInfo important = State(4);
+    important.importance = 4;
+    scheduler.Push(Fake(3), stateType, 60, important);
+    sent = SendAll(&scheduler, 100);
+    Assert::AreEqual(Size{1}, sent.size());
+    Assert::IsTrue(sent[0] == Fake(3));
+  }
+
+  TEST_METHOD(DropLeastUrgentWhenFull) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{2, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    scheduler.Push(Fake(0), controlType, 10, Control());
+    scheduler.Push(Fake(1), stateType, 10, State(1));
+    scheduler.Push(Fake(2), controlType, 10, Control());
+
+    Assert::AreEqual(U64{1}, scheduler.GetStats().dropped);
+    Assert::AreEqual(Size{1}, released.size());
+    Assert::IsTrue(released[0] == Fake(1));
+
+    scheduler.Clear();
+    Assert::AreEqual(Size{3}, released.size());
+    Assert::AreEqual(0, scheduler.GetStats().queueDepth);
+  }
+
+  TEST_METHOD(StateMarkedControlIsNeverDropped) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{2, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    // like a snap, a one-off that the state messages of its type don't cover
+    SendScheduler::MessageInfo info = State(1);
+    info.isControl = [](const yojimbo::Message* message) {
+      return message == Fake(1);
+    };
+    scheduler.Push(Fake(0), stateType, 10, info);
+    scheduler.Push(Fake(1), stateType, 10, info);
+    scheduler.Push(Fake(2), stateType, 10, info);
+    scheduler.Push(Fake(3), controlType, 10, Control());
+    // the later state replaced the first one instead of it, and the full
+    // queue dropped that state instead of it
+    Assert::AreEqual(U64{1}, scheduler.GetStats().coalesced);
+    Assert::AreEqual(Size{2}, released.size());
+    Assert::IsTrue(released[0] == Fake(0));
+    Assert::IsTrue(released[1] == Fake(2));
+
+    std::vector<SendScheduler::Priority> priorities;
+    scheduler.Send(0, [](SendScheduler::Priority) { return true; },
+                   [&priorities](yojimbo::Message*,
+                                 const SendScheduler::Priority priority) {
+                     priorities.push_back(priority);
+                   });
+    Assert::AreEqual(Size{2}, priorities.size());
+    Assert::IsTrue(priorities[0] == SendScheduler::Priority::CONTROL);
+    Assert::IsTrue(priorities[1] == SendScheduler::Priority::CONTROL);
+  }
+
+  TEST_METHOD(DropIncomingWhenLeastUrgent) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{2, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    scheduler.Push(Fake(0), stateType, 10, State(1));
+    scheduler.Push(Fake(1), stateType, 10, State(2));
+    SendScheduler::MessageInfo important = State(3);
+    important.importance = 4;
+    scheduler.Push(Fake(2), stateType, 10, important);
+    Assert::AreEqual(Size{1}, released.size());
+    Assert::IsTrue(released[0] == Fake(0));
+
+    // waited no longer than the queued ones and isn't more important
+    scheduler.Push(Fake(3), stateType, 10, State(4));
+    Assert::AreEqual(Size{2}, released.size());
+    Assert::IsTrue(released[1] == Fake(3));
+    Assert::AreEqual(U64{2}, scheduler.GetStats().dropped);
+    Assert::AreEqual(2, scheduler.GetStats().queueDepth);
+  }
+
+  TEST_METHOD(ControlNeverDropped) {
+    std::vector<yojimbo::Message*> released;
+    SendScheduler scheduler{2, [&released](yojimbo::Message* message) {
+                              released.push_back(message);
+                            }};
+    scheduler.Push(Fake(0), controlType, 10, Control());
+    scheduler.Push(Fake(1), controlType, 10, Control());
+    scheduler.Push(Fake(2), stateType, 10, State(1));
+    scheduler.Push(Fake(3), controlType, 10, Control());
+    Assert::AreEqual(Size{1}, released.size());
+    Assert::IsTrue(released[0] == Fake(2));
+    Assert::AreEqual(3, scheduler.GetStats().queueDepth);
+
+    std::vector<yojimbo::Message*> sent = SendAll(&scheduler, 0);
+    const std::vector<yojimbo::Message*> expected{Fake(0), Fake(1), Fake(3)};
+    Assert::IsTrue(sent == expected);
+  }
+
+ private:
+  static const int controlType = 0;
+  static const int stateType = 1;
+
+  /// The scheduler never looks inside messages, any address will do
+  static yojimbo::Message* Fake(const int index) {
+    static char messages[8];
+    return reinterpret_cast<yojimbo::Message*>(&messages[index]);
+  }
+
+  static SendScheduler::MessageInfo Control() {
+    return SendScheduler::MessageInfo{};
+  }
+
+  static SendScheduler::MessageInfo State(const U64 key) {
+    SendScheduler::MessageInfo info;
+    info.priority = SendScheduler::Priority::STATE;
+    info.coalesceKey = [key](const yojimbo::Message*) { return key; };
+    return info;
+  }
+
+  static std::vector<yojimbo::Message*> SendAll(SendScheduler* scheduler,
+                                                const int budget) {
+    std::vector<yojimbo::Message*> sent;
+    scheduler->Send(budget, [](SendScheduler::Priority) { return true; },
+                    [&sent](yojimbo::Message* message,
+                            SendScheduler::Priority) {
+                      sent.push_back(message);
+                    });
+    return sent;
+  }
+};
+}  // namespace NetworkingTest
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+#include "Networking/SnapshotReplication.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace {
+using Transforms = std::vector<ReplicatedTransform>;
+
+ReplicatedTransform MakeTransform(const U32 netId, const float x) {
+  ReplicatedTransform transform;
+  transform.netId = netId;
+  transform.fields = ReplicatedTransform::ALL;
+  transform.localPos = Math::Vector3{x, 0, 0};
+  transform.localRot = Math::Quaternion::FromEulerAngles(0, x, 0);
+  transform.localScale = Math::Vector3::one;
+  return transform;
+}
+
+bool Same(const ReplicatedTransform& a, const ReplicatedTransform& b) {
+  if (a.netId != b.netId || a.fields != b.fields) return false;
+  if ((a.fields & ReplicatedTransform::POSITION) && a.localPos != b.localPos) {
+    return false;
+  }
+  if ((a.fields & ReplicatedTransform::ROTATION) && a.localRot != b.localRot) {
+    return false;
+  }
+  return !(a.fields & ReplicatedTransform::SCALE) ||
+         a.localScale == b.localScale;
+}
+
+bool Same(const Transforms& a, const Transforms& b) {
+  if (a.size() != b.size()) return false;
+  for (Size i = 0; i < a.size(); ++i) {
+    if (!Same(a[i], b[i])) return false;
+  }
+  return true;
+}
+
+/// What the receiver ends up with after decoding the delta from baseline to
+/// current, checked against what the sender thinks it has
+Transforms RoundTrip(const Transforms& baseline, const Transforms& current,
+                     const int maxEntries, Transforms* delta) {
+  Transforms view, state;
+  SnapshotReplication::EncodeDelta(baseline, current, maxEntries, delta,
+                                   &view);
+  SnapshotReplication::DecodeDelta(baseline, delta->data(),
+                                   static_cast<int>(delta->size()), &state);
+  Assert::IsTrue(Same(view, state));
+  return state;
+}
+
+/// Bytes the snapshot takes on the wire
+int MeasureSnapshot(const Transforms& delta, const bool hasBaseline) {
+  // yojimbo messages are only ever released, never destroyed
+  alignas(SnapshotMessage) static char memory[sizeof(SnapshotMessage)];
+  SnapshotMessage* message = SnapshotMessage::Create(memory);
+  message->hasBaseline = hasBaseline;
+  message->entryCount = static_cast<int>(delta.size());
+  std::copy(delta.begin(), delta.end(), message->entries);
+  // the same way the networking module measures what it queues
+  yojimbo::Message* const base = message;
+  yojimbo::MeasureStream stream{yojimbo::GetDefaultAllocator()};
+  base->SerializeInternal(stream);
+  return stream.GetBytesProcessed();
+}
+}  // namespace
+
+namespace NetworkingTest {
+TEST_CLASS(SnapshotReplicationTest) {
+ public:
+  TEST_METHOD(NoBaselineSendsEverything) {
+    const Transforms current{MakeTransform(1, 1), MakeTransform(4, 2),
+                             MakeTransform(9, 3)};
+    Transforms delta;
+    Assert::IsTrue(Same(RoundTrip({}, current, 64, &delta), current));
+    Assert::AreEqual(3, static_cast<int>(delta.size()));
+  }
+
+  TEST_METHOD(DeltaHoldsOnlyChanges) {
+    const Transforms baseline{MakeTransform(1, 1), MakeTransform(4, 2),
+                              MakeTransform(9, 3)};
+    Transforms current = baseline;
+    current[1].localPos.y = 5;
+
+    Transforms delta;
+    Assert::IsTrue(Same(RoundTrip(baseline, current, 64, &delta), current));
+    Assert::AreEqual(1, static_cast<int>(delta.size()));
+    Assert::AreEqual(4, static_cast<int>(delta[0].netId));
+    Assert::AreEqual(static_cast<int>(ReplicatedTransform::POSITION),
+                     static_cast<int>(delta[0].fields));
+
+    Assert::IsTrue(Same(RoundTrip(baseline, baseline, 64, &delta), baseline));
+    Assert::IsTrue(delta.empty());
+  }
+
+  TEST_METHOD(AddedAndRemovedEntities) {
+    const Transforms baseline{MakeTransform(1, 1), MakeTransform(4, 2),
+                              MakeTransform(9, 3)};
+    // 1 and 9 are gone, 2 and 12 are new
+    const Transforms current{MakeTransform(2, 4), MakeTransform(4, 2),
+                             MakeTransform(12, 5)};
+    Transforms delta;
+    Assert::IsTrue(Same(RoundTrip(baseline, current, 64, &delta), current));
+    Assert::AreEqual(4, static_cast<int>(delta.size()));
+
+    Assert::IsTrue(RoundTrip(baseline, {}, 64, &delta).empty());
+    for (const ReplicatedTransform& entry : delta) {
+      Assert::AreEqual(0, static_cast<int>(entry.fields));
+    }
+  }
+
+  TEST_METHOD(TruncatedDeltasCatchUp) {
+    Transforms baseline;
+    Transforms current;
+    for (U32 i = 0; i < 10; ++i) {
+      baseline.push_back(MakeTransform(2 * i, 0));
+      current.push_back(MakeTransform(2 * i + 1, 1));
+    }
+
+    // each delta is cut at 3 entries, the receiver keeps a consistent state
+    // and gets there in the end
+    Transforms delta;
+    int snapshots = 0;
+    do {
+      baseline = RoundTrip(baseline, current, 3, &delta);
+      Assert::IsTrue(static_cast<int>(delta.size()) <= 3);
+      ++snapshots;
+    } while (!delta.empty() && snapshots < 20);
+    Assert::IsTrue(Same(baseline, current));
+    // 10 removed and 10 added, then the empty one
+    Assert::AreEqual(8, snapshots);
+  }
+
+  TEST_METHOD(BytesPerSnapshot) {
+    Transforms baseline;
+    for (U32 i = 0; i < SnapshotMessage::maxEntries; ++i) {
+      baseline.push_back(MakeTransform(i, static_cast<float>(i)));
+    }
+    Transforms delta;
+    RoundTrip({}, baseline, SnapshotMessage::maxEntries, &delta);
+    const int full = MeasureSnapshot(delta, false);
+
+    // a quarter of the entities moved
+    Transforms current = baseline;
+    for (Size i = 0; i < current.size(); i += 4) current[i].localPos.z = 1;
+    RoundTrip(baseline, current, SnapshotMessage::maxEntries, &delta);
+    const int moved = MeasureSnapshot(delta, true);
+
+    // Isetta has a Logger too
+    Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(
+        ("Snapshot bytes for " + std::to_string(baseline.size()) +
+         " entities: full " + std::to_string(full) + ", a quarter moved " +
+         std::to_string(moved) + "\n")
+            .c_str());
+    Assert::IsTrue(moved < full / 2);
+  }
+};
+}  // namespace NetworkingTest
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <cmath>
+#include <random>
+#include <string>
+#include "Core/Math/Quaternion.h"
+#include "Core/Math/Util.h"
+#include "Core/Math/Vector3.h"
+#include "CppUnitTest.h"
+#include "Networking/TransformQuantization.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace NetworkingTest {
+namespace {
+/// Angle in degrees between two rotations, q and -q counting as the same
+float AngleBetween(const Math::Quaternion& a, const Math::Quaternion& b) {
+  const float dot = Math::Util::Min(
+      1.f, Math::Util::Abs(Math::Quaternion::Dot(a.Normalized(),
+                                                 b.Normalized())));
+  return 2 * std::acos(dot) * 57.2957795f;
+}
+}  // namespace
+
+TEST_CLASS(TransformQuantizationTest) {
+ public:
+  TEST_METHOD(PositionRoundTrip) {
+    const TransformPrecision precision;
+    const float bound = static_cast<float>(precision.positionBound);
+    const float maxError =
+        TransformQuantization::MaxError(bound, precision.positionBits);
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> distribution{-bound, bound};
+    for (int i = 0; i < 1000; ++i) {
+      const float value = distribution(random);
+      const float result = TransformQuantization::DequantizeFloat(
+          TransformQuantization::QuantizeFloat(value, bound,
+                                               precision.positionBits),
+          bound, precision.positionBits);
+      Assert::IsTrue(Math::Util::Abs(result - value) <= maxError * 1.01f);
+    }
+  }
+
+  TEST_METHOD(ZeroIsExact) {
+    const int bitCounts[] = {TransformPrecision::minBits, 10, 20,
+                             TransformPrecision::maxBits};
+    for (const int bits : bitCounts) {
+      Assert::AreEqual(0.f, TransformQuantization::DequantizeFloat(
+                                TransformQuantization::QuantizeFloat(0, 512,
+                                                                     bits),
+                                512, bits));
+    }
+    U32 largest;
+    U32 values[3];
+    TransformQuantization::QuantizeRotation(Math::Quaternion::identity, 10,
+                                            &largest, values);
+    const Math::Quaternion identity =
+        TransformQuantization::DequantizeRotation(largest, values, 10);
+    Assert::AreEqual(0.f, identity.x);
+    Assert::AreEqual(0.f, identity.y);
+    Assert::AreEqual(0.f, identity.z);
+    Assert::AreEqual(1.f, identity.w);
+  }
+
+  TEST_METHOD(OutOfBoundsClamped) {
+    const float result = TransformQuantization::DequantizeFloat(
+        TransformQuantization::QuantizeFloat(1000, 512, 20), 512, 20);
+    Assert::AreEqual(512.f, result);
+  }
+
+  TEST_METHOD(RotationRoundTrip) {
+    const int bits = TransformPrecision{}.rotationBits;
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> distribution{-180, 180};
+    float maxAngle = 0;
+    for (int i = 0; i < 1000; ++i) {
+      const Math::Quaternion rotation = Math::Quaternion::FromEulerAngles(
+          distribution(random), distribution(random), distribution(random));
+      U32 largest;
+      U32 values[3];
+      TransformQuantization::QuantizeRotation(rotation, bits, &largest,
+                                              values);
+      const Math::Quaternion result =
+          TransformQuantization::DequantizeRotation(largest, values, bits);
+      maxAngle = Math::Util::Max(maxAngle, AngleBetween(rotation, result));
+    }
+    Assert::IsTrue(maxAngle < 0.5f);
+  }
+
+  TEST_METHOD(NegatedRotationSame) {
+    const int bits = TransformPrecision{}.rotationBits;
+    const Math::Quaternion rotation =
+        Math::Quaternion::FromEulerAngles(30, -60, 120);
+    const Math::Quaternion negated{-rotation.x, -rotation.y, -rotation.z,
+                                   -rotation.w};
+    U32 largest, negatedLargest;
+    U32 values[3], negatedValues[3];
+    TransformQuantization::QuantizeRotation(rotation, bits, &largest, values);
+    TransformQuantization::QuantizeRotation(negated, bits, &negatedLargest,
+                                            negatedValues);
+    Assert::AreEqual(largest, negatedLargest);
+    for (int i = 0; i < 3; ++i) {
+      Assert::AreEqual(values[i], negatedValues[i]);
+    }
+  }
+
+  TEST_METHOD(ScaleRoundTrip) {
+    const TransformPrecision precision;
+    const float bound = static_cast<float>(precision.scaleBound);
+    const float maxError =
+        TransformQuantization::MaxError(bound, precision.scaleBits);
+    const Math::Vector3 scales[] = {Math::Vector3::one,
+                                    Math::Vector3{0.25f, 2, 10},
+                                    Math::Vector3{-1, 0.01f, 63.5f}};
+    for (const Math::Vector3& scale : scales) {
+      for (int i = 0; i < 3; ++i) {
+        const float result = TransformQuantization::DequantizeFloat(
+            TransformQuantization::QuantizeFloat(scale[i], bound,
+                                                 precision.scaleBits),
+            bound, precision.scaleBits);
+        Assert::IsTrue(Math::Util::Abs(result - scale[i]) <=
+                       maxError * 1.01f);
+      }
+    }
+  }
+
+  TEST_METHOD(StreamRoundTrip) {
+    TransformPrecision custom;
+    custom.positionBound = 64;
+    custom.positionBits = 12;
+    custom.rotationBits = 8;
+    custom.scaleBound = 4;
+    custom.scaleBits = 6;
+    const TransformPrecision precisions[] = {TransformPrecision{}, custom};
+
+    // what the writer leaves in place is what the reader gets
+    TransformPrecision written[2];
+    Math::Vector3 positions[2];
+    Math::Quaternion rotations[2];
+    Math::Vector3 scales[2];
+    alignas(4) U8 buffer[256]{};
+    yojimbo::WriteStream writeStream{yojimbo::GetDefaultAllocator(), buffer,
+                                     sizeof(buffer)};
+    for (int i = 0; i < 2; ++i) {
+      written[i] = precisions[i];
+      positions[i] = Math::Vector3{1.23f, -45.6f, 0};
+      rotations[i] = Math::Quaternion::FromEulerAngles(10, -20, 170);
+      scales[i] = Math::Vector3{1, 0.5f, 3};
+      Assert::IsTrue(TransformQuantization::SerializePrecision(&writeStream,
+                                                               &written[i]));
+      Assert::IsTrue(TransformQuantization::SerializePosition(
+          &writeStream, &positions[i], written[i]));
+      Assert::IsTrue(TransformQuantization::SerializeRotation(
+          &writeStream, &rotations[i], written[i]));
+      Assert::IsTrue(TransformQuantization::SerializeScale(
+          &writeStream, &scales[i], written[i]));
+    }
+    writeStream.Flush();
+    Logger::WriteMessage(("Default and custom precision transforms: " +
+                          std::to_string(writeStream.GetBytesProcessed()) +
+                          " bytes\n")
+                             .c_str());
+
+    yojimbo::ReadStream readStream{yojimbo::GetDefaultAllocator(), buffer,
+                                   sizeof(buffer)};
+    for (int i = 0; i < 2; ++i) {
+      TransformPrecision precision;
+      Math::Vector3 position, scale;
+      Math::Quaternion rotation;
+      Assert::IsTrue(
+          TransformQuantization::SerializePrecision(&readStream, &precision));
+      Assert::IsTrue(precision == precisions[i]);
+      Assert::IsTrue(TransformQuantization::SerializePosition(
+          &readStream, &position, precision));
+      Assert::IsTrue(TransformQuantization::SerializeRotation(
+          &readStream, &rotation, precision));
+      Assert::IsTrue(TransformQuantization::SerializeScale(&readStream, &scale,
+                                                           precision));
+      Assert::IsTrue(position == positions[i]);
+      Assert::IsTrue(rotation == rotations[i]);
+      Assert::IsTrue(scale == scales[i]);
+      Assert::AreEqual(0.f, position.z);
+    }
+  }
+
+  TEST_METHOD(BytesPerObject) {
+    // full float transform: 3 position, 4 rotation, 3 scale
+    const int floatBits = 10 * 32;
+    const TransformPrecision precision;
+    const int bits = TransformQuantization::BitsPerTransform(precision, true);
+    const int noScaleBits =
+        TransformQuantization::BitsPerTransform(precision, false);
+    Logger::WriteMessage(
+        ("Transform bytes per object: floats " +
+         std::to_string(floatBits / 8.f) + ", quantized " +
+         std::to_string(bits / 8.f) + ", quantized without scale " +
+         std::to_string(noScaleBits / 8.f) + "\n")
+            .c_str());
+    Assert::IsTrue(bits < floatBits / 2);
+    Assert::IsTrue(noScaleBits < bits);
+  }
+};
+}  // namespace NetworkingTest
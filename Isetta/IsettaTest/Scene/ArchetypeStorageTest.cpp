@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <vector>
+#include "CppUnitTest.h"
+#include "Scene/ArchetypeStorage.h"
+#include "Scene/Entity.h"
+#include "Scene/Query.h"
+#include "TestLevel.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace {
+struct Position {
+  float x, y, z;
+};
+struct Velocity {
+  float x, y, z;
+};
+struct Health {
+  int value;
+};
+}  // namespace
+
+namespace SceneTest {
+TEST_CLASS(ArchetypeStorageTest) {
+ public:
+  TEST_METHOD(TypeIdsAreStable) {
+    const int position = ArchetypeStorage::GetTypeId<Position>();
+    Assert::AreEqual(position, ArchetypeStorage::GetTypeId<Position>());
+    Assert::AreNotEqual(position, ArchetypeStorage::GetTypeId<Velocity>());
+  }
+
+  TEST_METHOD(AddRemoveMigratesRows) {
+    TestLevel level;
+    Entity* a = Entity::Instantiate("a");
+    Entity* b = Entity::Instantiate("b");
+    a->AddData<Position>(Position{1, 2, 3});
+    b->AddData<Position>(Position{4, 5, 6});
+
+    // moving a to another archetype keeps its data and b's
+    a->AddData<Velocity>(Velocity{7, 8, 9});
+    Assert::AreEqual(2.f, a->GetData<Position>()->y);
+    Assert::AreEqual(8.f, a->GetData<Velocity>()->y);
+    Assert::AreEqual(5.f, b->GetData<Position>()->y);
+    Assert::IsTrue(b->GetData<Velocity>() == nullptr);
+
+    a->RemoveData<Position>();
+    Assert::IsTrue(a->GetData<Position>() == nullptr);
+    Assert::AreEqual(9.f, a->GetData<Velocity>()->z);
+
+    a->RemoveData<Velocity>();
+    Assert::IsTrue(a->GetData<Velocity>() == nullptr);
+    Assert::AreEqual(6.f, b->GetData<Position>()->z);
+  }
+
+  TEST_METHOD(RemovedRowIsFilledByTheLast) {
+    TestLevel level;
+    std::vector<Entity*> entities;
+    for (int i = 0; i < 5; ++i) {
+      entities.push_back(Entity::Instantiate("entity"));
+      entities.back()->AddData<Health>(Health{i});
+    }
+    entities[1]->RemoveData<Health>();
+    for (int i = 0; i < 5; ++i) {
+      if (i == 1) continue;
+      Assert::AreEqual(i, entities[i]->GetData<Health>()->value);
+    }
+  }
+
+  TEST_METHOD(QueryMatchesEveryArchetypeWithItsTypes) {
+    TestLevel level;
+    for (int i = 0; i < 3; ++i) {
+      Entity* entity = Entity::Instantiate("moving");
+      entity->AddData<Position>(Position{1, 0, 0});
+      entity->AddData<Velocity>(Velocity{static_cast<float>(i), 0, 0});
+    }
+    for (int i = 0; i < 2; ++i) {
+      Entity::Instantiate("still")->AddData<Position>(Position{1, 0, 0});
+    }
+    Entity::Instantiate("alive")->AddData<Health>(Health{1});
+
+    Query<Position> positions;
+    Query<Position, Velocity> moving;
+    Assert::AreEqual(5, positions.Count());
+    Assert::AreEqual(3, moving.Count());
+
+    moving.ForEach([](Position& position, const Velocity& velocity) {
+      position.x += velocity.x;
+    });
+    float sum = 0;
+    positions.ForEach([&sum](const Position& position) { sum += position.x; });
+    // 5 ones plus the velocities 0, 1 and 2
+    Assert::AreEqual(8.f, sum);
+
+    // archetypes created after the first run are picked up
+    Entity* late = Entity::Instantiate("late");
+    late->AddData<Position>(Position{});
+    late->AddData<Health>(Health{2});
+    Assert::AreEqual(6, positions.Count());
+
+    int entityCount = 0;
+    positions.ForEachEntity([&entityCount, late](Entity* entity, Position&) {
+      if (entity == late) ++entityCount;
+    });
+    Assert::AreEqual(1, entityCount);
+  }
+
+  TEST_METHOD(ParallelForEachVisitsEveryRowOnce) {
+    TestLevel level;
+    // enough rows for several chunks
+    const int count = 4000;
+    for (int i = 0; i < count; ++i) {
+      Entity* entity = Entity::Instantiate("entity");
+      entity->AddData<Health>(Health{0});
+      if (i % 2 == 0) entity->AddData<Position>(Position{});
+    }
+
+    Query<Health> query;
+    query.ParallelForEach([](Health& health) { ++health.value; });
+    query.ParallelForEach([](Health& health) { ++health.value; });
+
+    int visited = 0;
+    bool all = true;
+    query.ForEach([&visited, &all](const Health& health) {
+      ++visited;
+      all = all && health.value == 2;
+    });
+    Assert::AreEqual(count, visited);
+    Assert::IsTrue(all);
+  }
+};
+}  // namespace SceneTest
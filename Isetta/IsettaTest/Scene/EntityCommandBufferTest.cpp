@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CppUnitTest.h"
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+#include "Scene/EntityCommandBuffer.h"
+#include "TestLevel.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace Isetta {
+DEFINE_COMPONENT(CommandBufferTestComponent, Component, false)
+DEFINE_COMPONENT_END(CommandBufferTestComponent, Component)
+}  // namespace Isetta
+
+namespace {
+struct Health {
+  int value;
+};
+}  // namespace
+
+namespace SceneTest {
+TEST_CLASS(EntityCommandBufferTest) {
+ public:
+  TEST_METHOD(PlaysBackInThreadThenRecordOrder) {
+    TestLevel level;
+    std::vector<std::string> created;
+    const auto record = [&created](Entity* entity) {
+      created.push_back(entity->GetName());
+    };
+
+    const auto recordMore = [&record](Entity* entity) {
+      record(entity);
+      // into a buffer that was already played back
+      EntityCommandBuffer::Get(0).Instantiate("d", {}, false, record);
+    };
+    EntityCommandBuffer::Get(2).Instantiate("c", {}, false, recordMore);
+    EntityCommandBuffer::Get(0).Instantiate("a", {}, false, record);
+    EntityCommandBuffer::Get(0).Instantiate("b", {}, false, record);
+    Assert::IsTrue(created.empty());
+
+    level.PlayBackCommands();
+    const std::vector<std::string> expected{"a", "b", "c", "d"};
+    Assert::IsTrue(created == expected);
+    for (int i = 0; i < Level::maxCommandThreads; ++i) {
+      Assert::IsTrue(level.GetCommandBuffer(i).IsEmpty());
+    }
+  }
+
+  TEST_METHOD(EditsApplyInRecordOrder) {
+    TestLevel level;
+    Entity* entity = Entity::Instantiate("entity");
+    EntityCommandBuffer& buffer = EntityCommandBuffer::Get(1);
+    buffer.AddData(entity->GetHandle(), Health{1});
+    buffer.RemoveData<Health>(entity->GetHandle());
+    buffer.AddData(entity->GetHandle(), Health{2});
+    Assert::IsTrue(entity->GetData<Health>() == nullptr);
+
+    level.PlayBackCommands();
+    Assert::AreEqual(2, entity->GetData<Health>()->value);
+  }
+
+  TEST_METHOD(DestroyWaitsForPlayback) {
+    TestLevel level;
+    Entity* entity = Entity::Instantiate("entity");
+    const EntityHandle handle = entity->GetHandle();
+    EntityCommandBuffer::Get().Destroy(handle);
+    // commands on an entity that's gone by then are dropped
+    EntityCommandBuffer::Get().AddData(handle, Health{1});
+    Assert::IsTrue(Entity::GetEntity(handle) == entity);
+
+    level.EndFrame();
+    Assert::IsTrue(Entity::GetEntity(handle) == nullptr);
+
+    EntityCommandBuffer::Get().Destroy(handle);
+    level.EndFrame();
+  }
+
+  TEST_METHOD(DestroyComponentOnlyHitsTheRecordedOne) {
+    TestLevel level;
+    Entity* entity = Entity::Instantiate("entity");
+    auto* first = entity->AddComponent<CommandBufferTestComponent>();
+    EntityCommandBuffer::Get().DestroyComponent(entity->GetHandle(), first);
+
+    // freed before playback, so the next one can be at the same address
+    Component::Destroy(first);
+    level.FreeDestroyedComponents();
+    auto* second = entity->AddComponent<CommandBufferTestComponent>();
+    level.EndFrame();
+    Assert::IsTrue(entity->GetComponent<CommandBufferTestComponent>() ==
+                   second);
+
+    EntityCommandBuffer::Get(3).DestroyComponent(entity->GetHandle(), second);
+    Assert::IsTrue(entity->GetComponent<CommandBufferTestComponent>() ==
+                   second);
+    level.EndFrame();
+    Assert::IsTrue(entity->GetComponent<CommandBufferTestComponent>() ==
+                   nullptr);
+  }
+
+  TEST_METHOD(NoBufferPastTheLastThread) {
+    TestLevel level;
+    Assert::ExpectException<std::out_of_range>(
+        [] { EntityCommandBuffer::Get(Level::maxCommandThreads); });
+    Assert::ExpectException<std::out_of_range>(
+        [] { EntityCommandBuffer::Get(-1); });
+  }
+};
+}  // namespace SceneTest
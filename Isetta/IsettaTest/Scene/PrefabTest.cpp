@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <algorithm>
+#include <vector>
+#include "CppUnitTest.h"
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+#include "Scene/Prefab.h"
+#include "TestLevel.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Isetta;
+
+namespace Isetta {
+DEFINE_COMPONENT(PrefabTestComponent, Component, false)
+public:
+explicit PrefabTestComponent(const int value) : value{value} {}
+
+void Awake() override { ++awakeCount; }
+void OnEnable() override { ++enableCount; }
+void OnDisable() override { ++disableCount; }
+void Update() override { ++updateCount; }
+
+int value;
+int awakeCount = 0;
+int enableCount = 0;
+int disableCount = 0;
+int updateCount = 0;
+DEFINE_COMPONENT_END(PrefabTestComponent, Component)
+
+DEFINE_COMPONENT(PrefabIdleComponent, Component, false)
+public:
+void Awake() override { awoken = true; }
+
+bool awoken = false;
+DEFINE_COMPONENT_END(PrefabIdleComponent, Component)
+}  // namespace Isetta
+
+namespace {
+struct Health {
+  int value;
+};
+}  // namespace
+
+namespace SceneTest {
+TEST_CLASS(PrefabTest) {
+ public:
+  TEST_METHOD(BatchIsFoundByNameAndHandle) {
+    TestLevel level;
+    Prefab prefab{"minion"};
+    prefab.AddComponent<PrefabTestComponent>(3);
+    const std::vector<Entity*> batch = Entity::InstantiateBatch(prefab, 50);
+    Assert::AreEqual(50, static_cast<int>(batch.size()));
+
+    std::vector<Entity*> named = Entity::GetEntitiesByName("minion");
+    Assert::AreEqual(50, static_cast<int>(named.size()));
+    std::vector<EntityHandle> handles;
+    for (Entity* entity : batch) {
+      Assert::IsTrue(std::find(named.begin(), named.end(), entity) !=
+                     named.end());
+      Assert::IsTrue(Entity::GetEntity(entity->GetHandle()) == entity);
+      handles.push_back(entity->GetHandle());
+    }
+
+    // every other one
+    for (int i = 0; i < 50; i += 2) Entity::Destroy(batch[i]);
+    level.EndFrame();
+    for (int i = 0; i < 50; ++i) {
+      Assert::AreEqual(i % 2 == 1, Entity::GetEntity(handles[i]) != nullptr);
+    }
+    named = Entity::GetEntitiesByName("minion");
+    Assert::AreEqual(25, static_cast<int>(named.size()));
+    for (int i = 1; i < 50; i += 2) {
+      Assert::IsTrue(std::find(named.begin(), named.end(), batch[i]) !=
+                     named.end());
+    }
+  }
+
+  TEST_METHOD(ComponentsAreAwakeAndCopied) {
+    TestLevel level;
+    Prefab prefab{"minion"};
+    prefab.AddComponent<PrefabTestComponent>(3)
+        .AddComponent<PrefabIdleComponent, false>()
+        .AddData<Health>(7);
+    const std::vector<Entity*> batch = Entity::InstantiateBatch(prefab, 10);
+
+    for (Entity* entity : batch) {
+      Assert::IsTrue(entity->GetActive());
+      auto* component = entity->GetComponent<PrefabTestComponent>();
+      Assert::IsTrue(component != nullptr);
+      Assert::AreEqual(3, component->value);
+      Assert::AreEqual(1, component->awakeCount);
+      Assert::AreEqual(1, component->enableCount);
+      Assert::AreEqual(0, component->disableCount);
+
+      // added inactive, so not awoken yet
+      auto* idle = entity->GetComponent<PrefabIdleComponent>();
+      Assert::IsTrue(idle != nullptr);
+      Assert::IsFalse(idle->GetActive());
+      Assert::IsFalse(idle->awoken);
+
+      Assert::IsTrue(entity->GetData<Health>() != nullptr);
+      Assert::AreEqual(7, entity->GetData<Health>()->value);
+    }
+    // each instance has its own copy
+    batch[0]->GetData<Health>()->value = 1;
+    Assert::AreEqual(7, batch[1]->GetData<Health>()->value);
+  }
+
+  TEST_METHOD(InactivePrefabEndsUpDisabled) {
+    TestLevel level;
+    Prefab prefab{"minion"};
+    prefab.AddComponent<PrefabTestComponent>(3).SetActive(false);
+    const std::vector<Entity*> batch = Entity::InstantiateBatch(prefab, 10);
+
+    for (Entity* entity : batch) {
+      Assert::IsFalse(entity->GetActive());
+      auto* component = entity->GetComponent<PrefabTestComponent>();
+      Assert::AreEqual(1, component->awakeCount);
+      Assert::AreEqual(1, component->enableCount);
+      Assert::AreEqual(1, component->disableCount);
+    }
+
+    level.Update();
+    for (Entity* entity : batch) {
+      Assert::AreEqual(
+          0, entity->GetComponent<PrefabTestComponent>()->updateCount);
+    }
+  }
+
+  TEST_METHOD(ComponentsNeedingUpdateAreUpdated) {
+    TestLevel level;
+    Prefab prefab{"minion"};
+    prefab.AddComponent<PrefabTestComponent>(3);
+    const std::vector<Entity*> first = Entity::InstantiateBatch(prefab, 10);
+    level.Update();
+    // a second batch reuses the bucket the first one looked up
+    const std::vector<Entity*> second = Entity::InstantiateBatch(prefab, 10);
+    level.Update();
+
+    for (Entity* entity : first) {
+      Assert::AreEqual(
+          2, entity->GetComponent<PrefabTestComponent>()->updateCount);
+    }
+    for (Entity* entity : second) {
+      Assert::AreEqual(
+          1, entity->GetComponent<PrefabTestComponent>()->updateCount);
+    }
+  }
+};
+}  // namespace SceneTest
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include <string>
+#include "Scene/Entity.h"
+#include "Scene/Level.h"
+#include "Scene/LevelManager.h"
+
+namespace Isetta {
+/**
+ * \brief Level loaded for as long as it lives, so a test can create entities
+ * and run the end of a frame without the engine loop. Level and Entity
+ * befriend it
+ */
+class TestLevel : public Level {
+ public:
+  TestLevel() { LevelManager::Instance().loadedLevel = this; }
+  ~TestLevel() {
+    Unload();
+    LevelManager::Instance().loadedLevel = nullptr;
+  }
+
+  std::string GetName() const override { return "TestLevel"; }
+  void Load() override {}
+
+  /// Play back the command buffers and free destroyed entities, as the end
+  /// of a frame does
+  void EndFrame() { Level::LateUpdate(); }
+  /// Start and update the components, as the update of a frame does
+  void Update() { Level::Update(); }
+  void PlayBackCommands() { Level::PlayBackCommands(); }
+  /// Free destroyed components without playing back the commands first
+  void FreeDestroyedComponents() {
+    for (const EntityHandle handle : entitiesToCheck) {
+      Entity* entity = GetEntity(handle);
+      if (entity != nullptr) entity->CheckDestroy();
+    }
+    entitiesToCheck.clear();
+  }
+};
+}  // namespace Isetta
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include <algorithm>
+#include <memory>
+#include "Core/Math/Matrix4.h"
+#include "Core/Math/Vector3.h"
+#include "Core/Math/Vector4.h"
+#include "CppUnitTest.h"
+#include "Scene/Transform.h"
+#include "Scene/TransformHierarchy.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// in the engine namespace, TransformHierarchy befriends it to drive its slots
+// without entities
+namespace Isetta {
+TEST_CLASS(TransformHierarchyTest) {
+ public:
+  TEST_METHOD(ChildFollowsParent) {
+    TransformHierarchy& hierarchy = TransformHierarchy::Instance();
+    Transform parent{nullptr}, child{nullptr};
+    SetParent(&child, &parent);
+    Local(&parent) = Math::Vector3{1, 0, 0};
+    hierarchy.localScale[Index(&parent)] = Math::Vector3{2, 2, 2};
+    Local(&child) = Math::Vector3{1, 0, 0};
+    MarkDirty(&parent);
+
+    // read lazily, which has to clean the parent first
+    Assert::IsTrue(Near(WorldPos(&child), Math::Vector3{3, 0, 0}));
+    Assert::IsTrue(Near(WorldPos(&parent), Math::Vector3{1, 0, 0}));
+
+    Local(&parent) = Math::Vector3{0, 5, 0};
+    MarkDirty(&parent);
+    hierarchy.UpdateWorldMatrices();
+    Assert::IsFalse(hierarchy.IsWorldDirty(Index(&child)));
+    Assert::IsTrue(Near(WorldPos(&child), Math::Vector3{2, 5, 0}));
+
+    const Math::Vector3 local =
+        (hierarchy.GetWorldToLocal(Index(&child)) *
+         Math::Vector4{2, 5, 0, 1}).GetVector3();
+    Assert::IsTrue(Near(local, Math::Vector3::zero));
+  }
+
+  TEST_METHOD(ReparentUnderLaterSlot) {
+    TransformHierarchy& hierarchy = TransformHierarchy::Instance();
+    Transform child{nullptr}, grandchild{nullptr}, parent{nullptr};
+    SetParent(&grandchild, &child);
+    Local(&child) = Math::Vector3{0, 1, 0};
+    Local(&grandchild) = Math::Vector3{0, 0, 1};
+    Local(&parent) = Math::Vector3{1, 0, 0};
+
+    // the parent was created last, so the order has to be rebuilt
+    SetParent(&child, &parent);
+    MarkDirty(&child);
+    hierarchy.UpdateWorldMatrices();
+    Assert::IsTrue(Index(&parent) < Index(&child));
+    Assert::IsTrue(Index(&child) < Index(&grandchild));
+    Assert::IsTrue(Near(WorldPos(&grandchild), Math::Vector3{1, 1, 1}));
+
+    // and back to the root
+    SetParent(&child, nullptr);
+    MarkDirty(&child);
+    hierarchy.UpdateWorldMatrices();
+    Assert::IsTrue(Near(WorldPos(&grandchild), Math::Vector3{0, 1, 1}));
+  }
+
+  TEST_METHOD(DestroyedSlotsAreReused) {
+    TransformHierarchy& hierarchy = TransformHierarchy::Instance();
+    Transform parent{nullptr};
+    auto first = std::make_unique<Transform>(nullptr);
+    const Size slotCount = hierarchy.GetSlotCount();
+    first.reset();
+    Transform second{nullptr};
+    Assert::AreEqual(static_cast<int>(slotCount),
+                     static_cast<int>(hierarchy.GetSlotCount()));
+
+    // wherever the reused slot is, the child ends up after its parent
+    SetParent(&second, &parent);
+    Local(&parent) = Math::Vector3{0, 0, 3};
+    MarkDirty(&parent);
+    hierarchy.UpdateWorldMatrices();
+    Assert::IsTrue(Index(&parent) < Index(&second));
+    Assert::IsTrue(Near(WorldPos(&second), Math::Vector3{0, 0, 3}));
+  }
+
+ private:
+  static int Index(Transform* const transform) {
+    const auto& owners = TransformHierarchy::Instance().owners;
+    return static_cast<int>(
+        std::find(owners.begin(), owners.end(), transform) - owners.begin());
+  }
+  static Math::Vector3& Local(Transform* const transform) {
+    return TransformHierarchy::Instance().localPos[Index(transform)];
+  }
+  static void SetParent(Transform* const child, Transform* const parent) {
+    TransformHierarchy::Instance().SetParent(Index(child),
+                                             parent ? Index(parent) : -1);
+  }
+  /// What Transform::SetDirty does, without an entity
+  static void MarkDirty(Transform* const transform) {
+    TransformHierarchy& hierarchy = TransformHierarchy::Instance();
+    const int root = Index(transform);
+    for (int i = 0; i < static_cast<int>(hierarchy.GetSlotCount()); ++i) {
+      for (int cur = i; cur >= 0; cur = hierarchy.parents[cur]) {
+        if (cur == root) {
+          hierarchy.flags[i] |= TransformHierarchy::worldDirtyBit |
+                                TransformHierarchy::inverseDirtyBit;
+          break;
+        }
+      }
+    }
+  }
+  static Math::Vector3 WorldPos(Transform* const transform) {
+    return TransformHierarchy::Instance()
+        .GetLocalToWorld(Index(transform))
+        .GetCol(3)
+        .GetVector3();
+  }
+  static bool Near(const Math::Vector3& a, const Math::Vector3& b) {
+    return (a - b).Magnitude() < 1e-4f;
+  }
+};
+}  // namespace Isetta
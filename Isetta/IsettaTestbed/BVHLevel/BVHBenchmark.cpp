@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "BVHBenchmark.h"
+
+#include "Collisions/BVTree.h"
+
+namespace Isetta {
+BVHBenchmark::BVHBenchmark(const int frameCount, const int raysPerFrame,
+                           const float range)
+    : frameCount{frameCount}, raysPerFrame{raysPerFrame}, range{range} {}
+
+void BVHBenchmark::Update() {
+  // Rays start outside the movers' range and aim at a random point inside it
+  std::vector<Ray> rays;
+  rays.reserve(raysPerFrame);
+  for (int i = 0; i < raysPerFrame; ++i) {
+    Math::Vector3 origin = 2 * range *
+                           Math::Vector3{Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f}
+                               .Normalized();
+    Math::Vector3 target =
+        range * Math::Vector3{Math::Random::GetRandom01() - 0.5f,
+                              Math::Random::GetRandom01() - 0.5f,
+                              Math::Random::GetRandom01() - 0.5f};
+    rays.emplace_back(origin, (target - origin).Normalized());
+  }
+
+  auto& flatQueries = Config::Instance().collisionConfig.bvTreeFlatQueries;
+  const int flatQueriesVal = flatQueries.GetVal();
+  StopWatch stopWatch;
+  for (int layout = 0; layout < 2; ++layout) {
+    flatQueries.SetVal(layout == 0 ? "1" : "0");
+
+    stopWatch.Start();
+    for (const Ray& ray : rays) {
+      RaycastHit hitInfo;
+      if (Collisions::Raycast(ray, &hitInfo) && layout == 0) {
+        ++hitCount;
+      }
+    }
+    raycastTime[layout] += stopWatch.EvaluateInSecond();
+
+    stopWatch.Start();
+    for (const Ray& ray : rays) {
+      Collisions::RaycastAll(ray);
+    }
+    raycastAllTime[layout] += stopWatch.EvaluateInSecond();
+  }
+  flatQueries.SetVal("1");
+  std::vector<RaycastHit> hitInfos(rays.size());
+  stopWatch.Start();
+  Collisions::RaycastBatch(rays.data(), rays.size(), hitInfos.data());
+  raycastBatchTime += stopWatch.EvaluateInSecond();
+  flatQueries.SetVal(std::to_string(flatQueriesVal));
+
+  BVTreeStats stats = Collisions::GetTreeStats();
+  depthSum += stats.averageDepth;
+  sahCostSum += stats.sahCost;
+  maxDepth = Math::Util::Max({maxDepth, stats.maxDepth});
+
+  if (++frame < frameCount) return;
+
+  LOG_INFO(Debug::Channel::Collisions,
+           "[Benchmark] BVTree with %d leaves over %d frames "
+           "(bv_tree_rotations = %d, bv_tree_rebuild_ratio = %.2f)",
+           stats.leafCount, frameCount,
+           CONFIG_VAL(collisionConfig.bvTreeRotations),
+           CONFIG_VAL(collisionConfig.bvTreeRebuildRatio));
+  LOG_INFO(Debug::Channel::Collisions,
+           "[Benchmark] Average depth %.2f, max depth %d, SAH cost %.2f",
+           depthSum / frameCount, maxDepth, sahCostSum / frameCount);
+  const char* layouts[] = {"flattened", "linked"};
+  for (int layout = 0; layout < 2; ++layout) {
+    LOG_INFO(Debug::Channel::Collisions,
+             "[Benchmark] %s layout: %d raycasts per frame took %.3fms on "
+             "average (%.0f rays/ms), RaycastAll %.3fms (%.0f rays/ms)",
+             layouts[layout], raysPerFrame,
+             1000 * raycastTime[layout] / frameCount,
+             raysPerFrame * frameCount / (1000 * raycastTime[layout]),
+             1000 * raycastAllTime[layout] / frameCount,
+             raysPerFrame * frameCount / (1000 * raycastAllTime[layout]));
+  }
+  LOG_INFO(Debug::Channel::Collisions,
+           "[Benchmark] RaycastBatch took %.3fms on average (%.0f rays/ms)",
+           1000 * raycastBatchTime / frameCount,
+           raysPerFrame * frameCount / (1000 * raycastBatchTime));
+  LOG_INFO(Debug::Channel::Collisions, "[Benchmark] %.1f%% of the rays hit",
+           100.f * hitCount / (raysPerFrame * frameCount));
+
+  frame = 0;
+  for (int layout = 0; layout < 2; ++layout) {
+    raycastTime[layout] = 0;
+    raycastAllTime[layout] = 0;
+  }
+  raycastBatchTime = 0;
+  hitCount = 0;
+  depthSum = 0;
+  sahCostSum = 0;
+  maxDepth = 0;
+  SetActive(false);
+}
+}  // namespace Isetta
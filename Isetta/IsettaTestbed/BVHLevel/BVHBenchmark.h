@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Samples the collision tree for a number of frames, timing a batch of
+ * random raycasts each frame and tracking depth and SAH cost, then logs the
+ * averages. Every batch is cast against both the flattened and the linked
+ * layout of the tree so their throughput can be compared
+ *
+ */
+namespace Isetta {
+DEFINE_COMPONENT(BVHBenchmark, Component, false)
+public:
+BVHBenchmark(int frameCount = 300, int raysPerFrame = 1000,
+             float range = 50);
+void Update() override;
+
+private:
+int frameCount;
+int raysPerFrame;
+float range;
+
+int frame = 0;
+/// Index 0 is the flattened layout, 1 the linked one
+float raycastTime[2]{};
+float raycastAllTime[2]{};
+/// RaycastBatch of the same rays, flattened layout only
+float raycastBatchTime = 0;
+int hitCount = 0;
+float depthSum = 0;
+float sahCostSum = 0;
+int maxDepth = 0;
+DEFINE_COMPONENT_END(BVHBenchmark, Component)
+}  // namespace Isetta
@@ -7,6 +7,8 @@
 #include "Components/FlyController.h"
 #include "Components/GridComponent.h"
 
+#include "BVHLevel/BVHBenchmark.h"
+#include "BVHLevel/NarrowphaseBenchmark.h"
 #include "BVHLevel/RandomMover.h"
 #include "Components/Editor/EditorComponent.h"
 #include "Custom/DebugCollision.h"
@@ -108,6 +110,68 @@ void BVHLevel::Load() {
     spheres.push(sphere);
   });
 
+  // Benchmark: fill the level up to 10000 random movers spread over a wider
+  // range, then measure tree depth and raycast cost over the next frames
+  benchmark =
+      Entity::Instantiate("BVH Benchmark")->AddComponent<BVHBenchmark>();
+  benchmark->SetActive(false);
+  Input::RegisterKeyPressCallback(KeyCode::KP_8, [&]() {
+    const float benchmarkRange = 50;
+    Config::Instance().drawConfig.bvtDrawAABBs.SetVal("0");
+    for (RandomMover* randomMover : randomMovers) {
+      randomMover->range = benchmarkRange;
+    }
+    while (count < 10000) {
+      ++count;
+      Entity* sphere{
+          Entity::Instantiate(Util::StrFormat("Sphere (%d)", count))};
+      randomMovers.PushBack(sphere->AddComponent<RandomMover>());
+      randomMovers.Back()->SetActive(enable);
+      randomMovers.Back()->range = benchmarkRange;
+      sphere->AddComponent<SphereCollider>();
+      sphere->SetTransform(2 * benchmarkRange *
+                           Math::Vector3{Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f});
+    }
+    benchmark->SetActive(true);
+  });
+
+  // Benchmark: pack movers tightly enough for thousands of overlapping pairs,
+  // then time the narrowphase from one thread up to one per hardware thread
+  narrowphaseBenchmark = Entity::Instantiate("Narrowphase Benchmark")
+                             ->AddComponent<NarrowphaseBenchmark>();
+  narrowphaseBenchmark->SetActive(false);
+  Input::RegisterKeyPressCallback(KeyCode::KP_2, [&]() {
+    const float benchmarkRange = 10;
+    Config::Instance().drawConfig.bvtDrawAABBs.SetVal("0");
+    for (RandomMover* randomMover : randomMovers) {
+      randomMover->range = benchmarkRange;
+    }
+    while (count < 5000) {
+      ++count;
+      Entity* sphere{
+          Entity::Instantiate(Util::StrFormat("Sphere (%d)", count))};
+      randomMovers.PushBack(sphere->AddComponent<RandomMover>());
+      randomMovers.Back()->SetActive(enable);
+      randomMovers.Back()->range = benchmarkRange;
+      sphere->AddComponent<SphereCollider>();
+      sphere->SetTransform(2 * benchmarkRange *
+                           Math::Vector3{Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f,
+                                         Math::Random::GetRandom01() - 0.5f});
+    }
+    narrowphaseBenchmark->SetActive(true);
+  });
+
+  // Toggle tree rotations and rebuilds to compare benchmark runs
+  Input::RegisterKeyPressCallback(KeyCode::KP_1, [&]() {
+    auto& collisionConfig = Config::Instance().collisionConfig;
+    const bool enabled = collisionConfig.bvTreeRotations.GetVal();
+    collisionConfig.bvTreeRotations.SetVal(enabled ? "0" : "1");
+    collisionConfig.bvTreeRebuildRatio.SetVal(enabled ? "0" : "1.5");
+  });
+
   // Remove a single collider entity from the level
   Input::RegisterKeyPressCallback(KeyCode::KP_4, [&]() {
     if (!spheres.empty()) {
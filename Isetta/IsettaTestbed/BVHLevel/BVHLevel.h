@@ -15,6 +15,8 @@ void Load() override;
 private:
 std::queue<Entity*> spheres;
 Array<class RandomMover*> randomMovers;
+class BVHBenchmark* benchmark = nullptr;
+class NarrowphaseBenchmark* narrowphaseBenchmark = nullptr;
 int count = 0;
 DEFINE_LEVEL_END
 }  // namespace Isetta
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "NarrowphaseBenchmark.h"
+
+#include "Collisions/CollisionUtil.h"
+#include "Core/Jobs/JobSystem.h"
+
+namespace Isetta {
+NarrowphaseBenchmark::NarrowphaseBenchmark(const int maxThreads,
+                                           const int framesPerRun)
+    : maxThreads{maxThreads}, framesPerRun{framesPerRun} {}
+
+void NarrowphaseBenchmark::OnEnable() {
+  auto& collisionConfig = Config::Instance().collisionConfig;
+  oldThreads = collisionConfig.narrowphaseThreads.GetVal();
+  oldMinPairs = collisionConfig.narrowphaseMinPairs.GetVal();
+  // every thread count has to actually be used, however few pairs there are
+  collisionConfig.narrowphaseMinPairs.SetVal("0");
+  collisionConfig.narrowphaseThreads.SetVal("1");
+  // more ranges than job threads only adds jobs
+  if (maxThreads <= 0) {
+    maxThreads = JobSystem::GetThreadCount();
+  }
+
+  threadCount = 1;
+  frame = 0;
+  seconds = 0;
+  pairCount = 0;
+  collidingCount = 0;
+}
+
+void NarrowphaseBenchmark::Update() {
+  CollisionUtil::NarrowphaseStats stats = Collisions::GetNarrowphaseStats();
+  if (stats.threadCount != threadCount) return;
+  // the first step at a new count warms up the new ranges
+  if (frame++ == 0) return;
+
+  seconds += stats.seconds;
+  pairCount += stats.pairCount;
+  collidingCount += stats.collidingCount;
+  if (frame <= framesPerRun) return;
+
+  const float average = seconds / framesPerRun;
+  if (threadCount == 1) singleThreadSeconds = average;
+  LOG_INFO(Debug::Channel::Collisions,
+           "[Benchmark] Narrowphase on %d thread(s): %.3fms for %zu pairs "
+           "(%zu colliding) on average, %.2fx",
+           threadCount, 1000 * average, pairCount / framesPerRun,
+           collidingCount / framesPerRun, singleThreadSeconds / average);
+
+  frame = 0;
+  seconds = 0;
+  pairCount = 0;
+  collidingCount = 0;
+  if (++threadCount <= maxThreads) {
+    Config::Instance().collisionConfig.narrowphaseThreads.SetVal(
+        std::to_string(threadCount));
+    return;
+  }
+
+  auto& collisionConfig = Config::Instance().collisionConfig;
+  collisionConfig.narrowphaseThreads.SetVal(std::to_string(oldThreads));
+  collisionConfig.narrowphaseMinPairs.SetVal(std::to_string(oldMinPairs));
+  SetActive(false);
+}
+}  // namespace Isetta
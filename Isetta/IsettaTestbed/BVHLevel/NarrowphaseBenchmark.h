@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Times the collision narrowphase with one thread, then two, and so on
+ * up to maxThreads, for a number of frames each. Logs the average time of
+ * each thread count and its speedup over a single thread
+ *
+ */
+namespace Isetta {
+DEFINE_COMPONENT(NarrowphaseBenchmark, Component, false)
+public:
+/**
+ * @param maxThreads highest thread count to measure, 0 for one per hardware
+ * thread
+ * @param framesPerRun frames measured for each thread count
+ */
+NarrowphaseBenchmark(int maxThreads = 0, int framesPerRun = 120);
+void OnEnable() override;
+void Update() override;
+
+private:
+int maxThreads;
+int framesPerRun;
+
+int threadCount = 1;
+int frame = 0;
+float seconds = 0;
+float singleThreadSeconds = 0;
+Size pairCount = 0;
+Size collidingCount = 0;
+// settings to put back once done
+int oldThreads = 0;
+int oldMinPairs = 0;
+DEFINE_COMPONENT_END(NarrowphaseBenchmark, Component)
+}  // namespace Isetta
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "ComponentLevel.h"
+
+#include "Components/Editor/FrameReporter.h"
+
+#include "ComponentLevel/UpdateBenchmark.h"
+#include "ComponentLevel/UpdateWork.h"
+#include "Custom/EscapeExit.h"
+
+namespace Isetta {
+
+void ComponentLevel::Load() {
+  Entity* cameraEntity = Entity::Instantiate("Camera");
+  cameraEntity->AddComponent<CameraComponent>();
+  cameraEntity->SetTransform(Math::Vector3{0, 5, 10}, Math::Vector3{-15, 0, 0},
+                             Math::Vector3::one);
+  cameraEntity->AddComponent<EscapeExit>();
+  cameraEntity->AddComponent<FrameReporter>();
+
+  // The benchmark has to be updated before any worker, and its end after all
+  // of them, both entity by entity and type by type
+  benchmark = Entity::Instantiate("Update Benchmark")
+                  ->AddComponent<UpdateBenchmark>();
+
+  const int entityCount = 10000;
+  for (int i = 0; i < entityCount; ++i) {
+    Entity* worker{Entity::Instantiate(Util::StrFormat("Worker (%d)", i))};
+    if (i % 2 == 0) worker->AddComponent<UpdateWork>();
+    if (i % 3 == 0) worker->AddComponent<FixedUpdateWork>();
+    if (i % 5 == 0) worker->AddComponent<LateUpdateWork>();
+    worker->AddComponent<IdleWork>();
+  }
+
+  Entity::Instantiate("Update Benchmark End")
+      ->AddComponent<UpdateBenchmarkEnd>(benchmark);
+
+  // Run the benchmark again
+  Input::RegisterKeyPressCallback(KeyCode::KP_1,
+                                  [&]() { benchmark->SetActive(true); });
+}
+}  // namespace Isetta
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Level benchmarking how components are updated, with 10000 entities
+ * carrying a mix of components that need different update phases
+ *
+ */
+namespace Isetta {
+DEFINE_LEVEL(ComponentLevel)
+void Load() override;
+
+private:
+class UpdateBenchmark* benchmark = nullptr;
+DEFINE_LEVEL_END
+}  // namespace Isetta
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "UpdateBenchmark.h"
+
+namespace Isetta {
+UpdateBenchmark::UpdateBenchmark(const int framesPerRun)
+    : framesPerRun{framesPerRun} {}
+
+void UpdateBenchmark::OnEnable() {
+  auto& buckets = Config::Instance().levelConfig.componentUpdateBuckets;
+  oldBuckets = buckets.GetVal();
+  buckets.SetVal("1");
+
+  run = 0;
+  frame = 0;
+  seconds[0] = seconds[1] = 0;
+}
+
+void UpdateBenchmark::Update() { stopWatch.Start(); }
+
+void UpdateBenchmark::EndFrame() {
+  // the first frame of a run still has components dropping out
+  if (frame++ > 0) seconds[run] += stopWatch.EvaluateInSecond();
+  if (frame <= framesPerRun) return;
+
+  frame = 0;
+  auto& buckets = Config::Instance().levelConfig.componentUpdateBuckets;
+  if (run == 0) {
+    run = 1;
+    buckets.SetVal("0");
+    return;
+  }
+
+  const float bucketsAverage = seconds[0] / framesPerRun;
+  const float entitiesAverage = seconds[1] / framesPerRun;
+  LOG_INFO(Debug::Channel::General,
+           "[Benchmark] Level Update took %.3fms with component buckets and "
+           "%.3fms with the per-entity loop on average, %.2fx",
+           1000 * bucketsAverage, 1000 * entitiesAverage,
+           entitiesAverage / bucketsAverage);
+
+  buckets.SetVal(std::to_string(oldBuckets));
+  SetActive(false);
+}
+
+UpdateBenchmarkEnd::UpdateBenchmarkEnd(UpdateBenchmark* const benchmark)
+    : benchmark{benchmark} {}
+
+void UpdateBenchmarkEnd::Update() {
+  if (benchmark->GetActive()) benchmark->EndFrame();
+}
+}  // namespace Isetta
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Times the level's Update phase with per-type component buckets, then
+ * with the per-entity loop, for a number of frames each, and logs both
+ * averages. Needs an UpdateBenchmarkEnd updated after every other component in
+ * either mode: its type registered last, on the last entity created
+ *
+ */
+namespace Isetta {
+DEFINE_COMPONENT(UpdateBenchmark, Component, false)
+public:
+explicit UpdateBenchmark(int framesPerRun = 300);
+void OnEnable() override;
+void Update() override;
+/**
+ * @brief Called by UpdateBenchmarkEnd once the rest of the Update phase is done
+ */
+void EndFrame();
+
+private:
+int framesPerRun;
+
+StopWatch stopWatch;
+/// 0 while buckets are measured, 1 for the per-entity loop
+int run = 0;
+int frame = 0;
+float seconds[2]{};
+// setting to put back once done
+int oldBuckets = 1;
+DEFINE_COMPONENT_END(UpdateBenchmark, Component)
+
+DEFINE_COMPONENT(UpdateBenchmarkEnd, Component, false)
+public:
+explicit UpdateBenchmarkEnd(UpdateBenchmark* benchmark);
+void Update() override;
+
+private:
+UpdateBenchmark* benchmark;
+DEFINE_COMPONENT_END(UpdateBenchmarkEnd, Component)
+}  // namespace Isetta
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "UpdateWork.h"
+
+namespace Isetta {
+void UpdateWork::Update() { value = 0.5f * value + 1; }
+
+void FixedUpdateWork::FixedUpdate() { value = 0.5f * value + 1; }
+
+void LateUpdateWork::LateUpdate() { value = 0.5f * value + 1; }
+}  // namespace Isetta
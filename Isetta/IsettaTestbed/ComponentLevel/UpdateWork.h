@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Components with a tiny body in a single update phase each, so the
+ * cost of reaching them dominates the benchmark
+ *
+ */
+namespace Isetta {
+DEFINE_COMPONENT(UpdateWork, Component, false)
+public:
+void Update() override;
+float value = 0;
+DEFINE_COMPONENT_END(UpdateWork, Component)
+
+DEFINE_COMPONENT(FixedUpdateWork, Component, false)
+public:
+void FixedUpdate() override;
+float value = 0;
+DEFINE_COMPONENT_END(FixedUpdateWork, Component)
+
+DEFINE_COMPONENT(LateUpdateWork, Component, false)
+public:
+void LateUpdate() override;
+float value = 0;
+DEFINE_COMPONENT_END(LateUpdateWork, Component)
+
+/**
+ * @brief Overrides no update at all, like most components in a real level
+ *
+ */
+DEFINE_COMPONENT(IdleWork, Component, false)
+DEFINE_COMPONENT_END(IdleWork, Component)
+}  // namespace Isetta
@@ -17,13 +17,9 @@ void GameManager::Start() {
 void GameManager::OnEnable() {
   // create zombie pool
   // This is assuming game manager is only enabled once
-  zombies.reserve(poolSize);
-  for (int i = 0; i < poolSize; i++) {
-    Entity* zombie{Entity::Instantiate(Util::StrFormat("Zombie (%d)", i))};
-    zombie->AddComponent<Zombie, true>();
-    zombie->SetActive(false);
-    zombies.push_back(zombie);
-  }
+  Prefab zombie{"Zombie"};
+  zombie.AddComponent<Zombie, true>().SetActive(false);
+  zombies = Entity::InstantiateBatch(zombie, poolSize);
 }
 
 void GameManager::Update() {
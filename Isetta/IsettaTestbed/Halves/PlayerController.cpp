@@ -20,13 +20,9 @@ void PlayerController::OnEnable() {
   shootAudio->SetProperty(AudioSource::Property::IS_3D, false);
 
   // create the bullet pool
-  bullets.reserve(bulletPoolSize);
-  for (int i = 0; i < bulletPoolSize; i++) {
-    Entity* bullet{Entity::Instantiate(Util::StrFormat("Bullet (%d)", i))};
-    bullet->AddComponent<Bullet>();
-    bullet->SetActive(false);
-    bullets.push_back(bullet);
-  }
+  Prefab bullet{"Bullet"};
+  bullet.AddComponent<Bullet>().SetActive(false);
+  bullets = Entity::InstantiateBatch(bullet, bulletPoolSize);
 }
 
 void PlayerController::Start() {
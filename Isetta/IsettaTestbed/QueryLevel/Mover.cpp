@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "Mover.h"
+
+namespace Isetta {
+Mover::Mover(const Math::Vector3& position, const Math::Vector3& velocity)
+    : position{position}, velocity{velocity} {}
+
+void Mover::Move(const float deltaTime) { position += deltaTime * velocity; }
+}  // namespace Isetta
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+namespace Isetta {
+/**
+ * @brief Plain data moved by the query benchmark, Math::Vector3 isn't
+ * trivially copyable so the fields are spelled out
+ *
+ */
+struct MoverPosition {
+  float x, y, z;
+};
+struct MoverVelocity {
+  float x, y, z;
+};
+
+/**
+ * @brief The same mover as a classic component, living on the heap like every
+ * other component
+ *
+ */
+DEFINE_COMPONENT(Mover, Component, false)
+public:
+Mover(const Math::Vector3& position, const Math::Vector3& velocity);
+void Move(float deltaTime);
+
+Math::Vector3 position;
+Math::Vector3 velocity;
+DEFINE_COMPONENT_END(Mover, Component)
+}  // namespace Isetta
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "MoverBenchmark.h"
+
+namespace Isetta {
+MoverBenchmark::MoverBenchmark(const Array<Mover*>& movers, const int repeats)
+    : movers{movers}, repeats{repeats} {}
+
+void MoverBenchmark::Update() {
+  const float deltaTime = 1.f / 60;
+  StopWatch stopWatch;
+
+  stopWatch.Start();
+  for (int i = 0; i < repeats; ++i) {
+    for (Mover* mover : movers) {
+      mover->Move(deltaTime);
+    }
+  }
+  const float componentAverage = stopWatch.EvaluateInSecond() / repeats;
+
+  const auto move = [deltaTime](MoverPosition& position,
+                                const MoverVelocity& velocity) {
+    position.x += deltaTime * velocity.x;
+    position.y += deltaTime * velocity.y;
+    position.z += deltaTime * velocity.z;
+  };
+  stopWatch.Start();
+  for (int i = 0; i < repeats; ++i) {
+    moveQuery.ForEach(move);
+  }
+  const float queryAverage = stopWatch.EvaluateInSecond() / repeats;
+
+  stopWatch.Start();
+  for (int i = 0; i < repeats; ++i) {
+    moveQuery.ParallelForEach(move);
+  }
+  const float parallelAverage = stopWatch.EvaluateInSecond() / repeats;
+
+  // transforms aren't safe to write from other threads, this stays serial
+  stopWatch.Start();
+  transformQuery.ForEachEntity(
+      [](Entity* entity, const MoverPosition& position) {
+        entity->transform->SetLocalPos(
+            Math::Vector3{position.x, position.y, position.z});
+      });
+  const float transformSeconds = stopWatch.EvaluateInSecond();
+
+  LOG_INFO(Debug::Channel::General,
+           "[Benchmark] Moving %d movers took %.3fms as components, %.3fms "
+           "with a query (%.2fx) and %.3fms with a parallel query (%.2fx). "
+           "Copying positions to transforms took %.3fms",
+           moveQuery.Count(), 1000 * componentAverage, 1000 * queryAverage,
+           componentAverage / queryAverage, 1000 * parallelAverage,
+           componentAverage / parallelAverage, 1000 * transformSeconds);
+  SetActive(false);
+}
+}  // namespace Isetta
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+#include "QueryLevel/Mover.h"
+
+/**
+ * @brief Moves every mover a number of times as components, with a data query
+ * and with a parallel data query, then logs the average time of each. Also
+ * times writing the data back to the movers' transforms
+ *
+ */
+namespace Isetta {
+DEFINE_COMPONENT(MoverBenchmark, Component, false)
+public:
+MoverBenchmark(const Array<Mover*>& movers, int repeats = 20);
+void Update() override;
+
+private:
+Array<Mover*> movers;
+int repeats;
+
+Query<MoverPosition, MoverVelocity> moveQuery;
+Query<MoverPosition> transformQuery;
+DEFINE_COMPONENT_END(MoverBenchmark, Component)
+}  // namespace Isetta
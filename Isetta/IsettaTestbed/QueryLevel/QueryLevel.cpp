@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#include "QueryLevel.h"
+
+#include "Components/Editor/FrameReporter.h"
+
+#include "Custom/EscapeExit.h"
+#include "QueryLevel/Mover.h"
+#include "QueryLevel/MoverBenchmark.h"
+
+namespace Isetta {
+
+void QueryLevel::Load() {
+  Entity* cameraEntity = Entity::Instantiate("Camera");
+  cameraEntity->AddComponent<CameraComponent>();
+  cameraEntity->SetTransform(Math::Vector3{0, 5, 10}, Math::Vector3{-15, 0, 0},
+                             Math::Vector3::one);
+  cameraEntity->AddComponent<EscapeExit>();
+  cameraEntity->AddComponent<FrameReporter>();
+
+  const int moverCount = 100000;
+  auto positions = Math::Random::GetRandomGenerator(-50.f, 50.f);
+  auto velocities = Math::Random::GetRandomGenerator(-1.f, 1.f);
+  Array<Mover*> movers;
+  movers.Reserve(moverCount);
+  for (int i = 0; i < moverCount; ++i) {
+    Entity* entity{Entity::Instantiate(Util::StrFormat("Mover (%d)", i))};
+    const Math::Vector3 position{positions.GetValue(), positions.GetValue(),
+                                 positions.GetValue()};
+    const Math::Vector3 velocity{velocities.GetValue(), velocities.GetValue(),
+                                 velocities.GetValue()};
+    // every mover is both, so both sides of the benchmark do the same work
+    movers.PushBack(entity->AddComponent<Mover>(position, velocity));
+    entity->AddData<MoverPosition>(position.x, position.y, position.z);
+    entity->AddData<MoverVelocity>(velocity.x, velocity.y, velocity.z);
+  }
+
+  benchmark = Entity::Instantiate("Mover Benchmark")
+                  ->AddComponent<MoverBenchmark>(movers);
+
+  // Run the benchmark again
+  Input::RegisterKeyPressCallback(KeyCode::KP_1,
+                                  [&]() { benchmark->SetActive(true); });
+}
+}  // namespace Isetta
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2018 Isetta
+ */
+#pragma once
+
+/**
+ * @brief Level benchmarking data queries against classic components, with
+ * 100000 movers that carry both
+ *
+ */
+namespace Isetta {
+DEFINE_LEVEL(QueryLevel)
+void Load() override;
+
+private:
+class MoverBenchmark* benchmark = nullptr;
+DEFINE_LEVEL_END
+}  // namespace Isetta
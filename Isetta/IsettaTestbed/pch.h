@@ -29,14 +29,18 @@
 
 #include "Scene/Component.h"
 #include "Scene/Entity.h"
+#include "Scene/EntityCommandBuffer.h"
 #include "Scene/IsettaLevel.h"
+#include "Scene/Prefab.h"
 #include "Scene/Primitive.h"
+#include "Scene/Query.h"
 #include "Scene/Transform.h"
 
 #include "Events/Events.h"
 
 #include "Networking/NetworkManager.h"
 #include "Networking/NetworkTransform.h"
+#include "Networking/NetworkPrediction.h"
 #include "Networking/NetworkId.h"
 #include "Networking/NetworkDiscovery.h"
 #include "Networking/Messages.h"